@@ -164,6 +164,8 @@ macro(pism_find_prerequisites)
   find_package (NetCDF REQUIRED)
   find_package (FFTW REQUIRED)
   find_package (HDF5 COMPONENTS C HL)
+  # Used to run serial work on rank 0 in a helper thread (see Proc0Task)
+  find_package (Threads REQUIRED)
 
   # Optional libraries
   if (Pism_USE_PNETCDF)
@@ -178,6 +180,24 @@ macro(pism_find_prerequisites)
     find_package (ParallelIO REQUIRED)
   endif()
 
+  if (Pism_USE_OPENMP)
+    find_package (OpenMP REQUIRED)
+  endif()
+
+  if (Pism_USE_FFTW_MPI)
+    get_filename_component(FFTW_LIB_DIR ${FFTW_LIBRARIES} PATH)
+    find_library (FFTW_MPI_LIBRARIES
+      NAMES fftw3_mpi
+      HINTS ${FFTW_LIB_DIR})
+
+    find_file(FFTW_MPI_H fftw3-mpi.h HINTS ${FFTW_INCLUDES} NO_DEFAULT_PATH)
+
+    if ((NOT FFTW_MPI_LIBRARIES) OR (NOT FFTW_MPI_H))
+      message(FATAL_ERROR
+        "Selected FFTW library (include: ${FFTW_INCLUDES}, lib: ${FFTW_LIBRARIES}) does not include the MPI interface.")
+    endif()
+  endif()
+
   if (Pism_USE_PARALLEL_NETCDF4)
     # Try to find netcdf_par.h. We assume that NetCDF was compiled with
     # parallel I/O if this header is present.
@@ -242,7 +262,8 @@ macro(pism_set_dependencies)
     ${NETCDF_LIBRARIES}
     ${MPI_C_LIBRARIES}
     ${HDF5_LIBRARIES}
-    ${HDF5_HL_LIBRARIES})
+    ${HDF5_HL_LIBRARIES}
+    ${CMAKE_THREAD_LIBS_INIT})
 
   # optional libraries
   if (Pism_USE_JANSSON)
@@ -265,11 +286,20 @@ macro(pism_set_dependencies)
     list (APPEND Pism_EXTERNAL_LIBS ${PNETCDF_LIBRARIES})
   endif()
 
+  if (Pism_USE_FFTW_MPI)
+    list (APPEND Pism_EXTERNAL_LIBS ${FFTW_MPI_LIBRARIES})
+  endif()
+
+  if (Pism_USE_OPENMP)
+    set (CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${OpenMP_C_FLAGS}")
+    set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
+  endif()
+
   # Hide distracting CMake variables
   mark_as_advanced(file_cmd MPI_LIBRARY MPI_EXTRA_LIBRARY
     HDF5_C_LIBRARY_dl HDF5_C_LIBRARY_hdf5 HDF5_C_LIBRARY_hdf5_hl HDF5_C_LIBRARY_m HDF5_C_LIBRARY_z
     CMAKE_OSX_ARCHITECTURES CMAKE_OSX_DEPLOYMENT_TARGET CMAKE_OSX_SYSROOT
-    MAKE_EXECUTABLE HDF5_DIR NETCDF_PAR_H)
+    MAKE_EXECUTABLE HDF5_DIR NETCDF_PAR_H FFTW_MPI_H)
 
 endmacro()
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,10 +17,14 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <cmath>                // std::floor, std::ceil
+#include <algorithm>            // std::upper_bound, std::max
+
 #include "AgeModel.hh"
 
 #include "pism/age/AgeColumnSystem.hh"
 #include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/io/File.hh"
 
@@ -69,6 +73,16 @@ AgeModel::AgeModel(IceGrid::ConstPtr grid, stressbalance::StressBalance *stress_
 
   m_work.set_attrs("internal", "new values of age during time step",
                    "s", "s", "", 0);
+
+  std::string method = m_config->get_string("age.method");
+  if (method == "semi_lagrangian") {
+    m_semi_lagrangian = true;
+  } else if (method == "upwind") {
+    m_semi_lagrangian = false;
+  } else {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid age.method: '%s'", method.c_str());
+  }
 }
 
 /*!
@@ -104,6 +118,9 @@ calculation.  Note that the columnSystemCtx methods coarse_to_fine() and
 fine_to_coarse() interpolate back and forth between this fine grid and
 the storage grid.  The storage grid may or may not be equally-spaced.  See
 AgeColumnSystem::solve() for the actual method.
+
+Alternatively (`age.method = semi_lagrangian`) the age equation is solved using a
+semi-Lagrangian method; see update_semi_lagrangian().
  */
 void AgeModel::update(double t, double dt, const AgeModelInputs &inputs) {
 
@@ -112,6 +129,15 @@ void AgeModel::update(double t, double dt, const AgeModelInputs &inputs) {
 
   inputs.check();
 
+  if (m_semi_lagrangian) {
+    update_semi_lagrangian(dt, inputs);
+  } else {
+    update_upwind(dt, inputs);
+  }
+}
+
+void AgeModel::update_upwind(double dt, const AgeModelInputs &inputs) {
+
   const IceModelVec2S &ice_thickness = *inputs.ice_thickness;
 
   const IceModelVec3
@@ -169,6 +195,180 @@ void AgeModel::update(double t, double dt, const AgeModelInputs &inputs) {
   m_work.update_ghosts(m_ice_age);
 }
 
+//! Linear interpolation of `f` defined on levels `z` (clipped to `[z[0], z[Mz-1]]`).
+static double column_interp(const std::vector<double> &z, const double *f, double height) {
+  const size_t Mz = z.size();
+
+  if (height <= z[0]) {
+    return f[0];
+  }
+  if (height >= z[Mz - 1]) {
+    return f[Mz - 1];
+  }
+
+  const size_t k = (std::upper_bound(z.begin(), z.end(), height) - z.begin()) - 1;
+
+  const double lambda = (height - z[k]) / (z[k + 1] - z[k]);
+
+  return (1.0 - lambda) * f[k] + lambda * f[k + 1];
+}
+
+/*!
+ * Semi-Lagrangian age update.
+ *
+ * Traces each grid point \f$(x_i, y_j, z_k)\f$ in the ice back along the velocity field to
+ * its departure point \f$(x_i - u \Delta t, y_j - v \Delta t, z_k - w \Delta t)\f$ and sets
+ *
+ * \f[ \tau^{n+1}_{ijk} = \tau^{n}(\text{departure point}) + \Delta t, \f]
+ *
+ * using bilinear interpolation in the horizontal and linear interpolation in the
+ * vertical. If the departure point is above the ice surface (below the ice base) the ice
+ * entered through the surface (froze on at the base) during this step, so its age is the
+ * time elapsed since it crossed the boundary.
+ *
+ * This method is unconditionally stable, so it does not restrict the time step. Departure
+ * points have to be within the ghost region of the age field, though, so if the
+ * horizontal displacement exceeds `grid.max_stencil_width - 1` grid cells we split the
+ * step into several sub-steps (without re-computing velocities). This is much cheaper
+ * than shortening the time step of the whole model.
+ */
+void AgeModel::update_semi_lagrangian(double dt, const AgeModelInputs &inputs) {
+
+  const IceModelVec2S &ice_thickness = *inputs.ice_thickness;
+
+  const IceModelVec3
+    &u3 = *inputs.u3,
+    &v3 = *inputs.v3,
+    &w3 = *inputs.w3;
+
+  const std::vector<double> &z = m_grid->z();
+  const unsigned int Mz = m_grid->Mz();
+  const double
+    dx = m_grid->dx(),
+    dy = m_grid->dy();
+
+  // departure points have to be at most (W - 1) grid cells away for bilinear interpolation
+  // to use values in the ghost region only
+  const int W = std::min(m_ice_age.stencil_width(), ice_thickness.stencil_width());
+  if (W < 2) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "the semi-Lagrangian age method requires ice thickness and age"
+                                  " with stencil width of at least 2 (got %d)", W);
+  }
+
+  IceModelVec::AccessList list{&ice_thickness, &u3, &v3, &w3, &m_ice_age, &m_work};
+
+  // compute the number of sub-steps
+  unsigned int N = 1;
+  {
+    double max_displacement = 0.0;
+
+    ParallelSection loop(m_grid->com);
+    try {
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        const unsigned int ks = m_grid->kBelowHeight(ice_thickness(i, j));
+
+        const double
+          *u = u3.get_column(i, j),
+          *v = v3.get_column(i, j);
+
+        for (unsigned int k = 0; k <= ks; ++k) {
+          max_displacement = std::max(max_displacement,
+                                      std::max(fabs(u[k]) * dt / dx, fabs(v[k]) * dt / dy));
+        }
+      }
+    } catch (...) {
+      loop.failed();
+    }
+    loop.check();
+
+    max_displacement = GlobalMax(m_grid->com, max_displacement);
+
+    N = std::max(1, (int)std::ceil(max_displacement / (W - 1)));
+  }
+
+  const double dt_sub = dt / N;
+
+  for (unsigned int n = 0; n < N; ++n) {
+    ParallelSection loop(m_grid->com);
+    try {
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        const double H = ice_thickness(i, j);
+
+        double *result = m_work.get_column(i, j);
+
+        const unsigned int ks = m_grid->kBelowHeight(H);
+
+        if (ks == 0) {
+          // no ice (or very thin ice): set the entire column to zero age
+          m_work.set_column(i, j, 0.0);
+          continue;
+        }
+
+        const double
+          *u = u3.get_column(i, j),
+          *v = v3.get_column(i, j),
+          *w = w3.get_column(i, j);
+
+        for (unsigned int k = 0; k <= ks; ++k) {
+          // departure point in "index space"
+          const double
+            X   = i - u[k] * dt_sub / dx,
+            Y   = j - v[k] * dt_sub / dy,
+            z_d = z[k] - w[k] * dt_sub;
+
+          const int
+            i0 = std::floor(X),
+            j0 = std::floor(Y);
+
+          const double
+            alpha = X - i0,
+            beta  = Y - j0,
+            w00   = (1.0 - alpha) * (1.0 - beta),
+            w10   = alpha * (1.0 - beta),
+            w01   = (1.0 - alpha) * beta,
+            w11   = alpha * beta;
+
+          const double H_d = (w00 * ice_thickness(i0, j0) + w10 * ice_thickness(i0 + 1, j0) +
+                              w01 * ice_thickness(i0, j0 + 1) + w11 * ice_thickness(i0 + 1, j0 + 1));
+
+          if (z_d > H_d) {
+            // entered through the top surface: find the fraction of the step before crossing
+            const double s = (z_d - H_d) / ((z_d - H_d) - (z[k] - H));
+            result[k] = (1.0 - s) * dt_sub;
+          } else if (z_d < 0.0) {
+            // froze on at the base
+            const double s = - z_d / (z[k] - z_d);
+            result[k] = (1.0 - s) * dt_sub;
+          } else {
+            const double age_d =
+              (w00 * column_interp(z, m_ice_age.get_column(i0, j0), z_d) +
+               w10 * column_interp(z, m_ice_age.get_column(i0 + 1, j0), z_d) +
+               w01 * column_interp(z, m_ice_age.get_column(i0, j0 + 1), z_d) +
+               w11 * column_interp(z, m_ice_age.get_column(i0 + 1, j0 + 1), z_d));
+
+            result[k] = age_d + dt_sub;
+          }
+        }
+
+        // age of "ice" above the surface is zero
+        for (unsigned int k = ks + 1; k < Mz; ++k) {
+          result[k] = 0.0;
+        }
+      }
+    } catch (...) {
+      loop.failed();
+    }
+    loop.check();
+
+    m_work.update_ghosts(m_ice_age);
+  }
+}
+
 const IceModelVec3 & AgeModel::age() const {
   return m_ice_age;
 }
@@ -177,6 +377,11 @@ MaxTimestep AgeModel::max_timestep_impl(double t) const {
   // fix a compiler warning
   (void) t;
 
+  if (m_semi_lagrangian) {
+    // the semi-Lagrangian method is unconditionally stable
+    return MaxTimestep("age model");
+  }
+
   if (m_stress_balance == NULL) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
                                   "AgeModel: no stress balance provided."
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -52,12 +52,17 @@ public:
   const IceModelVec3 & age() const;
 protected:
   MaxTimestep max_timestep_impl(double t) const;
+  void update_upwind(double dt, const AgeModelInputs &inputs);
+  void update_semi_lagrangian(double dt, const AgeModelInputs &inputs);
   void define_model_state_impl(const File &output) const;
   void write_model_state_impl(const File &output) const;
 
   IceModelVec3 m_ice_age;
   IceModelVec3 m_work;
   stressbalance::StressBalance *m_stress_balance;
+
+  //! true if the semi-Lagrangian method is used (see `age.method`)
+  bool m_semi_lagrangian;
 };
 
 } // end of namespace pism
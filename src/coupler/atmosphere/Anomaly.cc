@@ -142,22 +142,23 @@ void Anomaly::init_timeseries_impl(const std::vector<double> &ts) const {
 void Anomaly::temp_time_series_impl(int i, int j, std::vector<double> &result) const {
   m_input_model->temp_time_series(i, j, result);
 
-  m_temp_anomaly.reserve(m_ts_times.size());
-  m_air_temp_anomaly->interp(i, j, m_temp_anomaly);
+  // use a local vector to make this method safe to call from thread-parallel loops
+  std::vector<double> temp_anomaly(m_ts_times.size());
+  m_air_temp_anomaly->interp(i, j, temp_anomaly);
 
   for (unsigned int k = 0; k < m_ts_times.size(); ++k) {
-    result[k] += m_temp_anomaly[k];
+    result[k] += temp_anomaly[k];
   }
 }
 
 void Anomaly::precip_time_series_impl(int i, int j, std::vector<double> &result) const {
   m_input_model->precip_time_series(i, j, result);
 
-  m_mass_flux_anomaly.reserve(m_ts_times.size());
-  m_precipitation_anomaly->interp(i, j, m_mass_flux_anomaly);
+  std::vector<double> mass_flux_anomaly(m_ts_times.size());
+  m_precipitation_anomaly->interp(i, j, mass_flux_anomaly);
 
   for (unsigned int k = 0; k < m_ts_times.size(); ++k) {
-    result[k] += m_mass_flux_anomaly[k];
+    result[k] += mass_flux_anomaly[k];
   }
 }
 
@@ -45,8 +45,6 @@ protected:
   void temp_time_series_impl(int i, int j, std::vector<double> &values) const;
   void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
 protected:
-  mutable std::vector<double> m_mass_flux_anomaly, m_temp_anomaly;
-
   IceModelVec2T::Ptr m_air_temp_anomaly;
   IceModelVec2T::Ptr m_precipitation_anomaly;
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -24,18 +24,25 @@
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/Time.hh"
+#include "pism/util/fftw_utilities.hh"
 
 namespace pism {
 namespace atmosphere {
 
 OrographicPrecipitation::OrographicPrecipitation(IceGrid::ConstPtr grid,
                                                  std::shared_ptr<AtmosphereModel> in)
-    : AtmosphereModel(grid, in) {
+    : AtmosphereModel(grid, in),
+      m_task(grid->com) {
 
   m_precipitation = allocate_precipitation(grid);
 
   m_work0 = m_precipitation->allocate_proc0_copy();
 
+  m_asynchronous = m_config->get_flag("atmosphere.orographic_precipitation.asynchronous");
+  if (m_asynchronous) {
+    m_surface0 = m_precipitation->allocate_proc0_copy();
+  }
+
   const int
     Mx = m_grid->Mx(),
     My = m_grid->My(),
@@ -75,27 +82,84 @@ void OrographicPrecipitation::init_impl(const Geometry &geometry) {
                 "A Linear Theory of Orographic Precipitation. J. Atmos. Sci. 61, 1377-1391.";
 
   m_precipitation->metadata().set_string("source", m_reference);
-}
 
+  if (m_asynchronous) {
+    m_log->message(2,
+                   "  Updating the model asynchronously: precipitation lags by one update.\n");
+  }
+
+  // discard the pending asynchronous update, if any
+  m_task.finish();
+}
 
-void OrographicPrecipitation::update_impl(const Geometry &geometry, double t, double dt) {
-  (void)t;
-  (void)dt;
 
-  geometry.ice_surface_elevation.put_on_proc0(*m_work0);
+/*!
+ * Gather surface elevation on rank 0 and copy it to `m_surface_elevation` (used by the
+ * pending asynchronous update).
+ */
+void OrographicPrecipitation::get_surface_elevation(const Geometry &geometry) {
+  geometry.ice_surface_elevation.put_on_proc0(*m_surface0);
 
   ParallelSection rank0(m_grid->com);
   try {
-    if (m_grid->rank() == 0) { // processor zero updates the precipitation
-      m_serial_model->update(*m_work0);
-
-      PetscErrorCode ierr = VecCopy(m_serial_model->precipitation(), *m_work0);
-      PISM_CHK(ierr, "VecCopy");
+    if (m_grid->rank() == 0) {
+      copy_from_vec(*m_surface0, m_surface_elevation);
     }
   } catch (...) {
     rank0.failed();
   }
   rank0.check();
+}
+
+void OrographicPrecipitation::update_impl(const Geometry &geometry, double t, double dt) {
+  (void)t;
+  (void)dt;
+
+  if (m_asynchronous) {
+    // The job runs in a helper thread, so it must not use PETSc: it uses a copy of the
+    // surface elevation in a plain array.
+    auto job = [this]() {
+      m_serial_model->update(m_surface_elevation.data());
+    };
+
+    if (not m_task.pending()) {
+      // There is no pending update (this is the first update after initialization):
+      // compute precipitation using the current surface elevation.
+      get_surface_elevation(geometry);
+      m_task.start(job);
+    }
+
+    // Get results of the pending update...
+    m_task.finish();
+
+    ParallelSection rank0(m_grid->com);
+    try {
+      if (m_grid->rank() == 0) {
+        copy_to_vec(m_serial_model->precipitation(), *m_work0);
+      }
+    } catch (...) {
+      rank0.failed();
+    }
+    rank0.check();
+
+    // ... and start the next one, using the current surface elevation.
+    get_surface_elevation(geometry);
+    m_task.start(job);
+  } else {
+    geometry.ice_surface_elevation.put_on_proc0(*m_work0);
+
+    ParallelSection rank0(m_grid->com);
+    try {
+      if (m_grid->rank() == 0) { // processor zero updates the precipitation
+        m_serial_model->update(*m_work0);
+
+        copy_to_vec(m_serial_model->precipitation(), *m_work0);
+      }
+    } catch (...) {
+      rank0.failed();
+    }
+    rank0.check();
+  }
 
   m_precipitation->get_from_proc0(*m_work0);
 
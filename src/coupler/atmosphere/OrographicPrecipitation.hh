@@ -1,4 +1,4 @@
-// Copyright (C) 2018 PISM Authors
+// Copyright (C) 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -19,7 +19,10 @@
 #ifndef _PAOROGRAPHICPRECIPITATION_H_
 #define _PAOROGRAPHICPRECIPITATION_H_
 
+#include <vector>
+
 #include "pism/coupler/AtmosphereModel.hh"
+#include "pism/util/Proc0Task.hh"
 
 namespace pism {
 
@@ -56,6 +59,22 @@ protected:
 
   //! Serial orographic precipitation model.
   std::unique_ptr<OrographicPrecipitationSerial> m_serial_model;
+
+  //! True if the serial model is updated asynchronously (see
+  //! atmosphere.orographic_precipitation.asynchronous).
+  bool m_asynchronous;
+
+  //! Rank 0 storage for the surface elevation.
+  petsc::Vec::Ptr m_surface0;
+
+  //! Surface elevation used by the pending asynchronous update (rank 0 only).
+  std::vector<double> m_surface_elevation;
+
+  //! Asynchronous update of the serial model. Note: this has to be destroyed before the
+  //! serial model and m_surface_elevation.
+  Proc0Task m_task;
+
+  void get_surface_elevation(const Geometry &geometry);
 };
 
 } // end of namespace atmosphere
@@ -1,4 +1,4 @@
-// Copyright (C) 2018, 2019 Andy Aschwanden and Constantine Khroulev
+// Copyright (C) 2018, 2019, 2020 Andy Aschwanden and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -87,21 +87,22 @@ OrographicPrecipitationSerial::OrographicPrecipitationSerial(const Config &confi
 
   // memory allocation
   {
-    PetscErrorCode ierr = 0;
-
     // precipitation
-    ierr = VecCreateSeq(PETSC_COMM_SELF, m_Mx * m_My, m_precipitation.rawptr());
-    PISM_CHK(ierr, "VecCreateSeq");
+    m_precipitation.resize(m_Mx * m_My, 0.0);
+
+    // Surface elevation and precipitation are real-valued, so we use real-to-complex
+    // transforms and store only the non-redundant half of Fourier coefficients.
+    m_Ny_hat = m_Ny / 2 + 1;
 
     // FFTW arrays
-    m_fftw_input  = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
-    m_fftw_output = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
+    m_fftw_real = (double *)fftw_malloc(sizeof(double) * m_Nx * m_Ny);
+    m_fftw_hat  = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny_hat);
 
     // FFTW plans
-    m_dft_forward = fftw_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
-                                     FFTW_FORWARD, FFTW_ESTIMATE);
-    m_dft_inverse = fftw_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
-                                     FFTW_BACKWARD, FFTW_ESTIMATE);
+    m_dft_forward = fftw_plan_dft_r2c_2d(m_Nx, m_Ny, m_fftw_real, m_fftw_hat,
+                                         FFTW_ESTIMATE);
+    m_dft_inverse = fftw_plan_dft_c2r_2d(m_Nx, m_Ny, m_fftw_hat, m_fftw_real,
+                                         FFTW_ESTIMATE);
 
     // Note: FFTW is weird. If a malloc() call fails it will just call
     // abort() on you without giving you a chance to recover or tell the
@@ -110,125 +111,176 @@ OrographicPrecipitationSerial::OrographicPrecipitationSerial(const Config &confi
     //
     // (Constantine Khroulev, February 1, 2015)
   }
+
+  compute_transfer_function();
 }
 
 OrographicPrecipitationSerial::~OrographicPrecipitationSerial() {
   fftw_destroy_plan(m_dft_forward);
   fftw_destroy_plan(m_dft_inverse);
-  fftw_free(m_fftw_input);
-  fftw_free(m_fftw_output);
+  fftw_free(m_fftw_real);
+  fftw_free(m_fftw_hat);
 }
 
 /*!
  * Return precipitation (FIXME: units?)
  */
-Vec OrographicPrecipitationSerial::precipitation() const {
+const std::vector<double>& OrographicPrecipitationSerial::precipitation() const {
   return m_precipitation;
 }
 
+/*!
+ * Transfer function of the linear orographic precipitation model at the wave number
+ * `(kx, ky)`.
+ *
+ * Solves:
+ * Phat(k,l) = (Cw * i * sigma * Hhat(k,l)) /
+ *             (1 - i * m * Hw) * (1 + i * sigma * tauc) * (1 + i * sigma * tauc);
+ * see equation (49) in
+ * R. B. Smith and I. Barstad, 2004:
+ * A Linear Theory of Orographic Precipitation. J. Atmos. Sci. 61, 1377-1391.
+ */
+std::complex<double> OrographicPrecipitationSerial::transfer_function(double kx,
+                                                                      double ky) const {
+  std::complex<double> I(0.0, 1.0);
+
+  double sigma = m_u * kx + m_v * ky;
+
+  // See equation (6) in [@ref SmithBarstadBonneau2005]
+  std::complex<double> m;
+  {
+    double denominator = sigma * sigma - m_f * m_f;
+
+    // avoid dividing by zero:
+    if (fabs(denominator) < m_eps) {
+      denominator = denominator >= 0 ? m_eps : -m_eps;
+    }
+
+    double m_squared = (m_Nm * m_Nm - sigma * sigma) * (kx * kx + ky * ky) / denominator;
+
+    // Note: this is a *complex* square root.
+    m = std::sqrt(std::complex<double>(m_squared));
+
+    if (m_squared >= 0.0 and sigma != 0.0) {
+      m *= sigma > 0.0 ? 1.0 : -1.0;
+    }
+  }
+
+  // avoid dividing by zero:
+  double delta = 0.0;
+  if (std::abs(1.0 - I * m * m_Hw) < m_eps) {
+    delta = m_eps;
+  }
+
+  // See equation (49) in [@ref SmithBarstad2004] or equation (3) in [@ref
+  // SmithBarstadBonneau2005].
+  return (m_Cw * I * sigma /
+          ((1.0 - I * m * m_Hw + delta) *
+           (1.0 + I * sigma * m_tau_c) *
+           (1.0 + I * sigma * m_tau_f)));
+  // Note: sigma, m_tau_c, and m_tau_f are purely real, so the second and the third
+  // factors in the denominator are never zero.
+  //
+  // The first factor (1 - i m H_w) *could* be zero. Here we check if it is and
+  // "regularize" if necessary.
+}
+
+/*!
+ * Pre-compute the transfer function at all wave numbers used by real-to-complex
+ * transforms.
+ *
+ * Model parameters are constant during a run, so this is done once. This method has to
+ * be called again if any of them change.
+ *
+ * We store the Hermitian part `(T(k) + conj(T(-k))) / 2` of the transfer function `T`.
+ * Because the Fourier transform of surface elevation is Hermitian, multiplying by it
+ * produces the same precipitation as taking the real part of the inverse transform of
+ * the product with `T` itself. Usually `T` is already Hermitian; the two differ only at
+ * the Nyquist frequency of an even-sized grid (where `k` and `-k` correspond to the same
+ * Fourier coefficient).
+ */
+void OrographicPrecipitationSerial::compute_transfer_function() {
+  m_transfer_function.resize(m_Nx * m_Ny_hat);
+
+  for (int i = 0; i < m_Nx; i++) {
+    // index corresponding to -kx
+    const int i_neg = (m_Nx - i) % m_Nx;
+
+    for (int j = 0; j < m_Ny_hat; j++) {
+      // index corresponding to -ky
+      const int j_neg = (m_Ny - j) % m_Ny;
+
+      auto T     = transfer_function(m_kx[i], m_ky[j]);
+      auto T_neg = transfer_function(m_kx[i_neg], m_ky[j_neg]);
+
+      m_transfer_function[i * m_Ny_hat + j] = 0.5 * (T + std::conj(T_neg));
+    }
+  }
+}
+
 /*!
  * Update precipitation.
  *
  * @param[in] surface_elevation surface on the physical (Mx*My) grid
  */
 void OrographicPrecipitationSerial::update(Vec surface_elevation) {
-  // solves:
-  // Phat(k,l) = (Cw * i * sigma * Hhat(k,l)) /
-  //             (1 - i * m * Hw) * (1 + i * sigma * tauc) * (1 + i * sigma * tauc);
-  // see equation (49) in
-  // R. B. Smith and I. Barstad, 2004:
-  // A Linear Theory of Orographic Precipitation. J. Atmos. Sci. 61, 1377-1391.
+  petsc::VecArray h(surface_elevation);
+  update(h.get());
+}
 
-  std::complex<double> I(0.0, 1.0);
+/*!
+ * Update precipitation.
+ *
+ * Same as above, but `surface_elevation` is an array of size `Mx*My` (`i` varies
+ * fastest). Does not use PETSc.
+ */
+void OrographicPrecipitationSerial::update(const double *surface_elevation) {
 
   // Compute fft2(surface_elevation)
   {
-    clear_fftw_array(m_fftw_input, m_Nx, m_Ny);
-    set_real_part(surface_elevation,
-                  1.0,
-                  m_Mx, m_My,
-                  m_Nx, m_Ny,
-                  m_i0_offset, m_j0_offset,
-                  m_fftw_input);
+    for (int k = 0; k < m_Nx * m_Ny; ++k) {
+      m_fftw_real[k] = 0.0;
+    }
+
+    for (int i = 0; i < m_Mx; i++) {
+      double *row = m_fftw_real + (m_i0_offset + i) * m_Ny + m_j0_offset;
+      for (int j = 0; j < m_My; j++) {
+        row[j] = surface_elevation[j * m_Mx + i];
+      }
+    }
+
     fftw_execute(m_dft_forward);
   }
 
+  // Multiply by the (pre-computed) transfer function
   {
-    FFTWArray
-      fftw_output(m_fftw_output, m_Nx, m_Ny),
-      fftw_input(m_fftw_input, m_Nx, m_Ny);
-
-    for (int i = 0; i < m_Nx; i++) {
-      const double kx = m_kx[i];
-      for (int j = 0; j < m_Ny; j++) {
-        const double ky = m_ky[j];
-
-        const auto &h_hat = fftw_output(i, j);
-
-        double sigma = m_u * kx + m_v * ky;
-
-        // See equation (6) in [@ref SmithBarstadBonneau2005]
-        std::complex<double> m;
-        {
-          double denominator = sigma * sigma - m_f * m_f;
-
-          // avoid dividing by zero:
-          if (fabs(denominator) < m_eps) {
-            denominator = denominator >= 0 ? m_eps : -m_eps;
-          }
-
-          double m_squared = (m_Nm * m_Nm - sigma * sigma) * (kx * kx + ky * ky) / denominator;
-
-          // Note: this is a *complex* square root.
-          m = std::sqrt(std::complex<double>(m_squared));
-
-          if (m_squared >= 0.0 and sigma != 0.0) {
-            m *= sigma > 0.0 ? 1.0 : -1.0;
-          }
-        }
-
-        // avoid dividing by zero:
-        double delta = 0.0;
-        if (std::abs(1.0 - I * m * m_Hw) < m_eps) {
-          delta = m_eps;
-        }
-
-        // See equation (49) in [@ref SmithBarstad2004] or equation (3) in [@ref
-        // SmithBarstadBonneau2005].
-        auto P_hat = h_hat * (m_Cw * I * sigma /
-                              ((1.0 - I * m * m_Hw + delta) *
-                               (1.0 + I * sigma * m_tau_c) *
-                               (1.0 + I * sigma * m_tau_f)));
-        // Note: sigma, m_tau_c, and m_tau_f are purely real, so the second and the third
-        // factors in the denominator are never zero.
-        //
-        // The first factor (1 - i m H_w) *could* be zero. Here we check if it is and
-        // "regularize" if necessary.
-
-        fftw_input(i, j) = P_hat;
-      }
+    auto *P_hat = reinterpret_cast<std::complex<double>*>(m_fftw_hat);
+
+    const int N = m_Nx * m_Ny_hat;
+    for (int k = 0; k < N; ++k) {
+      P_hat[k] *= m_transfer_function[k];
     }
   }
 
+  // Note: this overwrites m_fftw_hat.
   fftw_execute(m_dft_inverse);
 
-  // get m_fftw_output and put it into m_p
-  get_real_part(m_fftw_output,
-                1.0 / (m_Nx * m_Ny),
-                m_Mx, m_My,
-                m_Nx, m_Ny,
-                m_i0_offset, m_j0_offset,
-                m_precipitation);
+  // get m_fftw_real and put it into m_precipitation
+  const double normalization = 1.0 / (m_Nx * m_Ny);
 
-  petsc::VecArray2D p(m_precipitation, m_Mx, m_My);
   for (int i = 0; i < m_Mx; i++) {
+    const double *row = m_fftw_real + (m_i0_offset + i) * m_Ny + m_j0_offset;
     for (int j = 0; j < m_My; j++) {
-      p(i, j) += m_background_precip_pre;
+      double &P = m_precipitation[j * m_Mx + i];
+
+      P = row[j] * normalization;
+
+      P += m_background_precip_pre;
       if (m_truncate) {
-        p(i, j) = std::max(p(i, j), 0.0);
+        P = std::max(P, 0.0);
       }
-      p(i, j) *= m_precip_scale_factor;
-      p(i, j) += m_background_precip_post;
+      P *= m_precip_scale_factor;
+      P += m_background_precip_post;
     }
   }
 }
@@ -1,4 +1,4 @@
-// Copyright (C) 2018 Constantine Khroulev and Andy Aschwanden
+// Copyright (C) 2018, 2020 Constantine Khroulev and Andy Aschwanden
 //
 // This file is part of PISM.
 //
@@ -20,10 +20,10 @@
 #define OROGRAPHICPRECIPITATIONSERIAL_H
 
 #include <vector>
+#include <complex>
 
 #include <fftw3.h>
 #include <petscvec.h>
-#include <vector>
 
 #include "pism/util/petscwrappers/Vec.hh"
 
@@ -43,11 +43,16 @@ public:
                                 int Nx, int Ny);
   ~OrographicPrecipitationSerial();
 
-  Vec precipitation() const;
+  const std::vector<double>& precipitation() const;
 
   void update(Vec surface_elevation);
 
+  void update(const double *surface_elevation);
+
 private:
+  std::complex<double> transfer_function(double kx, double ky) const;
+  void compute_transfer_function();
+
   // regularization
   double m_eps;
 
@@ -100,11 +105,22 @@ private:
 
   std::vector<double> m_kx, m_ky;
 
-  // orographic precipitation
-  petsc::Vec m_precipitation;
+  //! orographic precipitation, size `Mx*My` (this model does not use PETSc in update(), so
+  //! it can be run in a thread other than the main one)
+  std::vector<double> m_precipitation;
+
+  //! number of Fourier coefficients in the Y direction stored by real-to-complex
+  //! transforms
+  int m_Ny_hat;
+
+  //! transfer function (the ratio of the Fourier transforms of precipitation and surface
+  //! elevation), size `Nx*(Ny/2 + 1)`
+  std::vector<std::complex<double> > m_transfer_function;
 
-  fftw_complex *m_fftw_input;
-  fftw_complex *m_fftw_output;
+  //! real-valued input of the forward (and output of the inverse) transform, size `Nx*Ny`
+  double *m_fftw_real;
+  //! Fourier coefficients, size `Nx*(Ny/2 + 1)`
+  fftw_complex *m_fftw_hat;
 
   fftw_plan m_dft_forward;
   fftw_plan m_dft_inverse;
@@ -1,4 +1,4 @@
-/* Copyright (C) 2018, 2019 PISM Authors
+/* Copyright (C) 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -18,9 +18,12 @@
  */
 
 #include <algorithm> // max_element
+#include <queue>
+#include <vector>
+#include <functional>   // std::greater
 
 #include "PicoGeometry.hh"
-#include "pism/util/connected_components.hh"
+#include "pism/util/label_components.hh"
 #include "pism/util/IceModelVec2CellType.hh"
 #include "pism/util/pism_utilities.hh"
 
@@ -37,7 +40,9 @@ PicoGeometry::PicoGeometry(IceGrid::ConstPtr grid)
       m_ocean_mask(grid, "pico_ocean_mask", WITH_GHOSTS),
       m_lake_mask(grid, "pico_lake_mask", WITHOUT_GHOSTS),
       m_ice_rises(grid, "pico_ice_rise_mask", WITH_GHOSTS),
-      m_tmp(grid, "temporary_storage", WITHOUT_GHOSTS) {
+      m_tmp(grid, "temporary_storage", WITHOUT_GHOSTS),
+      m_cell_type(grid, "pico_cell_type", WITHOUT_GHOSTS),
+      m_cell_type_valid(false) {
 
   m_boxes.metadata().set_number("_FillValue", 0.0);
 
@@ -46,7 +51,6 @@ PicoGeometry::PicoGeometry(IceGrid::ConstPtr grid)
   m_ice_rises.metadata().set_string("flag_meanings",
                                      "ocean ice_rise continental_ice_sheet, floating_ice");
 
-  m_tmp_p0 = m_tmp.allocate_proc0_copy();
 }
 
 PicoGeometry::~PicoGeometry() {
@@ -82,40 +86,65 @@ void PicoGeometry::update(const IceModelVec2S &bed_elevation, const IceModelVec2
 
   double continental_shelf_depth = m_config->get_number("ocean.pico.continental_shelf_depth");
 
-  // these three could be done at the same time
-  {
-    compute_ice_rises(cell_type, exclude_ice_rises, m_ice_rises);
+  // All masks except for the continental shelf mask depend on the cell type only, so we
+  // re-compute them only if it changed since the last call.
+  if (cell_type_changed(cell_type)) {
+    // these three could be done at the same time
+    {
+      compute_ice_rises(cell_type, exclude_ice_rises, m_ice_rises);
 
-    compute_ocean_mask(cell_type, m_ocean_mask);
+      compute_ocean_mask(cell_type, m_ocean_mask);
 
-    compute_lakes(cell_type, m_lake_mask);
-  }
+      compute_lakes(cell_type, m_lake_mask);
+    }
 
-  // these two could be optimized by trying to reduce the number of times we update ghosts
-  {
-    m_ice_rises.update_ghosts();
-    m_ocean_mask.update_ghosts();
+    {
+      m_ice_rises.update_ghosts();
+      m_ocean_mask.update_ghosts();
 
-    compute_distances_gl(m_ocean_mask, m_ice_rises, exclude_ice_rises, m_distance_gl);
+      compute_distances_gl(m_ocean_mask, m_ice_rises, exclude_ice_rises, m_distance_gl);
 
-    compute_distances_cf(m_ocean_mask, m_ice_rises, exclude_ice_rises, m_distance_cf);
-  }
+      compute_distances_cf(m_ocean_mask, m_ice_rises, exclude_ice_rises, m_distance_cf);
+    }
 
-  // these two could be done at the same time
-  {
     compute_ice_shelf_mask(m_ice_rises, m_lake_mask, m_ice_shelves);
 
-    compute_continental_shelf_mask(bed_elevation, m_ice_rises, continental_shelf_depth, m_continental_shelf);
+    compute_box_mask(m_distance_gl, m_distance_cf, m_ice_shelves, n_boxes, m_boxes);
   }
 
-  compute_box_mask(m_distance_gl, m_distance_cf, m_ice_shelves, n_boxes, m_boxes);
+  compute_continental_shelf_mask(bed_elevation, m_ice_rises, continental_shelf_depth, m_continental_shelf);
+}
+
+/*!
+ * Return true if `cell_type` differs from the one used during the last call and save a
+ * copy.
+ *
+ * Uses an exact comparison: IceModelVec2CellType is modified point-wise, so its state
+ * counter does not reflect all changes.
+ */
+bool PicoGeometry::cell_type_changed(const IceModelVec2CellType &cell_type) {
+  IceModelVec::AccessList list{&cell_type, &m_cell_type};
+
+  double changed = m_cell_type_valid ? 0.0 : 1.0;
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (cell_type.as_int(i, j) != m_cell_type.as_int(i, j)) {
+      changed = 1.0;
+      m_cell_type(i, j) = cell_type(i, j);
+    }
+  }
+
+  m_cell_type_valid = true;
+
+  return GlobalMax(m_grid->com, changed) > 0.0;
 }
 
 
 enum RelabelingType {BY_AREA, AREA_THRESHOLD};
 
 /*!
- * Re-label components in a mask processed by label_connected_components.
+ * Re-label components in a mask processed by label_components().
  *
  * If type is `BY_AREA`, the biggest one gets the value of 2, all the other ones 1, the
  * background is set to zero.
@@ -207,23 +236,10 @@ static void relabel(RelabelingType type,
 }
 
 /*!
- * Run the serial connected-component labeling algorithm on m_tmp.
+ * Run the connected-component labeling algorithm on m_tmp.
  */
 void PicoGeometry::label_tmp() {
-  m_tmp.put_on_proc0(*m_tmp_p0);
-
-  ParallelSection rank0(m_grid->com);
-  try {
-    if (m_grid->rank() == 0) {
-      petsc::VecArray mask_p0(*m_tmp_p0);
-      label_connected_components(mask_p0.get(), m_grid->My(), m_grid->Mx(), false, 0.0);
-    }
-  } catch (...) {
-    rank0.failed();
-  }
-  rank0.check();
-
-  m_tmp.get_from_proc0(*m_tmp_p0);
+  label_components(m_tmp, false, 0.0);
 }
 
 static bool edge_p(int i, int j, int Mx, int My) {
@@ -264,22 +280,7 @@ void PicoGeometry::compute_lakes(const IceModelVec2CellType &cell_type, IceModel
   }
 
   // identify "floating" areas that are not connected to the open ocean as defined above
-  {
-    m_tmp.put_on_proc0(*m_tmp_p0);
-
-    ParallelSection rank0(m_grid->com);
-    try {
-      if (m_grid->rank() == 0) {
-        petsc::VecArray mask_p0(*m_tmp_p0);
-        label_connected_components(mask_p0.get(), My, Mx, true, 2.0);
-      }
-    } catch (...) {
-      rank0.failed();
-    }
-    rank0.check();
-
-    m_tmp.get_from_proc0(*m_tmp_p0);
-  }
+  label_components(m_tmp, true, 2.0);
 
   result.copy_from(m_tmp);
 }
@@ -360,22 +361,7 @@ void PicoGeometry::compute_continental_shelf_mask(const IceModelVec2S &bed_eleva
 
   // use "iceberg identification" to label parts *not* connected to the continental ice
   // sheet
-  {
-    m_tmp.put_on_proc0(*m_tmp_p0);
-
-    ParallelSection rank0(m_grid->com);
-    try {
-      if (m_grid->rank() == 0) {
-        petsc::VecArray mask_p0(*m_tmp_p0);
-        label_connected_components(mask_p0.get(), m_grid->My(), m_grid->Mx(), true, 2.0);
-      }
-    } catch (...) {
-      rank0.failed();
-    }
-    rank0.check();
-
-    m_tmp.get_from_proc0(*m_tmp_p0);
-  }
+  label_components(m_tmp, true, 2.0);
 
   // At this point areas with bed > threshold are 1, everything else is zero.
   //
@@ -572,9 +558,18 @@ void PicoGeometry::compute_distances_cf(const IceModelVec2Int &ocean_mask,
  * generic ice shelf locations with zeros, set neighbors of the grounding line to 1, and
  * the rest of the grid with -1 or some other negative number.
  *
- * Note that this implementation updates ghosts *every* iteration. We could speed this
- * up by checking if a point at a boundary of the processor sub-domain was updated and
- * update ghosts in those cases only.
+ * Each domain cell gets the value `1 + d`, where `d` is the length of the shortest path
+ * (in the 4-neighborhood, through domain cells) to the wave front. Cells that cannot be
+ * reached from the wave front are left unchanged (zero).
+ *
+ * Each process computes distances in its sub-domain using Dijkstra's algorithm, taking
+ * values in ghost cells into account, and then exchanges ghosts. After an exchange only
+ * ghost cells that changed are used to seed the next local pass. The number of
+ * communication rounds is bounded by the number of times a shortest path crosses a
+ * sub-domain boundary (plus one) and does not depend on the size of the domain in grid
+ * cells.
+ *
+ * Ghosts of `mask` have to be up to date.
  */
 void eikonal_equation(IceModelVec2Int &mask) {
 
@@ -582,34 +577,98 @@ void eikonal_equation(IceModelVec2Int &mask) {
 
   IceGrid::ConstPtr grid = mask.grid();
 
-  double current_label = 1;
-  double continue_loop = 1;
-  while (continue_loop != 0) {
+  // local sub-domain, including one layer of ghost cells
+  const int
+    xs = grid->xs() - 1,
+    ys = grid->ys() - 1,
+    xm = grid->xm() + 2,
+    ym = grid->ym() + 2;
 
-    continue_loop = 0;
+  auto index = [xs, ys, xm](int i, int j) {
+    return (j - ys) * xm + (i - xs);
+  };
 
-    for (Points p(*grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  auto owned = [xm, ym](int n) {
+    const int i = n % xm, j = n / xm;
+    return i > 0 and i < xm - 1 and j > 0 and j < ym - 1;
+  };
+
+  IceModelVec::AccessList list{&mask};
+
+  std::vector<int> D(xm * ym);
+  for (PointsWithGhosts p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+    D[index(i, j)] = mask.as_int(i, j);
+  }
+
+  // queue of (distance, index) pairs, closest first
+  typedef std::pair<int, int> Item;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item> > queue;
+
+  // seed the first pass using all cells with known distances
+  for (int n = 0; n < xm * ym; ++n) {
+    if (D[n] > 0) {
+      queue.push({D[n], n});
+    }
+  }
 
-      if (mask.as_int(i, j) == 0) {
+  while (true) {
+    bool changed = false;
 
-        auto R = mask.int_star(i, j);
+    // propagate distances in the local sub-domain
+    while (not queue.empty()) {
+      const Item item = queue.top();
+      queue.pop();
 
-        if (R.ij == 0 and
-            (R.n == current_label or R.s == current_label or
-             R.e == current_label or R.w == current_label)) {
-          // i.e. this is an shelf cell with no distance assigned yet and with a neighbor
-          // that has a distance assigned
-          mask(i, j) = current_label + 1;
-          continue_loop = 1;
+      const int d = item.first, n = item.second;
+
+      if (D[n] != d) {
+        // this entry is stale: D[n] was reduced after it was added to the queue
+        continue;
+      }
+
+      const int neighbors[] = {n + 1, n - 1, n + xm, n - xm};
+      for (int k : neighbors) {
+        if (k < 0 or k >= xm * ym or not owned(k)) {
+          continue;
+        }
+
+        // D[k] == 0 means "not reached yet"; negative values are outside the domain
+        if (D[k] == 0 or D[k] > d + 1) {
+          D[k] = d + 1;
+          queue.push({D[k], k});
+          changed = true;
         }
       }
-    } // loop over grid points
+    }
+
+    if (GlobalMax(grid->com, changed ? 1.0 : 0.0) == 0.0) {
+      break;
+    }
+
+    if (changed) {
+      for (Points p(*grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+        mask(i, j) = D[index(i, j)];
+      }
+    }
 
-    current_label++;
     mask.update_ghosts();
 
-    continue_loop = GlobalMax(grid->com, continue_loop);
+    // seed the next pass using ghost cells that changed
+    for (PointsWithGhosts p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j(), n = index(i, j);
+
+      if (owned(n)) {
+        continue;
+      }
+
+      const int value = mask.as_int(i, j);
+      if (value != D[n]) {
+        D[n] = value;
+        queue.push({value, n});
+      }
+    }
   }
 }
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2018 PISM Authors
+/* Copyright (C) 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -65,6 +65,8 @@ private:
   void compute_box_mask(const IceModelVec2Int &D_gl, const IceModelVec2Int &D_cf, const IceModelVec2Int &shelf_mask,
                         int n_boxes, IceModelVec2Int &result);
 
+  bool cell_type_changed(const IceModelVec2CellType &cell_type);
+
   void label_tmp();
   void relabel_by_size(IceModelVec2Int &mask);
 
@@ -82,7 +84,10 @@ private:
 
   // temporary storage
   IceModelVec2Int m_tmp;
-  petsc::Vec::Ptr m_tmp_p0;
+
+  // copy of the cell type mask used during the last update
+  IceModelVec2Int m_cell_type;
+  bool m_cell_type_valid;
 };
 
 } // end of namespace ocean
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -32,6 +32,7 @@
 #include "pism/util/error_handling.hh"
 #include "pism/util/io/io_helpers.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/threading.hh"
 #include "pism/util/IceModelVec2CellType.hh"
 #include "pism/geometry/Geometry.hh"
 #include <iostream>
@@ -441,8 +442,7 @@ void TemperatureIndexITM::update_impl(const Geometry &geometry, double t, double
   int N = m_mbscheme->get_timeseries_length(dt);
 
   const double dtseries = dt / N;
-  std::vector<double> ts(N), T(N), S(N), P(N), Alb(N);
-  LocalMassBalanceITM::Melt  ETIM_melt;
+  std::vector<double> ts(N);
   for (int k = 0; k < N; ++k) {
     ts[k] = t + k * dtseries;
   }
@@ -481,6 +481,8 @@ void TemperatureIndexITM::update_impl(const Geometry &geometry, double t, double
 
   const bool force_albedo = m_config->get_flag("surface.itm.anomaly"); 
 
+  const double anomaly_value = m_config->get_number("surface.itm.anomaly_value");
+
 
   m_atmosphere->init_timeseries(ts);
   m_atmosphere->begin_pointwise_access();
@@ -490,13 +492,54 @@ void TemperatureIndexITM::update_impl(const Geometry &geometry, double t, double
   // use different calculations of solar radiation in dependence of the "paleo" flag
   bool paleo = m_config->get_flag("surface.itm.paleo.enabled");
 
+  // Quantities below depend on time only. Compute them once instead of doing it at each
+  // grid point. (This also makes the loop over grid points safe to run using threads.)
+  std::vector<double> delta(N), distance2(N);
+  std::vector<bool> snow_depth_reset(N, false), albedo_anomaly(N, false);
+  {
+    double next_snow_depth_reset = m_next_balance_year_start;
+    for (int k = 0; k < N; ++k) {
+      if (ts[k] >= next_snow_depth_reset) {
+        snow_depth_reset[k] = true;
+        while (next_snow_depth_reset <= ts[k]) {
+          next_snow_depth_reset = m_grid->ctx()->time()->increment_date(next_snow_depth_reset, 1);
+        }
+      }
 
+      if (force_albedo) {
+        albedo_anomaly[k] = albedo_anomaly_true(ts[k], 0);
+      }
+
+      if (paleo) {
+        delta[k]     = get_delta_paleo(ts[k]);
+        distance2[k] = get_distance2_paleo(ts[k]);
+      } else {
+        delta[k]     = get_delta(ts[k]);
+        distance2[k] = get_distance2(ts[k]);
+      }
+    }
+  }
+
+  // per-thread storage for time series at a grid point
+  struct Work {
+    Work(int size)
+      : T(size), S(size), P(size), Alb(size) {
+      // empty
+    }
+    std::vector<double> T, S, P, Alb;
+  };
+  PerThread<Work> work(N);
 
   ParallelSection loop(m_grid->com);
   try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+    parallel_for(*m_grid, [&](int i, int j) {
+      std::vector<double>
+        &T   = work.get().T,
+        &S   = work.get().S,
+        &P   = work.get().P,
+        &Alb = work.get().Alb;
 
+      LocalMassBalanceITM::Melt  ETIM_melt;
 
       // the temperature time series from the AtmosphereModel and its modifiers
       m_atmosphere->temp_time_series(i, j, T);
@@ -564,9 +607,6 @@ void TemperatureIndexITM::update_impl(const Geometry &geometry, double t, double
       // Use degree-day factors, the number of PDDs, and the snow precipitation to get surface mass
       // balance (and diagnostics: accumulation, melt, runoff)
       {
-        double next_snow_depth_reset = m_next_balance_year_start;
-
-
         // make copies of firn and snow depth values at this point to avoid accessing 2D
         // fields in the inner loop
         double
@@ -595,11 +635,8 @@ void TemperatureIndexITM::update_impl(const Geometry &geometry, double t, double
 
         for (int k = 0; k < N; ++k) {
 
-          if (ts[k] >= next_snow_depth_reset) {
+          if (snow_depth_reset[k]) {
             snow = 0.0;
-            while (next_snow_depth_reset <= ts[k]) {
-              next_snow_depth_reset = m_grid->ctx()->time()->increment_date(next_snow_depth_reset, 1);
-            }
           }
 
 
@@ -608,26 +645,14 @@ void TemperatureIndexITM::update_impl(const Geometry &geometry, double t, double
 
           LocalMassBalanceITM::Changes changes;
      
-          if (force_albedo){
-
-            if (albedo_anomaly_true(ts[k],0)){
-              albedo_loc = m_config->get_number("surface.itm.anomaly_value");
-            }
+          if (albedo_anomaly[k]) {
+            albedo_loc = anomaly_value;
           }
 
           if (m_albedo_input_set) albedo_loc = Alb[k];
           
-          double 
-            delta =  get_delta(ts[k]),
-            distance2 = get_distance2(ts[k]); 
-          if (paleo){
-            delta = get_delta_paleo(ts[k]);
-            distance2 = get_distance2_paleo(ts[k]);
-          }  
-              
-            
           ETIM_melt = m_mbscheme->calculate_ETIM_melt(dtseries, S[k], T[k], surfelev,
-                                         delta, distance2,
+                                         delta[k], distance2[k],
                                          lat * M_PI / 180.,
                                          albedo_loc);
           
@@ -648,10 +673,8 @@ void TemperatureIndexITM::update_impl(const Geometry &geometry, double t, double
             albedo_loc = m_mbscheme->get_albedo_melt(changes.melt,  mask(i, j), dtseries);
           }
 
-          if (force_albedo){
-            if (albedo_anomaly_true(ts[k],0)){
-              albedo_loc = m_config->get_number("surface.itm.anomaly_value");
-            }
+          if (albedo_anomaly[k]) {
+            albedo_loc = anomaly_value;
           }
 
           
@@ -713,7 +736,7 @@ void TemperatureIndexITM::update_impl(const Geometry &geometry, double t, double
         m_firn_depth(i, j) = 0.0;  // no firn in the ocean
         m_snow_depth(i, j) = 0.0;  // snow over the ocean does not stick
       }
-    }
+    });
   } catch (...) {
     loop.failed();
   }
@@ -68,7 +68,24 @@ ITMMassBalance::ITMMassBalance(Config::ConstPtr config, units::System::Ptr syste
   Tmax               = m_config->get_number("surface.pdd.air_temp_all_precip_as_rain");
   refreeze_ice_melt  = m_config->get_flag("surface.pdd.refreeze_ice_melt");
   pdd_threshold_temp = m_config->get_number("surface.pdd.positive_threshold_temp");
-  
+
+  m_ice_density             = m_config->get_number("constants.ice.density");
+  m_water_density           = m_config->get_number("constants.fresh_water.density");
+  m_latent_heat_of_fusion   = m_config->get_number("constants.fresh_water.latent_heat_of_fusion");
+  m_albedo_snow             = m_config->get_number("surface.itm.albedo_snow");
+  m_albedo_land             = m_config->get_number("surface.itm.albedo_land");
+  m_albedo_ocean            = m_config->get_number("surface.itm.albedo_ocean");
+  m_albedo_slope            = m_config->get_number("surface.itm.albedo_slope");
+  m_albedo_ice              = m_config->get_number("surface.itm.albedo_ice");
+  m_tau_a_slope             = m_config->get_number("surface.itm.tau_a_slope");
+  m_tau_a_intercept         = m_config->get_number("surface.itm.tau_a_intercept");
+  m_itm_c                   = m_config->get_number("surface.itm.itm_c");
+  m_itm_lambda              = m_config->get_number("surface.itm.itm_lambda");
+  m_background_melting_temp = m_config->get_number("surface.itm.background_melting_temp");
+  m_solar_constant          = m_config->get_number("surface.itm.solar_constant");
+  m_phi                     = m_config->get_number("surface.itm.phi") * M_PI / 180.;
+  m_air_temp_all_refreeze   = m_config->get_number("surface.itm.air_temp_all_refreeze");
+  m_air_temp_no_refreeze    = m_config->get_number("surface.itm.air_temp_no_refreeze");
 
   m_method = "insolation temperature melt";
 }
@@ -98,15 +115,15 @@ double ITMMassBalance::CalovGreveIntegrand(double sigma, double TacC) {
 
 
 double ITMMassBalance::get_albedo_melt(double melt, int mask_value, double dtseries){
-  const double ice_density = m_config->get_number("constants.ice.density");
-  double albedo =  m_config->get_number("surface.itm.albedo_snow");
-  const double albedo_land = m_config->get_number("surface.itm.albedo_land");
-  const double albedo_ocean = m_config->get_number("surface.itm.albedo_ocean");
+  const double ice_density = m_ice_density;
+  double albedo =  m_albedo_snow;
+  const double albedo_land = m_albedo_land;
+  const double albedo_ocean = m_albedo_ocean;
   // melt has a unit of meters ice equivalent
   // dtseries has a unit of seconds
-  const double albedo_intercept = m_config->get_number("surface.itm.albedo_snow");
-  const double albedo_slope = m_config->get_number("surface.itm.albedo_slope");
-  const double albedo_ice = m_config->get_number("surface.itm.albedo_ice");
+  const double albedo_intercept = m_albedo_snow;
+  const double albedo_slope = m_albedo_slope;
+  const double albedo_ice = m_albedo_ice;
 
   if (mask_value == 4){ // mask value for ice free ocean
       albedo = albedo_ocean;
@@ -125,9 +142,7 @@ double ITMMassBalance::get_albedo_melt(double melt, int mask_value, double dtser
 
 
 double ITMMassBalance::get_tau_a(double surface_elevation){
-   const double tau_a_slope = m_config->get_number("surface.itm.tau_a_slope");
-   const double tau_a_intercept = m_config->get_number("surface.itm.tau_a_intercept");
-   return tau_a_intercept +  tau_a_slope * surface_elevation;  // transmissivity of the atmosphere, linear fit
+   return m_tau_a_intercept +  m_tau_a_slope * surface_elevation;  // transmissivity of the atmosphere, linear fit
  }
 
 
@@ -191,15 +206,15 @@ ITMMassBalance::Melt ITMMassBalance::calculate_ETIM_melt(double dt_series,
 
   Melt ETIM_melt;
 
-  const double rho_w = m_config->get_number("constants.fresh_water.density");    // mass density of water
-  const double L_m = m_config->get_number("constants.fresh_water.latent_heat_of_fusion");      // latent heat of ice melting
+  const double rho_w = m_water_density;    // mass density of water
+  const double L_m = m_latent_heat_of_fusion;      // latent heat of ice melting
   const double tau_a = get_tau_a(surface_elevation);
-  const double itm_c = m_config->get_number("surface.itm.itm_c");
-  const double itm_lambda = m_config->get_number("surface.itm.itm_lambda");
-  const double bm_temp    = m_config->get_number("surface.itm.background_melting_temp"); // do not allow melting below this temp
-  const double solar_constant = m_config->get_number("surface.itm.solar_constant");
+  const double itm_c = m_itm_c;
+  const double itm_lambda = m_itm_lambda;
+  const double bm_temp    = m_background_melting_temp; // do not allow melting below this temp
+  const double solar_constant = m_solar_constant;
 
-  const double phi = m_config->get_number("surface.itm.phi") * M_PI / 180.; 
+  const double phi = m_phi;
 
   double h_phi = get_h_phi(phi, lat, delta);
   double h0 = get_h_phi(0, lat, delta);
@@ -280,8 +295,8 @@ void ITMMassBalance::get_snow_accumulationITM(const std::vector<double> &T,
 
 double ITMMassBalance::get_refreeze_fraction(const double &T) {
   double refreeze;
-  double Tmin_refreeze  = m_config->get_number("surface.itm.air_temp_all_refreeze");
-  double Tmax_refreeze  = m_config->get_number("surface.itm.air_temp_no_refreeze");
+  double Tmin_refreeze  = m_air_temp_all_refreeze;
+  double Tmax_refreeze  = m_air_temp_no_refreeze;
   if (T <= Tmin_refreeze){refreeze = 1. ;}
   else if ((Tmin_refreeze<  T) and (T <= Tmax_refreeze)){
     refreeze = 1./(Tmin_refreeze - Tmax_refreeze) * T + Tmax_refreeze / (Tmax_refreeze - Tmin_refreeze) ; 
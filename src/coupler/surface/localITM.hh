@@ -198,6 +198,15 @@ protected:
   double Tmin,             //!< the temperature below which all precipitation is snow
     Tmax;             //!< the temperature above which all precipitation is rain
   double pdd_threshold_temp; //!< threshold temperature for the PDD computation
+
+  // Parameters used in methods called inside loops over grid points. These are read from
+  // the configuration database once, in the constructor. This also makes these methods
+  // safe to call from thread-parallel loops.
+  double m_ice_density, m_water_density, m_latent_heat_of_fusion;
+  double m_albedo_snow, m_albedo_land, m_albedo_ocean, m_albedo_slope, m_albedo_ice;
+  double m_tau_a_slope, m_tau_a_intercept;
+  double m_itm_c, m_itm_lambda, m_background_melting_temp, m_solar_constant, m_phi;
+  double m_air_temp_all_refreeze, m_air_temp_no_refreeze;
 };
 
 
@@ -29,6 +29,10 @@
 #include "pism/util/fftw_utilities.hh"
 #include "LingleClarkSerial.hh"
 
+#if (Pism_USE_FFTW_MPI==1)
+#include "LingleClarkParallel.hh"
+#endif
+
 namespace pism {
 namespace bed {
 
@@ -37,28 +41,30 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
     m_total_displacement(m_grid, "bed_displacement", WITHOUT_GHOSTS),
     m_relief(m_grid, "bed_relief", WITHOUT_GHOSTS),
     m_load_thickness(grid, "load_thickness", WITHOUT_GHOSTS),
-    m_elastic_displacement(grid, "elastic_bed_displacement", WITHOUT_GHOSTS) {
+    m_elastic_displacement(grid, "elastic_bed_displacement", WITHOUT_GHOSTS),
+    m_pending_load(grid, "lingle_clark_pending_load", WITHOUT_GHOSTS),
+    m_task(grid->com) {
 
   m_time_name = m_config->get_string("time.dimension_name") + "_lingle_clark";
   m_t_last = m_grid->ctx()->time()->current();
   m_update_interval = m_config->get_number("bed_deformation.lc.update_interval", "seconds");
   m_t_eps = 1.0;
 
+  m_asynchronous = m_config->get_flag("bed_deformation.lc.asynchronous");
+  m_pending_dt = 0.0;
+  m_pending_dt_name = m_time_name + "_pending_dt";
+
   if (m_update_interval < 1.0) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
                                   "invalid bed_deformation.lc.update_interval = %f seconds",
                                   m_update_interval);
   }
 
-  // A work vector. This storage is used to put thickness change on rank 0 and to get the plate
-  // displacement change back.
   m_total_displacement.set_attrs("internal",
                                  "total (viscous and elastic) displacement "
                                  "in the Lingle-Clark bed deformation model",
                                  "meters", "meters", "", 0);
 
-  m_work0 = m_total_displacement.allocate_proc0_copy();
-
   m_relief.set_attrs("internal",
                      "bed relief relative to the modeled bed displacement",
                      "meters", "meters", "", 0);
@@ -69,7 +75,6 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
                                    "elastic part of the displacement in the "
                                    "Lingle-Clark bed deformation model; "
                                    "see :cite:`BLKfastearth`", "meters", "meters", "", 0);
-  m_elastic_displacement0 = m_elastic_displacement.allocate_proc0_copy();
 
   const int
     Mx = m_grid->Mx(),
@@ -102,7 +107,36 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
   // do not point to auxiliary coordinates "lon" and "lat".
   m_viscous_displacement.metadata().set_string("coordinates", "");
 
+  if (m_config->get_flag("bed_deformation.lc.distributed")) {
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model.reset(new LingleClarkParallel(m_grid, m_extended_grid,
+                                                   use_elastic_model));
+    // the distributed model does not use rank 0 storage
+    m_asynchronous = false;
+    return;
+#else
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "bed_deformation.lc.distributed requires PISM built with FFTW's MPI interface"
+                       " (Pism_USE_FFTW_MPI)");
+#endif
+  }
+
+  // A work vector. This storage is used to put thickness change on rank 0 and to get the plate
+  // displacement change back.
+  m_work0 = m_total_displacement.allocate_proc0_copy();
+
   m_viscous_displacement0 = m_viscous_displacement.allocate_proc0_copy();
+  m_elastic_displacement0 = m_elastic_displacement.allocate_proc0_copy();
+
+  if (m_asynchronous) {
+    m_pending_load.set_attrs("model state",
+                             "load thickness used by the pending asynchronous update "
+                             "of the Lingle-Clark bed deformation model",
+                             "meters", "meters", "", 0);
+    m_pending_load.set(0.0);
+
+    m_pending_load0 = m_pending_load.allocate_proc0_copy();
+  }
 
   ParallelSection rank0(m_grid->com);
   try {
@@ -135,6 +169,10 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
                                  const IceModelVec2S &bed_uplift,
                                  const IceModelVec2S &ice_thickness,
                                  const IceModelVec2S &sea_level_elevation) {
+  // discard the pending asynchronous update, if any
+  m_task.finish();
+  m_pending_dt = 0.0;
+
   m_t_last = m_grid->ctx()->time()->current();
 
   m_topg_last.copy_from(bed_elevation);
@@ -142,6 +180,20 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
   compute_load(bed_elevation, ice_thickness, sea_level_elevation,
                m_load_thickness);
 
+#if (Pism_USE_FFTW_MPI==1)
+  if (m_parallel_model) {
+    m_parallel_model->bootstrap(m_load_thickness, bed_uplift);
+
+    m_viscous_displacement.copy_from(m_parallel_model->viscous_displacement());
+    m_elastic_displacement.copy_from(m_parallel_model->elastic_displacement());
+    m_total_displacement.copy_from(m_parallel_model->total_displacement());
+
+    // compute bed relief
+    m_topg.add(-1.0, m_total_displacement, m_relief);
+    return;
+  }
+#endif
+
   petsc::Vec::Ptr thickness0 = m_load_thickness.allocate_proc0_copy();
 
   // initialize the plate displacement
@@ -152,18 +204,7 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
     ParallelSection rank0(m_grid->com);
     try {
       if (m_grid->rank() == 0) {
-        PetscErrorCode ierr = 0;
-
         m_serial_model->bootstrap(*thickness0, *m_work0);
-
-        ierr = VecCopy(m_serial_model->total_displacement(), *m_work0);
-        PISM_CHK(ierr, "VecCopy");
-
-        ierr = VecCopy(m_serial_model->viscous_displacement(), *m_viscous_displacement0);
-        PISM_CHK(ierr, "VecCopy");
-
-        ierr = VecCopy(m_serial_model->elastic_displacement(), *m_elastic_displacement0);
-        PISM_CHK(ierr, "VecCopy");
       }
     } catch (...) {
       rank0.failed();
@@ -171,11 +212,7 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
     rank0.check();
   }
 
-  m_viscous_displacement.get_from_proc0(*m_viscous_displacement0);
-
-  m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
-
-  m_total_displacement.get_from_proc0(*m_work0);
+  get_serial_model_state();
 
   // compute bed relief
   m_topg.add(-1.0, m_total_displacement, m_relief);
@@ -189,6 +226,13 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
 IceModelVec2S::Ptr LingleClark::elastic_load_response_matrix() const {
   IceModelVec2S::Ptr result(new IceModelVec2S(m_extended_grid, "lrm", WITHOUT_GHOSTS));
 
+#if (Pism_USE_FFTW_MPI==1)
+  if (m_parallel_model) {
+    m_parallel_model->compute_load_response_matrix(*result);
+    return result;
+  }
+#endif
+
   int
     Nx = m_extended_grid->Mx(),
     Ny = m_extended_grid->My();
@@ -229,6 +273,15 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
                             const IceModelVec2S &sea_level_elevation) {
   m_log->message(2, "* Initializing the Lingle-Clark bed deformation model...\n");
 
+  // discard the pending asynchronous update, if any
+  m_task.finish();
+  m_pending_dt = 0.0;
+
+  if (m_asynchronous) {
+    m_log->message(2,
+                   "  Updating the model asynchronously: bed displacement lags by one update interval.\n");
+  }
+
   if (opts.type == INIT_RESTART or opts.type == INIT_BOOTSTRAP) {
     File input_file(m_grid->com, opts.filename, PISM_NETCDF3, PISM_READONLY);
 
@@ -237,6 +290,11 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
     } else {
       m_t_last = m_grid->ctx()->time()->current();
     }
+
+    if (m_asynchronous and opts.type == INIT_RESTART and
+        input_file.find_variable(m_pending_dt_name)) {
+      input_file.read_variable(m_pending_dt_name, {0}, {1}, &m_pending_dt);
+    }
   } else {
     m_t_last = m_grid->ctx()->time()->current();
   }
@@ -251,6 +309,10 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
     m_viscous_displacement.read(opts.filename, opts.record);
     // Set elastic displacement by reading from the input file.
     m_elastic_displacement.read(opts.filename, opts.record);
+
+    if (m_pending_dt > 0.0) {
+      m_pending_load.read(opts.filename, opts.record);
+    }
   } else if (opts.type == INIT_BOOTSTRAP) {
     this->bootstrap(m_topg, m_uplift, ice_thickness, sea_level_elevation);
   } else {
@@ -266,6 +328,18 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
   compute_load(m_topg, ice_thickness, sea_level_elevation,
                m_load_thickness);
 
+#if (Pism_USE_FFTW_MPI==1)
+  if (m_parallel_model) {
+    m_parallel_model->init(m_viscous_displacement, m_elastic_displacement);
+
+    m_total_displacement.copy_from(m_parallel_model->total_displacement());
+
+    // compute bed relief
+    m_topg.add(-1.0, m_total_displacement, m_relief);
+    return;
+  }
+#endif
+
   // Now that viscous displacement and elastic displacement are finally initialized,
   // put them on rank 0 and initialize the serial model itself.
   {
@@ -275,12 +349,9 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
     ParallelSection rank0(m_grid->com);
     try {
       if (m_grid->rank() == 0) {  // only processor zero does the work
-        PetscErrorCode ierr = 0;
-
         m_serial_model->init(*m_viscous_displacement0, *m_work0);
 
-        ierr = VecCopy(m_serial_model->total_displacement(), *m_work0);
-        PISM_CHK(ierr, "VecCopy");
+        copy_to_vec(m_serial_model->total_displacement(), *m_work0);
       }
     } catch (...) {
       rank0.failed();
@@ -292,6 +363,11 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
 
   // compute bed relief
   m_topg.add(-1.0, m_total_displacement, m_relief);
+
+  if (m_pending_dt > 0.0) {
+    // re-start the update that was pending when the input file was written
+    start_serial_update(m_pending_dt);
+  }
 }
 
 MaxTimestep LingleClark::max_timestep_impl(double t) const {
@@ -343,34 +419,42 @@ void LingleClark::step(const IceModelVec2S &ice_thickness,
   compute_load(m_topg, ice_thickness, sea_level_elevation,
                m_load_thickness);
 
-  m_load_thickness.put_on_proc0(*m_work0);
-
-  ParallelSection rank0(m_grid->com);
-  try {
-    if (m_grid->rank() == 0) {  // only processor zero does the step
-      PetscErrorCode ierr = 0;
-
-      m_serial_model->step(dt, *m_work0);
+#if (Pism_USE_FFTW_MPI==1)
+  if (m_parallel_model) {
+    m_parallel_model->step(dt, m_load_thickness);
+
+    m_viscous_displacement.copy_from(m_parallel_model->viscous_displacement());
+    m_elastic_displacement.copy_from(m_parallel_model->elastic_displacement());
+    m_total_displacement.copy_from(m_parallel_model->total_displacement());
+  } else
+#endif
+  if (m_asynchronous) {
+    // Apply results of the previous update (if any)...
+    if (m_task.pending()) {
+      m_task.finish();
+      get_serial_model_state();
+    }
 
-      ierr = VecCopy(m_serial_model->total_displacement(), *m_work0);
-      PISM_CHK(ierr, "VecCopy");
+    // ... and start the next one, using the current load.
+    m_pending_load.copy_from(m_load_thickness);
+    m_pending_dt = dt;
 
-      ierr = VecCopy(m_serial_model->viscous_displacement(), *m_viscous_displacement0);
-      PISM_CHK(ierr, "VecCopy");
+    start_serial_update(dt);
+  } else {
+    m_load_thickness.put_on_proc0(*m_work0);
 
-      ierr = VecCopy(m_serial_model->elastic_displacement(), *m_elastic_displacement0);
-      PISM_CHK(ierr, "VecCopy");
+    ParallelSection rank0(m_grid->com);
+    try {
+      if (m_grid->rank() == 0) {  // only processor zero does the step
+        m_serial_model->step(dt, *m_work0);
+      }
+    } catch (...) {
+      rank0.failed();
     }
-  } catch (...) {
-    rank0.failed();
-  }
-  rank0.check();
-
-  m_viscous_displacement.get_from_proc0(*m_viscous_displacement0);
-
-  m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
+    rank0.check();
 
-  m_total_displacement.get_from_proc0(*m_work0);
+    get_serial_model_state();
+  }
 
   // Update bed elevation using bed displacement and relief.
   {
@@ -384,6 +468,53 @@ void LingleClark::step(const IceModelVec2S &ice_thickness,
   m_topg_last.copy_from(m_topg);
 }
 
+/*!
+ * Start an asynchronous step of the serial model using the load in `m_pending_load`.
+ *
+ * The job runs in a helper thread, so it must not use PETSc: it gets a copy of the load in
+ * a plain array and the serial model stores its state in plain arrays as well.
+ */
+void LingleClark::start_serial_update(double dt) {
+  m_pending_load.put_on_proc0(*m_pending_load0);
+
+  ParallelSection rank0(m_grid->com);
+  try {
+    if (m_grid->rank() == 0) {
+      copy_from_vec(*m_pending_load0, m_pending_load_array);
+    }
+  } catch (...) {
+    rank0.failed();
+  }
+  rank0.check();
+
+  m_task.start([this, dt]() {
+      m_serial_model->step(dt, m_pending_load_array.data());
+    });
+}
+
+/*!
+ * Copy viscous, elastic, and total displacement from the serial model on rank 0.
+ */
+void LingleClark::get_serial_model_state() {
+  ParallelSection rank0(m_grid->com);
+  try {
+    if (m_grid->rank() == 0) {
+      copy_to_vec(m_serial_model->total_displacement(), *m_work0);
+      copy_to_vec(m_serial_model->viscous_displacement(), *m_viscous_displacement0);
+      copy_to_vec(m_serial_model->elastic_displacement(), *m_elastic_displacement0);
+    }
+  } catch (...) {
+    rank0.failed();
+  }
+  rank0.check();
+
+  m_viscous_displacement.get_from_proc0(*m_viscous_displacement0);
+
+  m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
+
+  m_total_displacement.get_from_proc0(*m_work0);
+}
+
 //! Update the Lingle-Clark bed deformation model.
 void LingleClark::update_impl(const IceModelVec2S &ice_thickness,
                               const IceModelVec2S &sea_level_elevation,
@@ -417,6 +548,19 @@ void LingleClark::define_model_state_impl(const File &output) const {
     output.write_attribute(m_time_name, "calendar", m_grid->ctx()->time()->calendar());
     output.write_attribute(m_time_name, "units", m_grid->ctx()->time()->CF_units_string());
   }
+
+  if (m_asynchronous) {
+    m_pending_load.define(output);
+
+    if (not output.find_variable(m_pending_dt_name)) {
+      output.define_variable(m_pending_dt_name, PISM_DOUBLE, {});
+
+      output.write_attribute(m_pending_dt_name, "long_name",
+                             "length of the pending asynchronous update"
+                             " of the Lingle-Clark bed deformation model");
+      output.write_attribute(m_pending_dt_name, "units", "seconds");
+    }
+  }
 }
 
 void LingleClark::write_model_state_impl(const File &output) const {
@@ -426,6 +570,15 @@ void LingleClark::write_model_state_impl(const File &output) const {
   m_elastic_displacement.write(output);
 
   output.write_variable(m_time_name, {0}, {1}, &m_t_last);
+
+  if (m_asynchronous) {
+    // Save the input of the pending update (if any): the update is re-started when
+    // re-initializing from this file.
+    m_pending_load.write(output);
+
+    double dt = m_task.pending() ? m_pending_dt : 0.0;
+    output.write_variable(m_pending_dt_name, {0}, {1}, &dt);
+  }
 }
 
 DiagnosticList LingleClark::diagnostics_impl() const {
@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -21,15 +21,18 @@
 #define _PBLINGLECLARK_H_
 
 #include <memory>               // std::unique_ptr
+#include <vector>
 
 #include "BedDef.hh"
+#include "pism/util/Proc0Task.hh"
 
 namespace pism {
 namespace bed {
 
 class LingleClarkSerial;
+class LingleClarkParallel;
 
-//! A wrapper class around LingleClarkSerial.
+//! A wrapper class around LingleClarkSerial (or LingleClarkParallel).
 class LingleClark : public BedDef {
 public:
   LingleClark(IceGrid::ConstPtr g);
@@ -65,11 +68,14 @@ protected:
                    const IceModelVec2S &sea_level_elevation,
                    double t, double dt);
 
+  void get_serial_model_state();
+  void start_serial_update(double dt);
+
   //! Total (viscous and elastic) bed displacement.
   IceModelVec2S m_total_displacement;
 
   //! Storage on rank zero. Used to pass the load to the serial deformation model and get
-  //! bed displacement back.
+  //! bed displacement back. Not allocated if the model is distributed.
   petsc::Vec::Ptr m_work0;
 
   //! Bed relief relative to the bed displacement.
@@ -81,6 +87,12 @@ protected:
   //! Serial viscoelastic bed deformation model.
   std::unique_ptr<LingleClarkSerial> m_serial_model;
 
+#if (Pism_USE_FFTW_MPI==1)
+  //! Distributed viscoelastic bed deformation model (used if
+  //! bed_deformation.lc.distributed is set).
+  std::unique_ptr<LingleClarkParallel> m_parallel_model;
+#endif
+
   //! extended grid for the viscous plate displacement
   IceGrid::Ptr m_extended_grid;
 
@@ -102,6 +114,25 @@ protected:
   double m_t_eps;
   //! Name of the variable used to store the last update time.
   std::string m_time_name;
+
+  //! True if the serial model is updated asynchronously (see
+  //! bed_deformation.lc.asynchronous).
+  bool m_asynchronous;
+  //! Load thickness used by the pending asynchronous update (part of the model state in
+  //! the asynchronous mode).
+  IceModelVec2S m_pending_load;
+  //! rank 0 storage for the load used by the pending update
+  petsc::Vec::Ptr m_pending_load0;
+  //! copy of `m_pending_load0` used by the pending update (it must not use PETSc)
+  std::vector<double> m_pending_load_array;
+  //! Length of the pending update, in seconds (zero if there is no pending update).
+  double m_pending_dt;
+  //! Name of the variable used to store m_pending_dt.
+  std::string m_pending_dt_name;
+
+  //! Asynchronous update of the serial model. Note: this has to be destroyed before the
+  //! serial model and m_pending_load_array.
+  Proc0Task m_task;
 };
 
 } // end of namespace bed
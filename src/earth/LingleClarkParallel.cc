@@ -0,0 +1,594 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>                // sqrt
+#include <cstdlib>              // std::abs
+#include <cstring>              // memcpy
+#include <complex>
+#include <algorithm>            // std::max
+
+#include <fftw3-mpi.h>
+#include <gsl/gsl_math.h>       // M_PI
+#include <petscdmda.h>          // DMDAGetAO
+#include <petscao.h>
+
+#include "matlablike.hh"
+#include "greens.hh"
+#include "LingleClarkParallel.hh"
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/fftw_utilities.hh"
+#include "pism/util/petscwrappers/IS.hh"
+
+namespace pism {
+namespace bed {
+
+//! Treat an FFTW array as an array of std::complex<double>.
+static std::complex<double>* cplx(fftw_complex *a) {
+  return reinterpret_cast<std::complex<double>*>(a);
+}
+
+/*!
+ * @param[in] grid PISM's grid
+ * @param[in] extended_grid extended grid used by the spectral method
+ * @param[in] include_elastic include elastic deformation component
+ */
+LingleClarkParallel::LingleClarkParallel(IceGrid::ConstPtr grid,
+                                         IceGrid::ConstPtr extended_grid,
+                                         bool include_elastic)
+  : m_grid(grid),
+    m_Uv(extended_grid, "viscous_displacement", WITHOUT_GHOSTS),
+    m_Ue(grid, "elastic_displacement", WITHOUT_GHOSTS),
+    m_U(grid, "total_displacement", WITHOUT_GHOSTS),
+    m_work(grid, "lc_work", WITHOUT_GHOSTS),
+    m_log(grid->ctx()->log()) {
+
+  const Config &config = *grid->ctx()->config();
+
+  m_include_elastic = include_elastic;
+
+  if (include_elastic) {
+    // see LingleClarkSerial::LingleClarkSerial()
+    if (config.get_number("bed_deformation.lc.grid_size_factor") < 2) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "bed_deformation.lc.elastic_model"
+                                    " requires bed_deformation.lc.grid_size_factor > 1");
+    }
+  }
+
+  // grid parameters
+  m_Mx = grid->Mx();
+  m_My = grid->My();
+  m_dx = grid->dx();
+  m_dy = grid->dy();
+  m_Nx = extended_grid->Mx();
+  m_Ny = extended_grid->My();
+
+  m_load_density   = config.get_number("constants.ice.density");
+  m_mantle_density = config.get_number("bed_deformation.mantle_density");
+  m_eta            = config.get_number("bed_deformation.mantle_viscosity");
+  m_D              = config.get_number("bed_deformation.lithosphere_flexural_rigidity");
+
+  m_standard_gravity = config.get_number("constants.standard_gravity");
+
+  // derive more parameters
+  m_Lx        = 0.5 * (m_Nx - 1.0) * m_dx;
+  m_Ly        = 0.5 * (m_Ny - 1.0) * m_dy;
+  m_i0_offset = (m_Nx - m_Mx) / 2;
+  m_j0_offset = (m_Ny - m_My) / 2;
+
+  // Note: it is safe to call fftw_mpi_init() more than once.
+  fftw_mpi_init();
+
+  m_alloc_local = fftw_mpi_local_size_2d_transposed(m_Nx, m_Ny, grid->com,
+                                                    &m_Nx_local, &m_i_start,
+                                                    &m_Ny_local, &m_j_start);
+  // some processes may not own any part of the extended grid
+  m_alloc_local = std::max(m_alloc_local, (ptrdiff_t)1);
+
+  // See the note about error checking in LingleClarkSerial::LingleClarkSerial().
+  m_fftw_input  = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_alloc_local);
+  m_fftw_output = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_alloc_local);
+  m_loadhat     = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_alloc_local);
+  m_lrm_hat     = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_alloc_local);
+
+  clear_fftw_array(m_fftw_input, m_alloc_local, 1);
+
+  // Forward transforms produce transposed output and inverse transforms take transposed
+  // input: we never need Fourier coefficients in the "natural" layout.
+  m_dft_forward = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output, grid->com,
+                                       FFTW_FORWARD, FFTW_ESTIMATE | FFTW_MPI_TRANSPOSED_OUT);
+  m_dft_inverse = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output, grid->com,
+                                       FFTW_BACKWARD, FFTW_ESTIMATE | FFTW_MPI_TRANSPOSED_IN);
+
+  PetscErrorCode ierr = VecCreateMPI(grid->com, m_Nx_local * m_Ny, PETSC_DETERMINE,
+                                     m_slab.rawptr());
+  PISM_CHK(ierr, "VecCreateMPI");
+
+  create_scatter(m_work, m_i0_offset, m_j0_offset, m_centered);
+  create_scatter(m_work, 0, 0, m_corner);
+  if (m_include_elastic) {
+    create_scatter(m_work, m_Nx / 2, m_Ny / 2, m_elastic);
+  }
+  create_scatter(m_Uv, 0, 0, m_extended);
+
+  precompute_coefficients();
+}
+
+LingleClarkParallel::~LingleClarkParallel() {
+  fftw_destroy_plan(m_dft_forward);
+  fftw_destroy_plan(m_dft_inverse);
+  fftw_free(m_fftw_input);
+  fftw_free(m_fftw_output);
+  fftw_free(m_loadhat);
+  fftw_free(m_lrm_hat);
+}
+
+/*!
+ * Create a scatter from `v` (using PISM's domain decomposition) to the part of the
+ * extended grid with the lower left corner at `(i0, j0)` (using FFTW's decomposition).
+ */
+void LingleClarkParallel::create_scatter(IceModelVec2S &v, int i0, int j0,
+                                         petsc::VecScatter &result) {
+  PetscErrorCode ierr = 0;
+
+  const int
+    Mx = v.grid()->Mx(),
+    My = v.grid()->My();
+
+  // Each process lists the points it owns in FFTW's decomposition.
+  std::vector<PetscInt> from, to;
+  for (int i = m_i_start; i < m_i_start + m_Nx_local; ++i) {
+    const int i_source = i - i0;
+
+    if (i_source < 0 or i_source >= Mx) {
+      continue;
+    }
+
+    for (int j = 0; j < My; ++j) {
+      from.push_back(i_source + Mx * j); // natural ordering
+      to.push_back(i * m_Ny + j + j0);   // FFTW's ordering
+    }
+  }
+
+  // convert natural indexes to PETSc's ordering
+  AO ao;
+  ierr = DMDAGetAO(*v.dm(), &ao);
+  PISM_CHK(ierr, "DMDAGetAO");
+
+  ierr = AOApplicationToPetsc(ao, from.size(), from.data());
+  PISM_CHK(ierr, "AOApplicationToPetsc");
+
+  petsc::IS is_from, is_to;
+  ierr = ISCreateGeneral(PETSC_COMM_SELF, from.size(), from.data(), PETSC_COPY_VALUES,
+                         is_from.rawptr());
+  PISM_CHK(ierr, "ISCreateGeneral");
+
+  ierr = ISCreateGeneral(PETSC_COMM_SELF, to.size(), to.data(), PETSC_COPY_VALUES,
+                         is_to.rawptr());
+  PISM_CHK(ierr, "ISCreateGeneral");
+
+  ierr = VecScatterCreate(v.vec(), is_from, m_slab, is_to, result.rawptr());
+  PISM_CHK(ierr, "VecScatterCreate");
+}
+
+/*!
+ * Put `input` (scaled by `normalization`) in the real part of `output`, using `scatter` to
+ * embed it in the extended grid.
+ *
+ * Sets the imaginary part and the rest of the extended grid to zero.
+ */
+void LingleClarkParallel::set_real_part(VecScatter scatter, const IceModelVec2S &input,
+                                        double normalization, fftw_complex *output) {
+  PetscErrorCode ierr = 0;
+
+  // Scatters need the storage of a vector without ghosts. Inputs on the extended grid
+  // (viscous displacement) use m_Uv directly.
+  Vec in = NULL;
+  if (&input == &m_Uv) {
+    in = m_Uv.vec();
+  } else {
+    m_work.copy_from(input);
+    in = m_work.vec();
+  }
+
+  ierr = VecSet(m_slab, 0.0);
+  PISM_CHK(ierr, "VecSet");
+
+  ierr = VecScatterBegin(scatter, in, m_slab, INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterBegin");
+
+  ierr = VecScatterEnd(scatter, in, m_slab, INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterEnd");
+
+  petsc::VecArray slab(m_slab);
+  const double *s = slab.get();
+  std::complex<double> *out = cplx(output);
+
+  const ptrdiff_t N = m_Nx_local * m_Ny;
+  for (ptrdiff_t k = 0; k < N; ++k) {
+    out[k] = s[k] * normalization;
+  }
+}
+
+//! Put the real part of `input` (scaled by `normalization`) into `m_slab`.
+void LingleClarkParallel::get_real_part(fftw_complex *input, double normalization) {
+  petsc::VecArray slab(m_slab);
+  double *s = slab.get();
+  std::complex<double> *in = cplx(input);
+
+  const ptrdiff_t N = m_Nx_local * m_Ny;
+  for (ptrdiff_t k = 0; k < N; ++k) {
+    s[k] = in[k].real() * normalization;
+  }
+}
+
+//! Extract the part of `m_slab` corresponding to `scatter` and put it in `output`.
+void LingleClarkParallel::from_slab(VecScatter scatter, IceModelVec2S &output) {
+  PetscErrorCode ierr = 0;
+
+  ierr = VecScatterBegin(scatter, m_slab, output.vec(), INSERT_VALUES, SCATTER_REVERSE);
+  PISM_CHK(ierr, "VecScatterBegin");
+
+  ierr = VecScatterEnd(scatter, m_slab, output.vec(), INSERT_VALUES, SCATTER_REVERSE);
+  PISM_CHK(ierr, "VecScatterEnd");
+
+  output.inc_state_counter();
+}
+
+const IceModelVec2S& LingleClarkParallel::total_displacement() const {
+  return m_U;
+}
+
+const IceModelVec2S& LingleClarkParallel::viscous_displacement() const {
+  return m_Uv;
+}
+
+const IceModelVec2S& LingleClarkParallel::elastic_displacement() const {
+  return m_Ue;
+}
+
+/*!
+ * Compute the part of the load response matrix owned by this process.
+ *
+ * Same as LingleClarkSerial::compute_load_response_matrix(), except that each process
+ * computes rows of the matrix it owns (the matrix is symmetric about `(Nx/2, Ny/2)`).
+ */
+void LingleClarkParallel::load_response_matrix(fftw_complex *output) {
+
+  std::complex<double> *LRM = cplx(output);
+
+  greens_elastic G;
+  ge_data ge_data {m_dx, m_dy, 0, 0, &G};
+
+  const int
+    Nx2 = m_Nx / 2,
+    Ny2 = m_Ny / 2;
+
+  for (int i = 0; i < m_Nx_local; ++i) {
+    std::complex<double> *row = LRM + i * m_Ny;
+
+    ge_data.p = std::abs(Nx2 - (int)(m_i_start + i));
+
+    for (int j = 0; j <= Ny2; ++j) {
+      ge_data.q = Ny2 - j;
+
+      row[j] = dblquad_cubature(ge_integrand,
+                                -m_dx / 2, m_dx / 2,
+                                -m_dy / 2, m_dy / 2,
+                                1.0e-8, &ge_data);
+    }
+
+    for (int j = Ny2 + 1; j < m_Ny; ++j) {
+      row[j] = row[2 * Ny2 - j];
+    }
+  }
+}
+
+void LingleClarkParallel::compute_load_response_matrix(IceModelVec2S &result) {
+  load_response_matrix(m_fftw_input);
+  get_real_part(m_fftw_input, 1.0);
+  from_slab(m_extended, result);
+}
+
+//! Pre-compute coefficients used by the model.
+void LingleClarkParallel::precompute_coefficients() {
+
+  m_cx = fftfreq(m_Nx, m_Lx / (m_Nx * M_PI));
+  m_cy = fftfreq(m_Ny, m_Ly / (m_Ny * M_PI));
+
+  if (m_include_elastic) {
+    m_log->message(2, "     computing spherical elastic load response matrix ...");
+    {
+      load_response_matrix(m_fftw_input);
+      // Compute fft2(LRM) and save it in m_lrm_hat (this stays distributed)
+      fftw_execute(m_dft_forward);
+      memcpy(m_lrm_hat, m_fftw_output, m_alloc_local * sizeof(fftw_complex));
+    }
+    m_log->message(2, " done\n");
+  }
+}
+
+/*!
+ * Solve for the viscous displacement given the load and the bed uplift.
+ *
+ * See LingleClarkSerial::uplift_problem().
+ *
+ * Sets m_Uv.
+ */
+void LingleClarkParallel::uplift_problem(const IceModelVec2S &load_thickness,
+                                         const IceModelVec2S &bed_uplift) {
+
+  // Compute fft2(-load_density * g * load_thickness)
+  {
+    set_real_part(m_centered, load_thickness, - m_load_density * m_standard_gravity,
+                  m_fftw_input);
+    fftw_execute(m_dft_forward);
+    memcpy(m_loadhat, m_fftw_output, m_alloc_local * sizeof(fftw_complex));
+  }
+
+  // fft2(uplift)
+  {
+    set_real_part(m_centered, bed_uplift, 1.0, m_fftw_input);
+    fftw_execute(m_dft_forward);
+  }
+
+  // Note: Fourier coefficients are transposed, i.e. this process owns "rows" [m_j_start,
+  // m_j_start + m_Ny_local) in the Y direction.
+  {
+    std::complex<double>
+      *u0_hat     = cplx(m_fftw_input),
+      *load_hat   = cplx(m_loadhat),
+      *uplift_hat = cplx(m_fftw_output);
+
+    for (int j = 0; j < m_Ny_local; j++) {
+      const double cy = m_cy[m_j_start + j];
+      for (int i = 0; i < m_Nx; i++) {
+        const int k = j * m_Nx + i;
+        const double
+          C = m_cx[i]*m_cx[i] + cy*cy,
+          A = - 2.0 * m_eta * sqrt(C),
+          B = m_mantle_density * m_standard_gravity + m_D * C * C;
+
+        u0_hat[k] = (load_hat[k] + A * uplift_hat[k]) / B;
+      }
+    }
+  }
+
+  fftw_execute(m_dft_inverse);
+  get_real_part(m_fftw_output, 1.0 / ((double)m_Nx * m_Ny));
+
+  tweak(0.0, 0.0);
+
+  from_slab(m_extended, m_Uv);
+}
+
+/*! Initialize using provided load thickness and the bed uplift rate.
+ *
+ * See LingleClarkSerial::bootstrap().
+ */
+void LingleClarkParallel::bootstrap(const IceModelVec2S &thickness,
+                                    const IceModelVec2S &uplift) {
+
+  // compute viscous displacement
+  uplift_problem(thickness, uplift);
+
+  if (m_include_elastic) {
+    compute_elastic_response(thickness, m_Ue);
+  } else {
+    m_Ue.set(0.0);
+  }
+
+  update_displacement();
+}
+
+/*!
+ * Initialize using provided plate displacement.
+ *
+ * @param[in] viscous_displacement initial viscous plate displacement (meters) on the extended grid
+ * @param[in] elastic_displacement initial elastic plate displacement (meters) on the regular grid
+ */
+void LingleClarkParallel::init(const IceModelVec2S &viscous_displacement,
+                               const IceModelVec2S &elastic_displacement) {
+  m_Uv.copy_from(viscous_displacement);
+
+  if (m_include_elastic) {
+    m_Ue.copy_from(elastic_displacement);
+  } else {
+    m_Ue.set(0.0);
+  }
+
+  update_displacement();
+}
+
+/*!
+ * Perform a time step.
+ *
+ * See LingleClarkSerial::step().
+ *
+ * @param[in] dt time step length
+ * @param[in] H load thickness on the physical (Mx*My) grid
+ */
+void LingleClarkParallel::step(double dt, const IceModelVec2S &H) {
+  if (dt > 0.0) {
+    // Compute fft2(-load_density * g * dt * H)
+    {
+      set_real_part(m_centered, H, - m_load_density * m_standard_gravity * dt,
+                    m_fftw_input);
+      fftw_execute(m_dft_forward);
+
+      // Save fft2(-load_density * g * H * dt) in loadhat.
+      memcpy(m_loadhat, m_fftw_output, m_alloc_local * sizeof(fftw_complex));
+    }
+
+    // Compute fft2(u).
+    {
+      set_real_part(m_extended, m_Uv, 1.0, m_fftw_input);
+      fftw_execute(m_dft_forward);
+    }
+
+    // frhs = right.*fft2(uun) + fft2(dt*sszz);
+    // uun1 = real(ifft2(frhs./left));
+    {
+      std::complex<double>
+        *input    = cplx(m_fftw_input),
+        *u_hat    = cplx(m_fftw_output),
+        *load_hat = cplx(m_loadhat);
+
+      for (int j = 0; j < m_Ny_local; j++) {
+        const double cy = m_cy[m_j_start + j];
+        for (int i = 0; i < m_Nx; i++) {
+          const int k = j * m_Nx + i;
+          const double
+            C     = m_cx[i]*m_cx[i] + cy*cy,
+            part1 = 2.0 * m_eta * sqrt(C),
+            part2 = (dt / 2.0) * (m_mantle_density * m_standard_gravity + m_D * C * C),
+            A = part1 - part2,
+            B = part1 + part2;
+
+          input[k] = (load_hat[k] + A * u_hat[k]) / B;
+        }
+      }
+    }
+
+    fftw_execute(m_dft_inverse);
+    get_real_part(m_fftw_output, 1.0 / ((double)m_Nx * m_Ny));
+
+    // Now tweak. (See the "correction" in section 5 of BuelerLingleBrown.)
+    //
+    // Here 1e16 approximates t = \infty.
+    tweak(H.sum(), 1e16);
+
+    from_slab(m_extended, m_Uv);
+  } else {
+    // zero time step: viscous displacement is zero
+    m_Uv.set(0.0);
+  }
+
+  // now compute elastic response if desired
+  if (m_include_elastic) {
+    compute_elastic_response(H, m_Ue);
+  }
+
+  update_displacement();
+}
+
+/*!
+ * Compute elastic response to the load H
+ *
+ * @param[in] H load thickness (ice equivalent meters)
+ * @param[out] dE elastic plate displacement
+ */
+void LingleClarkParallel::compute_elastic_response(const IceModelVec2S &H, IceModelVec2S &dE) {
+
+  // Compute fft2(load_density * H) (the load is placed in the corner of the extended grid)
+  {
+    set_real_part(m_corner, H, m_load_density, m_fftw_input);
+    fftw_execute(m_dft_forward);
+  }
+
+  // fft2(m_response_matrix) * fft2(load_density*H)
+  {
+    std::complex<double>
+      *input    = cplx(m_fftw_input),
+      *LRM_hat  = cplx(m_lrm_hat),
+      *load_hat = cplx(m_fftw_output);
+
+    const ptrdiff_t N = m_Ny_local * m_Nx;
+    for (ptrdiff_t k = 0; k < N; ++k) {
+      input[k] = LRM_hat[k] * load_hat[k];
+    }
+  }
+
+  // Compute the inverse transform and extract the elastic response (the corner of the
+  // physical grid is at (Nx/2, Ny/2)).
+  fftw_execute(m_dft_inverse);
+  get_real_part(m_fftw_output, 1.0 / ((double)m_Nx * m_Ny));
+  from_slab(m_elastic, dE);
+}
+
+//! Compute total displacement by combining viscous and elastic contributions.
+void LingleClarkParallel::update_displacement() {
+  // extract the part of the viscous displacement on the physical grid
+  set_real_part(m_extended, m_Uv, 1.0, m_fftw_input);
+  from_slab(m_centered, m_U);
+
+  m_U.add(1.0, m_Ue);
+}
+
+/*!
+ * Modify the viscous plate displacement (stored in `m_slab`) to correct for the effect of
+ * imposing periodic boundary conditions at a finite distance.
+ *
+ * See LingleClarkSerial::tweak().
+ *
+ * @param[in] load_sum sum of load thickness values (used to compute the corresponding disc volume)
+ * @param[in] time time, seconds (usually 0 or a large number approximating \infty)
+ */
+void LingleClarkParallel::tweak(double load_sum, double time) {
+  PetscErrorCode ierr = 0;
+
+  // find average value along "distant" boundary of [-Lx, Lx]X[-Ly, Ly]
+  double average = 0.0;
+  {
+    petsc::VecArray slab(m_slab);
+    const double *u = slab.get();
+
+    // u(i, 0)
+    for (int i = 0; i < m_Nx_local; i++) {
+      average += u[i * m_Ny];
+    }
+
+    // u(0, j)
+    if (m_i_start == 0 and m_Nx_local > 0) {
+      for (int j = 0; j < m_Ny; j++) {
+        average += u[j];
+      }
+    }
+  }
+
+  average = GlobalSum(m_grid->com, average) / (double) (m_Nx + m_Ny);
+
+  double shift = 0.0;
+
+  if (time > 0.0) {
+    const double L_average = (m_Lx + m_Ly) / 2.0;
+    const double R         = L_average * (2.0 / 3.0);
+
+    // compute disc thickness by dividing its volume by the area
+    const double H = (load_sum * m_dx * m_dy) / (M_PI * R * R);
+
+    shift = viscDisc(time,               // time in seconds
+                     H,                  // disc thickness
+                     R,                  // disc radius
+                     L_average,          // compute deflection at this radius
+                     m_mantle_density, m_load_density,    // mantle and load densities
+                     m_standard_gravity, //
+                     m_D,                // flexural rigidity
+                     m_eta);             // mantle viscosity
+  }
+
+  ierr = VecShift(m_slab, shift - average); PISM_CHK(ierr, "VecShift");
+}
+
+} // end of namespace bed
+} // end of namespace pism
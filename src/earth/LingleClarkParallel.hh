@@ -0,0 +1,177 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LINGLECLARKPARALLEL_H
+#define LINGLECLARKPARALLEL_H
+
+#include <vector>
+#include <cstddef>              // ptrdiff_t
+
+#include <fftw3.h>
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/petscwrappers/VecScatter.hh"
+#include "pism/util/Logger.hh"
+
+namespace pism {
+namespace bed {
+
+//! Distributed version of LingleClarkSerial.
+/*!
+  Implements the same model (see LingleClarkSerial for details), but uses FFTW's MPI
+  interface to distribute the extended (spectral) grid among all processes in the
+  communicator of the PISM grid instead of gathering inputs on rank 0.
+
+  FFTW distributes the extended grid in "slabs": each process owns a contiguous block of
+  rows (in the X direction) of the `Nx*Ny` grid. PETSc scatters move data between PISM's
+  2D domain decomposition and this layout. Forward transforms produce *transposed* output
+  (each process owns a block of rows in the Y direction in Fourier space) and inverse
+  transforms take transposed input; this saves two global transposes per solve. Fourier
+  coefficients (including the spectrum of the elastic load response matrix) are never
+  gathered on one process.
+
+  Inputs and outputs use the PISM grid and the extended grid, respectively, so this class
+  can be used by LingleClark without any rank 0 storage.
+*/
+class LingleClarkParallel {
+public:
+  LingleClarkParallel(IceGrid::ConstPtr grid,
+                      IceGrid::ConstPtr extended_grid,
+                      bool include_elastic);
+  ~LingleClarkParallel();
+
+  void init(const IceModelVec2S &viscous_displacement,
+            const IceModelVec2S &elastic_displacement);
+
+  void bootstrap(const IceModelVec2S &thickness, const IceModelVec2S &uplift);
+
+  void step(double dt_seconds, const IceModelVec2S &H);
+
+  const IceModelVec2S& total_displacement() const;
+
+  const IceModelVec2S& viscous_displacement() const;
+
+  const IceModelVec2S& elastic_displacement() const;
+
+  void compute_load_response_matrix(IceModelVec2S &result);
+private:
+  void load_response_matrix(fftw_complex *output);
+
+  void compute_elastic_response(const IceModelVec2S &H, IceModelVec2S &dE);
+
+  void uplift_problem(const IceModelVec2S &load_thickness, const IceModelVec2S &bed_uplift);
+
+  void precompute_coefficients();
+
+  void update_displacement();
+
+  void tweak(double load_volume, double time);
+
+  void create_scatter(IceModelVec2S &v, int i0, int j0, petsc::VecScatter &result);
+
+  void set_real_part(VecScatter scatter, const IceModelVec2S &input, double normalization,
+                     fftw_complex *output);
+
+  void get_real_part(fftw_complex *input, double normalization);
+
+  void from_slab(VecScatter scatter, IceModelVec2S &output);
+
+  IceGrid::ConstPtr m_grid;
+
+  bool m_include_elastic;
+  // grid size
+  int m_Mx;
+  int m_My;
+  // grid spacing
+  double m_dx;
+  double m_dy;
+  //! load density (for computing load from its thickness)
+  double m_load_density;
+  //! mantle density
+  double m_mantle_density;
+  //! mantle viscosity
+  double m_eta;
+  //! lithosphere flexural rigidity
+  double m_D;
+
+  // acceleration due to gravity
+  double m_standard_gravity;
+
+  // size of the extended grid
+  int m_Nx;
+  int m_Ny;
+
+  // indices into extended grid for the corner of the physical grid
+  int m_i0_offset;
+  int m_j0_offset;
+
+  // half-lengths of the extended (FFT, spectral) computational domain
+  double m_Lx;
+  double m_Ly;
+
+  // Coefficients of derivatives in Fourier space
+  std::vector<double> m_cx, m_cy;
+
+  // Part of the extended grid owned by this process: rows [m_i_start, m_i_start + m_Nx_local)
+  // in physical space and [m_j_start, m_j_start + m_Ny_local) in Fourier space
+  ptrdiff_t m_i_start, m_Nx_local;
+  ptrdiff_t m_j_start, m_Ny_local;
+  //! number of complex values in each FFTW array owned by this process
+  ptrdiff_t m_alloc_local;
+
+  // viscous displacement on the extended grid
+  IceModelVec2S m_Uv;
+
+  // elastic plate displacement
+  IceModelVec2S m_Ue;
+
+  // total (viscous and elastic) plate displacement
+  IceModelVec2S m_U;
+
+  // storage for inputs on the PISM grid (without ghosts)
+  IceModelVec2S m_work;
+
+  //! real-valued storage using FFTW's distribution of the extended grid
+  petsc::Vec m_slab;
+
+  //! scatter from the PISM grid to the extended grid (corner at (m_i0_offset, m_j0_offset))
+  petsc::VecScatter m_centered;
+  //! scatter from the PISM grid to the corner of the extended grid
+  petsc::VecScatter m_corner;
+  //! scatter from the PISM grid to the extended grid (corner at (Nx/2, Ny/2))
+  petsc::VecScatter m_elastic;
+  //! scatter from the extended grid (PISM's decomposition) to FFTW's decomposition
+  petsc::VecScatter m_extended;
+
+  fftw_complex *m_fftw_input;
+  fftw_complex *m_fftw_output;
+  fftw_complex *m_loadhat;
+  fftw_complex *m_lrm_hat;
+
+  fftw_plan m_dft_forward;
+  fftw_plan m_dft_inverse;
+
+  Logger::ConstPtr m_log;
+};
+
+} // end of namespace bed
+} // end of namespace pism
+
+#endif /* LINGLECLARKPARALLEL_H */
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2009, 2011, 2013, 2014, 2015, 2016, 2017, 2018, 2019 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2009, 2011, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,7 @@
 
 #include <cassert>
 #include <cmath>                // sqrt
+#include <algorithm>            // std::fill
 #include <fftw3.h>
 #include <gsl/gsl_math.h>       // M_PI
 
@@ -89,19 +90,15 @@ LingleClarkSerial::LingleClarkSerial(Logger::ConstPtr log,
   m_j0_offset = (Ny - My) / 2;
 
   // memory allocation
-  PetscErrorCode ierr = 0;
 
   // total displacement
-  ierr = VecCreateSeq(PETSC_COMM_SELF, m_Mx * m_My, m_U.rawptr());;
-  PISM_CHK(ierr, "VecCreateSeq");
+  m_U.resize(m_Mx * m_My, 0.0);
 
   // elastic displacement
-  ierr = VecCreateSeq(PETSC_COMM_SELF, m_Mx * m_My, m_Ue.rawptr());;
-  PISM_CHK(ierr, "VecCreateSeq");
+  m_Ue.resize(m_Mx * m_My, 0.0);
 
   // viscous displacement
-  ierr = VecCreateSeq(PETSC_COMM_SELF, m_Nx * m_Ny, m_Uv.rawptr());
-  PISM_CHK(ierr, "VecCreateSeq");
+  m_Uv.resize(m_Nx * m_Ny, 0.0);
 
   // setup fftw stuff: FFTW builds "plans" based on observed performance
   m_fftw_input  = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
@@ -137,21 +134,21 @@ LingleClarkSerial::~LingleClarkSerial() {
 /*!
  * Return total displacement.
  */
-Vec LingleClarkSerial::total_displacement() const {
+const std::vector<double>& LingleClarkSerial::total_displacement() const {
   return m_U;
 }
 
 /*!
  * Return viscous plate displacement.
  */
-Vec LingleClarkSerial::viscous_displacement() const {
+const std::vector<double>& LingleClarkSerial::viscous_displacement() const {
   return m_Uv;
 }
 
 /*!
  * Return elastic plate displacement.
  */
-Vec LingleClarkSerial::elastic_displacement() const {
+const std::vector<double>& LingleClarkSerial::elastic_displacement() const {
   return m_Ue;
 }
 
@@ -249,8 +246,8 @@ void LingleClarkSerial::precompute_coefficients() {
  * @f$ \diff{u}{t} @f$ itself.
  *
  */
-void LingleClarkSerial::uplift_problem(Vec load_thickness, Vec bed_uplift,
-                                       Vec output) {
+void LingleClarkSerial::uplift_problem(const double *load_thickness, const double *bed_uplift,
+                                       double *output) {
 
   // Compute fft2(-load_density * g * load_thickness)
   {
@@ -315,17 +312,20 @@ void LingleClarkSerial::uplift_problem(Vec load_thickness, Vec bed_uplift,
  * Sets m_Uv, m_Ue, m_U.
  */
 void LingleClarkSerial::bootstrap(Vec thickness, Vec uplift) {
+  petsc::VecArray
+    H(thickness),
+    dbdt(uplift);
 
   // compute viscous displacement
-  uplift_problem(thickness, uplift, m_Uv);
+  uplift_problem(H.get(), dbdt.get(), m_Uv.data());
 
   if (m_include_elastic) {
-    compute_elastic_response(thickness, m_Ue);
+    compute_elastic_response(H.get(), m_Ue.data());
   } else {
-    PetscErrorCode ierr = VecSet(m_Ue, 0.0); PISM_CHK(ierr, "VecSet");
+    std::fill(m_Ue.begin(), m_Ue.end(), 0.0);
   }
 
-  update_displacement(m_Uv, m_Ue, m_U);
+  update_displacement(m_Uv.data(), m_Ue.data(), m_U.data());
 }
 
 /*!
@@ -338,17 +338,15 @@ void LingleClarkSerial::bootstrap(Vec thickness, Vec uplift) {
  */
 void LingleClarkSerial::init(Vec viscous_displacement,
                              Vec elastic_displacement) {
-  PetscErrorCode ierr = 0;
-
-  ierr = VecCopy(viscous_displacement, m_Uv);  PISM_CHK(ierr, "VecCopy");
+  copy_from_vec(viscous_displacement, m_Uv);
 
   if (m_include_elastic) {
-    ierr = VecCopy(elastic_displacement, m_Ue);  PISM_CHK(ierr, "VecCopy");
+    copy_from_vec(elastic_displacement, m_Ue);
   } else {
-    ierr = VecSet(m_Ue, 0.0); PISM_CHK(ierr, "VecSet");
+    std::fill(m_Ue.begin(), m_Ue.end(), 0.0);
   }
 
-  update_displacement(m_Uv, m_Ue, m_U);
+  update_displacement(m_Uv.data(), m_Ue.data(), m_U.data());
 }
 
 /*!
@@ -358,6 +356,16 @@ void LingleClarkSerial::init(Vec viscous_displacement,
  * @param[in] H load thickness on the physical (Mx*My) grid
  */
 void LingleClarkSerial::step(double dt, Vec H) {
+  petsc::VecArray load(H);
+  step(dt, load.get());
+}
+
+/*!
+ * Perform a time step.
+ *
+ * Same as above, but `H` is an array of size `Mx*My`. Does not use PETSc.
+ */
+void LingleClarkSerial::step(double dt, const double *H) {
   // solves:
   //     (2 eta |grad| U^{n+1}) + (dt/2) * (rho_r g U^{n+1} + D grad^4 U^{n+1})
   //   = (2 eta |grad| U^n) - (dt/2) * (rho_r g U^n + D grad^4 U^n) - dt * rho g H_start
@@ -387,7 +395,7 @@ void LingleClarkSerial::step(double dt, Vec H) {
     // Compute fft2(u).
     // no need to clear fftw_input: all values are overwritten
     {
-      set_real_part(m_Uv, 1.0, m_Nx, m_Ny, m_Nx, m_Ny, 0, 0, m_fftw_input);
+      set_real_part(m_Uv.data(), 1.0, m_Nx, m_Ny, m_Nx, m_Ny, 0, 0, m_fftw_input);
       fftw_execute(m_dft_forward);
     }
 
@@ -411,23 +419,24 @@ void LingleClarkSerial::step(double dt, Vec H) {
     }
 
     fftw_execute(m_dft_inverse);
-    get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_Nx, m_Ny, m_Nx, m_Ny, 0, 0, m_Uv);
+    get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_Nx, m_Ny, m_Nx, m_Ny, 0, 0,
+                  m_Uv.data());
 
     // Now tweak. (See the "correction" in section 5 of BuelerLingleBrown.)
     //
     // Here 1e16 approximates t = \infty.
-    tweak(H, m_Uv, m_Nx, m_Ny, 1e16);
+    tweak(H, m_Uv.data(), m_Nx, m_Ny, 1e16);
   } else {
     // zero time step: viscous displacement is zero
-    PetscErrorCode ierr = VecSet(m_Uv, 0.0); PISM_CHK(ierr, "VecSet");
+    std::fill(m_Uv.begin(), m_Uv.end(), 0.0);
   }
 
   // now compute elastic response if desired
   if (m_include_elastic) {
-    compute_elastic_response(H, m_Ue);
+    compute_elastic_response(H, m_Ue.data());
   }
 
-  update_displacement(m_Uv, m_Ue, m_U);
+  update_displacement(m_Uv.data(), m_Ue.data(), m_U.data());
 }
 
 /*!
@@ -436,7 +445,7 @@ void LingleClarkSerial::step(double dt, Vec H) {
  * @param[in] H load thickness (ice equivalent meters)
  * @param[out] dE elastic plate displacement
  */
-void LingleClarkSerial::compute_elastic_response(Vec H, Vec dE) {
+void LingleClarkSerial::compute_elastic_response(const double *H, double *dE) {
 
   // Compute fft2(load_density * H)
   //
@@ -480,18 +489,12 @@ void LingleClarkSerial::compute_elastic_response(Vec H, Vec dE) {
  * @param[in] dE elastic displacement
  * @param[out] dU total displacement
  */
-void LingleClarkSerial::update_displacement(Vec Uv, Vec Ue, Vec U) {
-  // PISM grid
-  petsc::VecArray2D
-    u(U, m_Mx, m_My),
-    u_elastic(Ue, m_Mx, m_My);
-  // extended grid
-  petsc::VecArray2D
-    u_viscous(Uv, m_Nx, m_Ny, m_i0_offset, m_j0_offset);
-
-  for (int i = 0; i < m_Mx; i++) {
-    for (int j = 0; j < m_My; j++) {
-      u(i, j) = u_viscous(i, j) + u_elastic(i, j);
+void LingleClarkSerial::update_displacement(const double *Uv, const double *Ue, double *U) {
+  for (int j = 0; j < m_My; j++) {
+    // viscous displacement is defined on the extended grid
+    const double *u_viscous = Uv + (j + m_j0_offset) * m_Nx + m_i0_offset;
+    for (int i = 0; i < m_Mx; i++) {
+      U[j * m_Mx + i] = u_viscous[i] + Ue[j * m_Mx + i];
     }
   }
 }
@@ -509,20 +512,18 @@ void LingleClarkSerial::update_displacement(Vec Uv, Vec Ue, Vec U) {
  * @param[in] Ny grid size
  * @param[in] time time, seconds (usually 0 or a large number approximating \infty)
  */
-void LingleClarkSerial::tweak(Vec load_thickness, Vec U, int Nx, int Ny, double time) {
-  PetscErrorCode ierr = 0;
-  petsc::VecArray2D u(U, Nx, Ny);
-
+void LingleClarkSerial::tweak(const double *load_thickness, double *U, int Nx, int Ny,
+                              double time) {
   // find average value along "distant" boundary of [-Lx, Lx]X[-Ly, Ly]
   // note domain is periodic, so think of cut locus of torus (!)
   // (will remove it:   uun1=uun1-(sum(uun1(1, :))+sum(uun1(:, 1)))/(2*N);)
   double average = 0.0;
   for (int i = 0; i < Nx; i++) {
-    average += u(i, 0);
+    average += U[i];             // U(i, 0)
   }
 
   for (int j = 0; j < Ny; j++) {
-    average += u(0, j);
+    average += U[j * Nx];        // U(0, j)
   }
 
   average /= (double) (Nx + Ny);
@@ -537,7 +538,9 @@ void LingleClarkSerial::tweak(Vec load_thickness, Vec U, int Nx, int Ny, double
     const double R         = L_average * (2.0 / 3.0);
 
     double H_sum = 0.0;
-    ierr = VecSum(load_thickness, &H_sum); PISM_CHK(ierr, "VecSum");
+    for (int k = 0; k < m_Mx * m_My; ++k) {
+      H_sum += load_thickness[k];
+    }
 
     // compute disc thickness by dividing its volume by the area
     const double H = (H_sum * m_dx * m_dy) / (M_PI * R * R);
@@ -552,7 +555,9 @@ void LingleClarkSerial::tweak(Vec load_thickness, Vec U, int Nx, int Ny, double
                      m_eta);             // mantle viscosity
   }
 
-  ierr = VecShift(U, shift - average); PISM_CHK(ierr, "VecShift");
+  for (int k = 0; k < Nx * Ny; ++k) {
+    U[k] += shift - average;
+  }
 }
 
 } // end of namespace bed
@@ -1,4 +1,4 @@
-// Copyright (C) 2007--2009, 2011, 2012, 2013, 2014, 2015, 2017, 2018, 2019 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2007--2009, 2011, 2012, 2013, 2014, 2015, 2017, 2018, 2019, 2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -23,7 +23,6 @@
 
 #include <petscvec.h>
 #include <fftw3.h>
-#include <vector>
 
 #include "pism/util/petscwrappers/Vec.hh"
 #include "pism/util/Logger.hh"
@@ -50,6 +49,9 @@ namespace bed {
   run only on processor zero (or possibly by each processor once each processor
   owns the entire 2D gridded load thicknesses and bed elevations.)
 
+  The model state is stored in plain arrays and step(double, const double*) does not use
+  PETSc, so it can be run in a thread other than the main one (see Proc0Task).
+
   This model always assumes that we start with no load. Note that this does not mean that we
   starting state is the equilibrium: the viscous plate may be "pre-bent" by using a provided
   displacement field or by computing its displacement using an uplift field.
@@ -71,21 +73,24 @@ public:
 
   void step(double dt_seconds, Vec H);
 
-  Vec total_displacement() const;
+  void step(double dt_seconds, const double *H);
+
+  const std::vector<double>& total_displacement() const;
 
-  Vec viscous_displacement() const;
+  const std::vector<double>& viscous_displacement() const;
 
-  Vec elastic_displacement() const;
+  const std::vector<double>& elastic_displacement() const;
 
   void compute_load_response_matrix(fftw_complex *output);
 private:
-  void compute_elastic_response(Vec H, Vec dE);
+  void compute_elastic_response(const double *H, double *dE);
 
-  void uplift_problem(Vec load_thickness, Vec bed_uplift, Vec output);
+  void uplift_problem(const double *load_thickness, const double *bed_uplift,
+                      double *output);
 
   void precompute_coefficients();
 
-  void update_displacement(Vec V, Vec dE, Vec dU);
+  void update_displacement(const double *Uv, const double *Ue, double *U);
 
   bool m_include_elastic;
   // grid size
@@ -122,13 +127,13 @@ private:
   std::vector<double> m_cx, m_cy;
 
   // viscous displacement on the extended grid
-  petsc::Vec m_Uv;
+  std::vector<double> m_Uv;
 
   // elastic plate displacement
-  petsc::Vec m_Ue;
+  std::vector<double> m_Ue;
 
   // total (viscous and elastic) plate displacement
-  petsc::Vec m_U;
+  std::vector<double> m_U;
 
   fftw_complex *m_fftw_input;
   fftw_complex *m_fftw_output;
@@ -138,7 +143,7 @@ private:
   fftw_plan m_dft_forward;
   fftw_plan m_dft_inverse;
 
-  void tweak(Vec load_thickness, Vec U, int Nx, int Ny, double time);
+  void tweak(const double *load_thickness, double *U, int Nx, int Ny, double time);
 
   Logger::ConstPtr m_log;
 };
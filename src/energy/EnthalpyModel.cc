@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -26,6 +26,7 @@
 #include "pism/util/io/File.hh"
 #include "utilities.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/threading.hh"
 
 namespace pism {
 namespace energy {
@@ -138,12 +139,15 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
     &ice_surface_temp         = *inputs.surface_temp,
     &till_water_thickness     = *inputs.till_water_thickness;
 
-  energy::enthSystemCtx system(m_grid->z(), "energy.enthalpy", m_grid->dx(), m_grid->dy(), dt,
-                               *m_config, m_ice_enthalpy, u3, v3, w3, strain_heating3, EC);
+  // each thread needs its own column system and storage for the new enthalpy
+  PerThread<energy::enthSystemCtx> systems(m_grid->z(), "energy.enthalpy",
+                                           m_grid->dx(), m_grid->dy(), dt,
+                                           *m_config, m_ice_enthalpy, u3, v3, w3,
+                                           strain_heating3, EC);
 
-  const size_t Mz_fine = system.z().size();
-  const double dz = system.dz();
-  std::vector<double> Enthnew(Mz_fine); // new enthalpy in column
+  const size_t Mz_fine = systems[0].z().size();
+  const double dz = systems[0].dz();
+  PerThread<std::vector<double> > Enthnew_storage(Mz_fine); // new enthalpy in column
 
   IceModelVec::AccessList list{&ice_surface_temp, &shelf_base_temp, &surface_liquid_fraction,
       &ice_thickness, &basal_frictional_heating, &basal_heat_flux, &till_water_thickness,
@@ -152,12 +156,15 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
 
   double margin_threshold = m_config->get_number("energy.margin_ice_thickness_limit");
 
-  unsigned int liquifiedCount = 0;
+  PerThread<unsigned int> liquified_count(0u);
+  PerThread<EnergyModelStats> stats;
 
   ParallelSection loop(m_grid->com);
   try {
-    for (Points pt(*m_grid); pt; pt.next()) {
-      const int i = pt.i(), j = pt.j();
+    parallel_for(*m_grid, [&](int i, int j) {
+      energy::enthSystemCtx &system = systems.get();
+      std::vector<double> &Enthnew = Enthnew_storage.get();
+      EnergyModelStats &thread_stats = stats.get();
 
       const double H = ice_thickness(i, j);
 
@@ -182,11 +189,11 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
         // case and set to zero for now. Also, there is no basal melt
         // rate on ice free land and ice free ocean
         m_basal_melt_rate(i, j) = 0.0;
-        continue;
+        return;
       } // end of if (ice_free_column)
 
       if (system.lambda() < 1.0) {
-        m_stats.reduced_accuracy_counter += 1; // count columns with lambda < 1
+        thread_stats.reduced_accuracy_counter += 1; // count columns with lambda < 1
       }
 
       const bool
@@ -247,7 +254,7 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
               L     = EC->L(T_m);
 
             if (Enthnew[k] >= system.Enth_s(k) + 0.5 * L) {
-              liquifiedCount++; // count these rare events...
+              liquified_count.get()++; // count these rare events...
               Enthnew[k] = system.Enth_s(k) + 0.5 * L; //  but lose the energy
             }
 
@@ -270,7 +277,7 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
           if (Enthnew[k] < lowerEnthLimit) {
             // Count grid points which have very large cold limit advection bulge... enthalpy not
             // too low.
-            m_stats.bulge_counter += 1;
+            thread_stats.bulge_counter += 1;
             Enthnew[k] = lowerEnthLimit;
           }
         }
@@ -373,12 +380,18 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
       } // end of the basal melt rate computation
 
       system.fine_to_coarse(Enthnew, i, j, m_work);
-    }
+    });
   } catch (...) {
     loop.failed();
   }
   loop.check();
 
+  unsigned int liquifiedCount = 0;
+  for (int k = 0; k < stats.size(); ++k) {
+    m_stats += stats[k];
+    liquifiedCount += liquified_count[k];
+  }
+
   m_stats.liquified_ice_volume = ((double) liquifiedCount) * dz * m_grid->cell_area();
 }
 
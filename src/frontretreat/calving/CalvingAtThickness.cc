@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -95,8 +95,7 @@ void CalvingAtThickness::update(IceModelVec2CellType &pism_mask,
     }
   }
 
-  pism_mask.update_ghosts();
-  ice_thickness.update_ghosts();
+  update_ghosts({&pism_mask, &ice_thickness});
 }
 
 const IceModelVec2S& CalvingAtThickness::threshold() const {
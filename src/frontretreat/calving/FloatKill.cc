@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -85,8 +85,7 @@ void FloatKill::update(IceModelVec2CellType &mask, IceModelVec2S &ice_thickness)
     }
   }
 
-  mask.update_ghosts();
-  ice_thickness.update_ghosts();
+  update_ghosts({&mask, &ice_thickness});
 }
 
 } // end of namespace calving
@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -18,21 +18,26 @@
  */
 
 #include "IcebergRemover.hh"
-#include "pism/util/connected_components.hh"
+#include "pism/util/label_components.hh"
 #include "pism/util/Mask.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/Diagnostic.hh"
+#include "pism/util/pism_utilities.hh"
 
 namespace pism {
 namespace calving {
 
 IcebergRemover::IcebergRemover(IceGrid::ConstPtr g)
   : Component(g),
-    m_iceberg_mask(m_grid, "iceberg_mask", WITHOUT_GHOSTS){
-
-  m_mask_p0 = m_iceberg_mask.allocate_proc0_copy();
+    m_iceberg_mask(m_grid, "iceberg_mask", WITHOUT_GHOSTS),
+    m_last_input(m_grid, "iceberg_mask_last", WITHOUT_GHOSTS),
+    m_last_input_valid(false),
+    m_labelings_performed(0),
+    m_labelings_skipped(0) {
+  // empty
 }
 
 IcebergRemover::~IcebergRemover() {
@@ -40,6 +45,7 @@ IcebergRemover::~IcebergRemover() {
 }
 
 void IcebergRemover::init() {
+  m_last_input_valid = false;
 }
 
 /**
@@ -82,28 +88,21 @@ void IcebergRemover::update(const IceModelVec2Int &bc_mask,
     }
   }
 
-  // identify icebergs using serial code on processor 0:
-  {
-    m_iceberg_mask.put_on_proc0(*m_mask_p0);
-
-    ParallelSection rank0(m_grid->com);
-    try {
-      if (m_grid->rank() == 0) {
-        petsc::VecArray mask_p0(*m_mask_p0);
-        label_connected_components(mask_p0.get(), m_grid->My(), m_grid->Mx(), true, mask_grounded_ice);
-      }
-    } catch (...) {
-      rank0.failed();
-    }
-    rank0.check();
+  if (not input_changed()) {
+    // The ice cover is the same as after the last call, so there are no icebergs.
+    m_labelings_skipped += 1;
+  } else {
+    // save the labeling input: label_components() overwrites it
+    m_last_input.copy_from(m_iceberg_mask);
 
-    m_iceberg_mask.get_from_proc0(*m_mask_p0);
-  }
+    // identify icebergs:
+    label_components(m_iceberg_mask, true, mask_grounded_ice);
+    m_labelings_performed += 1;
 
-  // correct ice thickness and the cell type mask using the resulting
-  // "iceberg" mask:
-  {
-    IceModelVec::AccessList list{&ice_thickness, &mask, &m_iceberg_mask, &bc_mask};
+    // correct ice thickness and the cell type mask using the resulting
+    // "iceberg" mask:
+    IceModelVec::AccessList list{&ice_thickness, &mask, &m_iceberg_mask, &bc_mask,
+                                 &m_last_input};
 
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
@@ -111,14 +110,92 @@ void IcebergRemover::update(const IceModelVec2Int &bc_mask,
       if (m_iceberg_mask(i,j) > 0.5 && bc_mask(i,j) < 0.5) {
         ice_thickness(i,j) = 0.0;
         mask(i,j)     = MASK_ICE_FREE_OCEAN;
+        // this is what the labeling input will look like during the next call
+        m_last_input(i, j) = 0;
       }
     }
+    m_last_input_valid = true;
   }
 
   // update ghosts of the mask and the ice thickness (then surface
   // elevation can be updated redundantly)
-  mask.update_ghosts();
-  ice_thickness.update_ghosts();
+  update_ghosts({&mask, &ice_thickness});
+}
+
+/*!
+ * Return true if the labeling input in m_iceberg_mask differs from the one saved during
+ * the last call (with icebergs removed).
+ *
+ * Compares masks exactly: this costs one pass over the grid and one reduction, which is
+ * much cheaper than labeling.
+ */
+bool IcebergRemover::input_changed() const {
+  if (not m_last_input_valid) {
+    return true;
+  }
+
+  IceModelVec::AccessList list{&m_iceberg_mask, &m_last_input};
+
+  double changed = 0.0;
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (m_iceberg_mask.as_int(i, j) != m_last_input.as_int(i, j)) {
+      changed = 1.0;
+      break;
+    }
+  }
+
+  return GlobalMax(m_grid->com, changed) > 0.0;
+}
+
+unsigned int IcebergRemover::labelings_performed() const {
+  return m_labelings_performed;
+}
+
+unsigned int IcebergRemover::labelings_skipped() const {
+  return m_labelings_skipped;
+}
+
+/*! @brief Number of connected component labelings performed by the iceberg remover. */
+class IcebergLabelingsPerformed : public TSDiag<TSSnapshotDiagnostic, IcebergRemover> {
+public:
+  IcebergLabelingsPerformed(const IcebergRemover *m)
+    : TSDiag<TSSnapshotDiagnostic, IcebergRemover>(m, "iceberg_labelings_performed") {
+
+    set_units("1", "1");
+    m_ts.variable().set_string("long_name",
+                               "number of times icebergs were identified using"
+                               " connected component labeling since the start of the run");
+  }
+protected:
+  double compute() {
+    return model->labelings_performed();
+  }
+};
+
+/*! @brief Number of labelings skipped because the ice cover did not change. */
+class IcebergLabelingsSkipped : public TSDiag<TSSnapshotDiagnostic, IcebergRemover> {
+public:
+  IcebergLabelingsSkipped(const IcebergRemover *m)
+    : TSDiag<TSSnapshotDiagnostic, IcebergRemover>(m, "iceberg_labelings_skipped") {
+
+    set_units("1", "1");
+    m_ts.variable().set_string("long_name",
+                               "number of times iceberg identification was skipped"
+                               " because the ice cover did not change since the last call");
+  }
+protected:
+  double compute() {
+    return model->labelings_skipped();
+  }
+};
+
+TSDiagnosticList IcebergRemover::ts_diagnostics_impl() const {
+  return {
+    {"iceberg_labelings_performed", TSDiagnostic::Ptr(new IcebergLabelingsPerformed(this))},
+    {"iceberg_labelings_skipped",   TSDiagnostic::Ptr(new IcebergLabelingsSkipped(this))}
+  };
 }
 
 } // end of namespace calving
@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -43,8 +43,12 @@ namespace calving {
  * They are observed to cause unrealistically large velocities that
  * may affect ice velocities elsewhere.
  *
- * This class uses a serial connected component labeling algorithm to
- * remove "icebergs".
+ * This class uses a connected component labeling algorithm to remove
+ * "icebergs".
+ *
+ * Labeling is skipped if the input of the labeling algorithm is the same as
+ * during the previous call (after removing icebergs found then): in this case
+ * we already know that there are no icebergs to remove.
  */
 class IcebergRemover : public Component
 {
@@ -56,9 +60,25 @@ public:
   void update(const IceModelVec2Int &bc_mask,
               IceModelVec2CellType &pism_mask,
               IceModelVec2S &ice_thickness);
+
+  //! Number of times connected component labeling was performed.
+  unsigned int labelings_performed() const;
+  //! Number of times labeling was skipped because the ice cover did not change.
+  unsigned int labelings_skipped() const;
 protected:
-  IceModelVec2S m_iceberg_mask;
-  petsc::Vec::Ptr m_mask_p0;
+  TSDiagnosticList ts_diagnostics_impl() const;
+
+  bool input_changed() const;
+
+  IceModelVec2Int m_iceberg_mask;
+
+  //! Labeling input used during the last call, with icebergs removed
+  IceModelVec2Int m_last_input;
+  //! True if m_last_input contains a valid copy
+  bool m_last_input_valid;
+
+  unsigned int m_labelings_performed;
+  unsigned int m_labelings_skipped;
 };
 
 } // end of namespace calving
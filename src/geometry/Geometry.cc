@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -167,10 +167,7 @@ void Geometry::ensure_consistency(double ice_free_thickness_threshold) {
     loop.check();
   }
 
-  ice_thickness.update_ghosts();
-  ice_area_specific_volume.update_ghosts();
-  cell_type.update_ghosts();
-  ice_surface_elevation.update_ghosts();
+  update_ghosts({&ice_thickness, &ice_area_specific_volume, &cell_type, &ice_surface_elevation});
 
   const double
     ice_density = config->get_number("constants.ice.density"),
@@ -236,9 +233,7 @@ double ice_volume(const Geometry &geometry, double thickness_threshold) {
     for (Points p(*grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      if (geometry.ice_thickness(i,j) >= thickness_threshold) {
-        volume += geometry.ice_thickness(i,j) * cell_area;
-      }
+      volume += cell_ice_volume(geometry.ice_thickness(i, j), thickness_threshold, cell_area);
     }
   }
 
@@ -261,9 +256,9 @@ double ice_volume_not_displacing_seawater(const Geometry &geometry,
   auto config = grid->ctx()->config();
 
   const double
-    sea_water_density = config->get_number("constants.sea_water.density"),
-    ice_density       = config->get_number("constants.ice.density"),
-    cell_area         = grid->cell_area();
+    density_ratio = (config->get_number("constants.sea_water.density") /
+                     config->get_number("constants.ice.density")),
+    cell_area     = grid->cell_area();
 
   IceModelVec::AccessList list{&geometry.cell_type, &geometry.ice_thickness,
       &geometry.bed_elevation, &geometry.sea_level_elevation};
@@ -273,20 +268,13 @@ double ice_volume_not_displacing_seawater(const Geometry &geometry,
   for (Points p(*grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    const double
-      bed       = geometry.bed_elevation(i, j),
-      thickness = geometry.ice_thickness(i, j),
-      sea_level = geometry.sea_level_elevation(i, j);
-
-    if (geometry.cell_type.grounded(i, j) and thickness > thickness_threshold) {
-      const double cell_ice_volume = thickness * cell_area;
-      if (bed > sea_level) {
-        volume += cell_ice_volume;
-      } else {
-        const double max_floating_volume = (sea_level - bed) * cell_area * (sea_water_density / ice_density);
-        volume += cell_ice_volume - max_floating_volume;
-      }
-    }
+    volume += cell_ice_volume_not_displacing_seawater(geometry.cell_type.grounded(i, j),
+                                                      geometry.ice_thickness(i, j),
+                                                      geometry.bed_elevation(i, j),
+                                                      geometry.sea_level_elevation(i, j),
+                                                      thickness_threshold,
+                                                      density_ratio,
+                                                      cell_area);
   } // end of the loop over grid points
 
   return GlobalSum(grid->com, volume);
@@ -304,9 +292,7 @@ double ice_area(const Geometry &geometry, double thickness_threshold) {
   for (Points p(*grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    if (geometry.ice_thickness(i, j) >= thickness_threshold) {
-      area += cell_area;
-    }
+    area += cell_ice_area(true, geometry.ice_thickness(i, j), thickness_threshold, cell_area);
   }
 
   return GlobalSum(grid->com, area);
@@ -324,10 +310,8 @@ double ice_area_grounded(const Geometry &geometry, double thickness_threshold) {
   for (Points p(*grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    if (geometry.cell_type.grounded(i, j) and
-        geometry.ice_thickness(i, j) >= thickness_threshold) {
-      area += cell_area;
-    }
+    area += cell_ice_area(geometry.cell_type.grounded(i, j), geometry.ice_thickness(i, j),
+                          thickness_threshold, cell_area);
   }
 
   return GlobalSum(grid->com, area);
@@ -345,10 +329,8 @@ double ice_area_floating(const Geometry &geometry, double thickness_threshold) {
   for (Points p(*grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    if (geometry.cell_type.ocean(i, j) and
-        geometry.ice_thickness(i, j) >= thickness_threshold) {
-      area += cell_area;
-    }
+    area += cell_ice_area(geometry.cell_type.ocean(i, j), geometry.ice_thickness(i, j),
+                          thickness_threshold, cell_area);
   }
 
   return GlobalSum(grid->com, area);
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -69,6 +69,45 @@ double ice_volume_not_displacing_seawater(const Geometry &geometry,
                                           double thickness_threshold);
 double sea_level_rise_potential(const Geometry &geometry, double thickness_threshold);
 
+/*!
+ * Contributions of one grid cell to ice_volume(), ice_area(), ice_area_grounded(),
+ * ice_area_floating() and ice_volume_not_displacing_seawater().
+ *
+ * These are shared with scalar diagnostics that compute the same sums in one pass over
+ * the grid.
+ */
+inline double cell_ice_volume(double thickness, double thickness_threshold, double cell_area) {
+  return thickness >= thickness_threshold ? thickness * cell_area : 0.0;
+}
+
+inline double cell_ice_area(bool included, double thickness, double thickness_threshold,
+                            double cell_area) {
+  return (included and thickness >= thickness_threshold) ? cell_area : 0.0;
+}
+
+/*!
+ * @param[in] density_ratio ratio of sea water density to ice density
+ */
+inline double cell_ice_volume_not_displacing_seawater(bool grounded,
+                                                      double thickness,
+                                                      double bed,
+                                                      double sea_level,
+                                                      double thickness_threshold,
+                                                      double density_ratio,
+                                                      double cell_area) {
+  if (not (grounded and thickness > thickness_threshold)) {
+    return 0.0;
+  }
+
+  const double volume = thickness * cell_area;
+  if (bed > sea_level) {
+    return volume;
+  }
+
+  const double max_floating_volume = (sea_level - bed) * cell_area * density_ratio;
+  return volume - max_floating_volume;
+}
+
 void set_no_model_strip(const IceGrid &grid, double width, IceModelVec2Int &result);
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -273,10 +273,8 @@ void GeometryEvolution::flow_step(const Geometry &geometry, double dt,
                            m_impl->flux_staggered);    // out
   m_impl->profile.end("ge.interface_fluxes");
 
-  m_impl->flux_staggered.update_ghosts();
-
   m_impl->profile.begin("ge.flux_divergence");
-  compute_flux_divergence(m_impl->flux_staggered,   // in (uses ghosts)
+  compute_flux_divergence(m_impl->flux_staggered,   // in (ghosts are updated)
                           thickness_bc_mask,        // in
                           m_impl->flux_divergence); // out
   m_impl->profile.end("ge.flux_divergence");
@@ -544,91 +542,93 @@ void GeometryEvolution::compute_interface_fluxes(const IceModelVec2CellType &cel
 
   ParallelSection loop(m_grid->com);
   try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int
-        i  = p.i(),
-        j  = p.j(),
-        M  = cell_type(i, j),
-        BC = velocity_bc_mask.as_int(i, j);
-
-      const double H = ice_thickness(i, j);
-      const Vector2 V  = velocity(i, j);
-
-      for (int n = 0; n < 2; ++n) {
+    for (Tiles t(*m_grid); t; t.next()) {
+      for (PointsInTile p(t); p; p.next()) {
         const int
-          oi  = 1 - n,               // offset in the i direction
-          oj  = n,                   // offset in the j direction
-          i_n = i + oi,              // i index of a neighbor
-          j_n = j + oj;              // j index of a neighbor
+          i  = p.i(),
+          j  = p.j(),
+          M  = cell_type(i, j),
+          BC = velocity_bc_mask.as_int(i, j);
 
-        const int M_n = cell_type(i_n, j_n);
+        const double H = ice_thickness(i, j);
+        const Vector2 V  = velocity(i, j);
 
-        // advective velocity at the current interface
-        double v = 0.0;
-        {
-          const Vector2 V_n  = velocity(i_n, j_n);
+        for (int n = 0; n < 2; ++n) {
+          const int
+            oi  = 1 - n,               // offset in the i direction
+            oj  = n,                   // offset in the j direction
+            i_n = i + oi,              // i index of a neighbor
+            j_n = j + oj;              // j index of a neighbor
 
-          // Regular case
+          const int M_n = cell_type(i_n, j_n);
+
+          // advective velocity at the current interface
+          double v = 0.0;
           {
-            if (icy(M) and icy(M_n)) {
-              // Case 1: both sides of the interface are icy
-              v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
+            const Vector2 V_n  = velocity(i_n, j_n);
+
+            // Regular case
+            {
+              if (icy(M) and icy(M_n)) {
+                // Case 1: both sides of the interface are icy
+                v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
 
-            } else if (icy(M) and ice_free(M_n)) {
-              // Case 2: icy cell next to an ice-free cell
-              v = (n == 0 ? V.u : V.v);
+              } else if (icy(M) and ice_free(M_n)) {
+                // Case 2: icy cell next to an ice-free cell
+                v = (n == 0 ? V.u : V.v);
 
-            } else if (ice_free(M) and icy(M_n)) {
-              // Case 3: ice-free cell next to icy cell
-              v = (n == 0 ? V_n.u : V_n.v);
+              } else if (ice_free(M) and icy(M_n)) {
+                // Case 3: ice-free cell next to icy cell
+                v = (n == 0 ? V_n.u : V_n.v);
 
-            } else if (ice_free(M) and ice_free(M_n)) {
-              // Case 4: both sides of the interface are ice-free
-              v = 0.0;
+              } else if (ice_free(M) and ice_free(M_n)) {
+                // Case 4: both sides of the interface are ice-free
+                v = 0.0;
 
+              }
             }
-          }
 
-          // The Dirichlet B.C. case:
-          {
-            const int BC_n = velocity_bc_mask.as_int(i_n, j_n);
+            // The Dirichlet B.C. case:
+            {
+              const int BC_n = velocity_bc_mask.as_int(i_n, j_n);
 
-            if (BC == 1 and BC_n == 1) {
-              // Case 1: both sides of the interface are B.C. locations: average from
-              // the regular grid onto the staggered grid.
-              v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
+              if (BC == 1 and BC_n == 1) {
+                // Case 1: both sides of the interface are B.C. locations: average from
+                // the regular grid onto the staggered grid.
+                v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
 
-            } else if (BC == 1 and BC_n == 0) {
-              // Case 2: at a Dirichlet B.C. location next to a regular location
-              v = (n == 0 ? V.u : V.v);
+              } else if (BC == 1 and BC_n == 0) {
+                // Case 2: at a Dirichlet B.C. location next to a regular location
+                v = (n == 0 ? V.u : V.v);
 
-            } else if (BC == 0 and BC_n == 1) {
+              } else if (BC == 0 and BC_n == 1) {
 
-              // Case 3: at a regular location next to a Dirichlet B.C. location
-              v = (n == 0 ? V_n.u : V_n.v);
+                // Case 3: at a regular location next to a Dirichlet B.C. location
+                v = (n == 0 ? V_n.u : V_n.v);
 
-            } else {
-              // Case 4: elsewhere.
-              // No Dirichlet B.C. adjustment here.
-            }
+              } else {
+                // Case 4: elsewhere.
+                // No Dirichlet B.C. adjustment here.
+              }
 
-          } // end of the Dirichlet B.C. case
+            } // end of the Dirichlet B.C. case
 
-          // finally, limit advective velocities
-          v = limit_advective_velocity(M, M_n, v);
-        }
+            // finally, limit advective velocities
+            v = limit_advective_velocity(M, M_n, v);
+          }
 
-        // advective flux
-        const double
-          H_n         = ice_thickness(i_n, j_n),
-          Q_advective = v * (v > 0.0 ? H : H_n); // first order upwinding
+          // advective flux
+          const double
+            H_n         = ice_thickness(i_n, j_n),
+            Q_advective = v * (v > 0.0 ? H : H_n); // first order upwinding
 
-        // diffusive flux
-        const double
-          Q_diffusive = limit_diffusive_flux(M, M_n, diffusive_flux(i, j, n));
+          // diffusive flux
+          const double
+            Q_diffusive = limit_diffusive_flux(M, M_n, diffusive_flux(i, j, n));
 
-        output(i, j, n) = Q_diffusive + Q_advective;
-      } // end of the loop over neighbors (n)
+          output(i, j, n) = Q_diffusive + Q_advective;
+        } // end of the loop over neighbors (n)
+      }
     }
   } catch (...) {
     loop.failed();
@@ -640,8 +640,11 @@ void GeometryEvolution::compute_interface_fluxes(const IceModelVec2CellType &cel
  * Compute flux divergence using cell interface fluxes on the staggered grid.
  *
  * The flux divergence at *ice thickness* Dirichlet B.C. locations is set to zero.
+ *
+ * Updates ghosts of `flux`, computing the divergence at points that do not need them
+ * while the update is in progress.
  */
-void GeometryEvolution::compute_flux_divergence(const IceModelVec2Stag &flux,
+void GeometryEvolution::compute_flux_divergence(IceModelVec2Stag &flux,
                                                 const IceModelVec2Int &thickness_bc_mask,
                                                 IceModelVec2S &output) {
   const double
@@ -650,18 +653,32 @@ void GeometryEvolution::compute_flux_divergence(const IceModelVec2Stag &flux,
 
   IceModelVec::AccessList list{&flux, &thickness_bc_mask, &output};
 
+  auto divergence = [&](int i, int j) {
+    if (thickness_bc_mask(i, j) > 0.5) {
+      output(i, j) = 0.0;
+    } else {
+      StarStencil<double> Q = flux.star(i, j);
+
+      output(i, j) = (Q.e - Q.w) / dx + (Q.n - Q.s) / dy;
+    }
+  };
+
+  GhostUpdate ghosts({&flux});
+
   ParallelSection loop(m_grid->com);
   try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+    for (PointsInterior p(*m_grid); p; p.next()) {
+      divergence(p.i(), p.j());
+    }
+  } catch (...) {
+    loop.failed();
+  }
 
-      if (thickness_bc_mask(i, j) > 0.5) {
-        output(i, j) = 0.0;
-      } else {
-        StarStencil<double> Q = flux.star(i, j);
+  ghosts.finish();
 
-        output(i, j) = (Q.e - Q.w) / dx + (Q.n - Q.s) / dy;
-      }
+  try {
+    for (PointsBoundary p(*m_grid); p; p.next()) {
+      divergence(p.i(), p.j());
     }
   } catch (...) {
     loop.failed();
@@ -863,7 +880,8 @@ void GeometryEvolution::residual_redistribution_iteration(const IceModelVec2S  &
       }
     }
 
-    residual.update_ghosts();
+    // ice_thickness is not modified below, so we can update its ghosts now
+    update_ghosts({&residual, &ice_thickness});
 
     // update area_specific_volume using adjusted residuals
     for (Points p(*m_grid); p; p.next()) {
@@ -881,8 +899,6 @@ void GeometryEvolution::residual_redistribution_iteration(const IceModelVec2S  &
     residual.set(0.0);
   }
 
-  ice_thickness.update_ghosts();
-
   // Store ice thickness. We need this copy to make sure that modifying ice_thickness in the loop
   // below does not affect the computation of the threshold thickness. (Note that
   // part_grid_threshold_thickness uses neighboring values of the mask, ice thickness, and surface
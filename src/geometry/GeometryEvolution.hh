@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -98,7 +98,7 @@ protected:
                                         const IceModelVec2Stag     &diffusive_flux,
                                         IceModelVec2Stag           &output);
 
-  virtual void compute_flux_divergence(const IceModelVec2Stag &flux_staggered,
+  virtual void compute_flux_divergence(IceModelVec2Stag &flux_staggered,
                                        const IceModelVec2Int &thickness_bc_mask,
                                        IceModelVec2S &flux_fivergence);
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2019 PISM Authors
+// Copyright (C) 2012-2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -325,8 +325,7 @@ void Distributed::update_impl(double t, double dt, const Inputs& inputs) {
   m_Qstag_average.set(0.0);
 
   // make sure W,P have valid ghosts before starting hydrology steps
-  m_W.update_ghosts();
-  m_P.update_ghosts();
+  update_ghosts({&m_W, &m_P});
 
 #if (Pism_DEBUG==1)
   double tillwat_max = m_config->get_number("hydrology.tillwat_max");
@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2019 PISM Authors
+// Copyright (C) 2012-2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -480,17 +480,19 @@ void Routing::compute_conductivity(const IceModelVec2Stag &W,
       P.add(m_rg, bed_elevation, m_R);  // yes, it updates ghosts
 
       list.add(m_R);
-      for (Points p(*m_grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
-
-        double dRdx, dRdy;
-        dRdx = (m_R(i + 1, j) - m_R(i, j)) / m_dx;
-        dRdy = (m_R(i + 1, j + 1) + m_R(i, j + 1) - m_R(i + 1, j - 1) - m_R(i, j - 1)) / (4.0 * m_dy);
-        result(i, j, 0) = dRdx * dRdx + dRdy * dRdy;
-
-        dRdx = (m_R(i + 1, j + 1) + m_R(i + 1, j) - m_R(i - 1, j + 1) - m_R(i - 1, j)) / (4.0 * m_dx);
-        dRdy = (m_R(i, j + 1) - m_R(i, j)) / m_dy;
-        result(i, j, 1) = dRdx * dRdx + dRdy * dRdy;
+      for (Tiles t(*m_grid); t; t.next()) {
+        for (PointsInTile p(t); p; p.next()) {
+          const int i = p.i(), j = p.j();
+
+          double dRdx, dRdy;
+          dRdx = (m_R(i + 1, j) - m_R(i, j)) / m_dx;
+          dRdy = (m_R(i + 1, j + 1) + m_R(i, j + 1) - m_R(i + 1, j - 1) - m_R(i, j - 1)) / (4.0 * m_dy);
+          result(i, j, 0) = dRdx * dRdx + dRdy * dRdy;
+
+          dRdx = (m_R(i + 1, j + 1) + m_R(i + 1, j) - m_R(i - 1, j + 1) - m_R(i - 1, j)) / (4.0 * m_dx);
+          dRdy = (m_R(i, j + 1) - m_R(i, j)) / m_dy;
+          result(i, j, 1) = dRdx * dRdx + dRdy * dRdy;
+        }
       }
     }
 
@@ -635,13 +637,16 @@ void Routing::compute_velocity(const IceModelVec2Stag &W,
                                const IceModelVec2Int *no_model_mask,
                                IceModelVec2Stag &result) const {
   IceModelVec2S &P = m_R;
-  P.copy_from(pressure);  // yes, it updates ghosts
 
-  IceModelVec::AccessList list{&P, &W, &K, &bed, &result};
+  IceModelVec::AccessList list{&P, &pressure, &W, &K, &bed, &result};
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
+    P(i, j) = pressure(i, j);
+  }
+
+  auto velocity = [&](int i, int j) {
     if (W(i, j, 0) > 0.0) {
       double
         P_x = (P(i + 1, j) - P(i, j)) / m_dx,
@@ -659,6 +664,21 @@ void Routing::compute_velocity(const IceModelVec2Stag &W,
     } else {
       result(i, j, 1) = 0.0;
     }
+  };
+
+  // compute velocity at interior points while ghosts of P are updated
+  {
+    GhostUpdate ghosts({&P});
+
+    for (PointsInterior p(*m_grid); p; p.next()) {
+      velocity(p.i(), p.j());
+    }
+
+    ghosts.finish();
+
+    for (PointsBoundary p(*m_grid); p; p.next()) {
+      velocity(p.i(), p.j());
+    }
   }
 
   if (no_model_mask) {
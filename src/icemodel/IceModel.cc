@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -40,6 +40,7 @@
 #include "pism/util/Mask.hh"
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/Diagnostic.hh"
+#include "pism/util/DiagnosticReducer.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/pism_options.hh"
 #include "pism/coupler/SeaLevel.hh"
@@ -57,6 +58,7 @@
 #include "pism/util/iceModelVec2T.hh"
 #include "pism/fracturedensity/FractureDensity.hh"
 #include "pism/coupler/util/options.hh" // ForcingOptions
+#include "pism/icemodel/MultirateForcing.hh"
 
 namespace pism {
 
@@ -154,6 +156,11 @@ void IceModel::reset_counters() {
   dt_TempAge       = 0.0;
   m_dt             = 0.0;
   m_skip_countdown = 0;
+  m_energy_age_step = false;
+
+  if (m_multirate_forcing) {
+    m_multirate_forcing->reset();
+  }
 
   m_timestep_hit_multiples_last_time = m_time->current();
 }
@@ -273,6 +280,10 @@ void IceModel::allocate_storage() {
   m_model_state.insert(&m_geometry.longitude);
   m_model_state.insert(&m_geometry.ice_thickness);
   m_model_state.insert(&m_geometry.ice_area_specific_volume);
+
+  if (m_config->get_flag("time_stepping.multirate.enabled")) {
+    m_multirate_forcing.reset(new MultirateForcing(m_grid));
+  }
 }
 
 //! Update the surface elevation and the flow-type mask when the geometry has changed.
@@ -367,6 +378,11 @@ energy::Inputs IceModel::energy_model_inputs() {
   result.v3                       = &m_stress_balance->velocity_v();
   result.w3                       = &m_stress_balance->velocity_w();
 
+  if (m_multirate_forcing and m_multirate_forcing->averaged()) {
+    // use forcing averaged over the time elapsed since the last energy update
+    m_multirate_forcing->replace(result);
+  }
+
   result.check();             // make sure all data members were set
 
   return result;
@@ -470,13 +486,44 @@ void IceModel::step(bool do_mass_continuity,
 
   dt_TempAge += m_dt;
 
+  //! \li accumulate forcing for energy and age models and decide if they should be
+  //! updated during this step (multi-rate time stepping)
+  m_energy_age_step = updateAtDepth;
+  if (m_multirate_forcing) {
+    m_multirate_forcing->add(m_dt, energy_model_inputs());
+
+    m_energy_age_step = multirate_update_due();
+
+    if (m_energy_age_step) {
+      m_multirate_forcing->average(energy_model_inputs());
+
+      const MaxTimestep dt_cfl = m_stress_balance->max_timestep_cfl_3d().dt_max;
+
+      m_log->message(3,
+                     "  multi-rate: updating energy and age after %d steps (%f years,"
+                     " 3D CFL limit: %f years);\n"
+                     "    max. difference between averaged and last-step forcing:\n"
+                     "      horizontal velocity: %f m/year, strain heating: %e W m-3,\n"
+                     "      surface temperature: %f K\n",
+                     m_multirate_forcing->n_steps(),
+                     units::convert(m_sys, dt_TempAge, "seconds", "years"),
+                     dt_cfl.finite() ? units::convert(m_sys, dt_cfl.value(), "seconds", "years") : -1.0,
+                     units::convert(m_sys, m_multirate_forcing->velocity_difference(),
+                                    "m second-1", "m year-1"),
+                     m_multirate_forcing->strain_heating_difference(),
+                     m_multirate_forcing->surface_temperature_difference());
+    }
+  }
+
   //! \li update the age of the ice (if appropriate)
-  if (m_age_model and updateAtDepth) {
+  if (m_age_model and m_energy_age_step) {
+    energy::Inputs velocity = energy_model_inputs();
+
     AgeModelInputs inputs;
     inputs.ice_thickness = &m_geometry.ice_thickness;
-    inputs.u3            = &m_stress_balance->velocity_u();
-    inputs.v3            = &m_stress_balance->velocity_v();
-    inputs.w3            = &m_stress_balance->velocity_w();
+    inputs.u3            = velocity.u3;
+    inputs.v3            = velocity.v3;
+    inputs.w3            = velocity.w3;
 
     profiling.begin("age");
     m_age_model->update(current_time, dt_TempAge, inputs);
@@ -489,7 +536,7 @@ void IceModel::step(bool do_mass_continuity,
   //! \li update the enthalpy (or temperature) field according to the conservation of
   //!  energy model based (especially) on the new velocity field; see
   //!  energy_step()
-  if (updateAtDepth) { // do the energy step
+  if (m_energy_age_step) { // do the energy step
     profiling.begin("energy");
     energy_step();
     profiling.end("energy");
@@ -641,9 +688,13 @@ void IceModel::step(bool do_mass_continuity,
   // Done with the step; now adopt the new time.
   m_time->step(m_dt);
 
-  if (updateAtDepth) {
+  if (m_energy_age_step) {
     t_TempAge  = m_time->current();
     dt_TempAge = 0.0;
+
+    if (m_multirate_forcing) {
+      m_multirate_forcing->reset();
+    }
   }
 
   // Check if the ice thickness exceeded the height of the computational box and stop if it did.
@@ -772,9 +823,7 @@ void IceModel::run() {
   // This is needed to compute rates of change of the ice mass, volume, etc.
   {
     const double time = m_time->current();
-    for (auto d : m_ts_diagnostics) {
-      d.second->update(time, time);
-    }
+    update_ts_diagnostics(m_ts_diagnostics, time, time);
   }
 
   m_log->message(2, "running forward ...\n");
@@ -800,7 +849,7 @@ void IceModel::run() {
     update_diagnostics(m_dt);
 
     // report a summary for major steps or the last one
-    bool updateAtDepth = m_skip_countdown == 0;
+    bool updateAtDepth = m_multirate_forcing ? m_energy_age_step : m_skip_countdown == 0;
     bool tempAgeStep   = updateAtDepth and (m_age_model or do_energy);
 
     const bool show_step = tempAgeStep or m_adaptive_timestep_reason == "end of the run";
@@ -826,6 +875,9 @@ void IceModel::run() {
 
   profiling.stage_end("time-stepping loop");
 
+  // make sure that all snapshots, backups and spatial time-series are written
+  flush_async_output();
+
   if (stepcount >= 0) {
     m_log->message(1,
                "count_time_steps:  run() took %d steps\n"
@@ -835,6 +887,37 @@ void IceModel::run() {
   }
 }
 
+/*!
+ * Report the work imbalance (max/mean per processor) estimated using the ice cover in
+ * `cell_type`.
+ *
+ * Uses the same estimate as GridParameters::balance_ownership_ranges(): each icy column
+ * contributes Mz, each ice-free column contributes 1.
+ */
+static void report_work_imbalance(const IceModelVec2CellType &cell_type) {
+  IceGrid::ConstPtr grid = cell_type.grid();
+
+  const double icy_weight = grid->Mz();
+
+  double work = 0.0;
+
+  IceModelVec::AccessList list{&cell_type};
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    work += cell_type.icy(i, j) ? icy_weight : 1.0;
+  }
+
+  const double
+    max  = GlobalMax(grid->com, work),
+    mean = GlobalSum(grid->com, work) / grid->size();
+
+  grid->ctx()->log()->message(2,
+                              "           work imbalance   %.2f (max/mean per processor,"
+                              " using the initial ice cover)\n",
+                              mean > 0.0 ? max / mean : 1.0);
+}
+
 //! Manage the initialization of the IceModel object.
 /*!
 Please see the documenting comments of the functions called below to find
@@ -870,6 +953,9 @@ void IceModel::init() {
 
   //! 7) Report grid parameters:
   m_grid->report_parameters();
+  if (m_config->get_flag("grid.load_balancing")) {
+    report_work_imbalance(m_geometry.cell_type);
+  }
 
   //! 8) Miscellaneous stuff: set up the bed deformation model, initialize the
   //! basal till model, initialize snapshots. This has to happen *after*
@@ -1037,10 +1123,12 @@ void IceModel::update_diagnostics(double dt) {
     d.second->update(dt);
   }
 
-  const double time = m_time->current();
-  for (auto d : m_ts_diagnostics) {
-    d.second->update(time - dt, time);
+  if (m_extra_reducer) {
+    m_extra_reducer->update(dt);
   }
+
+  const double time = m_time->current();
+  update_ts_diagnostics(m_ts_diagnostics, time - dt, time);
 }
 
 /*!
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -81,6 +81,8 @@ class IcebergRemover;
 
 class FractureDensity;
 
+class DiagnosticReducer;
+
 namespace energy {
 class BedThermalUnit;
 class Inputs;
@@ -96,8 +98,13 @@ namespace bed {
 class BedDef;
 }
 
+namespace io {
+class AsyncWriter;
+}
+
 class IceGrid;
 class AgeModel;
+class MultirateForcing;
 class IceModelVec2CellType;
 class IceModelVec2T;
 class Component;
@@ -305,6 +312,11 @@ protected:
 
   unsigned int m_skip_countdown;
 
+  //! time-averaged forcing for energy and age models (multi-rate time stepping)
+  std::unique_ptr<MultirateForcing> m_multirate_forcing;
+  //! true if energy and age models were updated during the last step
+  bool m_energy_age_step;
+
   std::string m_adaptive_timestep_reason;
 
   std::string m_stdout_flags;
@@ -315,6 +327,7 @@ protected:
   virtual MaxTimestep max_timestep_diffusivity();
   virtual void max_timestep(double &dt_result, unsigned int &skip_counter);
   virtual unsigned int skip_counter(double input_dt, double input_dt_diffusivity);
+  virtual bool multirate_update_due() const;
 
   // see energy.cc
   virtual void bedrock_thermal_model_step();
@@ -421,6 +434,8 @@ protected:
   std::set<std::string> m_extra_vars;
   TimeBoundsMetadata m_extra_bounds;
   std::unique_ptr<File> m_extra_file;
+  //! time-averages (and decimates) fields written to the extra file (if requested)
+  std::shared_ptr<DiagnosticReducer> m_extra_reducer;
   void init_extras();
   void write_extras();
   MaxTimestep extras_max_timestep(double my_t);
@@ -432,6 +447,11 @@ protected:
   void init_backups();
   void write_backup();
 
+  //! writes distributed arrays in a helper thread (if asynchronous output is enabled)
+  std::shared_ptr<io::AsyncWriter> m_output_writer;
+  void init_async_output();
+  void flush_async_output();
+
   // last time at which PISM hit a multiple of X years, see the configuration parameter
   // time_stepping.hit_multiples
   double m_timestep_hit_multiples_last_time;
@@ -449,6 +469,12 @@ private:
 MaxTimestep reporting_max_timestep(const std::vector<double> &times, double t,
                                    const std::string &description);
 
+void warn_about_missing(const Logger &log,
+                        const std::set<std::string> &vars,
+                        const std::string &type,
+                        const std::set<std::string> &available,
+                        bool stop);
+
 void check_minimum_ice_thickness(const IceModelVec2S &ice_thickness);
 bool check_maximum_ice_thickness(const IceModelVec2S &ice_thickness);
 
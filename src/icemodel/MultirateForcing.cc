@@ -0,0 +1,215 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>                // std::fabs
+#include <algorithm>            // std::max
+
+#include "pism/icemodel/MultirateForcing.hh"
+#include "pism/energy/EnergyModel.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
+
+namespace pism {
+
+//! Add `dt * input` to `result` (owned grid points only; ghosts are updated in `average()`).
+static void accumulate(double dt, const IceModelVec3 &input, IceModelVec3 &result) {
+  IceGrid::ConstPtr grid = result.grid();
+  const unsigned int Mz = grid->Mz();
+
+  IceModelVec::AccessList list{&input, &result};
+
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const double *in = input.get_column(i, j);
+    double *out = result.get_column(i, j);
+
+    for (unsigned int k = 0; k < Mz; ++k) {
+      out[k] += dt * in[k];
+    }
+  }
+}
+
+//! Maximum of `|a - b|` over all grid points.
+static double max_difference(const IceModelVec3 &a, const IceModelVec3 &b) {
+  IceGrid::ConstPtr grid = a.grid();
+  const unsigned int Mz = grid->Mz();
+
+  IceModelVec::AccessList list{&a, &b};
+
+  double result = 0.0;
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const double
+      *A = a.get_column(i, j),
+      *B = b.get_column(i, j);
+
+    for (unsigned int k = 0; k < Mz; ++k) {
+      result = std::max(result, std::fabs(A[k] - B[k]));
+    }
+  }
+
+  return GlobalMax(grid->com, result);
+}
+
+static double max_difference(const IceModelVec2S &a, const IceModelVec2S &b) {
+  IceGrid::ConstPtr grid = a.grid();
+
+  IceModelVec::AccessList list{&a, &b};
+
+  double result = 0.0;
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    result = std::max(result, std::fabs(a(i, j) - b(i, j)));
+  }
+
+  return GlobalMax(grid->com, result);
+}
+
+MultirateForcing::MultirateForcing(IceGrid::ConstPtr grid)
+  : m_u(grid, "multirate_uvel", WITH_GHOSTS),
+    m_v(grid, "multirate_vvel", WITH_GHOSTS),
+    m_w(grid, "multirate_wvel_rel", WITHOUT_GHOSTS),
+    m_strain_heating(grid, "multirate_strain_heating", WITHOUT_GHOSTS),
+    m_basal_frictional_heating(grid, "multirate_bfrict", WITHOUT_GHOSTS),
+    m_surface_temp(grid, "multirate_ice_surface_temp", WITHOUT_GHOSTS),
+    m_surface_liquid_fraction(grid, "multirate_ice_surface_liquid_water_fraction",
+                              WITHOUT_GHOSTS) {
+  reset();
+}
+
+//! Discard accumulated forcing.
+void MultirateForcing::reset() {
+  m_u.set(0.0);
+  m_v.set(0.0);
+  m_w.set(0.0);
+  m_strain_heating.set(0.0);
+  m_basal_frictional_heating.set(0.0);
+  m_surface_temp.set(0.0);
+  m_surface_liquid_fraction.set(0.0);
+
+  m_duration = 0.0;
+  m_n_steps  = 0;
+  m_averaged = false;
+
+  m_velocity_difference            = 0.0;
+  m_strain_heating_difference      = 0.0;
+  m_surface_temperature_difference = 0.0;
+}
+
+//! Add forcing used during a step of length `dt`.
+void MultirateForcing::add(double dt, const energy::Inputs &inputs) {
+  if (m_averaged) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "MultirateForcing: cannot add forcing after averaging (call reset() first)");
+  }
+
+  accumulate(dt, *inputs.u3, m_u);
+  accumulate(dt, *inputs.v3, m_v);
+  accumulate(dt, *inputs.w3, m_w);
+  accumulate(dt, *inputs.volumetric_heating_rate, m_strain_heating);
+
+  m_basal_frictional_heating.add(dt, *inputs.basal_frictional_heating);
+  m_surface_temp.add(dt, *inputs.surface_temp);
+  m_surface_liquid_fraction.add(dt, *inputs.surface_liquid_fraction);
+
+  m_duration += dt;
+  m_n_steps  += 1;
+}
+
+/*!
+ * Convert accumulated time integrals into time averages.
+ *
+ * Also computes differences between averaged fields and fields in `inputs` (forcing
+ * used during the last step). These approximate the error introduced by using
+ * "lagged" forcing and help choose `time_stepping.multirate.steps`.
+ */
+void MultirateForcing::average(const energy::Inputs &inputs) {
+  if (m_averaged) {
+    return;
+  }
+
+  if (m_duration > 0.0) {
+    const double C = 1.0 / m_duration;
+
+    m_u.scale(C);
+    m_v.scale(C);
+    m_w.scale(C);
+    m_strain_heating.scale(C);
+    m_basal_frictional_heating.scale(C);
+    m_surface_temp.scale(C);
+    m_surface_liquid_fraction.scale(C);
+  }
+
+  m_u.update_ghosts();
+  m_v.update_ghosts();
+
+  m_velocity_difference = std::max(max_difference(m_u, *inputs.u3),
+                                   max_difference(m_v, *inputs.v3));
+  m_strain_heating_difference = max_difference(m_strain_heating,
+                                               *inputs.volumetric_heating_rate);
+  m_surface_temperature_difference = max_difference(m_surface_temp, *inputs.surface_temp);
+
+  m_averaged = true;
+}
+
+//! Replace fields in `inputs` with their time averages.
+void MultirateForcing::replace(energy::Inputs &inputs) const {
+  if (not m_averaged) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "MultirateForcing: forcing is not averaged yet");
+  }
+
+  inputs.u3                       = &m_u;
+  inputs.v3                       = &m_v;
+  inputs.w3                       = &m_w;
+  inputs.volumetric_heating_rate  = &m_strain_heating;
+  inputs.basal_frictional_heating = &m_basal_frictional_heating;
+  inputs.surface_temp             = &m_surface_temp;
+  inputs.surface_liquid_fraction  = &m_surface_liquid_fraction;
+}
+
+bool MultirateForcing::averaged() const {
+  return m_averaged;
+}
+
+unsigned int MultirateForcing::n_steps() const {
+  return m_n_steps;
+}
+
+double MultirateForcing::duration() const {
+  return m_duration;
+}
+
+double MultirateForcing::velocity_difference() const {
+  return m_velocity_difference;
+}
+
+double MultirateForcing::strain_heating_difference() const {
+  return m_strain_heating_difference;
+}
+
+double MultirateForcing::surface_temperature_difference() const {
+  return m_surface_temperature_difference;
+}
+
+} // end of namespace pism
@@ -0,0 +1,91 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_MULTIRATEFORCING_H
+#define PISM_MULTIRATEFORCING_H
+
+#include "pism/util/iceModelVec.hh"
+
+namespace pism {
+
+namespace energy {
+class Inputs;
+}
+
+/*!
+ * Time-averaged forcing used by the energy and age models in multi-rate time stepping.
+ *
+ * When `time_stepping.multirate.enabled` is set, IceModel updates ice geometry and
+ * velocity every step, but updates energy and age only once every
+ * `time_stepping.multirate.steps` steps (or once every
+ * `time_stepping.multirate.interval` years). This class accumulates time integrals of
+ * the fields that change from step to step (3D velocity, strain heating, basal
+ * frictional heating, surface temperature and liquid water fraction) so that the
+ * deferred update can use their averages over the time elapsed since the last update.
+ *
+ * Usage:
+ *
+ * 1. call `add()` once per mass continuity step,
+ * 2. call `average()` before updating energy and age,
+ * 3. call `replace()` to substitute averaged fields into energy model inputs,
+ * 4. call `reset()` after the update.
+ */
+class MultirateForcing {
+public:
+  MultirateForcing(IceGrid::ConstPtr grid);
+
+  void reset();
+
+  void add(double dt, const energy::Inputs &inputs);
+
+  void average(const energy::Inputs &inputs);
+
+  void replace(energy::Inputs &inputs) const;
+
+  //! True if `average()` was called since the last `reset()`.
+  bool averaged() const;
+
+  //! Number of steps accumulated since the last reset.
+  unsigned int n_steps() const;
+
+  //! Time elapsed since the last reset, in seconds.
+  double duration() const;
+
+  //! Max. difference between averaged and last-step horizontal velocity, m/s.
+  double velocity_difference() const;
+  //! Max. difference between averaged and last-step strain heating, W m-3.
+  double strain_heating_difference() const;
+  //! Max. difference between averaged and last-step surface temperature, K.
+  double surface_temperature_difference() const;
+private:
+  IceModelVec3 m_u, m_v, m_w, m_strain_heating;
+  IceModelVec2S m_basal_frictional_heating, m_surface_temp, m_surface_liquid_fraction;
+
+  double m_duration;
+  unsigned int m_n_steps;
+  bool m_averaged;
+
+  double m_velocity_difference;
+  double m_strain_heating_difference;
+  double m_surface_temperature_difference;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_MULTIRATEFORCING_H */
@@ -963,161 +963,287 @@ IceModelVec::Ptr TemperateIceThicknessBasal::compute_impl() const {
 
 namespace scalar {
 
+//! \brief Scalar diagnostic computed as a sum of contributions from grid points.
+/*!
+ * Diagnostics derived from this class are computed in one pass over the grid (see
+ * update_ts_diagnostics()).
+ */
+template <class D>
+class TSSumDiag : public TSDiag<D, IceModel>
+{
+public:
+  TSSumDiag(const IceModel *m, const std::string &name)
+    : TSDiag<D, IceModel>(m, name),
+      m_geometry(nullptr),
+      m_cell_area(0.0) {
+    // empty
+  }
+
+  double compute() {
+    return this->compute_using_partial_sums();
+  }
+protected:
+  unsigned int n_partial_sums_impl() const {
+    return 1;
+  }
+
+  void prepare_partial_sums_impl(IceModelVec::AccessList &list) {
+    (void) list;
+    m_geometry  = &this->model->geometry();
+    m_cell_area = this->m_grid->cell_area();
+  }
+
+  const Geometry *m_geometry;
+  double m_cell_area;
+};
+
+//! \brief Ice volume (m^3) or mass (kg), including the ice in partially-filled cells.
+template <class D>
+class IceVolumeSum : public TSSumDiag<D>
+{
+public:
+  /*!
+   * @param[in] glacierized include areas where ice thickness exceeds
+   *                        `output.ice_free_thickness_standard` only
+   * @param[in] mass compute mass instead of volume
+   */
+  IceVolumeSum(const IceModel *m, const std::string &name, bool glacierized, bool mass)
+    : TSSumDiag<D>(m, name),
+      m_glacierized(glacierized),
+      m_mass(mass),
+      m_thickness_threshold(0.0),
+      m_scale(1.0),
+      m_ice_thickness(nullptr),
+      m_area_specific_volume(nullptr) {
+    // empty
+  }
+protected:
+  void prepare_partial_sums_impl(IceModelVec::AccessList &list) {
+    TSSumDiag<D>::prepare_partial_sums_impl(list);
+
+    const Config &config = *this->m_config;
+
+    m_thickness_threshold = (m_glacierized ?
+                             config.get_number("output.ice_free_thickness_standard") :
+                             0.0);
+    m_scale = m_mass ? config.get_number("constants.ice.density") : 1.0;
+
+    m_ice_thickness = &this->m_geometry->ice_thickness;
+    list.add(*m_ice_thickness);
+
+    // include the volume of the ice in Href
+    m_area_specific_volume = nullptr;
+    if (config.get_flag("geometry.part_grid.enabled")) {
+      m_area_specific_volume = &this->m_geometry->ice_area_specific_volume;
+      list.add(*m_area_specific_volume);
+    }
+  }
+
+  void add_partial_sums_impl(int i, int j, double *sums) const {
+    sums[0] += cell_ice_volume((*m_ice_thickness)(i, j), m_thickness_threshold,
+                               this->m_cell_area);
+
+    if (m_area_specific_volume) {
+      sums[0] += (*m_area_specific_volume)(i, j) * this->m_cell_area;
+    }
+  }
+
+  double value_impl(const double *sums) const {
+    return m_scale * sums[0];
+  }
+
+  bool m_glacierized, m_mass;
+  double m_thickness_threshold, m_scale;
+  const IceModelVec2S *m_ice_thickness, *m_area_specific_volume;
+};
+
+//! \brief Volume (m^3) of the grounded ice not displacing sea water.
+class IceVolumeNotDisplacingSeaWater : public TSSumDiag<TSSnapshotDiagnostic>
+{
+public:
+  IceVolumeNotDisplacingSeaWater(const IceModel *m, const std::string &name)
+    : TSSumDiag<TSSnapshotDiagnostic>(m, name),
+      m_thickness_threshold(0.0),
+      m_density_ratio(0.0) {
+    // empty
+  }
+protected:
+  void prepare_partial_sums_impl(IceModelVec::AccessList &list) {
+    TSSumDiag<TSSnapshotDiagnostic>::prepare_partial_sums_impl(list);
+
+    m_thickness_threshold = m_config->get_number("output.ice_free_thickness_standard");
+    m_density_ratio = (m_config->get_number("constants.sea_water.density") /
+                       m_config->get_number("constants.ice.density"));
+
+    const Geometry &geometry = *m_geometry;
+    list.add({&geometry.cell_type, &geometry.ice_thickness,
+        &geometry.bed_elevation, &geometry.sea_level_elevation});
+  }
+
+  void add_partial_sums_impl(int i, int j, double *sums) const {
+    const Geometry &geometry = *m_geometry;
+
+    sums[0] += cell_ice_volume_not_displacing_seawater(geometry.cell_type.grounded(i, j),
+                                                       geometry.ice_thickness(i, j),
+                                                       geometry.bed_elevation(i, j),
+                                                       geometry.sea_level_elevation(i, j),
+                                                       m_thickness_threshold,
+                                                       m_density_ratio,
+                                                       m_cell_area);
+  }
+
+  double m_thickness_threshold, m_density_ratio;
+};
+
 //! \brief Computes the total ice volume in glacierized areas.
-class IceVolumeGlacierized : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceVolumeGlacierized : public IceVolumeSum<TSSnapshotDiagnostic>
 {
 public:
   IceVolumeGlacierized(IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "ice_volume_glacierized") {
+    : IceVolumeSum<TSSnapshotDiagnostic>(m, "ice_volume_glacierized", true, false) {
 
     set_units("m3", "m3");
     m_ts.variable().set_string("long_name", "volume of the ice in glacierized areas");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-  double compute() {
-    return ice_volume(model->geometry(),
-                      m_config->get_number("output.ice_free_thickness_standard"));
-  }
 };
 
 //! \brief Computes the total ice volume.
-class IceVolume : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceVolume : public IceVolumeSum<TSSnapshotDiagnostic>
 {
 public:
   IceVolume(IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "ice_volume") {
+    : IceVolumeSum<TSSnapshotDiagnostic>(m, "ice_volume", false, false) {
 
     set_units("m3", "m3");
     m_ts.variable().set_string("long_name", "volume of the ice, including seasonal cover");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-
-  double compute() {
-    return ice_volume(model->geometry(), 0.0);
-  }
 };
 
 //! \brief Computes the total ice volume which is relevant for sea-level
-class SeaLevelRisePotential : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class SeaLevelRisePotential : public IceVolumeNotDisplacingSeaWater
 {
 public:
   SeaLevelRisePotential(const IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "sea_level_rise_potential") {
+    : IceVolumeNotDisplacingSeaWater(m, "sea_level_rise_potential") {
 
     set_units("m", "m");
     m_ts.variable().set_string("long_name", "the sea level rise that would result if all the ice were melted");
     m_ts.variable().set_number("valid_min", 0.0);
   }
+protected:
+  double value_impl(const double *sums) const {
+    const double
+      water_density = m_config->get_number("constants.fresh_water.density"),
+      ice_density   = m_config->get_number("constants.ice.density"),
+      ocean_area    = m_config->get_number("constants.global_ocean_area");
 
-  double compute() {
-    return sea_level_rise_potential(model->geometry(),
-                                    m_config->get_number("output.ice_free_thickness_standard"));
+    const double
+      volume                  = sums[0],
+      additional_water_volume = (ice_density / water_density) * volume,
+      sea_level_change        = additional_water_volume / ocean_area;
+
+    return sea_level_change;
   }
 };
 
 //! \brief Computes the rate of change of the total ice volume in glacierized areas.
-class IceVolumeRateOfChangeGlacierized : public TSDiag<TSRateDiagnostic, IceModel>
+class IceVolumeRateOfChangeGlacierized : public IceVolumeSum<TSRateDiagnostic>
 {
 public:
   IceVolumeRateOfChangeGlacierized(IceModel *m)
-    : TSDiag<TSRateDiagnostic, IceModel>(m, "tendency_of_ice_volume_glacierized") {
+    : IceVolumeSum<TSRateDiagnostic>(m, "tendency_of_ice_volume_glacierized", true, false) {
 
     set_units("m3 s-1", "m3 year-1");
     m_ts.variable().set_string("long_name", "rate of change of the ice volume in glacierized areas");
   }
-
-  double compute() {
-    return ice_volume(model->geometry(),
-                      m_config->get_number("output.ice_free_thickness_standard"));
-  }
 };
 
 //! \brief Computes the rate of change of the total ice volume.
-class IceVolumeRateOfChange : public TSDiag<TSRateDiagnostic, IceModel>
+class IceVolumeRateOfChange : public IceVolumeSum<TSRateDiagnostic>
 {
 public:
   IceVolumeRateOfChange(IceModel *m)
-    : TSDiag<TSRateDiagnostic, IceModel>(m, "tendency_of_ice_volume") {
+    : IceVolumeSum<TSRateDiagnostic>(m, "tendency_of_ice_volume", false, false) {
 
     set_units("m3 s-1", "m3 year-1");
     m_ts.variable().set_string("long_name",
                                "rate of change of the ice volume, including seasonal cover");
   }
-
-  double compute() {
-    return ice_volume(model->geometry(), 0.0);
-  }
 };
 
 //! \brief Computes the total ice area.
-class IceAreaGlacierized : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceAreaGlacierized : public TSSumDiag<TSSnapshotDiagnostic>
 {
 public:
   IceAreaGlacierized(IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "ice_area_glacierized") {
+    : TSSumDiag<TSSnapshotDiagnostic>(m, "ice_area_glacierized"),
+      m_thickness_threshold(0.0) {
 
     set_units("m2", "m2");
     m_ts.variable().set_string("long_name", "glacierized area");
     m_ts.variable().set_number("valid_min", 0.0);
   }
+protected:
+  void prepare_partial_sums_impl(IceModelVec::AccessList &list) {
+    TSSumDiag<TSSnapshotDiagnostic>::prepare_partial_sums_impl(list);
+
+    m_thickness_threshold = m_config->get_number("output.ice_free_thickness_standard");
+
+    list.add(m_geometry->ice_thickness);
+  }
 
-  double compute() {
-    return ice_area(model->geometry(), m_config->get_number("output.ice_free_thickness_standard"));
+  void add_partial_sums_impl(int i, int j, double *sums) const {
+    sums[0] += cell_ice_area(true, m_geometry->ice_thickness(i, j), m_thickness_threshold,
+                             m_cell_area);
   }
+
+  double m_thickness_threshold;
 };
 
 //! \brief Computes the total mass of the ice not displacing sea water.
-class IceMassNotDisplacingSeaWater : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceMassNotDisplacingSeaWater : public IceVolumeNotDisplacingSeaWater
 {
 public:
   IceMassNotDisplacingSeaWater(const IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "limnsw") {
+    : IceVolumeNotDisplacingSeaWater(m, "limnsw") {
 
     set_units("kg", "kg");
     m_ts.variable().set_string("long_name", "mass of the ice not displacing sea water");
     m_ts.variable().set_string("standard_name", "land_ice_mass_not_displacing_sea_water");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-
-  double compute() {
-
+protected:
+  double value_impl(const double *sums) const {
     const double
-      thickness_standard = m_config->get_number("output.ice_free_thickness_standard"),
-      ice_density        = m_config->get_number("constants.ice.density"),
-      ice_volume         = ice_volume_not_displacing_seawater(model->geometry(),
-                                                              thickness_standard),
-      ice_mass           = ice_volume * ice_density;
+      ice_density = m_config->get_number("constants.ice.density"),
+      ice_volume  = sums[0],
+      ice_mass    = ice_volume * ice_density;
 
     return ice_mass;
   }
 };
 
 //! \brief Computes the total ice mass in glacierized areas.
-class IceMassGlacierized : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceMassGlacierized : public IceVolumeSum<TSSnapshotDiagnostic>
 {
 public:
   IceMassGlacierized(IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "ice_mass_glacierized") {
+    : IceVolumeSum<TSSnapshotDiagnostic>(m, "ice_mass_glacierized", true, true) {
 
     set_units("kg", "kg");
     m_ts.variable().set_string("long_name", "mass of the ice in glacierized areas");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-
-  double compute() {
-    double
-      ice_density        = m_config->get_number("constants.ice.density"),
-      thickness_standard = m_config->get_number("output.ice_free_thickness_standard");
-    return ice_volume(model->geometry(), thickness_standard) * ice_density;
-  }
 };
 
 //! \brief Computes the total ice mass.
-class IceMass : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceMass : public IceVolumeSum<TSSnapshotDiagnostic>
 {
 public:
   IceMass(IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "ice_mass") {
+    : IceVolumeSum<TSSnapshotDiagnostic>(m, "ice_mass", false, true) {
 
     if (m_config->get_flag("output.ISMIP6")) {
       m_ts.variable().set_name("lim");
@@ -1128,30 +1254,110 @@ public:
     m_ts.variable().set_string("standard_name", "land_ice_mass");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-
-  double compute() {
-    return (ice_volume(model->geometry(), 0.0) *
-            m_config->get_number("constants.ice.density"));
-  }
 };
 
 //! \brief Computes the rate of change of the total ice mass in glacierized areas.
-class IceMassRateOfChangeGlacierized : public TSDiag<TSRateDiagnostic, IceModel>
+class IceMassRateOfChangeGlacierized : public IceVolumeSum<TSRateDiagnostic>
 {
 public:
   IceMassRateOfChangeGlacierized(IceModel *m)
-    : TSDiag<TSRateDiagnostic, IceModel>(m, "tendency_of_ice_mass_glacierized") {
+    : IceVolumeSum<TSRateDiagnostic>(m, "tendency_of_ice_mass_glacierized", true, true) {
 
     set_units("kg s-1", "Gt year-1");
     m_ts.variable().set_string("long_name", "rate of change of the ice mass in glacierized areas");
   }
+};
 
-  double compute() {
-    double
-      ice_density         = m_config->get_number("constants.ice.density"),
-      thickness_threshold = m_config->get_number("output.ice_free_thickness_standard");
-    return ice_volume(model->geometry(), thickness_threshold) * ice_density;
+/*!
+ * Total mass change due to one of the terms in the mass continuity equation.
+ *
+ * Possible terms are
+ *
+ * - SMB: surface mass balance
+ * - BMB: basal mass balance
+ * - FLOW: ice flow
+ * - ERROR: numerical flux needed to preserve non-negativity of thickness
+ *
+ * This computation can be restricted to grounded and floating areas
+ * using the `area` argument.
+ *
+ * - BOTH: include all contributions
+ * - GROUNDED: include grounded areas only
+ * - SHELF: include floating areas only
+ *
+ * When computing mass changes due to flow it is important to remember
+ * that ice mass in a cell can be represented by its thickness *or* an
+ * "area specific volume". Transferring mass from one representation
+ * to the other does not change the mass in a cell. This explains the
+ * special case used when `term == FLOW`. (Note that surface and basal
+ * mass balances do not affect the area specific volume field.)
+ */
+class MassChange : public TSSumDiag<TSFluxDiagnostic>
+{
+public:
+  MassChange(const IceModel *m, const std::string &name, TermType term, AreaType area)
+    : TSSumDiag<TSFluxDiagnostic>(m, name),
+      m_term(term),
+      m_area(area),
+      m_thickness_change(nullptr),
+      m_area_specific_volume_change(nullptr) {
+    // empty
   }
+protected:
+  void prepare_partial_sums_impl(IceModelVec::AccessList &list) {
+    TSSumDiag<TSFluxDiagnostic>::prepare_partial_sums_impl(list);
+
+    const GeometryEvolution &geometry_evolution = model->geometry_evolution();
+
+    switch (m_term) {
+    case FLOW:
+      m_thickness_change = &geometry_evolution.thickness_change_due_to_flow();
+      break;
+    case SMB:
+      m_thickness_change = &geometry_evolution.top_surface_mass_balance();
+      break;
+    case BMB:
+      m_thickness_change = &geometry_evolution.bottom_surface_mass_balance();
+      break;
+    case ERROR:
+      m_thickness_change = &geometry_evolution.conservation_error();
+      break;
+    default:
+      // can't happen
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid term type");
+    }
+
+    list.add({&m_geometry->cell_type, m_thickness_change});
+
+    m_area_specific_volume_change = nullptr;
+    if (m_term == FLOW) {
+      m_area_specific_volume_change = &geometry_evolution.area_specific_volume_change_due_to_flow();
+      list.add(*m_area_specific_volume_change);
+    }
+  }
+
+  void add_partial_sums_impl(int i, int j, double *sums) const {
+    const IceModelVec2CellType &cell_type = m_geometry->cell_type;
+
+    if ((m_area == BOTH) or
+        (m_area == GROUNDED and cell_type.grounded(i, j)) or
+        (m_area == SHELF and cell_type.ocean(i, j))) {
+
+      double dV = m_area_specific_volume_change ? (*m_area_specific_volume_change)(i, j) : 0.0;
+
+      // m^3 = m^2 * m
+      sums[0] += m_cell_area * ((*m_thickness_change)(i, j) + dV);
+    }
+  }
+
+  double value_impl(const double *sums) const {
+    // (kg / m^3) * m^3 = kg
+    return m_config->get_number("constants.ice.density") * sums[0];
+  }
+
+  TermType m_term;
+  AreaType m_area;
+  const IceModelVec2S *m_thickness_change, *m_area_specific_volume_change;
 };
 
 //! \brief Computes the rate of change of the total ice mass due to flow (influx due to
@@ -1159,61 +1365,31 @@ public:
 /*!
  * This is the change in mass resulting from prescribing (fixing) ice thickness.
  */
-class IceMassRateOfChangeDueToFlow : public TSDiag<TSFluxDiagnostic, IceModel>
+class IceMassRateOfChangeDueToFlow : public MassChange
 {
 public:
   IceMassRateOfChangeDueToFlow(IceModel *m)
-    : TSDiag<TSFluxDiagnostic, IceModel>(m, "tendency_of_ice_mass_due_to_flow") {
+    : MassChange(m, "tendency_of_ice_mass_due_to_flow", FLOW, BOTH) {
 
     set_units("kg s-1", "Gt year-1");
     m_ts.variable().set_string("long_name", "rate of change of the mass of ice due to flow"
                                " (i.e. prescribed ice thickness)");
   }
-
-  double compute() {
-
-    const double
-      ice_density = m_config->get_number("constants.ice.density");
-
-    const IceModelVec2S
-      &dH = model->geometry_evolution().thickness_change_due_to_flow(),
-      &dV = model->geometry_evolution().area_specific_volume_change_due_to_flow();
-
-    auto cell_area = m_grid->cell_area();
-
-    IceModelVec::AccessList list{&dH, &dV};
-
-    double volume_change = 0.0;
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-      // m * m^2 = m^3
-      volume_change += (dH(i, j) + dV(i, j)) * cell_area;
-    }
-
-    // (kg/m^3) * m^3 = kg
-    return ice_density * GlobalSum(m_grid->com, volume_change);
-  }
 };
 
 //! \brief Computes the rate of change of the total ice mass.
-class IceMassRateOfChange : public TSDiag<TSRateDiagnostic, IceModel>
+class IceMassRateOfChange : public IceVolumeSum<TSRateDiagnostic>
 {
 public:
   IceMassRateOfChange(IceModel *m)
-    : TSDiag<TSRateDiagnostic, IceModel>(m, "tendency_of_ice_mass") {
+    : IceVolumeSum<TSRateDiagnostic>(m, "tendency_of_ice_mass", false, true) {
 
     set_units("kg s-1", "Gt year-1");
     m_ts.variable().set_string("long_name",
                                "rate of change of the mass of ice, including seasonal cover");
   }
-
-  double compute() {
-    const double ice_density = m_config->get_number("constants.ice.density");
-    return ice_volume(model->geometry(), 0.0) * ice_density;
-  }
 };
 
-
 //! \brief Computes the total volume of the temperate ice in glacierized areas.
 class IceVolumeGlacierizedTemperate : public TSDiag<TSSnapshotDiagnostic, IceModel>
 {
@@ -1354,12 +1530,51 @@ public:
   }
 };
 
+//! \brief Area (m^2) or volume (m^3) of grounded or floating ice in glacierized areas.
+class GlacierizedIceSum : public TSSumDiag<TSSnapshotDiagnostic>
+{
+public:
+  GlacierizedIceSum(const IceModel *m, const std::string &name, AreaType area, bool volume)
+    : TSSumDiag<TSSnapshotDiagnostic>(m, name),
+      m_area(area),
+      m_volume(volume),
+      m_thickness_threshold(0.0) {
+    assert(area != BOTH);
+  }
+protected:
+  void prepare_partial_sums_impl(IceModelVec::AccessList &list) {
+    TSSumDiag<TSSnapshotDiagnostic>::prepare_partial_sums_impl(list);
+
+    m_thickness_threshold = m_config->get_number("output.ice_free_thickness_standard");
+
+    list.add({&m_geometry->cell_type, &m_geometry->ice_thickness});
+  }
+
+  void add_partial_sums_impl(int i, int j, double *sums) const {
+    const IceModelVec2CellType &cell_type = m_geometry->cell_type;
+
+    const double H = m_geometry->ice_thickness(i, j);
+
+    const bool included = (m_area == GROUNDED ?
+                           cell_type.grounded(i, j) :
+                           cell_type.ocean(i, j));
+
+    const double area = cell_ice_area(included, H, m_thickness_threshold, m_cell_area);
+
+    sums[0] += m_volume ? area * H : area;
+  }
+
+  AreaType m_area;
+  bool m_volume;
+  double m_thickness_threshold;
+};
+
 //! \brief Computes the total grounded ice area.
-class IceAreaGlacierizedGrounded : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceAreaGlacierizedGrounded : public GlacierizedIceSum
 {
 public:
   IceAreaGlacierizedGrounded(IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "ice_area_glacierized_grounded") {
+    : GlacierizedIceSum(m, "ice_area_glacierized_grounded", GROUNDED, false) {
 
     if (m_config->get_flag("output.ISMIP6")) {
       m_ts.variable().set_name("iareagr");
@@ -1370,19 +1585,14 @@ public:
     m_ts.variable().set_string("standard_name", "grounded_ice_sheet_area");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-
-  double compute() {
-    return ice_area_grounded(model->geometry(),
-                             m_config->get_number("output.ice_free_thickness_standard"));
-  }
 };
 
 //! \brief Computes the total floating ice area.
-class IceAreaGlacierizedShelf : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceAreaGlacierizedShelf : public GlacierizedIceSum
 {
 public:
   IceAreaGlacierizedShelf(IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "ice_area_glacierized_floating") {
+    : GlacierizedIceSum(m, "ice_area_glacierized_floating", SHELF, false) {
 
     if (m_config->get_flag("output.ISMIP6")) {
       m_ts.variable().set_name("iareafl");
@@ -1393,87 +1603,32 @@ public:
     m_ts.variable().set_string("standard_name", "floating_ice_shelf_area");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-
-  double compute() {
-    return ice_area_floating(model->geometry(),
-                             m_config->get_number("output.ice_free_thickness_standard"));
-  }
 };
 
 //! \brief Computes the total grounded ice volume.
-class IceVolumeGlacierizedGrounded : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceVolumeGlacierizedGrounded : public GlacierizedIceSum
 {
 public:
   IceVolumeGlacierizedGrounded(IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "ice_volume_glacierized_grounded") {
+    : GlacierizedIceSum(m, "ice_volume_glacierized_grounded", GROUNDED, true) {
 
     set_units("m3", "m3");
     m_ts.variable().set_string("long_name", "volume of grounded ice in glacierized areas");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-
-  double compute() {
-    const IceModelVec2CellType &cell_type = model->geometry().cell_type;
-
-    const IceModelVec2S &ice_thickness = model->geometry().ice_thickness;
-
-    const double
-      thickness_threshold = m_config->get_number("output.ice_free_thickness_standard"),
-      cell_area           = m_grid->cell_area();
-
-    IceModelVec::AccessList list{&ice_thickness, &cell_type};
-
-    double volume = 0.0;
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-
-      const double H = ice_thickness(i, j);
-
-      if (cell_type.grounded(i, j) and H >= thickness_threshold) {
-        volume += cell_area * H;
-      }
-    }
-
-    return GlobalSum(m_grid->com, volume);
-  }
 };
 
 //! \brief Computes the total floating ice volume.
-class IceVolumeGlacierizedShelf : public TSDiag<TSSnapshotDiagnostic, IceModel>
+class IceVolumeGlacierizedShelf : public GlacierizedIceSum
 {
 public:
   IceVolumeGlacierizedShelf(IceModel *m)
-    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "ice_volume_glacierized_floating") {
+    : GlacierizedIceSum(m, "ice_volume_glacierized_floating", SHELF, true) {
 
     set_units("m3", "m3");
     m_ts.variable().set_string("long_name", "volume of ice shelves in glacierized areas");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-
-  double compute() {
-    const IceModelVec2CellType &cell_type = model->geometry().cell_type;
-
-    const IceModelVec2S &ice_thickness = model->geometry().ice_thickness;
-
-    const double
-      thickness_threshold = m_config->get_number("output.ice_free_thickness_standard"),
-      cell_area           = m_grid->cell_area();
-
-    IceModelVec::AccessList list{&ice_thickness, &cell_type};
-
-    double volume = 0.0;
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-
-      const double H = ice_thickness(i, j);
-
-      if (cell_type.ocean(i, j) and H >= thickness_threshold) {
-        volume += cell_area * H;
-      }
-    }
-
-    return GlobalSum(m_grid->com, volume);
-  }
 };
 
 //! \brief Reports the mass continuity time step.
@@ -1541,93 +1696,12 @@ public:
   }
 };
 
-/*!
- * Return total mass change due to one of the terms in the mass continuity equation.
- *
- * Possible terms are
- *
- * - SMB: surface mass balance
- * - BMB: basal mass balance
- * - FLOW: ice flow
- * - ERROR: numerical flux needed to preserve non-negativity of thickness
- *
- * This computation can be restricted to grounded and floating areas
- * using the `area` argument.
- *
- * - BOTH: include all contributions
- * - GROUNDED: include grounded areas only
- * - SHELF: include floating areas only
- *
- * When computing mass changes due to flow it is important to remember
- * that ice mass in a cell can be represented by its thickness *or* an
- * "area specific volume". Transferring mass from one representation
- * to the other does not change the mass in a cell. This explains the
- * special case used when `term == FLOW`. (Note that surface and basal
- * mass balances do not affect the area specific volume field.)
- */
-double mass_change(const IceModel *model, TermType term, AreaType area) {
-  const IceGrid &grid = *model->grid();
-  const Config &config = *grid.ctx()->config();
-
-  const double
-    ice_density = config.get_number("constants.ice.density"),
-    cell_area   = grid.cell_area();
-
-  const IceModelVec2CellType &cell_type = model->geometry().cell_type;
-
-  const IceModelVec2S *thickness_change = nullptr;
-
-  switch (term) {
-  case FLOW:
-    thickness_change = &model->geometry_evolution().thickness_change_due_to_flow();
-    break;
-  case SMB:
-    thickness_change = &model->geometry_evolution().top_surface_mass_balance();
-    break;
-  case BMB:
-    thickness_change = &model->geometry_evolution().bottom_surface_mass_balance();
-    break;
-  case ERROR:
-    thickness_change = &model->geometry_evolution().conservation_error();
-    break;
-  default:
-    // can't happen
-    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid term type");
-  }
-
-  const IceModelVec2S &dV_flow = model->geometry_evolution().area_specific_volume_change_due_to_flow();
-
-  IceModelVec::AccessList list{&cell_type, thickness_change};
-
-  if (term == FLOW) {
-    list.add(dV_flow);
-  }
-
-  double volume_change = 0.0;
-  for (Points p(grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-
-    if ((area == BOTH) or
-        (area == GROUNDED and cell_type.grounded(i, j)) or
-        (area == SHELF and cell_type.ocean(i, j))) {
-
-      double dV = term == FLOW ? dV_flow(i, j) : 0.0;
-
-      // m^3 = m^2 * m
-      volume_change += cell_area * ((*thickness_change)(i, j) + dV);
-    }
-  }
-
-  // (kg / m^3) * m^3 = kg
-  return ice_density * GlobalSum(grid.com, volume_change);
-}
-
 //! \brief Reports the total bottom surface ice flux.
-class IceMassFluxBasal : public TSDiag<TSFluxDiagnostic, IceModel>
+class IceMassFluxBasal : public MassChange
 {
 public:
   IceMassFluxBasal(const IceModel *m)
-    : TSDiag<TSFluxDiagnostic, IceModel>(m, "tendency_of_ice_mass_due_to_basal_mass_flux") {
+    : MassChange(m, "tendency_of_ice_mass_due_to_basal_mass_flux", BMB, BOTH) {
 
     if (m_config->get_flag("output.ISMIP6")) {
       m_ts.variable().set_name("tendlibmassbf");
@@ -1638,18 +1712,14 @@ public:
     m_ts.variable().set_string("standard_name", "tendency_of_land_ice_mass_due_to_basal_mass_balance");
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
-
-  double compute() {
-    return mass_change(model, BMB, BOTH);
-  }
 };
 
 //! \brief Reports the total top surface ice flux.
-class IceMassFluxSurface : public TSDiag<TSFluxDiagnostic, IceModel>
+class IceMassFluxSurface : public MassChange
 {
 public:
   IceMassFluxSurface(const IceModel *m)
-    : TSDiag<TSFluxDiagnostic, IceModel>(m, "tendency_of_ice_mass_due_to_surface_mass_flux") {
+    : MassChange(m, "tendency_of_ice_mass_due_to_surface_mass_flux", SMB, BOTH) {
 
     if (m_config->get_flag("output.ISMIP6")) {
       m_ts.variable().set_name("tendacabf");
@@ -1660,36 +1730,28 @@ public:
     m_ts.variable().set_string("standard_name", "tendency_of_land_ice_mass_due_to_surface_mass_balance");
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
-
-  double compute() {
-    return mass_change(model, SMB, BOTH);
-  }
 };
 
 //! \brief Reports the total basal ice flux over the grounded region.
-class IceMassFluxBasalGrounded : public TSDiag<TSFluxDiagnostic, IceModel>
+class IceMassFluxBasalGrounded : public MassChange
 {
 public:
   IceMassFluxBasalGrounded(const IceModel *m)
-    : TSDiag<TSFluxDiagnostic, IceModel>(m, "basal_mass_flux_grounded") {
+    : MassChange(m, "basal_mass_flux_grounded", BMB, GROUNDED) {
 
     set_units("kg s-1", "Gt year-1");
     m_ts.variable().set_string("long_name", "total over grounded ice domain of basal mass flux");
     m_ts.variable().set_string("standard_name", "tendency_of_land_ice_mass_due_to_basal_mass_balance");
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
-
-  double compute() {
-    return mass_change(model, BMB, GROUNDED);
-  }
 };
 
 //! \brief Reports the total sub-shelf ice flux.
-class IceMassFluxBasalFloating : public TSDiag<TSFluxDiagnostic, IceModel>
+class IceMassFluxBasalFloating : public MassChange
 {
 public:
   IceMassFluxBasalFloating(const IceModel *m)
-    : TSDiag<TSFluxDiagnostic, IceModel>(m, "basal_mass_flux_floating") {
+    : MassChange(m, "basal_mass_flux_floating", BMB, SHELF) {
 
     if (m_config->get_flag("output.ISMIP6")) {
       m_ts.variable().set_name("tendlibmassbffl");
@@ -1700,37 +1762,32 @@ public:
     m_ts.variable().set_string("standard_name", "tendency_of_land_ice_mass_due_to_basal_mass_balance");
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
-
-  double compute() {
-    return mass_change(model, BMB, SHELF);
-  }
 };
 
 //! \brief Reports the total numerical mass flux needed to preserve
 //! non-negativity of ice thickness.
-class IceMassFluxConservationError : public TSDiag<TSFluxDiagnostic, IceModel>
+class IceMassFluxConservationError : public MassChange
 {
 public:
   IceMassFluxConservationError(const IceModel *m)
-    : TSDiag<TSFluxDiagnostic, IceModel>(m, "tendency_of_ice_mass_due_to_conservation_error") {
+    : MassChange(m, "tendency_of_ice_mass_due_to_conservation_error", ERROR, BOTH) {
 
     set_units("kg s-1", "Gt year-1");
     m_ts.variable().set_string("long_name", "total numerical flux needed to preserve non-negativity"
                                " of ice thickness");
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
-
-  double compute() {
-    return mass_change(model, ERROR, BOTH);
-  }
 };
 
 //! \brief Reports the total discharge flux.
-class IceMassFluxDischarge : public TSDiag<TSFluxDiagnostic, IceModel>
+class IceMassFluxDischarge : public TSSumDiag<TSFluxDiagnostic>
 {
 public:
   IceMassFluxDischarge(const IceModel *m)
-    : TSDiag<TSFluxDiagnostic, IceModel>(m, "tendency_of_ice_mass_due_to_discharge") {
+    : TSSumDiag<TSFluxDiagnostic>(m, "tendency_of_ice_mass_due_to_discharge"),
+      m_calving(nullptr),
+      m_frontal_melt(nullptr),
+      m_forced_retreat(nullptr) {
 
     if (m_config->get_flag("output.ISMIP6")) {
       m_ts.variable().set_name("tendlifmassbf");
@@ -1744,36 +1801,39 @@ public:
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
 
-  double compute() {
-    const double ice_density = m_config->get_number("constants.ice.density");
-
-    const IceModelVec2S &calving = model->calving();
-    const IceModelVec2S &frontal_melt = model->frontal_melt();
-    const IceModelVec2S &forced_retreat = model->forced_retreat();
-
-    auto cell_area = m_grid->cell_area();
+protected:
+  void prepare_partial_sums_impl(IceModelVec::AccessList &list) {
+    TSSumDiag<TSFluxDiagnostic>::prepare_partial_sums_impl(list);
 
-    double volume_change = 0.0;
+    m_calving        = &model->calving();
+    m_frontal_melt   = &model->frontal_melt();
+    m_forced_retreat = &model->forced_retreat();
 
-    IceModelVec::AccessList list{&calving, &frontal_melt, &forced_retreat};
+    list.add({m_calving, m_frontal_melt, m_forced_retreat});
+  }
 
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-      // m^2 * m = m^3
-      volume_change += cell_area * (calving(i, j) + frontal_melt(i, j) + forced_retreat(i, j));
-    }
+  void add_partial_sums_impl(int i, int j, double *sums) const {
+    // m^2 * m = m^3
+    sums[0] += m_cell_area * ((*m_calving)(i, j) +
+                              (*m_frontal_melt)(i, j) +
+                              (*m_forced_retreat)(i, j));
+  }
 
+  double value_impl(const double *sums) const {
     // (kg/m^3) * m^3 = kg
-    return ice_density * GlobalSum(m_grid->com, volume_change);
+    return m_config->get_number("constants.ice.density") * sums[0];
   }
+
+  const IceModelVec2S *m_calving, *m_frontal_melt, *m_forced_retreat;
 };
 
 //! \brief Reports the total calving flux.
-class IceMassFluxCalving : public TSDiag<TSFluxDiagnostic, IceModel>
+class IceMassFluxCalving : public TSSumDiag<TSFluxDiagnostic>
 {
 public:
   IceMassFluxCalving(const IceModel *m)
-    : TSDiag<TSFluxDiagnostic, IceModel>(m, "tendency_of_ice_mass_due_to_calving") {
+    : TSSumDiag<TSFluxDiagnostic>(m, "tendency_of_ice_mass_due_to_calving"),
+      m_calving(nullptr) {
 
     if (m_config->get_flag("output.ISMIP6")) {
       m_ts.variable().set_name("tendlicalvf");
@@ -1785,26 +1845,26 @@ public:
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
 
-  double compute() {
-    const double ice_density = m_config->get_number("constants.ice.density");
-
-    const IceModelVec2S &calving = model->calving();
-
-    auto cell_area = m_grid->cell_area();
+protected:
+  void prepare_partial_sums_impl(IceModelVec::AccessList &list) {
+    TSSumDiag<TSFluxDiagnostic>::prepare_partial_sums_impl(list);
 
-    double volume_change = 0.0;
+    m_calving = &model->calving();
 
-    IceModelVec::AccessList list{&calving};
+    list.add(*m_calving);
+  }
 
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-      // m^2 * m = m^3
-      volume_change += cell_area * calving(i, j);
-    }
+  void add_partial_sums_impl(int i, int j, double *sums) const {
+    // m^2 * m = m^3
+    sums[0] += m_cell_area * (*m_calving)(i, j);
+  }
 
+  double value_impl(const double *sums) const {
     // (kg/m^3) * m^3 = kg
-    return ice_density * GlobalSum(m_grid->com, volume_change);
+    return m_config->get_number("constants.ice.density") * sums[0];
   }
+
+  const IceModelVec2S *m_calving;
 };
 
 //! @brief Reports the total flux across the grounding line.
@@ -3003,6 +3063,11 @@ double IceModel::compute_temperate_base_fraction(double total_ice_area) {
 
   const IceModelVec3 &enthalpy = m_energy_model->enthalpy();
 
+  // basal enthalpy and pressure in icy columns
+  std::vector<double> E_basal, pressure;
+  E_basal.reserve(m_grid->xm() * m_grid->ym());
+  pressure.reserve(m_grid->xm() * m_grid->ym());
+
   IceModelVec::AccessList list{&enthalpy, &m_geometry.cell_type, &m_geometry.ice_thickness};
   ParallelSection loop(m_grid->com);
   try {
@@ -3010,13 +3075,8 @@ double IceModel::compute_temperate_base_fraction(double total_ice_area) {
       const int i = p.i(), j = p.j();
 
       if (m_geometry.cell_type.icy(i, j)) {
-        const double
-          E_basal  = enthalpy.get_column(i, j)[0],
-          pressure = EC->pressure(m_geometry.ice_thickness(i,j)); // FIXME issue #15
-        // accumulate area of base which is at melt point
-        if (EC->is_temperate_relaxed(E_basal, pressure)) {
-          meltarea += cell_area;
-        }
+        E_basal.push_back(enthalpy.get_column(i, j)[0]);
+        pressure.push_back(EC->pressure(m_geometry.ice_thickness(i,j))); // FIXME issue #15
       }
     }
   } catch (...) {
@@ -3024,6 +3084,18 @@ double IceModel::compute_temperate_base_fraction(double total_ice_area) {
   }
   loop.check();
 
+  // convert all basal values at once
+  const unsigned int N = E_basal.size();
+  std::unique_ptr<bool[]> temperate(new bool[N]);
+  EC->is_temperate_relaxed_n(E_basal.data(), pressure.data(), N, temperate.get());
+
+  // accumulate area of base which is at melt point
+  for (unsigned int k = 0; k < N; ++k) {
+    if (temperate[k]) {
+      meltarea += cell_area;
+    }
+  }
+
   // convert from m2 to km2
   meltarea = units::convert(m_sys, meltarea, "m2", "km2");
   // communication
@@ -3109,24 +3181,35 @@ double IceModel::ice_volume_temperate(double thickness_threshold) const {
 
   double volume = 0.0;
 
+  const unsigned int Mz = m_grid->Mz();
+  std::vector<double> pressure(Mz);
+  std::unique_ptr<bool[]> temperate(new bool[Mz]);
+
   IceModelVec::AccessList list{&m_geometry.ice_thickness, &ice_enthalpy};
   ParallelSection loop(m_grid->com);
   try {
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      if (m_geometry.ice_thickness(i,j) >= thickness_threshold) {
-        const int ks = m_grid->kBelowHeight(m_geometry.ice_thickness(i,j));
+      const double H = m_geometry.ice_thickness(i, j);
+
+      if (H >= thickness_threshold) {
+        const int ks = m_grid->kBelowHeight(H);
         const double *Enth = ice_enthalpy.get_column(i,j);
 
+        // FIXME issue #15: this uses the pressure at the base of the column everywhere
+        std::fill(pressure.begin(), pressure.begin() + ks + 1, EC->pressure(H));
+
+        EC->is_temperate_relaxed_n(Enth, pressure.data(), ks + 1, temperate.get());
+
         for (int k = 0; k < ks; ++k) {
-          if (EC->is_temperate_relaxed(Enth[k],EC->pressure(m_geometry.ice_thickness(i,j)))) { // FIXME issue #15
+          if (temperate[k]) {
             volume += (m_grid->z(k + 1) - m_grid->z(k)) * cell_area;
           }
         }
 
-        if (EC->is_temperate_relaxed(Enth[ks],EC->pressure(m_geometry.ice_thickness(i,j)))) { // FIXME issue #15
-          volume += (m_geometry.ice_thickness(i,j) - m_grid->z(ks)) * cell_area;
+        if (temperate[ks]) {
+          volume += (H - m_grid->z(ks)) * cell_area;
         }
       }
     }
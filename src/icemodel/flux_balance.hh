@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -125,6 +125,10 @@ protected:
     m_interval_length += dt;
   }
 
+  bool is_time_average_impl() const {
+    return true;
+  }
+
 protected:
   AmountKind m_kind;
   IceModelVec2S m_last_amount;
@@ -1,4 +1,4 @@
-// Copyright (C) 2009--2019 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2009--2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -780,6 +780,7 @@ void IceModel::misc_setup() {
   init_frontal_melt();
   init_front_retreat();
   init_diagnostics();
+  init_async_output();
   init_snapshots();
   init_backups();
   init_timeseries();
@@ -1005,6 +1006,13 @@ void IceModel::process_options() {
                "              -skip only makes sense in runs updating ice geometry.\n");
   }
 
+  if (m_config->get_flag("time_stepping.multirate.enabled") and
+      m_config->get_flag("time_stepping.skip.enabled")) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "time_stepping.multirate.enabled and time_stepping.skip.enabled"
+                       " cannot be used together.");
+  }
+
   if (m_config->get_string("calving.methods").find("thickness_calving") != std::string::npos &&
       not m_config->get_flag("geometry.part_grid.enabled")) {
     m_log->message(2,
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -30,6 +30,7 @@
 #include "pism/util/Time.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/io/File.hh"
+#include "pism/util/io/AsyncWriter.hh"
 #include "pism/util/pism_options.hh"
 
 #include "pism/util/Vars.hh"
@@ -96,6 +97,41 @@ void IceModel::write_metadata(const File &file, MappingTreatment mapping_flag,
   }
 }
 
+//! Initialize the asynchronous writer used for snapshots, backups and extra files.
+void IceModel::init_async_output() {
+  if (not m_config->get_flag("output.async.enabled")) {
+    return;
+  }
+
+  int max_pending = m_config->get_number("output.async.max_pending");
+  if (max_pending < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "output.async.max_pending = %d is invalid (has to be positive)",
+                                  max_pending);
+  }
+
+  // The helper thread re-opens files using the serial NetCDF library (nc_open()), so it
+  // cannot write files in other formats.
+  std::string format = m_config->get_string("output.format");
+  if (format != "netcdf3") {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "asynchronous output requires output.format = \"netcdf3\" (got \"%s\")",
+                                  format.c_str());
+  }
+
+  m_log->message(2,
+                 "* Writing snapshots, backups and spatial time-series asynchronously...\n");
+
+  m_output_writer.reset(new io::AsyncWriter(m_grid->com, max_pending));
+}
+
+//! Wait until asynchronous output (if any) is written.
+void IceModel::flush_async_output() {
+  if (m_output_writer) {
+    m_output_writer->flush();
+  }
+}
+
 //! Save model state in NetCDF format.
 /*!
 Calls save_variables() to do the actual work.
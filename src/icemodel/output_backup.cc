@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2019 PISM Authors
+/* Copyright (C) 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -21,6 +21,8 @@
 
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/io/File.hh"
+#include "pism/util/io/AsyncWriter.hh"
 
 namespace pism {
 
@@ -62,12 +64,27 @@ void IceModel::write_backup() {
   double backup_start_time = get_time();
   profiling.begin("io.backup");
   {
+    if (m_output_writer) {
+      // the previous backup may still be in progress
+      m_output_writer->wait(m_backup_filename);
+    }
+
+    std::string format = m_config->get_string("output.backup_format");
+    if (format.empty()) {
+      format = m_config->get_string("output.format");
+    }
+
     File file(m_grid->com,
               m_backup_filename,
-              string_to_backend(m_config->get_string("output.format")),
+              string_to_backend(format),
               PISM_READWRITE_MOVE,
               m_ctx->pio_iosys_id());
 
+    // backups in formats other than "netcdf3" (e.g. "native") are written synchronously
+    if (m_output_writer and format == "netcdf3") {
+      file.set_async_writer(m_output_writer);
+    }
+
     write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
     write_run_stats(file);
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -27,6 +27,8 @@
 #include "pism/util/pism_options.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/DiagnosticReducer.hh"
+#include "pism/util/io/AsyncWriter.hh"
 
 namespace pism {
 
@@ -227,6 +229,50 @@ void IceModel::init_extras() {
     m_log->message(2,
                    "PISM WARNING: output.extra.vars was not set. Writing the model state...\n");
   } // end of the else clause after "if (extra_vars_set)"
+
+  std::string reduction = m_config->get_string("output.extra.reduction");
+  int stride            = m_config->get_number("output.extra.stride");
+
+  if (stride < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "output.extra.stride = %d is invalid (has to be 1 or greater)",
+                                  stride);
+  }
+
+  m_extra_reducer.reset();
+  if (reduction != "none" or stride > 1) {
+    if (m_extra_vars.empty()) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "please set output.extra.vars to use output.extra.reduction"
+                         " or output.extra.stride");
+    }
+
+    m_extra_reducer.reset(new DiagnosticReducer(m_grid, reduction == "mean_min_max", stride));
+
+    std::set<std::string> available;
+    for (const auto &d : m_diagnostics) {
+      available.insert(d.first);
+    }
+
+    // warn (or stop) now: missing variables are not added to the reducer and are
+    // removed from m_extra_vars so that prune_diagnostics() does not report them again
+    warn_about_missing(*m_log, m_extra_vars, "diagnostic", available,
+                       m_config->get_flag("output.extra.stop_missing"));
+
+    std::set<std::string> reduced_vars;
+    for (const auto &v : m_extra_vars) {
+      auto d = m_diagnostics.find(v);
+      if (d != m_diagnostics.end()) {
+        m_extra_reducer->add(d->second);
+        reduced_vars.insert(v);
+      }
+    }
+    m_extra_vars = reduced_vars;
+
+    auto output_grid = m_extra_reducer->output_grid();
+    m_log->message(2, "reduction: %s, writing fields on a %d x %d grid\n",
+                   reduction.c_str(), output_grid->Mx(), output_grid->My());
+  }
 }
 
 //! Write spatially-variable diagnostic quantities.
@@ -274,6 +320,11 @@ void IceModel::write_extras() {
     // called).
     m_last_extra = current_time;
 
+    // start the first reporting interval
+    if (m_extra_reducer) {
+      m_extra_reducer->reset();
+    }
+
     // ISMIP6 runs need to save diagnostics at the beginning of the run
     if (not m_config->get_flag("output.ISMIP6")) {
       return;
@@ -314,11 +365,20 @@ void IceModel::write_extras() {
   profiling.begin("io.extra_file");
   {
     if (not m_extra_file) {
+      if (m_output_writer) {
+        // the previous record may still be in progress
+        m_output_writer->wait(filename);
+      }
+
       m_extra_file.reset(new File(m_grid->com,
                                   filename,
                                   string_to_backend(m_config->get_string("output.format")),
                                   mode,
                                   m_ctx->pio_iosys_id()));
+
+      if (m_output_writer) {
+        m_extra_file->set_async_writer(m_output_writer);
+      }
     }
 
     std::string time_name = m_config->get_string("time.dimension_name");
@@ -337,12 +397,21 @@ void IceModel::write_extras() {
 
     write_run_stats(*m_extra_file);
 
-    save_variables(*m_extra_file,
-                   m_extra_vars.empty() ? INCLUDE_MODEL_STATE : JUST_DIAGNOSTICS,
-                   m_extra_vars,
-                   0.5 * (m_last_extra + current_time), // use the mid-point of the
-                                                        // current reporting interval
-                   PISM_FLOAT);
+    if (m_extra_reducer) {
+      // write time and run statistics, then reduced fields
+      save_variables(*m_extra_file, JUST_DIAGNOSTICS, {},
+                     0.5 * (m_last_extra + current_time),
+                     PISM_FLOAT);
+
+      m_extra_reducer->write(*m_extra_file, PISM_FLOAT);
+    } else {
+      save_variables(*m_extra_file,
+                     m_extra_vars.empty() ? INCLUDE_MODEL_STATE : JUST_DIAGNOSTICS,
+                     m_extra_vars,
+                     0.5 * (m_last_extra + current_time), // use the mid-point of the
+                                                          // current reporting interval
+                     PISM_FLOAT);
+    }
 
     // Get the length of the time dimension *after* it is appended to.
     unsigned int time_length = m_extra_file->dimension_length(time_name);
@@ -357,8 +426,10 @@ void IceModel::write_extras() {
 
   flush_timeseries();
 
-  if (m_split_extra) {
-    // each record is saved to a new file, so we can close this one
+  if (m_split_extra or m_output_writer) {
+    // Each record is saved to a new file, so we can close this one. When writing
+    // asynchronously, closing the file submits this record for writing; the file will be
+    // re-opened to append the next record.
     m_extra_file.reset(nullptr);
   }
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -153,12 +153,22 @@ void IceModel::write_snapshot() {
   profiling.begin("io.snapshots");
   IO_Mode mode = m_snapshots_file_is_ready ? PISM_READWRITE : PISM_READWRITE_MOVE;
   {
+    if (m_output_writer) {
+      // this file may be written to (or moved aside below) while a previous snapshot
+      // is still being written
+      m_output_writer->wait(filename);
+    }
+
     File file(m_grid->com,
               filename,
               string_to_backend(m_config->get_string("output.format")),
               mode,
               m_ctx->pio_iosys_id());
 
+    if (m_output_writer) {
+      file.set_async_writer(m_output_writer);
+    }
+
     if (not m_snapshots_file_is_ready) {
       write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2017, 2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2017, 2019, 2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -98,6 +98,41 @@ unsigned int IceModel::skip_counter(double input_dt, double input_dt_diffusivity
   return 0;
 }
 
+/*!
+ * Returns true if energy and age models should be updated at the end of the current step
+ * (multi-rate time stepping).
+ *
+ * Uses the number of steps or the model time elapsed since the last update. Also forces
+ * an update if the accumulated energy time step reached the 3D CFL limit and at the end
+ * of the run.
+ */
+bool IceModel::multirate_update_due() const {
+  if (not m_multirate_forcing) {
+    return true;
+  }
+
+  // the accumulated time step is limited by the 3D CFL criterion (see max_timestep())
+  const MaxTimestep dt_cfl = m_stress_balance->max_timestep_cfl_3d().dt_max;
+  if (m_adaptive_timestep_reason.find("multi-rate energy") == 0 or
+      (dt_cfl.finite() and dt_TempAge >= dt_cfl.value())) {
+    return true;
+  }
+
+  // always update at the end of the run
+  if (m_time->current() + m_dt >= m_time->end()) {
+    return true;
+  }
+
+  const double interval = m_config->get_number("time_stepping.multirate.interval", "seconds");
+  if (interval > 0.0) {
+    return dt_TempAge >= interval;
+  }
+
+  const unsigned int n_steps = static_cast<unsigned int>(m_config->get_number("time_stepping.multirate.steps"));
+
+  return m_multirate_forcing->n_steps() >= std::max(n_steps, 1u);
+}
+
 //! Use various stability criteria to determine the time step for an evolution run.
 /*!
 The main loop in run() approximates many physical processes.  Several of these approximations,
@@ -170,6 +205,17 @@ void IceModel::max_timestep(double &dt_result, unsigned int &skip_counter_result
     restrictions.push_back(save_max_timestep(current_time));
   }
 
+  // multi-rate time stepping: energy and age models use the time step equal to the sum of
+  // all mass continuity steps since the last update, so we have to make sure that this sum
+  // does not exceed the 3D CFL limit
+  if (m_multirate_forcing and dt_TempAge > 0.0) {
+    const MaxTimestep dt_cfl = m_stress_balance->max_timestep_cfl_3d().dt_max;
+
+    if (dt_cfl.finite() and dt_cfl.value() > dt_TempAge) {
+      restrictions.push_back(MaxTimestep(dt_cfl.value() - dt_TempAge, "multi-rate energy"));
+    }
+  }
+
   // mass continuity stability criteria
   if (m_config->get_flag("geometry.update.enabled")) {
     CFLData cfl = m_stress_balance->max_timestep_cfl_2d();
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -53,6 +53,10 @@ int IceModel::process_signals() {
 
     prepend_history(pism::printf("EARLY EXIT caused by signal SIGTERM. Completed timestep at time=%s.",
                                  m_time->date().c_str()));
+
+    // finish writing snapshots, backups and spatial time-series
+    flush_async_output();
+
     // Tell the caller that the user requested an early termination of
     // the run.
     return 1;
@@ -76,6 +80,7 @@ int IceModel::process_signals() {
 
     // flush all the time-series buffers:
     flush_timeseries();
+    flush_async_output();
   }
 
   if (pism_signal == SIGUSR2) {
@@ -85,6 +90,7 @@ int IceModel::process_signals() {
 
     // flush all the time-series buffers:
     flush_timeseries();
+    flush_async_output();
   }
 
   return 0;
@@ -62,6 +62,12 @@ extern const char *cmake_version;
 /* Equal to 1 if PISM was built with NCAR's ParallelIO. */
 #define Pism_USE_PIO 0
 
+/* Equal to 1 if PISM was built with OpenMP support, 0 otherwise. */
+#define Pism_USE_OPENMP 0
+
+/* Equal to 1 if PISM was built with FFTW's MPI interface, 0 otherwise. */
+#define Pism_USE_FFTW_MPI 0
+
 /* Equal to 1 if PISM's Python bindings were built, 0 otherwise. */
 #define Pism_BUILD_PYTHON_BINDINGS 0
 
@@ -47,6 +47,7 @@
 #include "basalstrength/MohrCoulombYieldStress.hh"
 #include "util/error_handling.hh"
 #include "util/Diagnostic.hh"
+#include "util/DiagnosticReducer.hh"
 #include "util/Config.hh"
 
 #if (Pism_USE_JANSSON==1)
@@ -263,6 +264,7 @@
 
 %shared_ptr(pism::Diagnostic)
 %include "util/Diagnostic.hh"
+%include "util/DiagnosticReducer.hh"
 %include "stressbalance/timestepping.hh"
 
 %shared_ptr(pism::Component)
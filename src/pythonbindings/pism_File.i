@@ -5,6 +5,8 @@
 
 %ignore pism::File::read_variable(const std::string &, const std::vector<unsigned int> &, const std::vector<unsigned int> &, double *) const;
 %ignore pism::File::write_variable(const std::string &, const std::vector<unsigned int> &, const std::vector<unsigned int> &, const double *) const;
+%ignore pism::File::set_async_writer;
+%ignore pism::File::regridding_cache;
 
 %include "util/io/IO_Flags.hh"
 %include "util/io/File.hh"
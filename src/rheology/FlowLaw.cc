@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2018 Jed Brown, Ed Bueler, and Constantine Khroulev
+// Copyright (C) 2004-2018, 2020 Jed Brown, Ed Bueler, and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -16,6 +16,8 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>            // std::min
+
 #include "FlowLaw.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/EnthalpyConverter.hh"
@@ -222,23 +224,32 @@ double averaged_hardness(const FlowLaw &ice,
 
   EnthalpyConverter &EC = *ice.EC();
 
-  // Use trapezoidal rule to integrate from 0 to zlevels[kbelowH]:
-  if (kbelowH > 0) {
-    double
-      p0 = EC.pressure(thickness),
-      E0 = enthalpy[0],
-      h0 = ice.hardness(E0, p0); // ice hardness at the left endpoint
+  // Compute hardness at levels 0, ..., kbelowH one block at a time using the column
+  // version of FlowLaw::hardness() (this avoids a virtual call per level). Fixed-size scratch
+  // storage makes this safe to call from thread-parallel loops.
+  const int block_size = 64;
+  double P[block_size], h[block_size];
+
+  // hardness at the left endpoint of the current interval
+  double h0 = 0.0;
 
-    for (int i = 1; i <= kbelowH; ++i) { // note the "1" and the "<="
-      const double
-        p1 = EC.pressure(thickness - zlevels[i]), // pressure at the right endpoint
-        E1 = enthalpy[i], // enthalpy at the right endpoint
-        h1 = ice.hardness(E1, p1); // ice hardness at the right endpoint
+  for (int start = 0; start <= kbelowH; start += block_size) {
+    const int N = std::min(block_size, kbelowH + 1 - start);
+
+    for (int k = 0; k < N; ++k) {
+      P[k] = EC.pressure(thickness - zlevels[start + k]);
+    }
 
-      // The trapezoid rule sans the "1/2":
-      B += (zlevels[i] - zlevels[i-1]) * (h0 + h1);
+    ice.hardness_n(enthalpy + start, P, N, h);
 
-      h0 = h1;
+    // Use trapezoidal rule to integrate from 0 to zlevels[kbelowH]:
+    for (int k = 0; k < N; ++k) {
+      const int i = start + k;
+      if (i > 0) {
+        // The trapezoid rule sans the "1/2":
+        B += (zlevels[i] - zlevels[i-1]) * (h0 + h[k]);
+      }
+      h0 = h[k];
     }
   }
 
@@ -246,12 +257,10 @@ double averaged_hardness(const FlowLaw &ice,
   B *= 0.5;
 
   // use the "rectangle method" to integrate from
-  // zlevels[kbelowH] to thickness:
-  double
-    depth = thickness - zlevels[kbelowH],
-    p = EC.pressure(depth);
+  // zlevels[kbelowH] to thickness (h0 is the hardness at zlevels[kbelowH]):
+  double depth = thickness - zlevels[kbelowH];
 
-  B += depth * ice.hardness(enthalpy[kbelowH], p);
+  B += depth * h0;
 
   // Now B is an integral of ice hardness; next, compute the average:
   if (thickness > 0) {
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,9 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <cmath>
+#include <algorithm>            // std::min
+
 #include "GPBLD.hh"
 #include "pism/util/ConfigInterface.hh"
 
@@ -60,5 +63,62 @@ double GPBLD::softness_impl(double enthalpy, double pressure) const {
   }
 }
 
+//! Column version of softness_impl().
+/*!
+  Uses column methods of the enthalpy converter instead of converting one value at a time.
+
+  This is called from thread-parallel loops, so it processes the column in blocks, using
+  fixed-size scratch storage on the stack.
+*/
+void GPBLD::softness_n(const double *enthalpy, const double *pressure,
+                       unsigned int n, double *result) const {
+  const unsigned int block_size = 64;
+  double omega[block_size];
+
+  const double A_temperate = softness_paterson_budd(m_T_0);
+
+  for (unsigned int start = 0; start < n; start += block_size) {
+    const unsigned int N = std::min(block_size, n - start);
+
+    const double
+      *E = enthalpy + start,
+      *P = pressure + start;
+    double *A = result + start;
+
+    m_EC->water_fraction_n(E, P, N, omega);
+    m_EC->pressure_adjusted_temperature_n(E, P, N, A);
+
+    for (unsigned int k = 0; k < N; ++k) {
+      // Note: omega == 0 if E == E_s(p). In this case T_pa == m_T_0 and both branches
+      // below give the same result.
+      if (omega[k] > 0.0) {
+        A[k] = A_temperate * (1.0 + m_water_frac_coeff * std::min(omega[k],
+                                                                  m_water_frac_observed_limit));
+      } else {
+        A[k] = softness_paterson_budd(A[k]);
+      }
+    }
+  }
+}
+
+void GPBLD::hardness_n_impl(const double *enthalpy, const double *pressure,
+                            unsigned int n, double *result) const {
+  softness_n(enthalpy, pressure, n, result);
+
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = pow(result[k], m_hardness_power);
+  }
+}
+
+void GPBLD::flow_n_impl(const double *stress, const double *E,
+                        const double *pressure, const double * /* grainsize */,
+                        unsigned int n, double *result) const {
+  softness_n(E, pressure, n, result);
+
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] *= pow(stress[k], m_n - 1);
+  }
+}
+
 } // end of namespace rheology
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2004--2019 Jed Brown, Craig Lingle, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004--2020 Jed Brown, Craig Lingle, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -30,6 +30,7 @@
 #include "pism/util/error_handling.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/threading.hh"
 #include "pism/util/IceModelVec2CellType.hh"
 #include "pism/geometry/Geometry.hh"
 #include "pism/stressbalance/StressBalance.hh"
@@ -309,17 +310,19 @@ void SIAFD::surface_gradient_mahaffy(const IceModelVec2S &ice_surface_elevation,
   // surface elevation needs more ghosts
   assert(h.stencil_width()   >= 2);
 
-  for (PointsWithGhosts p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-
-    // I-offset
-    h_x(i, j, 0) = (h(i + 1, j) - h(i, j)) / dx;
-    h_y(i, j, 0) = (+ h(i + 1, j + 1) + h(i, j + 1)
-                    - h(i + 1, j - 1) - h(i, j - 1)) / (4.0*dy);
-    // J-offset
-    h_y(i, j, 1) = (h(i, j + 1) - h(i, j)) / dy;
-    h_x(i, j, 1) = (+ h(i + 1, j + 1) + h(i + 1, j)
-                    - h(i - 1, j + 1) - h(i - 1, j)) / (4.0*dx);
+  for (Tiles t(*m_grid, 1); t; t.next()) {
+    for (PointsInTile p(t); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      // I-offset
+      h_x(i, j, 0) = (h(i + 1, j) - h(i, j)) / dx;
+      h_y(i, j, 0) = (+ h(i + 1, j + 1) + h(i, j + 1)
+                      - h(i + 1, j - 1) - h(i, j - 1)) / (4.0*dy);
+      // J-offset
+      h_y(i, j, 1) = (h(i, j + 1) - h(i, j)) / dy;
+      h_x(i, j, 1) = (+ h(i + 1, j + 1) + h(i + 1, j)
+                      - h(i - 1, j + 1) - h(i - 1, j)) / (4.0*dx);
+    }
   }
 }
 
@@ -393,44 +396,46 @@ void SIAFD::surface_gradient_haseloff(const IceModelVec2S &ice_surface_elevation
   assert(w_i.stencil_width()  >= 1);
   assert(w_j.stencil_width()  >= 1);
 
-  for (PointsWithGhosts p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-
-    // x-derivative, i-offset
-    {
-      if ((mask.floating_ice(i,j) && mask.ice_free_ocean(i+1,j)) ||
-          (mask.ice_free_ocean(i,j) && mask.floating_ice(i+1,j))) {
-        // marine margin
-        h_x(i,j,0) = 0;
-        w_i(i,j)   = 0;
-      } else if ((mask.icy(i,j) && mask.ice_free(i+1,j) && h(i+1,j) > h(i,j)) ||
-                 (mask.ice_free(i,j) && mask.icy(i+1,j) && h(i,j) > h(i+1,j))) {
-        // ice next to a "cliff"
-        h_x(i,j,0) = 0.0;
-        w_i(i,j)   = 0;
-      } else {
-        // default case
-        h_x(i,j,0) = (h(i+1,j) - h(i,j)) / dx;
-        w_i(i,j)   = 1;
+  for (Tiles t(*m_grid, 1); t; t.next()) {
+    for (PointsInTile p(t); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      // x-derivative, i-offset
+      {
+        if ((mask.floating_ice(i,j) && mask.ice_free_ocean(i+1,j)) ||
+            (mask.ice_free_ocean(i,j) && mask.floating_ice(i+1,j))) {
+          // marine margin
+          h_x(i,j,0) = 0;
+          w_i(i,j)   = 0;
+        } else if ((mask.icy(i,j) && mask.ice_free(i+1,j) && h(i+1,j) > h(i,j)) ||
+                   (mask.ice_free(i,j) && mask.icy(i+1,j) && h(i,j) > h(i+1,j))) {
+          // ice next to a "cliff"
+          h_x(i,j,0) = 0.0;
+          w_i(i,j)   = 0;
+        } else {
+          // default case
+          h_x(i,j,0) = (h(i+1,j) - h(i,j)) / dx;
+          w_i(i,j)   = 1;
+        }
       }
-    }
 
-    // y-derivative, j-offset
-    {
-      if ((mask.floating_ice(i,j) && mask.ice_free_ocean(i,j+1)) ||
-          (mask.ice_free_ocean(i,j) && mask.floating_ice(i,j+1))) {
-        // marine margin
-        h_y(i,j,1) = 0.0;
-        w_j(i,j)   = 0.0;
-      } else if ((mask.icy(i,j) && mask.ice_free(i,j+1) && h(i,j+1) > h(i,j)) ||
-                 (mask.ice_free(i,j) && mask.icy(i,j+1) && h(i,j) > h(i,j+1))) {
-        // ice next to a "cliff"
-        h_y(i,j,1) = 0.0;
-        w_j(i,j)   = 0.0;
-      } else {
-        // default case
-        h_y(i,j,1) = (h(i,j+1) - h(i,j)) / dy;
-        w_j(i,j)   = 1.0;
+      // y-derivative, j-offset
+      {
+        if ((mask.floating_ice(i,j) && mask.ice_free_ocean(i,j+1)) ||
+            (mask.ice_free_ocean(i,j) && mask.floating_ice(i,j+1))) {
+          // marine margin
+          h_y(i,j,1) = 0.0;
+          w_j(i,j)   = 0.0;
+        } else if ((mask.icy(i,j) && mask.ice_free(i,j+1) && h(i,j+1) > h(i,j)) ||
+                   (mask.ice_free(i,j) && mask.icy(i,j+1) && h(i,j) > h(i,j+1))) {
+          // ice next to a "cliff"
+          h_y(i,j,1) = 0.0;
+          w_j(i,j)   = 0.0;
+        } else {
+          // default case
+          h_y(i,j,1) = (h(i,j+1) - h(i,j)) / dy;
+          w_j(i,j)   = 1.0;
+        }
       }
     }
   }
@@ -495,8 +500,7 @@ void SIAFD::surface_gradient_haseloff(const IceModelVec2S &ice_surface_elevation
     } // end of "y-derivative, i-offset"
   }
 
-  h_x.update_ghosts();
-  h_y.update_ghosts();
+  update_ghosts({&h_x, &h_y});
 }
 
 
@@ -572,8 +576,6 @@ void SIAFD::compute_diffusivity(bool full_update,
     limit_diffusivity            = m_config->get_flag("stress_balance.sia.limit_diffusivity"),
     use_age                      = compute_grain_size_using_age or e_age_coupling;
 
-  rheology::grain_size_vostok gs_vostok;
-
   // get "theta" from Schoof (2003) bed smoothness calculation and the
   // thickness relative to the smoothed bed; each IceModelVec2S involved must
   // have stencil width WIDE_GHOSTS for this too work
@@ -607,18 +609,39 @@ void SIAFD::compute_diffusivity(bool full_update,
     My = m_grid->My(),
     Mz = m_grid->Mz();
 
-  std::vector<double> depth(Mz), stress(Mz), pressure(Mz), E(Mz), flow(Mz);
-  std::vector<double> delta_ij(Mz);
-  std::vector<double> A(Mz), ice_grain_size(Mz, m_config->get_number("constants.ice.grain_size", "m"));
-  std::vector<double> e_factor(Mz, enhancement_factor);
+  // Storage for column values. Each thread gets its own copy.
+  struct Work {
+    Work(unsigned int N, double grain_size, double enhancement)
+      : depth(N), stress(N), pressure(N), E(N), flow(N), delta_ij(N), A(N),
+        ice_grain_size(N, grain_size), e_factor(N, enhancement),
+        D_max(0.0), high_diffusivity_counter(0) {
+      // empty
+    }
+    std::vector<double> depth, stress, pressure, E, flow, delta_ij, A, ice_grain_size, e_factor;
+    double D_max;
+    int high_diffusivity_counter;
+    rheology::grain_size_vostok gs_vostok;
+  };
+
+  PerThread<Work> work(Mz, m_config->get_number("constants.ice.grain_size", "m"),
+                       enhancement_factor);
 
-  double D_max = 0.0;
-  int high_diffusivity_counter = 0;
   for (int o=0; o<2; o++) {
     ParallelSection loop(m_grid->com);
     try {
-      for (PointsWithGhosts p(*m_grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
+      parallel_for(*m_grid, 1, [&](int i, int j) {
+        Work &w = work.get();
+
+        std::vector<double>
+          &depth          = w.depth,
+          &stress         = w.stress,
+          &pressure       = w.pressure,
+          &E              = w.E,
+          &flow           = w.flow,
+          &delta_ij       = w.delta_ij,
+          &A              = w.A,
+          &ice_grain_size = w.ice_grain_size,
+          &e_factor       = w.e_factor;
 
         // staggered point: o=0 is i+1/2, o=1 is j+1/2, (i, j) and (i+oi, j+oj)
         //   are regular grid neighbors of a staggered point:
@@ -633,7 +656,7 @@ void SIAFD::compute_diffusivity(bool full_update,
           if (full_update) {
             delta[o]->set_column(i, j, 0.0);
           }
-          continue;
+          return;
         }
 
         const int ks = m_grid->kBelowHeight(thk);
@@ -658,7 +681,7 @@ void SIAFD::compute_diffusivity(bool full_update,
           if (compute_grain_size_using_age) {
             for (int k = 0; k <= ks; ++k) {
               // convert age from seconds to years:
-              ice_grain_size[k] = gs_vostok(A[k] * m_seconds_per_year);
+              ice_grain_size[k] = w.gs_vostok(A[k] * m_seconds_per_year);
             }
           }
 
@@ -723,10 +746,10 @@ void SIAFD::compute_diffusivity(bool full_update,
 
         if (limit_diffusivity and D >= D_limit) {
           D = D_limit;
-          high_diffusivity_counter += 1;
+          w.high_diffusivity_counter += 1;
         }
 
-        D_max = std::max(D_max, D);
+        w.D_max = std::max(w.D_max, D);
 
         result(i, j, o) = D;
 
@@ -738,13 +761,20 @@ void SIAFD::compute_diffusivity(bool full_update,
           }
           delta[o]->set_column(i, j, &delta_ij[0]);
         }
-      } // i, j-loop
+      }); // i, j-loop
     } catch (...) {
       loop.failed();
     }
     loop.check();
   } // o-loop
 
+  double D_max = 0.0;
+  int high_diffusivity_counter = 0;
+  for (int k = 0; k < work.size(); ++k) {
+    D_max = std::max(D_max, work[k].D_max);
+    high_diffusivity_counter += work[k].high_diffusivity_counter;
+  }
+
   m_D_max = GlobalMax(m_grid->com, D_max);
 
   high_diffusivity_counter = GlobalSum(m_grid->com, high_diffusivity_counter);
@@ -901,9 +931,7 @@ void SIAFD::compute_3d_horizontal_velocity(const Geometry &geometry,
 
   const unsigned int Mz = m_grid->Mz();
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-
+  auto velocity = [&](int i, int j) {
     const double
       *I_e = I[0]->get_column(i, j),
       *I_w = I[0]->get_column(i - 1, j),
@@ -940,11 +968,23 @@ void SIAFD::compute_3d_horizontal_velocity(const Geometry &geometry,
       v_ij[k] = sliding_velocity_v - 0.25 * (I_e[k] * h_y_e + I_w[k] * h_y_w +
                                              I_n[k] * h_y_n + I_s[k] * h_y_s);
     }
+  };
+
+  // Compute velocity near sub-domain edges first, then communicate to get ghosts while
+  // computing velocity in the interior.
+  const unsigned int width = std::max(u_out.stencil_width(), v_out.stencil_width());
+
+  for (PointsBoundary p(*m_grid, width); p; p.next()) {
+    velocity(p.i(), p.j());
+  }
+
+  GhostUpdate ghosts({&u_out, &v_out});
+
+  for (PointsInterior p(*m_grid, width); p; p.next()) {
+    velocity(p.i(), p.j());
   }
 
-  // Communicate to get ghosts:
-  u_out.update_ghosts();
-  v_out.update_ghosts();
+  ghosts.finish();
 }
 
 //! Determine if `accumulation_time` corresponds to an interglacial period.
@@ -1,4 +1,4 @@
-// Copyright (C) 2004--2019 Constantine Khroulev, Ed Bueler and Jed Brown
+// Copyright (C) 2004--2020 Constantine Khroulev, Ed Bueler and Jed Brown
 //
 // This file is part of PISM.
 //
@@ -1277,14 +1277,17 @@ void SSAFD::compute_hardav_staggered(const Inputs &inputs) {
           continue;
         }
 
+        const int ks = m_grid->kBelowHeight(H);
+
         E_offset = enthalpy.get_column(i+oi,j+oj);
-        // build a column of enthalpy values a the current location:
-        for (unsigned int k = 0; k < m_grid->Mz(); ++k) {
+        // build a column of enthalpy values a the current location (only levels 0, ..., ks
+        // are used below):
+        for (int k = 0; k <= ks; ++k) {
           E[k] = 0.5 * (E_ij[k] + E_offset[k]);
         }
 
         m_hardness(i,j,o) = rheology::averaged_hardness(*m_flow_law,
-                                                        H, m_grid->kBelowHeight(H),
+                                                        H, ks,
                                                         &(m_grid->z()[0]), &E[0]);
       } // o
     } // loop over points
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017, 2019 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <set>
+
 #include "Diagnostic.hh"
 #include "pism/util/Time.hh"
 #include "error_handling.hh"
@@ -63,6 +65,18 @@ void Diagnostic::reset_impl() {
   // empty
 }
 
+/*!
+ * Returns true if this diagnostic reports an average over the reporting interval (i.e.
+ * since the last reset()) instead of an instantaneous value.
+ */
+bool Diagnostic::is_time_average() const {
+  return this->is_time_average_impl();
+}
+
+bool Diagnostic::is_time_average_impl() const {
+  return false;
+}
+
 /*!
  * Convert from external (output) units to internal units.
  */
@@ -185,6 +199,8 @@ TSDiagnostic::TSDiagnostic(IceGrid::ConstPtr g, const std::string &name)
 
   m_current_time = 0;
   m_start        = 0;
+  m_value        = 0.0;
+  m_value_set    = false;
 
   m_buffer_size = (size_t)m_config->get_number("output.timeseries.buffer_size");
 
@@ -312,6 +328,134 @@ void TSRateDiagnostic::evaluate(double t0, double t1, double change) {
 
 void TSDiagnostic::update(double t0, double t1) {
   this->update_impl(t0, t1);
+  m_value_set = false;
+}
+
+unsigned int TSDiagnostic::n_partial_sums() const {
+  return this->n_partial_sums_impl();
+}
+
+void TSDiagnostic::prepare_partial_sums(IceModelVec::AccessList &list) {
+  this->prepare_partial_sums_impl(list);
+}
+
+void TSDiagnostic::set_partial_sums(const double *sums) {
+  m_value     = this->value_impl(sums);
+  m_value_set = true;
+}
+
+unsigned int TSDiagnostic::n_partial_sums_impl() const {
+  return 0;
+}
+
+void TSDiagnostic::prepare_partial_sums_impl(IceModelVec::AccessList &list) {
+  (void) list;
+}
+
+void TSDiagnostic::add_partial_sums_impl(int i, int j, double *sums) const {
+  (void) i;
+  (void) j;
+  (void) sums;
+}
+
+double TSDiagnostic::value_impl(const double *sums) const {
+  return sums[0];
+}
+
+/*!
+ * Compute this diagnostic alone using partial sums (see n_partial_sums()).
+ *
+ * Diagnostics that support partial sums can use this to implement compute().
+ */
+double TSDiagnostic::compute_using_partial_sums() {
+  const unsigned int N = this->n_partial_sums();
+
+  std::vector<double> local(N, 0.0), global(N, 0.0);
+  {
+    IceModelVec::AccessList list;
+    this->prepare_partial_sums(list);
+
+    for (Points p(*m_grid); p; p.next()) {
+      this->add_partial_sums(p.i(), p.j(), local.data());
+    }
+  }
+
+  GlobalSum(m_grid->com, local.data(), global.data(), N);
+
+  return this->value_impl(global.data());
+}
+
+//! Value of this diagnostic: set using set_partial_sums() or computed from scratch.
+double TSDiagnostic::value() {
+  if (m_value_set) {
+    return m_value;
+  }
+  return this->compute();
+}
+
+/*!
+ * Update all diagnostics in `diagnostics`.
+ *
+ * Diagnostics that support partial sums are computed in one pass over the grid and
+ * combined using one reduction. The rest are computed one by one.
+ *
+ * Diagnostics that appear in `diagnostics` under more than one name are updated once.
+ */
+void update_ts_diagnostics(const TSDiagnosticList &diagnostics, double t0, double t1) {
+
+  std::vector<TSDiagnostic*> unique;
+  {
+    std::set<TSDiagnostic*> seen;
+    for (const auto &d : diagnostics) {
+      if (seen.insert(d.second.get()).second) {
+        unique.push_back(d.second.get());
+      }
+    }
+  }
+
+  // diagnostics supporting partial sums and offsets of their sums in the combined array
+  std::vector<TSDiagnostic*> summed;
+  std::vector<unsigned int> offset;
+  unsigned int N = 0;
+  for (auto d : unique) {
+    const unsigned int n = d->n_partial_sums();
+    if (n > 0) {
+      summed.push_back(d);
+      offset.push_back(N);
+      N += n;
+    }
+  }
+
+  if (N > 0) {
+    const IceGrid &grid = *summed.front()->m_grid;
+    const unsigned int n_summed = summed.size();
+
+    std::vector<double> local(N, 0.0), global(N, 0.0);
+    {
+      IceModelVec::AccessList list;
+      for (auto d : summed) {
+        d->prepare_partial_sums(list);
+      }
+
+      for (Points p(grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        for (unsigned int k = 0; k < n_summed; ++k) {
+          summed[k]->add_partial_sums(i, j, &local[offset[k]]);
+        }
+      }
+    }
+
+    GlobalSum(grid.com, local.data(), global.data(), N);
+
+    for (unsigned int k = 0; k < n_summed; ++k) {
+      summed[k]->set_partial_sums(&global[offset[k]]);
+    }
+  }
+
+  for (auto d : unique) {
+    d->update(t0, t1);
+  }
 }
 
 void TSSnapshotDiagnostic::update_impl(double t0, double t1) {
@@ -319,11 +463,11 @@ void TSSnapshotDiagnostic::update_impl(double t0, double t1) {
     return;
   }
   assert(t1 > t0);
-  evaluate(t0, t1, this->compute());
+  evaluate(t0, t1, this->value());
 }
 
 void TSRateDiagnostic::update_impl(double t0, double t1) {
-  const double v = this->compute();
+  const double v = this->value();
 
   if (m_v_previous_set) {
     assert(t1 > t0);
@@ -339,7 +483,7 @@ void TSFluxDiagnostic::update_impl(double t0, double t1) {
     return;
   }
   assert(t1 > t0);
-  evaluate(t0, t1, this->compute());
+  evaluate(t0, t1, this->value());
 }
 
 void TSDiagnostic::define(const File &file) const {
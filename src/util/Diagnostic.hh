@@ -1,4 +1,4 @@
-// Copyright (C) 2010--2019 PISM Authors
+// Copyright (C) 2010--2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -69,6 +69,8 @@ public:
   void update(double dt);
   void reset();
 
+  bool is_time_average() const;
+
   //! @brief Compute a diagnostic quantity and return a pointer to a newly-allocated IceModelVec.
   IceModelVec::Ptr compute() const;
 
@@ -95,6 +97,7 @@ protected:
 
   virtual void update_impl(double dt);
   virtual void reset_impl();
+  virtual bool is_time_average_impl() const;
 
   virtual IceModelVec::Ptr compute_impl() const = 0;
 
@@ -235,6 +238,10 @@ protected:
     m_interval_length = 0.0;
   }
 
+  bool is_time_average_impl() const {
+    return true;
+  }
+
   virtual IceModelVec::Ptr compute_impl() const {
     IceModelVec2S::Ptr result(new IceModelVec2S(Diagnostic::m_grid,
                                                 "diagnostic", WITHOUT_GHOSTS));
@@ -277,6 +284,28 @@ public:
 
   void flush();
 
+  /*!
+   * Number of partial sums used to compute this diagnostic.
+   *
+   * Diagnostics that are global sums of contributions from individual grid points can
+   * provide these contributions instead of computing the sum themselves. This allows
+   * update_ts_diagnostics() to compute all of them in one pass over the grid and
+   * combine them using one reduction. Zero means that compute() performs its own
+   * reductions.
+   */
+  unsigned int n_partial_sums() const;
+
+  //! Prepare to compute partial sums: add fields to `list`, cache parameters.
+  void prepare_partial_sums(IceModelVec::AccessList &list);
+
+  //! Add contributions from the grid point `(i, j)` to `n_partial_sums()` elements of `sums`.
+  void add_partial_sums(int i, int j, double *sums) const {
+    this->add_partial_sums_impl(i, j, sums);
+  }
+
+  //! Use global partial sums to set the value used by the next call of update().
+  void set_partial_sums(const double *sums);
+
   void init(const File &output_file,
             std::shared_ptr<std::vector<double>> requested_times);
 
@@ -294,6 +323,16 @@ protected:
    */
   virtual double compute() = 0;
 
+  virtual unsigned int n_partial_sums_impl() const;
+  virtual void prepare_partial_sums_impl(IceModelVec::AccessList &list);
+  virtual void add_partial_sums_impl(int i, int j, double *sums) const;
+  //! Compute the value of this diagnostic using global partial sums.
+  virtual double value_impl(const double *sums) const;
+
+  double compute_using_partial_sums();
+
+  double value();
+
   /*!
    * Set internal (MKS) and "glaciological" units.
    *
@@ -323,10 +362,20 @@ protected:
   unsigned int m_start;
   //! size of the buffer used to store data
   size_t m_buffer_size;
+
+  //! the value computed using set_partial_sums()
+  double m_value;
+  //! true if m_value should be used by the next call of update()
+  bool m_value_set;
+
+  friend void update_ts_diagnostics(const std::map<std::string, Ptr> &diagnostics,
+                                    double t0, double t1);
 };
 
 typedef std::map<std::string, TSDiagnostic::Ptr> TSDiagnosticList;
 
+void update_ts_diagnostics(const TSDiagnosticList &diagnostics, double t0, double t1);
+
 //! Scalar diagnostic reporting a snapshot of a quantity modeled by PISM.
 /*!
  * The method compute() should return the instantaneous "snapshot" value.
@@ -0,0 +1,402 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::max, std::min
+
+#include "DiagnosticReducer.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/io/io_helpers.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+
+namespace pism {
+
+//! Create the grid containing every `stride`-th point of `grid`, using the same domain
+//! decomposition.
+static IceGrid::Ptr decimated_grid(const IceGrid &grid, unsigned int stride) {
+  const int s = stride;
+
+  GridParameters P;
+  P.Mx           = (grid.Mx() - 1) / s + 1;
+  P.My           = (grid.My() - 1) / s + 1;
+  P.Lx           = 0.5 * (P.Mx - 1) * s * grid.dx();
+  P.Ly           = 0.5 * (P.My - 1) * s * grid.dy();
+  P.x0           = grid.x().front() + P.Lx;
+  P.y0           = grid.y().front() + P.Ly;
+  P.registration = CELL_CORNER;
+  P.periodicity  = NOT_PERIODIC;
+  P.z            = grid.z();
+
+  // Ownership ranges: each rank gets coarse grid points that coincide with fine grid
+  // points it owns.
+  {
+    petsc::DM::Ptr da = grid.get_dm(1, 0);
+
+    PetscInt m = 0, n = 0;
+    PetscErrorCode ierr = DMDAGetInfo(*da, NULL, NULL, NULL, NULL, &m, &n,
+                                      NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    PISM_CHK(ierr, "DMDAGetInfo");
+
+    const PetscInt *lx = NULL, *ly = NULL;
+    ierr = DMDAGetOwnershipRanges(*da, &lx, &ly, NULL);
+    PISM_CHK(ierr, "DMDAGetOwnershipRanges");
+
+    // number of multiples of s in [start, start + size)
+    auto count = [s](int start, int size) {
+      return (start + size - 1) / s - (start + s - 1) / s + 1;
+    };
+
+    int start = 0;
+    for (int k = 0; k < m; ++k) {
+      P.procs_x.push_back(count(start, lx[k]));
+      start += lx[k];
+    }
+
+    start = 0;
+    for (int k = 0; k < n; ++k) {
+      P.procs_y.push_back(count(start, ly[k]));
+      start += ly[k];
+    }
+  }
+
+  IceGrid::Ptr result;
+  try {
+    result.reset(new IceGrid(grid.ctx(), P));
+  } catch (RuntimeError &e) {
+    e.add_context("decimating a %d x %d grid (stride %d)", grid.Mx(), grid.My(), s);
+    throw;
+  }
+  result->set_mapping_info(grid.get_mapping_info());
+
+  return result;
+}
+
+//! Rename `field` (appending `suffix`) and set its `cell_methods`.
+static void rename(IceModelVec &field, const std::string &suffix,
+                   const std::string &cell_methods) {
+  for (unsigned int k = 0; k < field.ndof(); ++k) {
+    auto &m = field.metadata(k);
+    m.set_name(m.get_name() + suffix);
+    m.set_string("cell_methods", cell_methods);
+  }
+}
+
+DiagnosticReducer::DiagnosticReducer(IceGrid::ConstPtr grid, bool min_max, unsigned int stride)
+  : m_grid(grid),
+    m_min_max(min_max),
+    m_stride(std::max(stride, 1U)),
+    m_interval_length(0.0) {
+
+  if (m_stride > 1) {
+    m_output_grid = decimated_grid(*m_grid, m_stride);
+  }
+}
+
+DiagnosticReducer::~DiagnosticReducer() {
+  // empty
+}
+
+IceGrid::ConstPtr DiagnosticReducer::output_grid() const {
+  if (m_output_grid) {
+    return m_output_grid;
+  }
+  return m_grid;
+}
+
+void DiagnosticReducer::add(Diagnostic::Ptr diagnostic) {
+  Field f;
+  f.diagnostic = diagnostic;
+  m_fields.push_back(f);
+}
+
+//! Returns true if `d` has to be averaged by the reducer.
+static bool reduced(Diagnostic &d) {
+  return not (d.is_time_average() or d.metadata(0).get_time_independent());
+}
+
+void DiagnosticReducer::reset() {
+  m_interval_length = 0.0;
+
+  for (auto &f : m_fields) {
+    if (f.sum) {
+      f.sum->set(0.0);
+      f.weight->set(0.0);
+    }
+  }
+}
+
+/*!
+ * Add contributions of the current values of all diagnostics (weighted by the length `dt`
+ * of the time step that just ended).
+ */
+void DiagnosticReducer::update(double dt) {
+  m_interval_length += dt;
+
+  for (auto &f : m_fields) {
+    if (reduced(*f.diagnostic)) {
+      IceModelVec::Ptr value = f.diagnostic->compute();
+      accumulate(f, *value, dt);
+    }
+  }
+}
+
+void DiagnosticReducer::accumulate(Field &field, IceModelVec &value, double dt) {
+  if (not field.sum) {
+    field.sum    = field.diagnostic->compute();
+    field.weight = field.diagnostic->compute();
+    field.sum->set(0.0);
+    field.weight->set(0.0);
+
+    rename(*field.sum, "", "time: mean");
+
+    if (m_min_max) {
+      field.min = field.diagnostic->compute();
+      field.max = field.diagnostic->compute();
+      rename(*field.min, "_min", "time: minimum");
+      rename(*field.max, "_max", "time: maximum");
+    }
+  }
+
+  const unsigned int ndof = value.ndof();
+
+  std::vector<bool> has_fill(ndof, false);
+  std::vector<double> fill(ndof, 0.0);
+  for (unsigned int k = 0; k < ndof; ++k) {
+    if (value.metadata(k).has_attribute("_FillValue")) {
+      has_fill[k] = true;
+      fill[k]     = value.metadata(k).get_number("_FillValue");
+    }
+  }
+
+  PetscInt size = 0;
+  PetscErrorCode ierr = VecGetLocalSize(value.vec(), &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  petsc::VecArray
+    X(value.vec()),
+    S(field.sum->vec()),
+    W(field.weight->vec());
+
+  double
+    *x = X.get(),
+    *sum = S.get(),
+    *w = W.get();
+
+  if (m_min_max) {
+    petsc::VecArray
+      Min(field.min->vec()),
+      Max(field.max->vec());
+    double
+      *min = Min.get(),
+      *max = Max.get();
+
+    for (PetscInt e = 0; e < size; ++e) {
+      const unsigned int k = e % ndof;
+
+      if (has_fill[k] and x[e] == fill[k]) {
+        continue;
+      }
+
+      if (w[e] == 0.0) {
+        // the first valid value at this location
+        min[e] = x[e];
+        max[e] = x[e];
+      } else {
+        min[e] = std::min(min[e], x[e]);
+        max[e] = std::max(max[e], x[e]);
+      }
+    }
+  }
+
+  for (PetscInt e = 0; e < size; ++e) {
+    const unsigned int k = e % ndof;
+
+    if (has_fill[k] and x[e] == fill[k]) {
+      continue;
+    }
+
+    sum[e] += dt * x[e];
+    w[e]   += dt;
+  }
+}
+
+/*!
+ * Convert sums into means and fill locations that had no valid values during the
+ * reporting interval.
+ */
+void DiagnosticReducer::finalize(Field &field) {
+  const unsigned int ndof = field.sum->ndof();
+
+  std::vector<double> fill(ndof, 0.0);
+  for (unsigned int k = 0; k < ndof; ++k) {
+    if (field.sum->metadata(k).has_attribute("_FillValue")) {
+      fill[k] = field.sum->metadata(k).get_number("_FillValue");
+    }
+  }
+
+  PetscInt size = 0;
+  PetscErrorCode ierr = VecGetLocalSize(field.sum->vec(), &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  petsc::VecArray
+    S(field.sum->vec()),
+    W(field.weight->vec());
+
+  double
+    *sum = S.get(),
+    *w = W.get();
+
+  for (PetscInt e = 0; e < size; ++e) {
+    if (w[e] > 0.0) {
+      sum[e] /= w[e];
+    } else {
+      sum[e] = fill[e % ndof];
+    }
+  }
+
+  if (m_min_max) {
+    petsc::VecArray
+      Min(field.min->vec()),
+      Max(field.max->vec());
+    double
+      *min = Min.get(),
+      *max = Max.get();
+
+    for (PetscInt e = 0; e < size; ++e) {
+      if (not (w[e] > 0.0)) {
+        min[e] = fill[e % ndof];
+        max[e] = fill[e % ndof];
+      }
+    }
+  }
+}
+
+//! Fields to write for a given diagnostic.
+std::vector<IceModelVec::Ptr> DiagnosticReducer::outputs(Field &field) {
+  if (not reduced(*field.diagnostic) or m_interval_length == 0.0 or not field.sum) {
+    // this diagnostic is not reduced or the reporting interval is empty (i.e. we are
+    // asked to write a report at the beginning of a run): write the current value
+    IceModelVec::Ptr value = field.diagnostic->compute();
+
+    if (not m_min_max or not reduced(*field.diagnostic)) {
+      return {value};
+    }
+
+    IceModelVec::Ptr
+      min = field.diagnostic->compute(),
+      max = field.diagnostic->compute();
+    rename(*min, "_min", "time: minimum");
+    rename(*max, "_max", "time: maximum");
+
+    return {value, min, max};
+  }
+
+  finalize(field);
+
+  if (m_min_max) {
+    return {field.sum, field.min, field.max};
+  }
+  return {field.sum};
+}
+
+void DiagnosticReducer::define(const IceModelVec &field, const File &file,
+                               IO_Type default_type) const {
+  if (not m_output_grid) {
+    field.define(file, default_type);
+    return;
+  }
+
+  for (unsigned int k = 0; k < field.ndof(); ++k) {
+    IO_Type type = field.metadata(k).get_output_type();
+    type = type == PISM_NAT ? default_type : type;
+    io::define_spatial_variable(field.metadata(k), *m_output_grid, file, type);
+  }
+}
+
+void DiagnosticReducer::write(const IceModelVec &field, const File &file) const {
+  if (not m_output_grid) {
+    field.write(file);
+    return;
+  }
+
+  const IceGrid
+    &fine   = *m_grid,
+    &coarse = *m_output_grid;
+  const int s = m_stride;
+
+  // number of values per grid point (3D fields use a DMDA with dof == Mz)
+  const unsigned int
+    ndof    = field.ndof(),
+    N       = std::max((size_t)ndof, field.levels().size()),
+    z_count = ndof == 1 ? N : 1;
+
+  // a copy without ghosts
+  petsc::TemporaryGlobalVec tmp(field.dm());
+  field.copy_to_vec(field.dm(), tmp);
+
+  petsc::VecArray input_array(tmp);
+  const double *input = input_array.get();
+
+  std::vector<double> buffer(coarse.xm() * coarse.ym() * z_count);
+
+  for (unsigned int k = 0; k < ndof; ++k) {
+    for (int j_c = coarse.ys(); j_c < coarse.ys() + coarse.ym(); ++j_c) {
+      const int j = j_c * s;
+      for (int i_c = coarse.xs(); i_c < coarse.xs() + coarse.xm(); ++i_c) {
+        const int i = i_c * s;
+
+        const size_t
+          offset   = ((j - fine.ys()) * fine.xm() + (i - fine.xs())) * N,
+          offset_c = ((j_c - coarse.ys()) * coarse.xm() + (i_c - coarse.xs())) * z_count;
+
+        for (unsigned int c = 0; c < z_count; ++c) {
+          buffer[offset_c + c] = input[offset + (ndof == 1 ? c : k)];
+        }
+      }
+    }
+
+    io::write_spatial_variable(field.metadata(k), coarse, file, buffer.data());
+  }
+}
+
+/*!
+ * Write reduced fields to `file` and start a new reporting interval.
+ *
+ * Assumes that the current record is appended to the time dimension already.
+ */
+void DiagnosticReducer::write(const File &file, IO_Type default_type) {
+  std::vector<IceModelVec::Ptr> fields;
+  for (auto &f : m_fields) {
+    for (auto v : outputs(f)) {
+      fields.push_back(v);
+    }
+  }
+
+  // define all variables first to avoid switching between define and data modes
+  for (auto f : fields) {
+    define(*f, file, default_type);
+  }
+
+  for (auto f : fields) {
+    write(*f, file);
+  }
+
+  reset();
+}
+
+} // end of namespace pism
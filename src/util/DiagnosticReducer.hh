@@ -0,0 +1,104 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_DIAGNOSTICREDUCER_H
+#define PISM_DIAGNOSTICREDUCER_H
+
+#include <string>
+#include <vector>
+
+#include "pism/util/Diagnostic.hh"
+
+namespace pism {
+
+//! Time-averaged (and decimated) output of spatial diagnostics.
+/*!
+ * Keeps running means (and, optionally, minimums and maximums) of diagnostics over a
+ * reporting interval in memory, so that only reduced records have to be written.
+ *
+ * Call update() after each time step, write() at the end of a reporting interval and
+ * reset() at the beginning of the first one.
+ *
+ * - Means are weighted by time step lengths. Grid points where a diagnostic is equal to its
+ *   `_FillValue` (ice-free areas, for example) are excluded, so a mean is the average over
+ *   the part of the interval when a value was defined.
+ * - Minimums and maximums are written as `name_min` and `name_max`.
+ * - Diagnostics that report time averages already (rates of change, fluxes) and
+ *   time-independent ones are not reduced: they are computed when written.
+ *
+ * If `stride` is greater than one, fields are written on a coarser grid containing every
+ * `stride`-th grid point in each direction. The coarse grid uses the same domain
+ * decomposition, so decimation requires no communication (but each sub-domain has to
+ * contain at least `grid.max_stencil_width` points of the coarse grid in each direction).
+ *
+ * Reductions are not saved to backup files: after a re-start the current reporting
+ * interval starts at the re-start time.
+ */
+class DiagnosticReducer {
+public:
+  DiagnosticReducer(IceGrid::ConstPtr grid, bool min_max, unsigned int stride);
+  ~DiagnosticReducer();
+
+  void add(Diagnostic::Ptr diagnostic);
+
+  void update(double dt);
+
+  void reset();
+
+  void write(const File &file, IO_Type default_type);
+
+  IceGrid::ConstPtr output_grid() const;
+private:
+  struct Field {
+    Diagnostic::Ptr diagnostic;
+    //! time step-weighted sums
+    IceModelVec::Ptr sum;
+    //! sums of time step lengths at each grid point (used to skip missing values)
+    IceModelVec::Ptr weight;
+    IceModelVec::Ptr min, max;
+  };
+
+  void accumulate(Field &field, IceModelVec &value, double dt);
+  void finalize(Field &field);
+
+  std::vector<IceModelVec::Ptr> outputs(Field &field);
+
+  void define(const IceModelVec &field, const File &file, IO_Type default_type) const;
+  void write(const IceModelVec &field, const File &file) const;
+
+  IceGrid::ConstPtr m_grid;
+  //! the grid used for output (`m_grid` if `m_stride` is 1)
+  IceGrid::Ptr m_output_grid;
+
+  bool m_min_max;
+  unsigned int m_stride;
+
+  //! length of the current reporting interval
+  double m_interval_length;
+
+  std::vector<Field> m_fields;
+
+  // disable copying
+  DiagnosticReducer(const DiagnosticReducer&);
+  DiagnosticReducer& operator=(const DiagnosticReducer&);
+};
+
+} // end of namespace pism
+
+#endif /* PISM_DIAGNOSTICREDUCER_H */
@@ -1,4 +1,4 @@
-// Copyright (C) 2009-2017 Andreas Aschwanden, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2009-2017, 2020 Andreas Aschwanden, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -284,6 +284,70 @@ double EnthalpyConverter::enthalpy_permissive(double T, double omega, double P)
   }
 }
 
+/*!
+ * @name Column versions
+ *
+ * These are equivalent to calling corresponding scalar methods in a loop, but the
+ * compiler can inline all the arithmetic, keep converter parameters in registers and
+ * vectorize the loop. Use them when converting whole columns (or other large batches).
+ */
+///@{
+
+//! Column version of is_temperate_relaxed().
+void EnthalpyConverter::is_temperate_relaxed_n(const double *E, const double *P,
+                                               unsigned int n, bool *result) const {
+  const double T_threshold = m_T_melting - m_T_tolerance;
+
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = (pressure_adjusted_temperature(E[k], P[k]) >= T_threshold);
+  }
+}
+
+//! Column version of temperature().
+void EnthalpyConverter::temperature_n(const double *E, const double *P,
+                                      unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = temperature(E[k], P[k]);
+  }
+}
+
+//! Column version of melting_temperature().
+void EnthalpyConverter::melting_temperature_n(const double *P, unsigned int n,
+                                              double *result) const {
+  const double T_melting = m_T_melting, beta = m_beta;
+
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = T_melting - beta * P[k];
+  }
+}
+
+//! Column version of pressure_adjusted_temperature().
+void EnthalpyConverter::pressure_adjusted_temperature_n(const double *E, const double *P,
+                                                        unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = pressure_adjusted_temperature(E[k], P[k]);
+  }
+}
+
+//! Column version of water_fraction().
+void EnthalpyConverter::water_fraction_n(const double *E, const double *P,
+                                         unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = water_fraction(E[k], P[k]);
+  }
+}
+
+//! Column version of enthalpy_permissive().
+void EnthalpyConverter::enthalpy_permissive_n(const double *T, const double *omega,
+                                              const double *P,
+                                              unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = enthalpy_permissive(T[k], omega[k], P[k]);
+  }
+}
+
+///@}
+
 ColdEnthalpyConverter::ColdEnthalpyConverter(const Config &config)
   : EnthalpyConverter(config) {
   // turn on the "cold" enthalpy converter mode
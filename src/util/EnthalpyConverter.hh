@@ -1,4 +1,4 @@
-// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016 Andreas Aschwanden, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016, 2020 Andreas Aschwanden, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -75,6 +75,23 @@ public:
   double pressure(double depth) const;
   void pressure(const std::vector<double> &depth,
                 unsigned int ks, std::vector<double> &result) const;
+
+  // Column versions of the methods above: each one processes `n` values stored in
+  // arrays `E`, `P`, etc and puts results in `result` (an array of length `n`).
+  void is_temperate_relaxed_n(const double *E, const double *P,
+                              unsigned int n, bool *result) const;
+
+  void temperature_n(const double *E, const double *P,
+                     unsigned int n, double *result) const;
+  void melting_temperature_n(const double *P, unsigned int n, double *result) const;
+  void pressure_adjusted_temperature_n(const double *E, const double *P,
+                                       unsigned int n, double *result) const;
+
+  void water_fraction_n(const double *E, const double *P,
+                        unsigned int n, double *result) const;
+
+  void enthalpy_permissive_n(const double *T, const double *omega, const double *P,
+                             unsigned int n, double *result) const;
 protected:
   void validate_E_P(double E, double P) const;
   void validate_T_omega_P(double T, double omega, double P) const;
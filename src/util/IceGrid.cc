@@ -34,6 +34,7 @@
 #include "pism/util/Vars.hh"
 #include "pism/util/Logger.hh"
 #include "pism/util/projection.hh"
+#include "pism/util/iceModelVec.hh"
 #include "pism/pism_config.hh"
 
 #if (Pism_USE_PIO==1)
@@ -339,6 +340,10 @@ IceGrid::Ptr IceGrid::FromFile(Context::ConstPtr ctx,
 
     p.ownership_ranges_from_options(ctx->size());
 
+    if (ctx->config()->get_flag("grid.load_balancing")) {
+      p.balance_ownership_ranges(ctx, file);
+    }
+
     return IceGrid::Ptr(new IceGrid(ctx, p));
   } catch (RuntimeError &e) {
     e.add_context("initializing computational grid from variable \"%s\" in \"%s\"",
@@ -1195,6 +1200,212 @@ void GridParameters::ownership_ranges_from_options(unsigned int size) {
   procs_y = procs.y;
 }
 
+/*!
+ * Split `cost.size()` slices (columns or rows of the grid) into `N` contiguous parts, each
+ * containing at least `min_size` slices, so that the sum of costs in each part does not
+ * exceed `bound`.
+ *
+ * Uses a greedy algorithm (each part takes as many slices as possible), which finds a
+ * partition if one exists.
+ *
+ * Returns false if there is no such partition.
+ */
+static bool partition(const std::vector<double> &cost,
+                      unsigned int N, unsigned int min_size, double bound,
+                      std::vector<unsigned int> &result) {
+  const unsigned int M = cost.size();
+
+  result.resize(N);
+
+  unsigned int start = 0;
+  for (unsigned int p = 0; p < N; ++p) {
+    // leave enough slices for the remaining parts
+    const unsigned int end_max = p + 1 < N ? M - (N - p - 1) * min_size : M;
+    const unsigned int end_min = p + 1 < N ? start + min_size : M;
+
+    double sum = 0.0;
+
+    unsigned int end = start;
+    for (; end < end_max; ++end) {
+      if (sum + cost[end] > bound and end >= end_min) {
+        break;
+      }
+      sum += cost[end];
+    }
+
+    if (sum > bound) {
+      return false;
+    }
+
+    result[p] = end - start;
+    start = end;
+  }
+
+  return true;
+}
+
+/*!
+ * Choose ownership ranges in one direction minimizing the largest sum of costs per part.
+ *
+ * Here `cost[k]` is the sum of weights in the slice `k` (a column if computing `procs_x`,
+ * a row if computing `procs_y`).
+ */
+static std::vector<unsigned int> balance(const std::vector<double> &cost,
+                                         unsigned int N, unsigned int min_size) {
+  double upper = std::accumulate(cost.begin(), cost.end(), 0.0);
+
+  std::vector<unsigned int> result;
+  // bisection: partitioning with the bound `upper` always succeeds
+  double lower = 0.0;
+  for (int k = 0; k < 64 and upper - lower > 1e-6 * upper; ++k) {
+    double middle = 0.5 * (lower + upper);
+    if (partition(cost, N, min_size, middle, result)) {
+      upper = middle;
+    } else {
+      lower = middle;
+    }
+  }
+
+  partition(cost, N, min_size, upper, result);
+
+  return result;
+}
+
+//! Index of the part containing `k` (`ranges` are sizes of contiguous parts).
+static unsigned int part_index(const std::vector<unsigned int> &ranges, unsigned int k) {
+  unsigned int start = 0;
+  for (unsigned int p = 0; p < ranges.size(); ++p) {
+    start += ranges[p];
+    if (k < start) {
+      return p;
+    }
+  }
+  return ranges.size() - 1;
+}
+
+/*!
+ * Compute the largest sum of `weights` over blocks of the decomposition `procs_x`,
+ * `procs_y`, divided by the mean over all blocks.
+ *
+ * Here `weights` is stored on `grid` (which may use a different decomposition). This is
+ * a collective operation that communicates one number per block.
+ */
+static double imbalance(const IceGrid &grid, const IceModelVec2S &weights,
+                        const std::vector<unsigned int> &procs_x,
+                        const std::vector<unsigned int> &procs_y) {
+  const unsigned int Nx = procs_x.size(), Ny = procs_y.size();
+
+  std::vector<unsigned int> p(grid.xm()), q(grid.ym());
+  for (int i = 0; i < grid.xm(); ++i) {
+    p[i] = part_index(procs_x, grid.xs() + i);
+  }
+  for (int j = 0; j < grid.ym(); ++j) {
+    q[j] = part_index(procs_y, grid.ys() + j);
+  }
+
+  std::vector<double> local(Nx * Ny, 0.0), sums(Nx * Ny, 0.0);
+
+  IceModelVec::AccessList list{&weights};
+  for (Points pt(grid); pt; pt.next()) {
+    const int i = pt.i(), j = pt.j();
+
+    local[q[j - grid.ys()] * Nx + p[i - grid.xs()]] += weights(i, j);
+  }
+
+  GlobalSum(grid.com, local.data(), sums.data(), Nx * Ny);
+
+  double
+    max  = *std::max_element(sums.begin(), sums.end()),
+    mean = std::accumulate(sums.begin(), sums.end(), 0.0) / sums.size();
+
+  return mean > 0.0 ? max / mean : 1.0;
+}
+
+/*!
+ * Choose ownership ranges balancing the work per processor.
+ *
+ * The work is estimated using ice thickness in `file`: each icy column contributes `Mz`
+ * (the number of vertical levels used by the energy, age and SIA code) and each ice-free
+ * column contributes 1 (2D computations). PETSc's DMDA requires a tensor-product
+ * decomposition, so this keeps the number of processors in each direction and chooses
+ * `procs_x` balancing sums of work over columns of the grid and `procs_y` balancing
+ * sums over rows. This needs only `Mx + My` numbers on each processor. New ranges are
+ * used only if they reduce the estimated imbalance (the largest amount of work per
+ * processor divided by the mean).
+ *
+ * Call this after ownership_ranges_from_options(). This is a collective operation: it
+ * reads ice thickness using a temporary grid with current ownership ranges.
+ */
+void GridParameters::balance_ownership_ranges(Context::ConstPtr ctx, const File &file) {
+  const Logger &log = *ctx->log();
+
+  const unsigned int
+    min_size = std::max(2, (int)ctx->config()->get_number("grid.max_stencil_width")),
+    Nx       = procs_x.size(),
+    Ny       = procs_y.size();
+
+  if (Nx * min_size > Mx or Ny * min_size > My) {
+    log.message(2, "* Load balancing: grid is too small, using default ownership ranges.\n");
+    return;
+  }
+
+  IceGrid::Ptr grid(new IceGrid(ctx, *this));
+
+  IceModelVec2S weights(grid, "thk", WITHOUT_GHOSTS);
+  weights.set_attrs("internal", "land ice thickness",
+                    "m", "m", "land_ice_thickness", 0);
+  weights.regrid(file, OPTIONAL, 0.0);
+
+  // sums of weights over columns (X) and rows (Y) of the grid
+  std::vector<double> column_sums(Mx, 0.0), row_sums(My, 0.0);
+  {
+    const double icy_weight = z.size();
+
+    std::vector<double> local_x(Mx, 0.0), local_y(My, 0.0);
+
+    IceModelVec::AccessList list{&weights};
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      weights(i, j) = weights(i, j) > 0.0 ? icy_weight : 1.0;
+
+      local_x[i] += weights(i, j);
+      local_y[j] += weights(i, j);
+    }
+
+    GlobalSum(ctx->com(), local_x.data(), column_sums.data(), Mx);
+    GlobalSum(ctx->com(), local_y.data(), row_sums.data(), My);
+  }
+
+  std::vector<unsigned int>
+    px = balance(column_sums, Nx, min_size),
+    py = balance(row_sums, Ny, min_size);
+
+  const double
+    uniform_imbalance  = imbalance(*grid, weights, procs_x, procs_y),
+    balanced_imbalance = imbalance(*grid, weights, px, py);
+
+  if (balanced_imbalance < uniform_imbalance) {
+    procs_x = px;
+    procs_y = py;
+  }
+
+  log.message(2,
+              "* Load balancing: estimated work imbalance (max/mean per processor)"
+              " %.2f (uniform), %.2f (balanced)\n",
+              uniform_imbalance, std::min(uniform_imbalance, balanced_imbalance));
+  auto to_string = [](const std::vector<unsigned int> &ranges) {
+    std::vector<std::string> result;
+    for (auto r : ranges) {
+      result.push_back(pism::printf("%d", (int)r));
+    }
+    return join(result, ",");
+  };
+
+  log.message(3, "  procs_x: %s\n  procs_y: %s\n",
+              to_string(procs_x).c_str(), to_string(procs_y).c_str());
+}
+
 //! Initialize from a configuration database. Does not try to compute ownership ranges.
 void GridParameters::init_from_config(Config::ConstPtr config) {
   Lx = config->get_number("grid.Lx");
@@ -1398,6 +1609,10 @@ IceGrid::Ptr IceGrid::FromOptions(Context::ConstPtr ctx) {
     input_grid.vertical_grid_from_options(config);
     input_grid.ownership_ranges_from_options(ctx->size());
 
+    if (config->get_flag("grid.load_balancing")) {
+      input_grid.balance_ownership_ranges(ctx, file);
+    }
+
     IceGrid::Ptr result(new IceGrid(ctx, input_grid));
 
     units::System::Ptr sys = ctx->unit_system();
@@ -1483,4 +1698,47 @@ int IceGrid::pio_io_decomposition(int dof, int output_datatype) const {
   return result;
 }
 
+Tiles::Tiles(const IceGrid &grid, unsigned int stencil_width) {
+  double tile_size = grid.ctx()->config()->get_number("grid.tile_size");
+
+  if (tile_size < 0.0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "grid.tile_size = %f is invalid (has to be non-negative)",
+                                  tile_size);
+  }
+
+  init(grid, (unsigned int)tile_size, (unsigned int)tile_size, stencil_width);
+}
+
+Tiles::Tiles(const IceGrid &grid, unsigned int tile_size_x, unsigned int tile_size_y,
+             unsigned int stencil_width) {
+  init(grid, tile_size_x, tile_size_y, stencil_width);
+}
+
+void Tiles::init(const IceGrid &grid, unsigned int tile_size_x, unsigned int tile_size_y,
+                 unsigned int stencil_width) {
+  m_i_first = grid.xs() - stencil_width;
+  m_i_last  = grid.xs() + grid.xm() + stencil_width - 1;
+  m_j_first = grid.ys() - stencil_width;
+  m_j_last  = grid.ys() + grid.ym() + stencil_width - 1;
+
+  const int
+    width  = m_i_last - m_i_first + 1,
+    height = m_j_last - m_j_first + 1;
+
+  if (tile_size_x == 0 or tile_size_y == 0) {
+    // each tile is a row of the local sub-domain
+    m_tile_size_x = width;
+    m_tile_size_y = 1;
+  } else {
+    m_tile_size_x = std::min((int)tile_size_x, width);
+    m_tile_size_y = std::min((int)tile_size_y, height);
+  }
+
+  m_n_tiles_x = (width + m_tile_size_x - 1) / m_tile_size_x;
+  m_n_tiles_y = (height + m_tile_size_y - 1) / m_tile_size_y;
+
+  m_k = 0;
+}
+
 } // end of namespace pism
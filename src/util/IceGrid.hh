@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 #define __grid_hh
 
 #include <cassert>
+#include <algorithm>            // std::min
 #include <vector>
 #include <string>
 #include <memory>
@@ -115,6 +116,8 @@ public:
   void vertical_grid_from_options(Config::ConstPtr config);
   //! Re-compute ownership ranges. Uses current values of Mx and My.
   void ownership_ranges_from_options(unsigned int size);
+  //! Adjust ownership ranges to balance the work estimated using ice thickness in `file`.
+  void balance_ownership_ranges(Context::ConstPtr ctx, const File &file);
 
   //! Validate data members.
   void validate() const;
@@ -376,7 +379,19 @@ public:
   operator bool() const {
     return not m_done;
   }
-private:
+protected:
+  //! Traverse the rectangle `[i_first, i_last] x [j_first, j_last]`.
+  PointsWithGhosts(int i_first, int i_last, int j_first, int j_last) {
+    m_i_first = i_first;
+    m_i_last  = i_last;
+    m_j_first = j_first;
+    m_j_last  = j_last;
+
+    m_i = m_i_first;
+    m_j = m_j_first;
+    m_done = (m_i_first > m_i_last or m_j_first > m_j_last);
+  }
+
   int m_i, m_j;
   int m_i_first, m_i_last, m_j_first, m_j_last;
   bool m_done;
@@ -393,6 +408,190 @@ public:
   Points(const IceGrid &g) : PointsWithGhosts(g, 0) {}
 };
 
+/** Iterator class for traversing the interior of the sub-domain owned by this processor,
+ * i.e. points that are at least `width` grid cells away from its edges.
+ *
+ * Stencil computations (using stencils of width up to `width`) at these points do not use
+ * ghosts, so they can overlap with a ghost update (see GhostUpdate). Use PointsBoundary to
+ * traverse the remaining points:
+ *
+ * `GhostUpdate ghosts({&input});`
+ * `for (PointsInterior p(grid); p; p.next()) { ... }`
+ * `ghosts.finish();`
+ * `for (PointsBoundary p(grid); p; p.next()) { ... }`
+ */
+class PointsInterior : public PointsWithGhosts {
+public:
+  PointsInterior(const IceGrid &g, unsigned int width = 1)
+    : PointsWithGhosts(g.xs() + (int)width, g.xs() + g.xm() - (int)width - 1,
+                       g.ys() + (int)width, g.ys() + g.ym() - (int)width - 1) {}
+};
+
+/** Iterator class for traversing the strip of width `width` along edges of the sub-domain
+ * owned by this processor.
+ *
+ * Together with PointsInterior (using the same `width`) it visits each owned point
+ * exactly once.
+ */
+class PointsBoundary {
+public:
+  PointsBoundary(const IceGrid &g, unsigned int width = 1) {
+    const int
+      w       = width,
+      i_first = g.xs(),
+      i_last  = g.xs() + g.xm() - 1,
+      j_first = g.ys(),
+      j_last  = g.ys() + g.ym() - 1;
+
+    // last row of the bottom strip and first row of the top strip
+    const int
+      j_bottom = std::min(j_first + w - 1, j_last),
+      j_top    = std::max(j_last - w + 1, j_bottom + 1);
+    // last column of the left strip and first column of the right strip
+    const int
+      i_left  = std::min(i_first + w - 1, i_last),
+      i_right = std::max(i_last - w + 1, i_left + 1);
+
+    set_rectangle(0, i_first, i_last,  j_first,      j_bottom);
+    set_rectangle(1, i_first, i_last,  j_top,        j_last);
+    set_rectangle(2, i_first, i_left,  j_bottom + 1, j_top - 1);
+    set_rectangle(3, i_right, i_last,  j_bottom + 1, j_top - 1);
+
+    m_k = 0;
+    m_done = false;
+    start_rectangle();
+  }
+
+  int i() const {
+    return m_i;
+  }
+  int j() const {
+    return m_j;
+  }
+
+  void next() {
+    assert(not m_done);
+    m_i += 1;
+    if (m_i > m_rect[m_k][1]) {
+      m_i = m_rect[m_k][0];   // wrap around
+      m_j += 1;
+    }
+    if (m_j > m_rect[m_k][3]) {
+      m_k += 1;
+      start_rectangle();
+    }
+  }
+
+  operator bool() const {
+    return not m_done;
+  }
+private:
+  void set_rectangle(int k, int i_first, int i_last, int j_first, int j_last) {
+    m_rect[k][0] = i_first;
+    m_rect[k][1] = i_last;
+    m_rect[k][2] = j_first;
+    m_rect[k][3] = j_last;
+  }
+
+  //! Start traversing the first non-empty rectangle starting with `m_k`.
+  void start_rectangle() {
+    while (m_k < 4 and (m_rect[m_k][0] > m_rect[m_k][1] or m_rect[m_k][2] > m_rect[m_k][3])) {
+      m_k += 1;
+    }
+
+    if (m_k < 4) {
+      m_i = m_rect[m_k][0];
+      m_j = m_rect[m_k][2];
+    } else {
+      m_done = true;
+    }
+  }
+
+  // rectangles [i_first, i_last] x [j_first, j_last]: bottom, top, left, right strips
+  int m_rect[4][4];
+  int m_k;
+  int m_i, m_j;
+  bool m_done;
+};
+
+/** Partition of the part of the grid owned by this processor (optionally including ghost
+ * points) into rectangular tiles.
+ *
+ * Kernels that read many fields at each point (e.g. staggered-grid stencils) can traverse the
+ * grid tile by tile to improve cache reuse on large sub-domains:
+ *
+ * `for (Tiles t(grid, stencil_width); t; t.next()) {`
+ * `  for (PointsInTile p(t); p; p.next()) { ... }`
+ * `}`
+ *
+ * The default tile size is set using the configuration parameter `grid.tile_size`. Setting it
+ * to zero makes each tile a row of the local sub-domain, which is equivalent to using
+ * PointsWithGhosts.
+ */
+class Tiles {
+public:
+  //! Use square tiles of the size `grid.tile_size`.
+  Tiles(const IceGrid &grid, unsigned int stencil_width = 0);
+  Tiles(const IceGrid &grid, unsigned int tile_size_x, unsigned int tile_size_y,
+        unsigned int stencil_width);
+
+  //! Total number of tiles.
+  unsigned int size() const {
+    return m_n_tiles_x * m_n_tiles_y;
+  }
+
+  //! Index of the current tile.
+  unsigned int index() const {
+    return m_k;
+  }
+
+  int i_first(unsigned int k) const {
+    return m_i_first + (int)(k % m_n_tiles_x) * m_tile_size_x;
+  }
+  int i_last(unsigned int k) const {
+    return std::min(i_first(k) + m_tile_size_x - 1, m_i_last);
+  }
+  int j_first(unsigned int k) const {
+    return m_j_first + (int)(k / m_n_tiles_x) * m_tile_size_y;
+  }
+  int j_last(unsigned int k) const {
+    return std::min(j_first(k) + m_tile_size_y - 1, m_j_last);
+  }
+
+  void next() {
+    assert(m_k < size());
+    m_k += 1;
+  }
+
+  operator bool() const {
+    return m_k < size();
+  }
+private:
+  void init(const IceGrid &grid, unsigned int tile_size_x, unsigned int tile_size_y,
+            unsigned int stencil_width);
+
+  int m_i_first, m_i_last, m_j_first, m_j_last;
+  int m_tile_size_x, m_tile_size_y;
+  unsigned int m_n_tiles_x, m_n_tiles_y;
+  unsigned int m_k;
+};
+
+/** Iterator class for traversing one tile of a Tiles partition.
+ *
+ * Usage:
+ *
+ * `for (PointsInTile p(tiles); p; p.next()) { ... }` (uses the current tile)
+ */
+class PointsInTile : public PointsWithGhosts {
+public:
+  PointsInTile(const Tiles &t)
+    : PointsWithGhosts(t.i_first(t.index()), t.i_last(t.index()),
+                       t.j_first(t.index()), t.j_last(t.index())) {}
+
+  PointsInTile(const Tiles &t, unsigned int k)
+    : PointsWithGhosts(t.i_first(k), t.i_last(k), t.j_first(k), t.j_last(k)) {}
+};
+
 } // end of namespace pism
 
 #endif  /* __grid_hh */
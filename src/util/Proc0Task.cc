@@ -0,0 +1,90 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "pism/util/Proc0Task.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+Proc0Task::Proc0Task(MPI_Comm com)
+  : m_com(com), m_pending(false) {
+  // empty
+}
+
+Proc0Task::~Proc0Task() {
+  // Wait for the job to complete: it may use objects owned by the caller. Errors are
+  // ignored because we cannot report them here.
+  if (m_result.valid()) {
+    m_result.wait();
+  }
+}
+
+/*!
+ * Start `job` in a helper thread on rank 0.
+ *
+ * Finishes the previous job (if any) first.
+ */
+void Proc0Task::start(std::function<void()> job) {
+  finish();
+
+  int rank = 0;
+  MPI_Comm_rank(m_com, &rank);
+
+  ParallelSection rank0(m_com);
+  try {
+    if (rank == 0) {
+      m_result = std::async(std::launch::async, job);
+    }
+  } catch (...) {
+    rank0.failed();
+  }
+  rank0.check();
+
+  m_pending = true;
+}
+
+/*!
+ * Wait for the current job to complete.
+ *
+ * Errors (exceptions thrown by the job) are reported on all ranks.
+ */
+void Proc0Task::finish() {
+  if (not m_pending) {
+    return;
+  }
+
+  m_pending = false;
+
+  ParallelSection rank0(m_com);
+  try {
+    if (m_result.valid()) {
+      // re-throws the exception thrown by the job, if any
+      m_result.get();
+    }
+  } catch (...) {
+    rank0.failed();
+  }
+  rank0.check();
+}
+
+bool Proc0Task::pending() const {
+  return m_pending;
+}
+
+} // end of namespace pism
@@ -0,0 +1,75 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_PROC0TASK_H
+#define PISM_PROC0TASK_H
+
+#include <functional>
+#include <future>
+#include <mpi.h>
+
+namespace pism {
+
+/*!
+ * Serial work performed on rank 0 in a helper thread.
+ *
+ * Several components gather inputs on rank 0, run a serial model there and scatter
+ * results. When this work is done synchronously all other ranks wait for rank 0. This
+ * class makes it possible to start the serial work and collect its results later (for
+ * example during the next update of a component), so that rank 0 does it while other
+ * ranks continue the run.
+ *
+ * Usage:
+ *
+ * 1. gather inputs on rank 0 (collective),
+ * 2. call `start()` (collective; the job runs on rank 0 only),
+ * 3. do something else,
+ * 4. call `finish()` (collective) before using results of the job,
+ * 5. scatter results (collective).
+ *
+ * The job runs concurrently with the rest of PISM on rank 0, so
+ *
+ * - it must not call PETSc (PETSc is not thread-safe: logging, flop counters and the
+ *   debugging call stack are global) or MPI (MPI is initialized for use by one thread).
+ *   This includes PISM's wrappers such as petsc::VecArray. Copy inputs to plain arrays
+ *   before calling `start()` and copy results from plain arrays after `finish()` returns.
+ * - it must only touch data that is not used by PISM until `finish()` returns: inputs
+ *   copied on rank 0 and objects owned by a serial model.
+ */
+class Proc0Task {
+public:
+  Proc0Task(MPI_Comm com);
+  ~Proc0Task();
+
+  void start(std::function<void()> job);
+
+  void finish();
+
+  //! True if `start()` was called and `finish()` was not called since.
+  bool pending() const;
+private:
+  MPI_Comm m_com;
+  bool m_pending;
+  // only valid on rank 0
+  std::future<void> m_result;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_PROC0TASK_H */
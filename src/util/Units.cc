@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -180,6 +180,10 @@ void Converter::convert_doubles(double *data, size_t length) const {
   cv_convert_doubles(m_converter, data, length, data);
 }
 
+void Converter::convert_doubles(const double *input, size_t length, double *output) const {
+  cv_convert_doubles(m_converter, input, length, output);
+}
+
 } // end of namespace units
 
 } // end of namespace pism
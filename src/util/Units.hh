@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -101,6 +101,13 @@ public:
    * @param length length of the array
    */
   void convert_doubles(double *data, size_t length) const;
+  /** Convert an array of doubles, putting results in `output`
+   *
+   * @param[in] input array to process
+   * @param length length of arrays
+   * @param[out] output results
+   */
+  void convert_doubles(const double *input, size_t length, double *output) const;
   double operator()(double input) const;
 private:
   cv_converter *m_converter;
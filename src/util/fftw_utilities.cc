@@ -1,4 +1,4 @@
-/* Copyright (C) 2018, 2019 PISM Authors
+/* Copyright (C) 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -18,10 +18,12 @@
  */
 
 #include <cstring>              // memcpy
+#include <algorithm>            // std::copy
 
 #include "fftw_utilities.hh"
 
 #include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/error_handling.hh"
 
 namespace pism {
 
@@ -92,12 +94,26 @@ void set_real_part(Vec input,
                    int Nx, int Ny,
                    int i0, int j0,
                    fftw_complex *output) {
-  petsc::VecArray2D in(input, Mx, My);
+  petsc::VecArray in(input);
+  set_real_part(in.get(), normalization, Mx, My, Nx, Ny, i0, j0, output);
+}
+
+/*!
+ * Same as above, but `input` is an array of size `Mx*My` (`i` varies fastest).
+ *
+ * Does not use PETSc, so it can be called from a thread other than the main one.
+ */
+void set_real_part(const double *input,
+                   double normalization,
+                   int Mx, int My,
+                   int Nx, int Ny,
+                   int i0, int j0,
+                   fftw_complex *output) {
   FFTWArray out(output, Nx, Ny, i0, j0);
 
   for (int j = 0; j < My; ++j) {
     for (int i = 0; i < Mx; ++i) {
-      out(i, j) = in(i, j) * normalization;
+      out(i, j) = input[j * Mx + i] * normalization;
     }
   }
 }
@@ -113,13 +129,53 @@ void get_real_part(fftw_complex *input,
                    int Nx, int Ny,
                    int i0, int j0,
                    Vec output) {
-  petsc::VecArray2D out(output, Mx, My);
+  petsc::VecArray out(output);
+  get_real_part(input, normalization, Mx, My, Nx, Ny, i0, j0, out.get());
+}
+
+/*!
+ * Same as above, but `output` is an array of size `Mx*My` (`i` varies fastest).
+ *
+ * Does not use PETSc, so it can be called from a thread other than the main one.
+ */
+void get_real_part(fftw_complex *input,
+                   double normalization,
+                   int Mx, int My,
+                   int Nx, int Ny,
+                   int i0, int j0,
+                   double *output) {
   FFTWArray in(input, Nx, Ny, i0, j0);
   for (int j = 0; j < My; ++j) {
     for (int i = 0; i < Mx; ++i) {
-      out(i, j) = in(i, j).real() * normalization;
+      output[j * Mx + i] = in(i, j).real() * normalization;
     }
   }
 }
 
+void copy_from_vec(Vec input, std::vector<double> &output) {
+  PetscInt size = 0;
+  PetscErrorCode ierr = VecGetLocalSize(input, &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  output.resize(size);
+
+  petsc::VecArray in(input);
+  std::copy(in.get(), in.get() + size, output.begin());
+}
+
+void copy_to_vec(const std::vector<double> &input, Vec output) {
+  PetscInt size = 0;
+  PetscErrorCode ierr = VecGetLocalSize(output, &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  if ((size_t)size != input.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "array size mismatch: %d != %d",
+                                  (int)size, (int)input.size());
+  }
+
+  petsc::VecArray out(output);
+  std::copy(input.begin(), input.end(), out.get());
+}
+
 } // end of namespace pism
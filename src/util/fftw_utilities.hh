@@ -1,4 +1,4 @@
-/* Copyright (C) 2018 PISM Authors
+/* Copyright (C) 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -74,6 +74,13 @@ void set_real_part(Vec input,
                    int i0, int j0,
                    fftw_complex *output);
 
+void set_real_part(const double *input,
+                   double normalization,
+                   int Mx, int My,
+                   int Nx, int Ny,
+                   int i0, int j0,
+                   fftw_complex *output);
+
 //! \brief Get the real part of input and put it in output.
 /*!
  * See set_real_part for details.
@@ -85,4 +92,17 @@ void get_real_part(fftw_complex *input,
                    int i0, int j0,
                    Vec output);
 
+void get_real_part(fftw_complex *input,
+                   double normalization,
+                   int Mx, int My,
+                   int Nx, int Ny,
+                   int i0, int j0,
+                   double *output);
+
+//! Copy values of a sequential `input` to `output`.
+void copy_from_vec(Vec input, std::vector<double> &output);
+
+//! Copy `input` to a sequential `output`.
+void copy_to_vec(const std::vector<double> &input, Vec output);
+
 } // end of namespace pism
@@ -0,0 +1,270 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Tests the ghost update of several fields packed into one vector, non-blocking ghost\n"
+  "updates and iterators used to overlap them with computations.\n\n";
+
+#include <algorithm>            // std::max
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+
+using namespace pism;
+
+//! Value stored at the grid point `(i, j)` in the component `k`.
+/*!
+ * Uses periodic boundary conditions, so that this is also the expected value at a ghost
+ * point.
+ */
+static double value(const IceGrid &grid, int i, int j, int k) {
+  const int
+    Mx = grid.Mx(),
+    My = grid.My();
+
+  i = (i + Mx) % Mx;
+  j = (j + My) % My;
+
+  return i + Mx * (j + My * k);
+}
+
+//! Number of degrees of freedom of `field`.
+static unsigned int dof(const IceModelVec &field) {
+  // 2D fields have one level, 3D fields have one degree of freedom per grid point
+  return std::max((size_t)field.ndof(), field.levels().size());
+}
+
+//! Set owned values of `field` and fill ghosts with junk.
+static void set_owned(IceModelVec &field) {
+  const IceGrid &grid = *field.grid();
+  const unsigned int N = dof(field);
+
+  field.set(-1.0);
+
+  petsc::DMDAVecArrayDOF tmp(field.dm(), field.vec());
+  double ***F = static_cast<double***>(tmp.get());
+
+  for (Points p(grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    for (unsigned int k = 0; k < N; ++k) {
+      F[j][i][k] = value(grid, i, j, k);
+    }
+  }
+}
+
+//! Count points (including ghosts) where `a` and `b` differ or `a` has an unexpected value.
+static int compare(IceModelVec &a, IceModelVec &b) {
+  const IceGrid &grid = *a.grid();
+  const unsigned int N = dof(a);
+
+  petsc::DMDAVecArrayDOF tmp_a(a.dm(), a.vec()), tmp_b(b.dm(), b.vec());
+  double
+    ***A = static_cast<double***>(tmp_a.get()),
+    ***B = static_cast<double***>(tmp_b.get());
+
+  int errors = 0;
+  for (PointsWithGhosts p(grid, a.stencil_width()); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    for (unsigned int k = 0; k < N; ++k) {
+      if (A[j][i][k] != B[j][i][k] or A[j][i][k] != value(grid, i, j, k)) {
+        errors += 1;
+        break;
+      }
+    }
+  }
+
+  return errors;
+}
+
+//! Compare update_ghosts() of several fields to updating ghosts of each field separately.
+static int test_packed_update(IceGrid::ConstPtr grid) {
+  IceModelVec2S a(grid, "a", WITH_GHOSTS, 2), a_ref(grid, "a", WITH_GHOSTS, 2);
+  IceModelVec2V b(grid, "b", WITH_GHOSTS, 1), b_ref(grid, "b", WITH_GHOSTS, 1);
+  IceModelVec3 c(grid, "c", WITH_GHOSTS, 1), c_ref(grid, "c", WITH_GHOSTS, 1);
+  IceModelVec2Stag d(grid, "d", WITH_GHOSTS, 1), d_ref(grid, "d", WITH_GHOSTS, 1);
+  // a field without ghosts (should be ignored)
+  IceModelVec2S e(grid, "e", WITHOUT_GHOSTS);
+
+  std::vector<IceModelVec*>
+    fields    = {&a, &b, &c, &d, &e},
+    reference = {&a_ref, &b_ref, &c_ref, &d_ref};
+
+  for (auto *f : fields) {
+    set_owned(*f);
+  }
+  for (auto *f : reference) {
+    set_owned(*f);
+    f->update_ghosts();
+  }
+
+  update_ghosts(fields);
+
+  int errors = 0;
+  for (unsigned int k = 0; k < reference.size(); ++k) {
+    errors += compare(*fields[k], *reference[k]);
+  }
+
+  return errors;
+}
+
+//! Compare GhostUpdate::finish() to update_ghosts() of each field.
+static int test_non_blocking_update(IceGrid::ConstPtr grid) {
+  IceModelVec2S a(grid, "a", WITH_GHOSTS, 2), a_ref(grid, "a", WITH_GHOSTS, 2);
+  IceModelVec2V b(grid, "b", WITH_GHOSTS, 1), b_ref(grid, "b", WITH_GHOSTS, 1);
+  IceModelVec3 c(grid, "c", WITH_GHOSTS, 1), c_ref(grid, "c", WITH_GHOSTS, 1);
+
+  std::vector<IceModelVec*>
+    fields    = {&a, &b, &c},
+    reference = {&a_ref, &b_ref, &c_ref};
+
+  for (auto *f : fields) {
+    set_owned(*f);
+  }
+  for (auto *f : reference) {
+    set_owned(*f);
+    f->update_ghosts();
+  }
+
+  int errors = 0;
+
+  // one field (updated in place)
+  {
+    GhostUpdate update({&a});
+    update.finish();
+    errors += compare(a, a_ref);
+  }
+
+  // several fields
+  {
+    GhostUpdate update({&b, &c});
+    update.finish();
+    errors += compare(b, b_ref);
+    errors += compare(c, c_ref);
+  }
+
+  return errors;
+}
+
+//! Check that PointsInterior and PointsBoundary together visit each owned point once.
+static int test_interior_and_boundary(const IceGrid &grid, unsigned int width) {
+  const int
+    xs = grid.xs(),
+    ys = grid.ys(),
+    xm = grid.xm(),
+    ym = grid.ym();
+
+  std::vector<int> count(xm * ym, 0);
+  int errors = 0;
+
+  auto visit = [&](int i, int j) {
+    if (i < xs or i >= xs + xm or j < ys or j >= ys + ym) {
+      // not an owned point
+      errors += 1;
+    } else {
+      count[(j - ys) * xm + (i - xs)] += 1;
+    }
+  };
+
+  for (PointsInterior p(grid, width); p; p.next()) {
+    visit(p.i(), p.j());
+  }
+
+  for (PointsBoundary p(grid, width); p; p.next()) {
+    visit(p.i(), p.j());
+  }
+
+  for (auto c : count) {
+    if (c != 1) {
+      errors += 1;
+    }
+  }
+
+  return errors;
+}
+
+int main(int argc, char *argv[]) {
+
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Context::Ptr ctx = context_from_options(com, "ghost_update_test");
+    Logger::Ptr log = ctx->log();
+    Config::Ptr config = ctx->config();
+
+    std::string usage =
+      "  ghost_update_test [-Mx N -My N -Mz N]\n"
+      "where\n"
+      "  -Mx, -My, -Mz  grid size (use small grids to test narrow sub-domains)\n";
+
+    bool done = show_usage_check_req_opts(*log, "GHOST_UPDATE_TEST %s", {}, usage);
+    if (done) {
+      return 0;
+    }
+
+    GridParameters P(config);
+    P.horizontal_size_from_options();
+    P.horizontal_extent_from_options();
+    P.vertical_grid_from_options(config);
+    P.ownership_ranges_from_options(ctx->size());
+
+    IceGrid::Ptr grid(new IceGrid(ctx, P));
+
+    int failures = 0;
+
+    int errors = GlobalSum(com, test_packed_update(grid));
+    log->message(1, "packed ghost update: %s (%d points differ)\n",
+                 errors == 0 ? "OK" : "FAILED", errors);
+    failures += errors;
+
+    errors = GlobalSum(com, test_non_blocking_update(grid));
+    log->message(1, "non-blocking ghost update: %s (%d points differ)\n",
+                 errors == 0 ? "OK" : "FAILED", errors);
+    failures += errors;
+
+    // widths 2 and 3 make the interior empty in narrow sub-domains
+    for (unsigned int width : {0, 1, 2, 3}) {
+      errors = GlobalSum(com, test_interior_and_boundary(*grid, width));
+      log->message(1, "interior and boundary points (width %u): %s (%d errors)\n",
+                   width, errors == 0 ? "OK" : "FAILED", errors);
+      failures += errors;
+    }
+
+    if (failures > 0) {
+      return 1;
+    }
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,4 +1,4 @@
-// Copyright (C) 2008--2019 Ed Bueler, Constantine Khroulev, and David Maxwell
+// Copyright (C) 2008--2020 Ed Bueler, Constantine Khroulev, and David Maxwell
 //
 // This file is part of PISM.
 //
@@ -17,6 +17,7 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <cassert>
+#include <algorithm>             // std::copy, std::max
 
 #include "pism_utilities.hh"
 #include "iceModelVec.hh"
@@ -642,6 +643,193 @@ void  IceModelVec::update_ghosts() {
   PISM_CHK(ierr, "DMLocalToLocalEnd");
 }
 
+//! Copy `count` values per grid point between `field` and degrees of freedom
+//! `[offset, offset + count)` of `buffer`.
+/*!
+ * If `pack` is true, copies owned grid points in the strip of width `width` along edges
+ * of the sub-domain (these are the only values sent to neighbors) from `field` to
+ * `buffer`. Otherwise copies ghost points (using the stencil width of `field`) from
+ * `buffer` to `field`.
+ */
+static void copy_dofs(IceModelVec &field, petsc::DM::Ptr buffer_dm, Vec buffer,
+                      unsigned int offset, unsigned int count, unsigned int width,
+                      bool pack) {
+  IceGrid::ConstPtr grid = field.grid();
+
+  petsc::DMDAVecArrayDOF tmp_b(buffer_dm, buffer), tmp_f(field.dm(), field.vec());
+
+  double
+    ***b = static_cast<double***>(tmp_b.get()),
+    ***f = static_cast<double***>(tmp_f.get());
+
+  if (pack) {
+    for (PointsBoundary p(*grid, width); p; p.next()) {
+      const int i = p.i(), j = p.j();
+      std::copy(f[j][i], f[j][i] + count, &b[j][i][offset]);
+    }
+  } else {
+    const int
+      xs = grid->xs(),
+      xe = grid->xs() + grid->xm() - 1,
+      ys = grid->ys(),
+      ye = grid->ys() + grid->ym() - 1;
+
+    for (PointsWithGhosts p(*grid, field.stencil_width()); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (i >= xs and i <= xe and j >= ys and j <= ye) {
+        // skip owned points: they may have been modified after the update started
+        continue;
+      }
+
+      std::copy(&b[j][i][offset], &b[j][i][offset] + count, f[j][i]);
+    }
+  }
+}
+
+struct GhostUpdate::Impl {
+  //! fields that have ghosts
+  std::vector<IceModelVec*> fields;
+  //! number of degrees of freedom of each field
+  std::vector<unsigned int> dofs;
+  //! largest stencil width
+  unsigned int stencil_width;
+  //! DM and vector used to pack several fields (not used if there is only one field)
+  petsc::DM::Ptr dm;
+  std::unique_ptr<petsc::TemporaryLocalVec> buffer;
+  //! true if an update is in progress
+  bool in_progress;
+
+  //! The vector and the DM used to update ghosts.
+  Vec vec() {
+    return buffer ? Vec(*buffer) : fields[0]->vec();
+  }
+  petsc::DM::Ptr da() {
+    return buffer ? dm : fields[0]->dm();
+  }
+};
+
+/*!
+ * Start updating ghosts of `fields`.
+ *
+ * Owned values of `fields` in the strip of the width equal to the largest stencil width
+ * along edges of the sub-domain have to be up to date; other owned values may be
+ * modified until finish() is called. Ghosts must not be used until finish() is called.
+ *
+ * If only one field has ghosts its ghosts are updated in place, i.e. owned values of this
+ * field are sent to neighbors directly. In this case *none* of its owned values may be
+ * modified until finish() is called.
+ *
+ * If there is more than one field with ghosts, values of all fields are packed into one
+ * vector (with the number of degrees of freedom equal to the sum of numbers of degrees of
+ * freedom of `fields` and the largest stencil width). This sends one message to each
+ * neighbor instead of one message per neighbor and per field.
+ *
+ * Fields without ghosts are ignored. All fields have to use the same grid.
+ */
+GhostUpdate::GhostUpdate(const std::vector<IceModelVec*> &fields)
+  : m_impl(new Impl) {
+  PetscErrorCode ierr;
+
+  m_impl->stencil_width = 0;
+  m_impl->in_progress   = false;
+
+  for (auto *f : fields) {
+    if (f->stencil_width() > 0) {
+      m_impl->fields.push_back(f);
+    }
+  }
+
+  if (m_impl->fields.empty()) {
+    return;
+  }
+
+  IceGrid::ConstPtr grid = m_impl->fields[0]->grid();
+
+  unsigned int total_dof = 0;
+  for (auto *f : m_impl->fields) {
+    if (f->grid().get() != grid.get()) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "fields %s and %s use different grids",
+                                    m_impl->fields[0]->get_name().c_str(),
+                                    f->get_name().c_str());
+    }
+
+    PetscInt dof = 0;
+    ierr = DMDAGetInfo(*f->dm(),
+                       NULL,           // dimensions
+                       NULL, NULL, NULL, // global size
+                       NULL, NULL, NULL, // number of processes
+                       &dof,
+                       NULL,           // stencil width
+                       NULL, NULL, NULL, // boundary types
+                       NULL);          // stencil type
+    PISM_CHK(ierr, "DMDAGetInfo");
+
+    m_impl->dofs.push_back(dof);
+    total_dof += dof;
+    m_impl->stencil_width = std::max(m_impl->stencil_width, f->stencil_width());
+  }
+
+  if (m_impl->fields.size() > 1) {
+    m_impl->dm = grid->get_dm(total_dof, m_impl->stencil_width);
+    m_impl->buffer.reset(new petsc::TemporaryLocalVec(m_impl->dm));
+
+    unsigned int offset = 0;
+    for (unsigned int k = 0; k < m_impl->fields.size(); ++k) {
+      copy_dofs(*m_impl->fields[k], m_impl->dm, *m_impl->buffer,
+                offset, m_impl->dofs[k], m_impl->stencil_width, true);
+      offset += m_impl->dofs[k];
+    }
+  }
+
+  Vec v = m_impl->vec();
+  ierr = DMLocalToLocalBegin(*m_impl->da(), v, INSERT_VALUES, v);
+  PISM_CHK(ierr, "DMLocalToLocalBegin");
+
+  m_impl->in_progress = true;
+}
+
+GhostUpdate::~GhostUpdate() {
+  // Complete communication if finish() was not called (e.g. because of an exception).
+  if (m_impl->in_progress) {
+    Vec v = m_impl->vec();
+    PetscErrorCode ierr = DMLocalToLocalEnd(*m_impl->da(), v, INSERT_VALUES, v);
+    CHKERRCONTINUE(ierr);
+  }
+  delete m_impl;
+}
+
+//! Finish updating ghosts.
+void GhostUpdate::finish() {
+  if (not m_impl->in_progress) {
+    return;
+  }
+
+  Vec v = m_impl->vec();
+  m_impl->in_progress = false;
+  PetscErrorCode ierr = DMLocalToLocalEnd(*m_impl->da(), v, INSERT_VALUES, v);
+  PISM_CHK(ierr, "DMLocalToLocalEnd");
+
+  if (m_impl->buffer) {
+    unsigned int offset = 0;
+    for (unsigned int k = 0; k < m_impl->fields.size(); ++k) {
+      copy_dofs(*m_impl->fields[k], m_impl->dm, *m_impl->buffer,
+                offset, m_impl->dofs[k], m_impl->stencil_width, false);
+      offset += m_impl->dofs[k];
+    }
+  }
+}
+
+//! Update ghosts of several fields using one round of messages.
+/*!
+ * See GhostUpdate.
+ */
+void update_ghosts(const std::vector<IceModelVec*> &fields) {
+  GhostUpdate update(fields);
+  update.finish();
+}
+
 void IceModelVec::global_to_local(petsc::DM::Ptr dm, Vec source, Vec destination) const {
   PetscErrorCode ierr;
 
@@ -863,6 +1051,10 @@ void IceModelVec::regrid(const std::string &filename, RegriddingFlag flag,
  * fill the whole IceModelVec with `default_value` if could not find
  * the variable.
  *
+ * Grid information and interpolation weights are cached in `file` if it is open for
+ * reading only, so regridding many fields using the same `file` is cheaper than calling
+ * regrid(filename, ...) for each one.
+ *
  * @param file input file
  * @param flag regridding mode, see above
  * @param default_value default value, meaning depends on the
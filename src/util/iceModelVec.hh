@@ -1,4 +1,4 @@
-// Copyright (C) 2008--2019 Ed Bueler, Constantine Khroulev, and David Maxwell
+// Copyright (C) 2008--2020 Ed Bueler, Constantine Khroulev, and David Maxwell
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 #define __IceModelVec_hh
 
 #include <initializer_list>
+#include <vector>
 #include <memory>
 #include <cstdint>              // uint64_t
 
@@ -358,6 +359,33 @@ protected:
 
 bool set_contains(const std::set<std::string> &S, const IceModelVec &field);
 
+void update_ghosts(const std::vector<IceModelVec*> &fields);
+
+//! Non-blocking update of ghosts of one or more fields.
+/*!
+ * The constructor starts the update, finish() (or the destructor) completes it. Use it to
+ * overlap communication with computations that do not need ghosts (see PointsInterior and
+ * PointsBoundary).
+ *
+ * Ghosts of a single field are updated in place, so its owned values must not be modified
+ * until finish() is called. Several fields are packed into a separate buffer, so owned
+ * values outside the strip sent to neighbors may be modified (see the constructor).
+ */
+class GhostUpdate {
+public:
+  GhostUpdate(const std::vector<IceModelVec*> &fields);
+  ~GhostUpdate();
+
+  void finish();
+private:
+  struct Impl;
+  Impl *m_impl;
+
+  // disable copy constructor and the assignment operator:
+  GhostUpdate(const GhostUpdate &other);
+  GhostUpdate& operator=(const GhostUpdate&);
+};
+
 class IceModelVec2S;
 
 /** Class for a 2d DA-based Vec.
@@ -1,4 +1,4 @@
-// Copyright (C) 2009--2019 Constantine Khroulev
+// Copyright (C) 2009--2020 Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -30,6 +30,7 @@
 #include "io/io_helpers.hh"
 #include "pism/util/Logger.hh"
 #include "pism/util/interpolation.hh"
+#include "pism/util/Profiling.hh"
 
 namespace pism {
 
@@ -390,25 +391,46 @@ void IceModelVec2T::update(unsigned int start) {
     m_report_range = true;
   }
 
-  File file(m_grid->com, m_filename, PISM_GUESS, PISM_READONLY);
+  const Profiling &profiling = m_grid->ctx()->profiling();
+  profiling.begin("io.forcing");
+  {
+    // PISM_GUESS selects a parallel I/O backend if the file format allows it
+    File file(m_grid->com, m_filename, PISM_GUESS, PISM_READONLY);
+
+    const bool allow_extrapolation = m_grid->ctx()->config()->get_flag("grid.allow_extrapolation");
 
-  const bool allow_extrapolation = m_grid->ctx()->config()->get_flag("grid.allow_extrapolation");
+    // read all missing records at once
+    const size_t record_size = m_grid->xm() * m_grid->ym();
+    std::vector<double> records(missing * record_size);
 
-  for (unsigned int j = 0; j < missing; ++j) {
-    {
-      petsc::VecArray tmp_array(m_v);
-      io::regrid_spatial_variable(m_metadata[0], *m_grid, file, start + j, CRITICAL,
-                                  m_report_range, allow_extrapolation,
-                                  0.0, m_interpolation_type, tmp_array.get());
+    io::regrid_spatial_variable(m_metadata[0], *m_grid, file, start, missing, CRITICAL,
+                                m_report_range, allow_extrapolation,
+                                0.0, m_interpolation_type, records.data());
+
+    for (unsigned int j = 0; j < missing; ++j) {
+      m_grid->ctx()->log()->message(5, " %s: read entry #%02d, year %s...\n",
+                                    m_name.c_str(),
+                                    start + j,
+                                    t->date(m_time[start + j]).c_str());
     }
 
-    m_grid->ctx()->log()->message(5, " %s: reading entry #%02d, year %s...\n",
-                                  m_name.c_str(),
-                                  start + j,
-                                  t->date(m_time[start + j]).c_str());
+    // copy records into the buffer
+    double ***a3 = get_array3();
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      const size_t offset = (j - m_grid->ys()) * m_grid->xm() + (i - m_grid->xs());
+
+      for (unsigned int k = 0; k < missing; ++k) {
+        a3[j][i][kept + k] = records[k * record_size + offset];
+      }
+    }
+    end_access();
 
-    set_record(kept + j);
+    // the last record read is stored in the 2D Vec, as before
+    get_record(kept + missing - 1);
   }
+  profiling.end("io.forcing");
 }
 
 //! Discard the first N records, shifting the rest of them towards the "beginning".
@@ -0,0 +1,403 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::max
+#include <climits>              // INT_MAX
+#include <condition_variable>
+#include <cstdio>               // fprintf, stderr
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "AsyncWriter.hh"
+#include "NCFile.hh"            // netcdf_mutex()
+
+// The following is a stupid kludge necessary to make NetCDF 4.x work in
+// serial mode in an MPI program:
+#ifndef MPI_INCLUDED
+#define MPI_INCLUDED 1
+#endif
+#include <netcdf.h>
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+typedef std::lock_guard<std::recursive_mutex> NetCDFLock;
+
+static void check(const ErrorLocation &where, int return_code) {
+  if (return_code != NC_NOERR) {
+    throw RuntimeError(where, nc_strerror(return_code));
+  }
+}
+
+//! A distributed array gathered on rank 0.
+struct StagedArray {
+  std::string variable_name;
+  unsigned int record;
+  unsigned int z_count;
+  //! xs, xm, ys, ym of each rank
+  std::vector<int> patches;
+  //! data of all ranks, one after another
+  std::vector<double> data;
+};
+
+//! All arrays staged for one file.
+struct StagedFile {
+  std::string filename;
+  std::vector<StagedArray> arrays;
+};
+
+struct AsyncWriter::Impl {
+  MPI_Comm com;
+  int rank;
+  unsigned int max_pending;
+
+  // All fields below are used on rank 0 only.
+
+  //! arrays staged for files that are still open
+  std::map<std::string, std::shared_ptr<StagedFile>> staged;
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  //! files submitted for writing (the first one may be in progress)
+  std::deque<std::shared_ptr<StagedFile>> queue;
+  //! names of files in `queue`
+  std::multiset<std::string> pending;
+  //! the first error thrown by the helper thread
+  std::exception_ptr error;
+  bool done;
+
+  std::thread thread;
+
+  void run();
+};
+
+//! Write all arrays in `file`.
+static void write(const StagedFile &file) {
+  int ncid = -1;
+  {
+    NetCDFLock lock(netcdf_mutex());
+    int stat = nc_open(file.filename.c_str(), NC_WRITE, &ncid);
+    check(PISM_ERROR_LOCATION, stat);
+  }
+
+  try {
+    for (const auto &array : file.arrays) {
+      int varid = -1, ndims = 0;
+      {
+        NetCDFLock lock(netcdf_mutex());
+        int stat = nc_inq_varid(ncid, array.variable_name.c_str(), &varid);
+        check(PISM_ERROR_LOCATION, stat);
+
+        stat = nc_inq_varndims(ncid, varid, &ndims);
+        check(PISM_ERROR_LOCATION, stat);
+      }
+
+      // see NCFile::write_darray_impl()
+      const bool time_dependent = ((array.z_count  > 1 and ndims == 4) or
+                                   (array.z_count == 1 and ndims == 3));
+
+      const size_t n_patches = array.patches.size() / 4;
+      size_t offset = 0;
+      for (size_t r = 0; r < n_patches; ++r) {
+        const int
+          xs = array.patches[4 * r + 0],
+          xm = array.patches[4 * r + 1],
+          ys = array.patches[4 * r + 2],
+          ym = array.patches[4 * r + 3];
+
+        std::vector<size_t> start, count;
+        if (time_dependent) {
+          start.push_back(array.record);
+          count.push_back(1);
+        }
+        start.push_back(ys);
+        count.push_back(ym);
+        start.push_back(xs);
+        count.push_back(xm);
+        // z (not used when writing 2D fields)
+        start.push_back(0);
+        count.push_back(array.z_count);
+
+        NetCDFLock lock(netcdf_mutex());
+        int stat = nc_put_vara_double(ncid, varid, start.data(), count.data(),
+                                      &array.data[offset]);
+        check(PISM_ERROR_LOCATION, stat);
+
+        offset += static_cast<size_t>(xm) * ym * array.z_count;
+      }
+    }
+  } catch (RuntimeError &e) {
+    e.add_context("writing to '%s' asynchronously", file.filename.c_str());
+    NetCDFLock lock(netcdf_mutex());
+    nc_close(ncid);
+    throw;
+  }
+
+  NetCDFLock lock(netcdf_mutex());
+  int stat = nc_close(ncid);
+  check(PISM_ERROR_LOCATION, stat);
+}
+
+//! The loop of the helper thread: write submitted files one by one.
+void AsyncWriter::Impl::run() {
+  while (true) {
+    std::shared_ptr<StagedFile> file;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [this]() { return done or not queue.empty(); });
+
+      if (queue.empty()) {
+        // done and nothing left to write
+        return;
+      }
+
+      // leave it in the queue: it counts towards max_pending until it is written
+      file = queue.front();
+    }
+
+    try {
+      write(*file);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (not error) {
+        error = std::current_exception();
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.pop_front();
+      pending.erase(pending.find(file->filename));
+    }
+    changed.notify_all();
+  }
+}
+
+AsyncWriter::AsyncWriter(MPI_Comm com, unsigned int max_pending)
+  : m_impl(new Impl) {
+  m_impl->com         = com;
+  m_impl->rank        = 0;
+  m_impl->max_pending = std::max(max_pending, 1U);
+  m_impl->done        = false;
+
+  MPI_Comm_rank(com, &m_impl->rank);
+
+  if (m_impl->rank == 0) {
+    m_impl->thread = std::thread(&Impl::run, m_impl);
+  }
+}
+
+AsyncWriter::~AsyncWriter() {
+  // Write everything submitted so far: the helper thread exits once the queue is empty.
+  if (m_impl->thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_impl->mutex);
+      m_impl->done = true;
+    }
+    m_impl->changed.notify_all();
+    m_impl->thread.join();
+
+    // We cannot throw here, but we should not lose errors silently either.
+    if (m_impl->error) {
+      try {
+        std::rethrow_exception(m_impl->error);
+      } catch (std::exception &e) {
+        fprintf(stderr, "PISM ERROR: asynchronous output failed: %s\n", e.what());
+      }
+    }
+  }
+  delete m_impl;
+}
+
+/*!
+ * Gather `input` on rank 0 and stage it for writing to the variable `variable_name` in
+ * `filename` (record `record`).
+ *
+ * `input` is a distributed array with `z_count` values per grid point, as in
+ * File::write_distributed_array().
+ *
+ * This is a collective operation.
+ */
+void AsyncWriter::stage(const std::string &filename,
+                        const std::string &variable_name,
+                        const IceGrid &grid,
+                        unsigned int z_count,
+                        unsigned int record,
+                        const double *input) {
+  const int size = grid.size();
+
+  int patch[4] = {grid.xs(), grid.xm(), grid.ys(), grid.ym()};
+
+  StagedArray array;
+  array.variable_name = variable_name;
+  array.record        = record;
+  array.z_count       = z_count;
+
+  if (m_impl->rank == 0) {
+    array.patches.resize(4 * size);
+  }
+
+  int ierr = MPI_Gather(patch, 4, MPI_INT, array.patches.data(), 4, MPI_INT, 0, m_impl->com);
+  PISM_C_CHK(ierr, 0, "MPI_Gather");
+
+  std::vector<int> counts, offsets;
+  {
+    ParallelSection rank0(m_impl->com);
+    try {
+      if (m_impl->rank == 0) {
+        counts.resize(size);
+        offsets.resize(size);
+
+        size_t total = 0;
+        for (int r = 0; r < size; ++r) {
+          const size_t count = (static_cast<size_t>(array.patches[4 * r + 1]) *
+                                array.patches[4 * r + 3] * z_count);
+          if (total + count > INT_MAX) {
+            throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                          "'%s' is too big to be written asynchronously",
+                                          variable_name.c_str());
+          }
+          counts[r]  = static_cast<int>(count);
+          offsets[r] = static_cast<int>(total);
+          total += count;
+        }
+
+        array.data.resize(total);
+      }
+    } catch (...) {
+      rank0.failed();
+    }
+    rank0.check();
+  }
+
+  const int local_count = grid.xm() * grid.ym() * z_count;
+
+  ierr = MPI_Gatherv(const_cast<double*>(input), local_count, MPI_DOUBLE,
+                     array.data.data(), counts.data(), offsets.data(), MPI_DOUBLE,
+                     0, m_impl->com);
+  PISM_C_CHK(ierr, 0, "MPI_Gatherv");
+
+  if (m_impl->rank == 0) {
+    auto &file = m_impl->staged[filename];
+    if (not file) {
+      file.reset(new StagedFile);
+      file->filename = filename;
+    }
+    file->arrays.push_back(std::move(array));
+  }
+}
+
+/*!
+ * Submit arrays staged for `filename` for writing.
+ *
+ * Call this after `filename` is closed. Blocks (on rank 0) if `max_pending` files are
+ * waiting to be written already.
+ */
+void AsyncWriter::submit(const std::string &filename) {
+  if (m_impl->rank != 0) {
+    return;
+  }
+
+  auto j = m_impl->staged.find(filename);
+  if (j == m_impl->staged.end()) {
+    return;
+  }
+
+  std::shared_ptr<StagedFile> file = j->second;
+  m_impl->staged.erase(j);
+
+  {
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->changed.wait(lock, [this]() {
+        return m_impl->queue.size() < m_impl->max_pending;
+      });
+
+    m_impl->queue.push_back(file);
+    m_impl->pending.insert(filename);
+  }
+  m_impl->changed.notify_all();
+}
+
+/*!
+ * Wait until all data submitted for `filename` are written.
+ *
+ * Reports errors that occurred while writing (any file) on all ranks.
+ *
+ * This is a collective operation.
+ */
+void AsyncWriter::wait(const std::string &filename) {
+  ParallelSection rank0(m_impl->com);
+  try {
+    if (m_impl->rank == 0) {
+      std::unique_lock<std::mutex> lock(m_impl->mutex);
+      m_impl->changed.wait(lock, [this, &filename]() {
+          return m_impl->pending.count(filename) == 0;
+        });
+
+      if (m_impl->error) {
+        std::exception_ptr error = m_impl->error;
+        m_impl->error = nullptr;
+        std::rethrow_exception(error);
+      }
+    }
+  } catch (...) {
+    rank0.failed();
+  }
+  rank0.check();
+}
+
+/*!
+ * Wait until all submitted data are written.
+ *
+ * Reports errors that occurred while writing on all ranks.
+ *
+ * This is a collective operation.
+ */
+void AsyncWriter::flush() {
+  ParallelSection rank0(m_impl->com);
+  try {
+    if (m_impl->rank == 0) {
+      std::unique_lock<std::mutex> lock(m_impl->mutex);
+      m_impl->changed.wait(lock, [this]() {
+          return m_impl->queue.empty();
+        });
+
+      if (m_impl->error) {
+        std::exception_ptr error = m_impl->error;
+        m_impl->error = nullptr;
+        std::rethrow_exception(error);
+      }
+    }
+  } catch (...) {
+    rank0.failed();
+  }
+  rank0.check();
+}
+
+} // end of namespace io
+} // end of namespace pism
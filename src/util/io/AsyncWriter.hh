@@ -0,0 +1,91 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_ASYNCWRITER_H
+#define PISM_ASYNCWRITER_H
+
+#include <string>
+#include <mpi.h>
+
+namespace pism {
+
+class IceGrid;
+
+namespace io {
+
+/*!
+ * Writes distributed arrays to NetCDF files in a helper thread on rank 0.
+ *
+ * A File using an AsyncWriter (see File::set_async_writer()) does not write distributed
+ * arrays right away. Instead, File::write_distributed_array() gathers an array (already
+ * converted to output units) in a staging buffer on rank 0 and returns. Closing the file
+ * submits all arrays staged for it: rank 0 re-opens the file in a helper thread and
+ * writes them while the run continues.
+ *
+ * Everything else (dimensions, variables, attributes, time and other small variables)
+ * is written by the main thread as usual, so the structure of the file is the same.
+ *
+ * At most `max_pending` files can wait to be written. Closing one more file blocks until
+ * the oldest one is written.
+ *
+ * Usage:
+ *
+ * 1. call `wait()` before opening a file (collective): it may have pending writes,
+ * 2. open the file and call File::set_async_writer(),
+ * 3. write to it as usual,
+ * 4. close it,
+ * 5. call `flush()` (collective) to make sure all data are written (e.g. at the end of
+ *    the run or when PISM receives a signal).
+ *
+ * The helper thread does not use MPI. Its NetCDF calls are serialized with the rest of
+ * PISM's NetCDF calls using netcdf_mutex().
+ *
+ * The helper thread re-opens files using the serial NetCDF library, so files written
+ * this way have to use the NetCDF-3 format (the "netcdf3" backend).
+ */
+class AsyncWriter {
+public:
+  AsyncWriter(MPI_Comm com, unsigned int max_pending);
+  ~AsyncWriter();
+
+  void stage(const std::string &filename,
+             const std::string &variable_name,
+             const IceGrid &grid,
+             unsigned int z_count,
+             unsigned int record,
+             const double *input);
+
+  void submit(const std::string &filename);
+
+  void wait(const std::string &filename);
+
+  void flush();
+private:
+  struct Impl;
+  Impl *m_impl;
+
+  // disable copying
+  AsyncWriter(const AsyncWriter&);
+  AsyncWriter& operator=(const AsyncWriter&);
+};
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* PISM_ASYNCWRITER_H */
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -18,7 +18,9 @@
 
 #include <cassert>
 #include <cstdio>
+#include <map>
 #include <memory>
+#include <set>
 using std::shared_ptr;
 
 #include <petscvec.h>
@@ -30,6 +32,7 @@ using std::shared_ptr;
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/Time.hh"
 #include "NC3File.hh"
+#include "NativeFile.hh"
 
 #include "pism/pism_config.hh"
 
@@ -47,13 +50,98 @@ using std::shared_ptr;
 
 #include "pism/util/error_handling.hh"
 #include "pism/util/io/io_helpers.hh"
+#include "pism/util/io/AsyncWriter.hh"
+#include "pism/util/io/LocalInterpCtx.hh"
 
 namespace pism {
 
+/*!
+ * Metadata (dimensions, variables, attributes) read from a file.
+ *
+ * With most backends every metadata query is a collective operation (with NetCDF-3 it
+ * is a call on rank 0 followed by a broadcast). Queries are answered by the backend once
+ * and then locally, on all ranks. Entries are updated or erased when File changes the
+ * corresponding metadata.
+ */
+struct MetadataCache {
+  typedef std::pair<std::string, std::string> Attribute;
+
+  std::map<std::string, bool> dimension_exists;
+  std::map<std::string, unsigned int> dimension_length;
+  std::map<std::string, AxisType> dimension_type;
+  //! name of the unlimited dimension (empty if there isn't one); valid if `have_unlimited`
+  std::string unlimited_dimension;
+  bool have_unlimited;
+
+  std::map<std::string, bool> variable_exists;
+  std::map<std::string, std::vector<std::string>> variable_dimensions;
+  //! number of variables (negative if unknown)
+  int n_variables;
+  std::map<unsigned int, std::string> variable_name;
+
+  std::map<Attribute, IO_Type> attribute_type;
+  std::map<Attribute, std::string> text_attribute;
+  std::map<Attribute, std::vector<double>> double_attribute;
+
+  MetadataCache() {
+    clear();
+  }
+
+  void clear() {
+    dimension_exists.clear();
+    dimension_length.clear();
+    dimension_type.clear();
+    unlimited_dimension.clear();
+    have_unlimited = false;
+
+    variable_exists.clear();
+    variable_dimensions.clear();
+    n_variables = -1;
+    variable_name.clear();
+
+    attribute_type.clear();
+    text_attribute.clear();
+    double_attribute.clear();
+  }
+
+  //! Forget everything we know about the attribute `attribute` of `variable`.
+  void erase_attribute(const std::string &variable, const std::string &attribute) {
+    Attribute key(variable, attribute);
+    attribute_type.erase(key);
+    text_attribute.erase(key);
+    double_attribute.erase(key);
+    // the type of a dimension depends on attributes of its coordinate variable
+    dimension_type.erase(variable);
+  }
+};
+
 struct File::Impl {
   MPI_Comm com;
   IO_Backend backend;
   io::NCFile::Ptr nc;
+  //! if set, distributed arrays are written asynchronously
+  std::shared_ptr<io::AsyncWriter> writer;
+  //! grid information and regridding plans (used if the file is open for reading only)
+  std::unique_ptr<RegriddingCache> regridding_cache;
+  //! file metadata known so far
+  MetadataCache metadata;
+
+  //! time-independent and coordinate variables written to this file
+  std::set<std::string> written;
+  //! variables that still have the "not_written" attribute (it is removed by sync() and
+  //! close())
+  std::set<std::string> not_written;
+
+  //! Unit converter used to write a variable.
+  struct OutputConverter {
+    std::string internal_units;
+    std::string output_units;
+    std::shared_ptr<units::Converter> converter;
+  };
+  //! unit converters used to write variables, kept for the life of the file
+  std::map<std::string, OutputConverter> converters;
+  //! storage for data converted to output units
+  std::vector<double> buffer;
 };
 
 IO_Backend string_to_backend(const std::string &backend) {
@@ -78,6 +166,9 @@ IO_Backend string_to_backend(const std::string &backend) {
   if (backend == "pio_netcdf4p") {
     return PISM_PIO_NETCDF4P;
   }
+  if (backend == "native") {
+    return PISM_NATIVE;
+  }
   throw RuntimeError::formatted(PISM_ERROR_LOCATION,
                                 "unknown or unsupported I/O backend: %s", backend.c_str());
 }
@@ -85,6 +176,10 @@ IO_Backend string_to_backend(const std::string &backend) {
 // Chooses the best available I/O backend for reading from 'filename'.
 static IO_Backend choose_backend(MPI_Comm com, const std::string &filename) {
 
+  if (io::NativeFile::is_native(com, filename)) {
+    return PISM_NATIVE;
+  }
+
   std::string format;
   {
     // This is the rank-0-only purely-serial mode of accessing NetCDF files, but it
@@ -117,6 +212,10 @@ static io::NCFile::Ptr create_backend(MPI_Comm com, IO_Backend backend, int iosy
   if (backend == PISM_NETCDF3) {
     return io::NCFile::Ptr(new io::NC3File(com));
   }
+
+  if (backend == PISM_NATIVE) {
+    return io::NCFile::Ptr(new io::NativeFile(com));
+  }
 #if (Pism_USE_PARALLEL_NETCDF4==1)
   if (backend == PISM_NETCDF4_PARALLEL) {
     return io::NCFile::Ptr(new io::NC4_Par(com));
@@ -156,6 +255,11 @@ File::File(MPI_Comm com, const std::string &filename, IO_Backend backend, IO_Mod
 
   if (backend == PISM_GUESS) {
     m_impl->backend = choose_backend(com, filename);
+  } else if ((mode == PISM_READONLY or mode == PISM_READWRITE) and
+             io::NativeFile::is_native(com, filename)) {
+    // Native files can only be read using the native "backend". This makes it possible to
+    // restart from a native file (-i) without changing the code that reads it.
+    m_impl->backend = PISM_NATIVE;
   } else {
     m_impl->backend = backend;
   }
@@ -189,12 +293,17 @@ IO_Backend File::backend() const {
 
 void File::open(const std::string &filename, IO_Mode mode) {
   try {
+    m_impl->metadata.clear();
+    m_impl->written.clear();
+    m_impl->not_written.clear();
 
     // opening for reading
     if (mode == PISM_READONLY) {
 
       m_impl->nc->open(filename, mode);
 
+      m_impl->regridding_cache.reset(new RegriddingCache());
+
     } else if (mode == PISM_READWRITE_CLOBBER or mode == PISM_READWRITE_MOVE) {
 
       if (mode == PISM_READWRITE_MOVE) {
@@ -224,6 +333,7 @@ void File::open(const std::string &filename, IO_Mode mode) {
 
 void File::remove_attribute(const std::string &variable_name, const std::string &att_name) const {
   try {
+    m_impl->metadata.erase_attribute(variable_name, att_name);
     m_impl->nc->del_att(variable_name, att_name);
   } catch (RuntimeError &e) {
     e.add_context("deleting the attribute %s:%s", variable_name.c_str(), att_name.c_str());
@@ -232,16 +342,53 @@ void File::remove_attribute(const std::string &variable_name, const std::string
 }
 
 void File::close() {
+  std::string name = filename();
   try {
+    remove_not_written_attributes();
+
+    m_impl->regridding_cache.reset();
+    m_impl->metadata.clear();
+    m_impl->written.clear();
+    m_impl->converters.clear();
+
     m_impl->nc->close();
+
+    if (m_impl->writer) {
+      // the file is closed, so the writer can re-open it and write staged arrays
+      m_impl->writer->submit(name);
+    }
   } catch (RuntimeError &e) {
-    e.add_context("closing \"" + filename() + "\"");
+    e.add_context("closing \"" + name + "\"");
     throw;
   }
 }
 
+/*!
+ * Use `writer` to write distributed arrays to this file asynchronously.
+ *
+ * Arrays written using write_distributed_array() are gathered on rank 0 and written
+ * after this file is closed. See io::AsyncWriter for details.
+ */
+void File::set_async_writer(std::shared_ptr<io::AsyncWriter> writer) {
+  if (m_impl->backend == PISM_NATIVE) {
+    // native files are written by all ranks in parallel: there is nothing to gain
+    return;
+  }
+  m_impl->writer = writer;
+}
+
+/*!
+ * Return the cache of grid information and regridding plans for this file, or `nullptr`
+ * if the file may change (i.e. it is not open for reading only).
+ */
+RegriddingCache* File::regridding_cache() const {
+  return m_impl->regridding_cache.get();
+}
+
 void File::sync() const {
   try {
+    remove_not_written_attributes();
+
     m_impl->nc->sync();
   } catch (RuntimeError &e) {
     e.add_context("synchronizing \"" + filename() + "\"");
@@ -276,8 +423,12 @@ std::string File::filename() const {
 //! \brief Get the number of records. Uses the length of an unlimited dimension.
 unsigned int File::nrecords() const {
   try {
-    std::string dim;
-    m_impl->nc->inq_unlimdim(dim);
+    auto &cache = m_impl->metadata;
+    if (not cache.have_unlimited) {
+      m_impl->nc->inq_unlimdim(cache.unlimited_dimension);
+      cache.have_unlimited = true;
+    }
+    const std::string &dim = cache.unlimited_dimension;
 
     if (dim.empty()) {
       return 1;                 // one record
@@ -361,7 +512,7 @@ VariableLookupData File::find_variable(const std::string &short_name, const std:
     } // end of if (not std_name.empty())
 
     if (not result.exists) {
-      m_impl->nc->inq_varid(short_name, result.exists);
+      result.exists = find_variable(short_name);
       if (result.exists) {
         result.name = short_name;
       } else {
@@ -382,8 +533,15 @@ VariableLookupData File::find_variable(const std::string &short_name, const std:
 //! \brief Checks if a variable exists.
 bool File::find_variable(const std::string &name) const {
   try {
+    auto &cache = m_impl->metadata.variable_exists;
+    auto j = cache.find(name);
+    if (j != cache.end()) {
+      return j->second;
+    }
+
     bool exists = false;
     m_impl->nc->inq_varid(name, exists);
+    cache[name] = exists;
     return exists;
   } catch (RuntimeError &e) {
     e.add_context("searching for variable '%s' in '%s'", name.c_str(), filename().c_str());
@@ -393,8 +551,15 @@ bool File::find_variable(const std::string &name) const {
 
 std::vector<std::string> File::dimensions(const std::string &variable_name) const {
   try {
+    auto &cache = m_impl->metadata.variable_dimensions;
+    auto j = cache.find(variable_name);
+    if (j != cache.end()) {
+      return j->second;
+    }
+
     std::vector<std::string> result;
     m_impl->nc->inq_vardimid(variable_name, result);
+    cache[variable_name] = result;
     return result;
   } catch (RuntimeError &e) {
     e.add_context("getting dimensions of variable '%s' in '%s'", variable_name.c_str(),
@@ -407,8 +572,15 @@ std::vector<std::string> File::dimensions(const std::string &variable_name) cons
 //! \brief Checks if a dimension exists.
 bool File::find_dimension(const std::string &name) const {
   try {
+    auto &cache = m_impl->metadata.dimension_exists;
+    auto j = cache.find(name);
+    if (j != cache.end()) {
+      return j->second;
+    }
+
     bool exists = false;
     m_impl->nc->inq_dimid(name, exists);
+    cache[name] = exists;
     return exists;
   } catch (RuntimeError &e) {
     e.add_context("searching for dimension '%s' in '%s'", name.c_str(), filename().c_str());
@@ -423,8 +595,15 @@ bool File::find_dimension(const std::string &name) const {
 unsigned int File::dimension_length(const std::string &name) const {
   try {
     if (find_dimension(name)) {
+      auto &cache = m_impl->metadata.dimension_length;
+      auto j = cache.find(name);
+      if (j != cache.end()) {
+        return j->second;
+      }
+
       unsigned int result = 0;
       m_impl->nc->inq_dimlen(name, result);
+      cache[name] = result;
       return result;
     } else {
       return 0;
@@ -441,6 +620,19 @@ unsigned int File::dimension_length(const std::string &name) const {
  */
 AxisType File::dimension_type(const std::string &name,
                               units::System::Ptr unit_system) const {
+  auto &cache = m_impl->metadata.dimension_type;
+  auto j = cache.find(name);
+  if (j != cache.end()) {
+    return j->second;
+  }
+
+  AxisType result = guess_dimension_type(name, unit_system);
+  cache[name] = result;
+  return result;
+}
+
+AxisType File::guess_dimension_type(const std::string &name,
+                                    units::System::Ptr unit_system) const {
   try {
     if (not find_variable(name)) {
       throw RuntimeError(PISM_ERROR_LOCATION, "coordinate variable " + name + " is missing");
@@ -506,6 +698,13 @@ AxisType File::dimension_type(const std::string &name,
 void File::define_dimension(const std::string &name, size_t length) const {
   try {
     m_impl->nc->def_dim(name, length);
+
+    auto &cache = m_impl->metadata;
+    cache.dimension_exists[name] = true;
+    cache.dimension_length.erase(name);
+    if (length == PISM_UNLIMITED) {
+      cache.have_unlimited = false;
+    }
   } catch (RuntimeError &e) {
     e.add_context("defining dimension '%s' in '%s'", name.c_str(), filename().c_str());
     throw;
@@ -517,27 +716,46 @@ void File::define_variable(const std::string &name, IO_Type nctype, const std::v
   try {
     m_impl->nc->def_var(name, nctype, dims);
 
-    // FIXME: I need to write and tune chunk_dimensions that would be called below before we use
-    // this.
-    //
-    /*
-    // if it's not a spatial variable, we're done
-    if (dims.size() < 2) {
-      return;
-    }
-
-    std::vector<size_t> dim_lengths;
-    for (unsigned int k = 0; k < dims.size(); ++k) {
-      dim_lengths.push_back(this->dimension_length(dims[k]));
-    }
-
-    std::vector<size_t> chunk_dims = chunk_dimensions(nctype, dim_lengths);
+    auto &cache = m_impl->metadata;
+    cache.variable_exists[name] = true;
+    cache.variable_dimensions[name] = dims;
+    cache.n_variables = -1;
+    cache.variable_name.clear();
+  } catch (RuntimeError &e) {
+    e.add_context("defining variable '%s' in '%s'", name.c_str(), filename().c_str());
+    throw;
+  }
+}
 
-    m_impl->nc->def_var_chunking(name, chunk_dims);
-    */
+/*!
+ * Set chunk sizes of the variable `name` (one per dimension).
+ *
+ * Only NetCDF-4 files are chunked; other formats ignore this. See
+ * io::define_spatial_variable() for the chunking policy used for spatial variables.
+ */
+void File::define_chunking(const std::string &name,
+                           const std::vector<size_t> &chunk_sizes) const {
+  try {
+    std::vector<size_t> tmp = chunk_sizes;
+    m_impl->nc->def_var_chunking(name, tmp);
+  } catch (RuntimeError &e) {
+    e.add_context("setting chunk sizes of '%s' in '%s'", name.c_str(), filename().c_str());
+    throw;
+  }
+}
 
+/*!
+ * Set the compression level (0 -- no compression, 9 -- maximum) of the variable `name` and
+ * enable the shuffle filter (if `shuffle` is true).
+ *
+ * Only NetCDF-4 files support compression; other formats ignore this.
+ */
+void File::define_compression(const std::string &name, bool shuffle, int level) const {
+  try {
+    m_impl->nc->def_var_deflate(name, shuffle, level);
   } catch (RuntimeError &e) {
-    e.add_context("defining variable '%s' in '%s'", name.c_str(), filename().c_str());
+    e.add_context("setting compression parameters of '%s' in '%s'",
+                  name.c_str(), filename().c_str());
     throw;
   }
 }
@@ -582,6 +800,7 @@ void File::write_attribute(const std::string &var_name, const std::string &att_n
                            const std::vector<double> &values) const {
   try {
     redef();
+    m_impl->metadata.erase_attribute(var_name, att_name);
     m_impl->nc->put_att_double(var_name, att_name, nctype, values);
   } catch (RuntimeError &e) {
     e.add_context("writing double attribute '%s:%s' in '%s'",
@@ -595,6 +814,7 @@ void File::write_attribute(const std::string &var_name, const std::string &att_n
                            const std::string &value) const {
   try {
     redef();
+    m_impl->metadata.erase_attribute(var_name, att_name);
     // ensure that the string is null-terminated
     m_impl->nc->put_att_text(var_name, att_name, value + "\0");
   } catch (RuntimeError &e) {
@@ -621,8 +841,16 @@ std::vector<double> File::read_double_attribute(const std::string &var_name, con
     } else {
       // In this case att_type might be PISM_NAT (if an attribute does not
       // exist), but read_double_attribute can handle that.
+      auto &cache = m_impl->metadata.double_attribute;
+      MetadataCache::Attribute key(var_name, att_name);
+      auto j = cache.find(key);
+      if (j != cache.end()) {
+        return j->second;
+      }
+
       std::vector<double> result;
       m_impl->nc->get_att_double(var_name, att_name, result);
+      cache[key] = result;
       return result;
     }
   } catch (RuntimeError &e) {
@@ -642,8 +870,16 @@ std::string File::read_text_attribute(const std::string &var_name, const std::st
                                     "attribute %s is not a string", att_name.c_str());
     }
 
+    auto &cache = m_impl->metadata.text_attribute;
+    MetadataCache::Attribute key(var_name, att_name);
+    auto j = cache.find(key);
+    if (j != cache.end()) {
+      return j->second;
+    }
+
     std::string result;
     m_impl->nc->get_att_text(var_name, att_name, result);
+    cache[key] = result;
     return result;
   } catch (RuntimeError &e) {
     e.add_context("reading text attribute '%s:%s' from %s", var_name.c_str(), att_name.c_str(), filename().c_str());
@@ -677,8 +913,16 @@ std::string File::attribute_name(const std::string &var_name, unsigned int n) co
 
 IO_Type File::attribute_type(const std::string &var_name, const std::string &att_name) const {
   try {
+    auto &cache = m_impl->metadata.attribute_type;
+    MetadataCache::Attribute key(var_name, att_name);
+    auto j = cache.find(key);
+    if (j != cache.end()) {
+      return j->second;
+    }
+
     IO_Type result;
     m_impl->nc->inq_atttype(var_name, att_name, result);
+    cache[key] = result;
     return result;
   } catch (RuntimeError &e) {
     e.add_context("getting the type of an attribute of variable '%s' in '%s'", var_name.c_str(), filename().c_str());
@@ -706,6 +950,9 @@ void File::write_variable(const std::string &variable_name,
                           const double *op) const {
   try {
     m_impl->nc->put_vara_double(variable_name, start, count, op);
+
+    // this may have increased the length of the unlimited dimension
+    m_impl->metadata.dimension_length.clear();
   } catch (RuntimeError &e) {
     e.add_context("writing variable '%s' to '%s'", variable_name.c_str(), filename().c_str());
     throw;
@@ -721,7 +968,11 @@ void File::write_distributed_array(const std::string &variable_name,
     unsigned int t_length = nrecords();
     assert(t_length > 0);
 
-    m_impl->nc->write_darray(variable_name, grid, z_count, t_length - 1, input);
+    if (m_impl->writer) {
+      m_impl->writer->stage(filename(), variable_name, grid, z_count, t_length - 1, input);
+    } else {
+      m_impl->nc->write_darray(variable_name, grid, z_count, t_length - 1, input);
+    }
   } catch (RuntimeError &e) {
     e.add_context("writing distributed array '%s' to '%s'",
                   variable_name.c_str(), filename().c_str());
@@ -729,6 +980,93 @@ void File::write_distributed_array(const std::string &variable_name,
   }
 }
 
+/*!
+ * Write a distributed array, converting from `internal_units` to `output_units`.
+ *
+ * Unit converters and the buffer used to store converted data are kept for the life of
+ * the file, so writing a variable once per record does not allocate memory or re-create
+ * converters.
+ */
+void File::write_distributed_array(const std::string &variable_name,
+                                   const IceGrid &grid,
+                                   unsigned int z_count,
+                                   units::System::Ptr unit_system,
+                                   const std::string &internal_units,
+                                   const std::string &output_units,
+                                   const double *input) const {
+  if (internal_units == output_units) {
+    write_distributed_array(variable_name, grid, z_count, input);
+    return;
+  }
+
+  try {
+    auto &c = m_impl->converters[variable_name];
+    if (not c.converter or
+        c.internal_units != internal_units or c.output_units != output_units) {
+      c.internal_units = internal_units;
+      c.output_units   = output_units;
+      c.converter.reset(new units::Converter(unit_system, internal_units, output_units));
+    }
+
+    const size_t data_size = static_cast<size_t>(grid.xm()) * grid.ym() * z_count;
+    if (m_impl->buffer.size() < data_size) {
+      m_impl->buffer.resize(data_size);
+    }
+
+    // copy and convert in one pass
+    c.converter->convert_doubles(input, data_size, m_impl->buffer.data());
+  } catch (RuntimeError &e) {
+    e.add_context("converting '%s' from '%s' to '%s'",
+                  variable_name.c_str(), internal_units.c_str(), output_units.c_str());
+    throw;
+  }
+
+  write_distributed_array(variable_name, grid, z_count, m_impl->buffer.data());
+}
+
+/*!
+ * Returns true if the time-independent (or coordinate) variable `variable_name` was
+ * written already.
+ *
+ * Such variables are defined with the attribute `not_written`. Variables written using
+ * this File instance are tracked in memory, so this does not require switching to
+ * define mode.
+ */
+bool File::was_written(const std::string &variable_name) const {
+  if (m_impl->written.count(variable_name) > 0) {
+    return true;
+  }
+
+  bool result = attribute_type(variable_name, "not_written") == PISM_NAT;
+  if (result) {
+    m_impl->written.insert(variable_name);
+  }
+  return result;
+}
+
+/*!
+ * Mark a time-independent (or coordinate) variable as written.
+ *
+ * The `not_written` attribute is removed (for all variables written since the last
+ * call) by the next sync() or close() call.
+ */
+void File::mark_as_written(const std::string &variable_name) const {
+  m_impl->written.insert(variable_name);
+  m_impl->not_written.insert(variable_name);
+}
+
+void File::remove_not_written_attributes() const {
+  if (m_impl->not_written.empty()) {
+    return;
+  }
+
+  redef();
+  for (const auto &name : m_impl->not_written) {
+    remove_attribute(name, "not_written");
+  }
+  m_impl->not_written.clear();
+}
+
 
 void File::read_variable_transposed(const std::string &variable_name,
                                     const std::vector<unsigned int> &start,
@@ -743,10 +1081,16 @@ void File::read_variable_transposed(const std::string &variable_name,
 }
 
 unsigned int File::nvariables() const {
+  auto &cache = m_impl->metadata;
+  if (cache.n_variables >= 0) {
+    return cache.n_variables;
+  }
+
   int n_vars = 0;
 
   try {
     m_impl->nc->inq_nvars(n_vars);
+    cache.n_variables = n_vars;
   } catch (RuntimeError &e) {
     e.add_context("getting the number of variables in '%s'", filename().c_str());
     throw;
@@ -756,9 +1100,16 @@ unsigned int File::nvariables() const {
 }
 
 std::string File::variable_name(unsigned int id) const {
+  auto &cache = m_impl->metadata.variable_name;
+  auto j = cache.find(id);
+  if (j != cache.end()) {
+    return j->second;
+  }
+
   std::string result;
   try {
     m_impl->nc->inq_varname(id, result);
+    cache[id] = result;
   } catch (RuntimeError &e) {
     e.add_context("getting the name of %d-th variable in '%s'", id, filename().c_str());
     throw;
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -19,6 +19,7 @@
 #ifndef _PISM_FILE_ACCESS_H_
 #define _PISM_FILE_ACCESS_H_
 
+#include <memory>
 #include <vector>
 #include <string>
 #include <mpi.h>
@@ -31,6 +32,11 @@ namespace pism {
 enum AxisType {X_AXIS, Y_AXIS, Z_AXIS, T_AXIS, UNKNOWN_AXIS};
 
 class IceGrid;
+class RegriddingCache;
+
+namespace io {
+class AsyncWriter;
+}
 
 /*!
  * Convert a string to PISM's backend type.
@@ -60,6 +66,8 @@ public:
 
   void close();
 
+  void set_async_writer(std::shared_ptr<io::AsyncWriter> writer);
+
   void redef() const;
 
   void enddef() const;
@@ -99,6 +107,10 @@ public:
   void define_variable(const std::string &name, IO_Type nctype,
                        const std::vector<std::string> &dims) const;
 
+  void define_chunking(const std::string &name, const std::vector<size_t> &chunk_sizes) const;
+
+  void define_compression(const std::string &name, bool shuffle, int level) const;
+
   VariableLookupData find_variable(const std::string &short_name, const std::string &std_name) const;
 
   bool find_variable(const std::string &short_name) const;
@@ -123,6 +135,18 @@ public:
                                unsigned int z_count,
                                const double *input) const;
 
+  void write_distributed_array(const std::string &variable_name,
+                               const IceGrid &grid,
+                               unsigned int z_count,
+                               units::System::Ptr unit_system,
+                               const std::string &internal_units,
+                               const std::string &output_units,
+                               const double *input) const;
+
+  bool was_written(const std::string &variable_name) const;
+
+  void mark_as_written(const std::string &variable_name) const;
+
   // attributes
 
   void remove_attribute(const std::string &variable_name, const std::string &att_name) const;
@@ -143,12 +167,19 @@ public:
   std::string read_text_attribute(const std::string &var_name, const std::string &att_name) const;
 
   void append_history(const std::string &history) const;
+
+  RegriddingCache* regridding_cache() const;
 private:
   struct Impl;
   Impl *m_impl;
 
   void open(const std::string &filename, IO_Mode mode);
 
+  AxisType guess_dimension_type(const std::string &name,
+                                units::System::Ptr unit_system) const;
+
+  void remove_not_written_attributes() const;
+
   // disable copying and assignments
   File(const File &other);
   File & operator=(const File &);
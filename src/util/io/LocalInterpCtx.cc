@@ -1,4 +1,4 @@
-// Copyright (C) 2007-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2007-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -140,4 +140,91 @@ LocalInterpCtx::LocalInterpCtx(const grid_info &input, const IceGrid &grid,
   }
 }
 
+std::string RegriddingCache::grid_key(const File &file, const std::string &variable_name,
+                                      GridRegistration registration) const {
+  // see grid_info::grid_info()
+  auto var = file.find_variable(variable_name, variable_name);
+  if (not var.exists) {
+    // grid_info::grid_info() will report this
+    return "";
+  }
+
+  std::string result = registration_to_string(registration);
+  for (const auto &d : file.dimensions(var.name)) {
+    result += "," + d;
+  }
+  return result;
+}
+
+/*!
+ * Return the description of the grid of the variable `variable_name` in `file`, reading
+ * it from the file only if it is not in the cache.
+ *
+ * This is a collective operation.
+ */
+std::shared_ptr<const grid_info> RegriddingCache::input_grid(const File &file,
+                                                             const std::string &variable_name,
+                                                             units::System::Ptr unit_system,
+                                                             GridRegistration registration) {
+  std::string key = grid_key(file, variable_name, registration);
+
+  if (key.empty()) {
+    return std::make_shared<grid_info>(file, variable_name, unit_system, registration);
+  }
+
+  auto &result = m_grids[key];
+  if (not result) {
+    result = std::make_shared<grid_info>(file, variable_name, unit_system, registration);
+  }
+  return result;
+}
+
+/*!
+ * Return the regridding plan (LocalInterpCtx) for reading `variable_name` from `file`
+ * onto `grid` and vertical levels `z_output`, creating it only if it is not in the cache.
+ *
+ * This is a collective operation.
+ */
+std::shared_ptr<LocalInterpCtx> RegriddingCache::plan(const File &file,
+                                                      const std::string &variable_name,
+                                                      const IceGrid &grid,
+                                                      const std::vector<double> &z_output,
+                                                      InterpolationType type) {
+  std::string input_key = grid_key(file, variable_name, grid.registration());
+
+  // The plan depends on the part of the grid owned by this processor.
+  std::vector<double> output_key;
+  output_key.push_back(type);
+  output_key.push_back(grid.xm());
+  output_key.push_back(grid.ym());
+  output_key.push_back(z_output.size());
+  output_key.insert(output_key.end(), &grid.x()[grid.xs()], &grid.x()[grid.xs()] + grid.xm());
+  output_key.insert(output_key.end(), &grid.y()[grid.ys()], &grid.y()[grid.ys()] + grid.ym());
+  output_key.insert(output_key.end(), z_output.begin(), z_output.end());
+
+  PlanKey key(input_key, output_key);
+
+  auto j = m_plans.find(key);
+
+  // LocalInterpCtx::LocalInterpCtx() is collective, so all processors have to agree:
+  // create a new plan if it is missing on any processor.
+  int missing = (input_key.empty() or j == m_plans.end()) ? 1 : 0;
+  int missing_anywhere = missing;
+  MPI_Allreduce(&missing, &missing_anywhere, 1, MPI_INT, MPI_MAX, grid.com);
+
+  if (missing_anywhere == 0) {
+    return j->second;
+  }
+
+  auto input = input_grid(file, variable_name, grid.ctx()->unit_system(), grid.registration());
+
+  std::shared_ptr<LocalInterpCtx> result(new LocalInterpCtx(*input, grid, z_output, type));
+
+  if (not input_key.empty()) {
+    m_plans[key] = result;
+  }
+
+  return result;
+}
+
 } // end of namespace pism
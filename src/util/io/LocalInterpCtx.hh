@@ -1,4 +1,4 @@
-// Copyright (C) 2007--2011, 2013, 2014, 2015, 2017, 2018 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2007--2011, 2013, 2014, 2015, 2017, 2018, 2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of Pism.
 //
@@ -21,14 +21,16 @@
 
 #include <vector>
 #include <memory>
+#include <map>
+#include <string>
 
 #include "pism/util/interpolation.hh"
 #include "pism/util/io/IO_Flags.hh"
+#include "pism/util/IceGrid.hh"  // grid_info, GridRegistration
 
 namespace pism {
 
-class IceGrid;
-class grid_info;
+class File;
 
 //! The "local interpolation context" describes the processor's part of the source NetCDF file (for regridding).
 /*!
@@ -59,6 +61,41 @@ public:
   std::vector<double> buffer;
 };
 
+//! A cache of input grid descriptions and regridding plans for one input file.
+/*!
+ * Reading many variables from the same file (bootstrapping, `-regrid_file`) requires
+ * the same grid information (coordinate variables read from the file) and the same
+ * LocalInterpCtx (subsets of the input grid and interpolation weights) over and over.
+ *
+ * Grid information is keyed by the list of dimensions of a variable and the grid
+ * registration. Regridding plans are keyed by the input grid, the part of the target grid
+ * owned by this processor, target vertical levels and the interpolation type.
+ *
+ * The cache assumes that the file does not change, so File uses it only if the file is
+ * opened for reading only.
+ */
+class RegriddingCache {
+public:
+  std::shared_ptr<const grid_info> input_grid(const File &file,
+                                              const std::string &variable_name,
+                                              units::System::Ptr unit_system,
+                                              GridRegistration registration);
+
+  std::shared_ptr<LocalInterpCtx> plan(const File &file,
+                                       const std::string &variable_name,
+                                       const IceGrid &grid,
+                                       const std::vector<double> &z_output,
+                                       InterpolationType type);
+private:
+  std::string grid_key(const File &file, const std::string &variable_name,
+                       GridRegistration registration) const;
+
+  std::map<std::string, std::shared_ptr<const grid_info>> m_grids;
+
+  typedef std::pair<std::string, std::vector<double>> PlanKey;
+  std::map<PlanKey, std::shared_ptr<LocalInterpCtx>> m_plans;
+};
+
 } // end of namespace pism
 
 #endif // __lic_hh
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -26,6 +26,7 @@
 #include <netcdf.h>
 #include <cstring>              // memset
 #include <cstdio>               // stderr, fprintf
+#include <vector>
 
 #include "pism/util/pism_utilities.hh" // join
 #include "pism/util/error_handling.hh"
@@ -50,6 +51,169 @@ static void check_and_abort(MPI_Comm com, const ErrorLocation &where, int return
   }
 }
 
+/*!
+ * Maximum number of values in a band (see aggregate()).
+ *
+ * Rank 0 uses two buffers of this size when writing or reading.
+ */
+static const size_t max_band_size = 8 * 1024 * 1024;
+
+//! A hyperslab formed by hyperslabs of one or more consecutive ranks.
+struct Band {
+  std::vector<unsigned int> start;
+  std::vector<unsigned int> count;
+  //! ranks contributing to this band
+  std::vector<int> ranks;
+  //! number of values in this band
+  size_t size;
+};
+
+/*!
+ * Combine hyperslabs of all ranks into "bands".
+ *
+ * `starts` and `counts` contain `ndims` values per rank.
+ *
+ * Consecutive ranks are combined if their hyperslabs are next to each other in one
+ * dimension and have the same start and count in all others. With PISM's domain
+ * decomposition (ranks are ordered by x first, then y) this combines patches of ranks in
+ * a row of the processor grid into a band of rows covering the whole grid in the x
+ * direction. Such a band is contiguous in the file.
+ *
+ * Ranks with empty hyperslabs are skipped. Bands are limited to `max_size` values
+ * unless a hyperslab of one rank is bigger than that.
+ */
+static std::vector<Band> aggregate(const std::vector<unsigned int> &starts,
+                                   const std::vector<unsigned int> &counts,
+                                   int ndims, size_t max_size) {
+  std::vector<Band> result;
+
+  const int size = static_cast<int>(starts.size()) / ndims;
+  for (int r = 0; r < size; ++r) {
+    const unsigned int
+      *start = &starts[r * ndims],
+      *count = &counts[r * ndims];
+
+    size_t n = 1;
+    for (int k = 0; k < ndims; ++k) {
+      n *= count[k];
+    }
+
+    if (n == 0) {
+      continue;
+    }
+
+    if (not result.empty()) {
+      Band &band = result.back();
+
+      // find the dimension along which this hyperslab continues the band
+      int dim = -1;
+      bool adjacent = true;
+      for (int k = 0; k < ndims; ++k) {
+        if (start[k] == band.start[k] and count[k] == band.count[k]) {
+          continue;
+        }
+
+        if (dim < 0 and start[k] == band.start[k] + band.count[k]) {
+          dim = k;
+        } else {
+          adjacent = false;
+          break;
+        }
+      }
+
+      if (adjacent and dim >= 0 and band.size + n <= max_size) {
+        band.count[dim] += count[dim];
+        band.size += n;
+        band.ranks.push_back(r);
+        continue;
+      }
+    }
+
+    Band band;
+    band.start.assign(start, start + ndims);
+    band.count.assign(count, count + ndims);
+    band.ranks = {r};
+    band.size  = n;
+    result.push_back(band);
+  }
+
+  return result;
+}
+
+/*!
+ * Post non-blocking receives (if `send` is false) or sends (otherwise) of hyperslabs of
+ * all ranks in `band` into (from) the corresponding parts of `buffer`.
+ *
+ * Uses MPI subarray types, so no extra copies are needed.
+ */
+static void exchange(MPI_Comm com, const Band &band,
+                     const std::vector<unsigned int> &starts,
+                     const std::vector<unsigned int> &counts,
+                     int tag, bool send,
+                     std::vector<double> &buffer,
+                     std::vector<MPI_Request> &requests) {
+  const int ndims = static_cast<int>(band.start.size());
+
+  buffer.resize(band.size);
+  requests.resize(band.ranks.size());
+
+  std::vector<int> sizes(ndims), subsizes(ndims), offsets(ndims);
+  for (int k = 0; k < ndims; ++k) {
+    sizes[k] = static_cast<int>(band.count[k]);
+  }
+
+  for (unsigned int n = 0; n < band.ranks.size(); ++n) {
+    const int r = band.ranks[n];
+
+    for (int k = 0; k < ndims; ++k) {
+      subsizes[k] = static_cast<int>(counts[r * ndims + k]);
+      offsets[k]  = static_cast<int>(starts[r * ndims + k] - band.start[k]);
+    }
+
+    MPI_Datatype patch;
+    MPI_Type_create_subarray(ndims, sizes.data(), subsizes.data(), offsets.data(),
+                             MPI_ORDER_C, MPI_DOUBLE, &patch);
+    MPI_Type_commit(&patch);
+
+    if (send) {
+      MPI_Isend(buffer.data(), 1, patch, r, tag, com, &requests[n]);
+    } else {
+      MPI_Irecv(buffer.data(), 1, patch, r, tag, com, &requests[n]);
+    }
+
+    // pending operations are not affected
+    MPI_Type_free(&patch);
+  }
+}
+
+static void wait_all(std::vector<MPI_Request> &requests) {
+  MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+  requests.clear();
+}
+
+//! Gather `start` and `count` of all ranks on rank 0.
+static void gather_hyperslabs(MPI_Comm com,
+                              const std::vector<unsigned int> &start,
+                              const std::vector<unsigned int> &count,
+                              std::vector<unsigned int> &starts,
+                              std::vector<unsigned int> &counts) {
+  int rank = 0, size = 0;
+  MPI_Comm_rank(com, &rank);
+  MPI_Comm_size(com, &size);
+
+  const int ndims = static_cast<int>(start.size());
+
+  if (rank == 0) {
+    starts.resize(size * ndims);
+    counts.resize(size * ndims);
+  }
+
+  MPI_Gather(const_cast<unsigned int*>(start.data()), ndims, MPI_UNSIGNED,
+             starts.data(), ndims, MPI_UNSIGNED, 0, com);
+  MPI_Gather(const_cast<unsigned int*>(count.data()), ndims, MPI_UNSIGNED,
+             counts.data(), ndims, MPI_UNSIGNED, 0, com);
+}
+
 NC3File::NC3File(MPI_Comm c)
   : NCFile(c), m_rank(0) {
   MPI_Comm_rank(m_com, &m_rank);
@@ -272,205 +436,144 @@ void NC3File::def_var_impl(const std::string &name,
   check(PISM_ERROR_LOCATION, stat);
 }
 
-void NC3File::get_varm_double_impl(const std::string &variable_name,
-                                 const std::vector<unsigned int> &start,
-                                 const std::vector<unsigned int> &count,
-                                 const std::vector<unsigned int> &imap, double *op) const {
-  return this->get_var_double(variable_name,
-                              start, count, imap, op, true);
-}
-
+/*!
+ * Read a hyperslab on rank 0 and send parts of it to other ranks.
+ *
+ * Hyperslabs of consecutive ranks are combined into bands (see aggregate()). Rank 0 reads
+ * each band using one nc_get_vara_double() call. Sending a band to other ranks overlaps
+ * with reading the next one.
+ */
 void NC3File::get_vara_double_impl(const std::string &variable_name,
                                  const std::vector<unsigned int> &start,
                                  const std::vector<unsigned int> &count,
-                                 double *op) const {
-  std::vector<unsigned int> dummy;
-  return this->get_var_double(variable_name,
-                              start, count, dummy, op, false);
-}
-
-//! \brief Get variable data.
-void NC3File::get_var_double(const std::string &variable_name,
-                            const std::vector<unsigned int> &start_input,
-                            const std::vector<unsigned int> &count_input,
-                            const std::vector<unsigned int> &imap_input, double *ip,
-                            bool transposed) const {
-  std::vector<unsigned int> start = start_input;
-  std::vector<unsigned int> count = count_input;
-  std::vector<unsigned int> imap = imap_input;
-  const int start_tag = 1,
-    count_tag = 2,
-    data_tag =  3,
-    imap_tag =  4,
-    chunk_size_tag = 5;
-  int stat = NC_NOERR, com_size, ndims = static_cast<int>(start.size());
-  std::vector<double> processor_0_buffer;
-  MPI_Status mpi_stat;
-  unsigned int local_chunk_size = 1,
-    processor_0_chunk_size = 0;
-
-  if (not transposed) {
-    imap.resize(ndims);
-  }
-
-  // get the size of the communicator
-  MPI_Comm_size(m_com, &com_size);
-
-  // compute the size of a local chunk
+                                 double *ip) const {
+  const int data_tag = 3;
+  const int ndims = static_cast<int>(start.size());
+
+  size_t local_chunk_size = 1;
   for (int k = 0; k < ndims; ++k) {
     local_chunk_size *= count[k];
   }
 
-  // compute the maximum and send it to processor 0; this is the size of the
-  // buffer processor 0 will need
-  MPI_Reduce(&local_chunk_size, &processor_0_chunk_size, 1, MPI_UNSIGNED, MPI_MAX, 0, m_com);
+  std::vector<unsigned int> starts, counts;
+  gather_hyperslabs(m_com, start, count, starts, counts);
 
-  // now we need to send start, count and imap data to processor 0 and receive data
   if (m_rank == 0) {
-    // Note: this could be optimized: if processor_0_chunk_size <=
-    // max(local_chunk_size) we can avoid allocating this buffer. The inner for
-    // loop will have to be re-ordered, though.
-    processor_0_buffer.resize(processor_0_chunk_size);
-
-    // MPI calls below require C datatypes (so that we don't have to worry
-    // about sizes of size_t and ptrdiff_t), so we make local copies of start,
-    // count, and imap to use in the nc_get_varm_double() call.
-    std::vector<size_t> nc_start(ndims), nc_count(ndims);
-    std::vector<ptrdiff_t> nc_imap(ndims), nc_stride(ndims);
-    int varid;
-
-    stat = nc_inq_varid(m_file_id, variable_name.c_str(), &varid);
+    int varid = -1;
+    int stat = nc_inq_varid(m_file_id, variable_name.c_str(), &varid);
     check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
 
-    for (int r = 0; r < com_size; ++r) {
+    // rank 0 receives its own part just like all other ranks
+    MPI_Request self = MPI_REQUEST_NULL;
+    if (local_chunk_size > 0) {
+      MPI_Irecv(ip, static_cast<int>(local_chunk_size), MPI_DOUBLE, 0, data_tag, m_com, &self);
+    }
 
-      if (r != 0) {
-        // Note: start, count, imap, and local_chunk_size on processor zero are
-        // used *before* they get overwritten by these calls
-        MPI_Recv(&start[0],         ndims, MPI_UNSIGNED, r, start_tag,      m_com, &mpi_stat);
-        MPI_Recv(&count[0],         ndims, MPI_UNSIGNED, r, count_tag,      m_com, &mpi_stat);
-        MPI_Recv(&imap[0],          ndims, MPI_UNSIGNED, r, imap_tag,       m_com, &mpi_stat);
-        MPI_Recv(&local_chunk_size, 1,     MPI_UNSIGNED, r, chunk_size_tag, m_com, &mpi_stat);
-      }
+    std::vector<Band> bands = aggregate(starts, counts, ndims, max_band_size);
+
+    std::vector<double> buffer[2];
+    std::vector<MPI_Request> requests[2];
+    std::vector<size_t> nc_start(ndims), nc_count(ndims);
+
+    for (unsigned int b = 0; b < bands.size(); ++b) {
+      const Band &band = bands[b];
+      const int n = b % 2;
+
+      // make sure the buffer is not in use
+      wait_all(requests[n]);
+      buffer[n].resize(band.size);
 
-      // This for loop uses start, count and imap passed in as arguments when r
-      // == 0. For r > 0 they are overwritten by MPI_Recv calls above.
       for (int k = 0; k < ndims; ++k) {
-        nc_start[k]  = start[k];
-        nc_count[k]  = count[k];
-        nc_imap[k]   = imap[k];
-        nc_stride[k] = 1;       // fill with ones; this way it works even with
-                                // NetCDF versions with a bug affecting the
-                                // stride == NULL case.
+        nc_start[k] = band.start[k];
+        nc_count[k] = band.count[k];
       }
 
-      if (transposed) {
-        stat = nc_get_varm_double(m_file_id, varid, &nc_start[0], &nc_count[0], &nc_stride[0], &nc_imap[0],
-                                  &processor_0_buffer[0]);
-      } else {
-        stat = nc_get_vara_double(m_file_id, varid, &nc_start[0], &nc_count[0],
-                                  &processor_0_buffer[0]);
-      }
+      stat = nc_get_vara_double(m_file_id, varid, nc_start.data(), nc_count.data(),
+                                buffer[n].data());
       check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
 
-      if (r != 0) {
-        MPI_Send(&processor_0_buffer[0], local_chunk_size, MPI_DOUBLE, r, data_tag, m_com);
-      } else {
-        for (unsigned int k = 0; k < local_chunk_size; ++k) {
-          ip[k] = processor_0_buffer[k];
-        }
-      }
-    } // end of the for loop
-
-  } else {
-    MPI_Send(&start[0],          ndims, MPI_UNSIGNED, 0, start_tag,      m_com);
-    MPI_Send(&count[0],          ndims, MPI_UNSIGNED, 0, count_tag,      m_com);
-    MPI_Send(&imap[0],           ndims, MPI_UNSIGNED, 0, imap_tag,       m_com);
-    MPI_Send(&local_chunk_size,  1,     MPI_UNSIGNED, 0, chunk_size_tag, m_com);
+      exchange(m_com, band, starts, counts, data_tag, true, buffer[n], requests[n]);
+    }
 
-    MPI_Recv(ip, local_chunk_size, MPI_DOUBLE, 0, data_tag, m_com, &mpi_stat);
+    wait_all(requests[0]);
+    wait_all(requests[1]);
+    MPI_Wait(&self, MPI_STATUS_IGNORE);
+  } else if (local_chunk_size > 0) {
+    MPI_Recv(ip, static_cast<int>(local_chunk_size), MPI_DOUBLE, 0, data_tag, m_com,
+             MPI_STATUS_IGNORE);
   }
 }
 
+/*!
+ * Send hyperslabs of all ranks to rank 0 and write them.
+ *
+ * Hyperslabs of consecutive ranks are combined into bands (see aggregate()). Rank 0 writes
+ * each band using one nc_put_vara_double() call. Receiving the next band overlaps with
+ * writing the current one.
+ */
 void NC3File::put_vara_double_impl(const std::string &variable_name,
-                                 const std::vector<unsigned int> &start_input,
-                                 const std::vector<unsigned int> &count_input,
+                                 const std::vector<unsigned int> &start,
+                                 const std::vector<unsigned int> &count,
                                  const double *op) const {
-  // make copies of start and count so that we can use them in MPI_Recv() calls below
-  std::vector<unsigned int> start = start_input;
-  std::vector<unsigned int> count = count_input;
-  const int start_tag = 1,
-    count_tag = 2,
-    data_tag =  3,
-    chunk_size_tag = 4;
-  int stat = NC_NOERR, com_size = 0, ndims = static_cast<int>(start.size());
-  std::vector<double> processor_0_buffer;
-  MPI_Status mpi_stat;
-  unsigned int local_chunk_size = 1,
-    processor_0_chunk_size = 0;
-
-  // get the size of the communicator
-  MPI_Comm_size(m_com, &com_size);
-
-  // compute the size of a local chunk
+  const int data_tag = 3;
+  const int ndims = static_cast<int>(start.size());
+
+  size_t local_chunk_size = 1;
   for (int k = 0; k < ndims; ++k) {
     local_chunk_size *= count[k];
   }
 
-  // compute the maximum and send it to processor 0; this is the size of the
-  // buffer processor 0 will need
-  MPI_Reduce(&local_chunk_size, &processor_0_chunk_size, 1, MPI_UNSIGNED, MPI_MAX, 0, m_com);
+  std::vector<unsigned int> starts, counts;
+  gather_hyperslabs(m_com, start, count, starts, counts);
 
-  // now we need to send start and count data to processor 0 and receive data
   if (m_rank == 0) {
-    processor_0_buffer.resize(processor_0_chunk_size);
+    int varid = -1;
+    int stat = nc_inq_varid(m_file_id, variable_name.c_str(), &varid);
+    check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
+
+    // rank 0 sends its own part just like all other ranks
+    MPI_Request self = MPI_REQUEST_NULL;
+    if (local_chunk_size > 0) {
+      MPI_Isend(const_cast<double*>(op), static_cast<int>(local_chunk_size), MPI_DOUBLE,
+                0, data_tag, m_com, &self);
+    }
 
-    // MPI calls below require C datatypes (so that we don't have to worry about sizes of
-    // size_t and ptrdiff_t), so we make local copies of start and count to use in the
-    // nc_get_vara_double() call.
+    std::vector<Band> bands = aggregate(starts, counts, ndims, max_band_size);
+
+    std::vector<double> buffer[2];
+    std::vector<MPI_Request> requests[2];
     std::vector<size_t> nc_start(ndims), nc_count(ndims);
-    std::vector<ptrdiff_t> nc_stride(ndims);
-    int varid;
 
-    stat = nc_inq_varid(m_file_id, variable_name.c_str(), &varid);
-    check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
+    if (not bands.empty()) {
+      exchange(m_com, bands[0], starts, counts, data_tag, false, buffer[0], requests[0]);
+    }
 
-    for (int r = 0; r < com_size; ++r) {
+    for (unsigned int b = 0; b < bands.size(); ++b) {
+      const Band &band = bands[b];
+      const int n = b % 2;
 
-      if (r != 0) {
-        // Note: start, count, and local_chunk_size on processor zero are used *before*
-        // they get overwritten by these calls
-        MPI_Recv(&start[0],         ndims, MPI_UNSIGNED, r, start_tag,      m_com, &mpi_stat);
-        MPI_Recv(&count[0],         ndims, MPI_UNSIGNED, r, count_tag,      m_com, &mpi_stat);
-        MPI_Recv(&local_chunk_size, 1,     MPI_UNSIGNED, r, chunk_size_tag, m_com, &mpi_stat);
+      wait_all(requests[n]);
 
-        MPI_Recv(&processor_0_buffer[0], local_chunk_size, MPI_DOUBLE, r, data_tag, m_com, &mpi_stat);
-      } else {
-        for (unsigned int k = 0; k < local_chunk_size; ++k) {
-          processor_0_buffer[k] = op[k];
-        }
+      // start receiving the next band
+      if (b + 1 < bands.size()) {
+        exchange(m_com, bands[b + 1], starts, counts, data_tag, false,
+                 buffer[1 - n], requests[1 - n]);
       }
 
-      // This for loop uses start and count passed in as arguments when r == 0. For r > 0
-      // they are overwritten by MPI_Recv calls above.
       for (int k = 0; k < ndims; ++k) {
-        nc_start[k]  = start[k];
-        nc_count[k]  = count[k];
-        nc_stride[k] = 1;       // fill with ones; this way it works even with
-                                // NetCDF versions with a bug affecting the
-                                // stride == NULL case.
+        nc_start[k] = band.start[k];
+        nc_count[k] = band.count[k];
       }
 
-      stat = nc_put_vara_double(m_file_id, varid, &nc_start[0], &nc_count[0],
-                                &processor_0_buffer[0]);
+      stat = nc_put_vara_double(m_file_id, varid, nc_start.data(), nc_count.data(),
+                                buffer[n].data());
       check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
-    } // end of the for loop
-  } else {
-    MPI_Send(&start[0],          ndims, MPI_UNSIGNED, 0, start_tag,      m_com);
-    MPI_Send(&count[0],          ndims, MPI_UNSIGNED, 0, count_tag,      m_com);
-    MPI_Send(&local_chunk_size,  1,     MPI_UNSIGNED, 0, chunk_size_tag, m_com);
+    }
 
-    MPI_Send(const_cast<double*>(op), local_chunk_size, MPI_DOUBLE, 0, data_tag, m_com);
+    MPI_Wait(&self, MPI_STATUS_IGNORE);
+  } else if (local_chunk_size > 0) {
+    MPI_Send(const_cast<double*>(op), static_cast<int>(local_chunk_size), MPI_DOUBLE,
+             0, data_tag, m_com);
   }
 }
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -70,12 +70,6 @@ protected:
                       const std::vector<unsigned int> &count,
                       const double *op) const;
 
-  void get_varm_double_impl(const std::string &variable_name,
-                      const std::vector<unsigned int> &start,
-                      const std::vector<unsigned int> &count,
-                      const std::vector<unsigned int> &imap,
-                      double *ip) const;
-
   void inq_nvars_impl(int &result) const;
 
   void inq_vardimid_impl(const std::string &variable_name, std::vector<std::string> &result) const;
@@ -106,12 +100,6 @@ protected:
 private:
   int m_rank;
 
-  void get_var_double(const std::string &variable_name,
-                     const std::vector<unsigned int> &start,
-                     const std::vector<unsigned int> &count,
-                     const std::vector<unsigned int> &imap, double *ip,
-                     bool transposed) const;
-
   int get_varid(const std::string &variable_name) const;
   };
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -42,8 +42,8 @@ static void check(const ErrorLocation &where, int return_code) {
   }
 }
 
-NC4File::NC4File(MPI_Comm c, unsigned int compression_level)
-  : NCFile(c), m_compression_level(compression_level) {
+NC4File::NC4File(MPI_Comm c)
+  : NCFile(c) {
   // empty
 }
 
@@ -136,13 +136,6 @@ void NC4File::def_var_impl(const std::string &name,
   stat = nc_def_var(m_file_id, name.c_str(), pism_type_to_nc_type(nctype),
                     static_cast<int>(dims.size()), &dimids[0], &varid);
   check(PISM_ERROR_LOCATION, stat);
-
-  // Compress 2D and 3D variables
-  if (m_compression_level > 0 and dims.size() > 1) {
-    stat = nc_inq_varid(m_file_id, name.c_str(), &varid); check(PISM_ERROR_LOCATION, stat);
-    stat = nc_def_var_deflate(m_file_id, varid, 0, 1, m_compression_level);
-    check(PISM_ERROR_LOCATION, stat);
-  }
 }
 
 void NC4File::def_var_chunking_impl(const std::string &name,
@@ -156,36 +149,41 @@ void NC4File::def_var_chunking_impl(const std::string &name,
   check(PISM_ERROR_LOCATION, stat);
 }
 
-void NC4File::get_varm_double_impl(const std::string &variable_name,
-                                  const std::vector<unsigned int> &start,
-                                  const std::vector<unsigned int> &count,
-                                  const std::vector<unsigned int> &imap, double *op) const {
-  return this->get_put_var_double(variable_name,
-                                  start, count, imap, op,
-                                  true /*get*/,
-                                  true /*transposed*/);
+void NC4File::def_var_deflate_impl(const std::string &name, bool shuffle, int level) const {
+  if (level == 0) {
+    // Not compressed. Returning early makes it possible to use this with NetCDF versions
+    // that do not support filters in parallel.
+    return;
+  }
+
+  int stat = 0, varid = 0;
+
+  stat = nc_inq_varid(m_file_id, name.c_str(), &varid);
+  check(PISM_ERROR_LOCATION, stat);
+
+  stat = nc_def_var_deflate(m_file_id, varid,
+                            (shuffle and level > 0) ? 1 : 0,
+                            level > 0 ? 1 : 0,
+                            level);
+  check(PISM_ERROR_LOCATION, stat);
 }
 
 void NC4File::get_vara_double_impl(const std::string &variable_name,
                                   const std::vector<unsigned int> &start,
                                   const std::vector<unsigned int> &count,
                                   double *op) const {
-  std::vector<unsigned int> dummy;
   return this->get_put_var_double(variable_name,
-                                  start, count, dummy, op,
-                                  true /*get*/,
-                                  false /*not transposed*/);
+                                  start, count, op,
+                                  true /*get*/);
 }
 
 void NC4File::put_vara_double_impl(const std::string &variable_name,
                                   const std::vector<unsigned int> &start,
                                   const std::vector<unsigned int> &count,
                                   const double *op) const {
-  std::vector<unsigned int> dummy;
   return this->get_put_var_double(variable_name,
-                                  start, count, dummy, const_cast<double*>(op),
-                                  false /*put*/,
-                                  false /*not transposed*/);
+                                  start, count, const_cast<double*>(op),
+                                  false /*put*/);
 }
 
 
@@ -404,62 +402,36 @@ void NC4File::set_fill_impl(int fillmode, int &old_modep) const {
   int stat = nc_set_fill(m_file_id, fillmode, &old_modep); check(PISM_ERROR_LOCATION, stat);
 }
 
-void NC4File::set_access_mode(int, bool) const {
+void NC4File::set_access_mode(int) const {
   // empty
 }
 
 void NC4File::get_put_var_double(const std::string &variable_name,
                                 const std::vector<unsigned int> &start,
                                 const std::vector<unsigned int> &count,
-                                const std::vector<unsigned int> &imap_input,
                                 double *op,
-                                bool get,
-                                bool transposed) const {
+                                bool get) const {
   int stat, varid, ndims = static_cast<int>(start.size());
-  std::vector<unsigned int> imap = imap_input;
-
-  if (not transposed) {
-    imap.resize(ndims);
-  }
 
   std::vector<size_t> nc_start(ndims), nc_count(ndims);
-  std::vector<ptrdiff_t> nc_imap(ndims), nc_stride(ndims);
 
   stat = nc_inq_varid(m_file_id, variable_name.c_str(), &varid); check(PISM_ERROR_LOCATION, stat);
 
   for (int j = 0; j < ndims; ++j) {
-    nc_start[j]  = start[j];
-    nc_count[j]  = count[j];
-    nc_imap[j]   = imap[j];
-    nc_stride[j] = 1;
+    nc_start[j] = start[j];
+    nc_count[j] = count[j];
   }
 
-  if (transposed) {
-
-    set_access_mode(varid, transposed);
+  set_access_mode(varid);
 
-    if (get) {
-      stat = nc_get_varm_double(m_file_id, varid,
-                                &nc_start[0], &nc_count[0], &nc_stride[0], &nc_imap[0],
-                                op); check(PISM_ERROR_LOCATION, stat);
-    } else {
-      stat = nc_put_varm_double(m_file_id, varid,
-                                &nc_start[0], &nc_count[0], &nc_stride[0], &nc_imap[0],
-                                op); check(PISM_ERROR_LOCATION, stat);
-    }
+  if (get) {
+    stat = nc_get_vara_double(m_file_id, varid,
+                              &nc_start[0], &nc_count[0],
+                              op); check(PISM_ERROR_LOCATION, stat);
   } else {
-
-    set_access_mode(varid, transposed);
-
-    if (get) {
-      stat = nc_get_vara_double(m_file_id, varid,
-                                &nc_start[0], &nc_count[0],
-                                op); check(PISM_ERROR_LOCATION, stat);
-    } else {
-      stat = nc_put_vara_double(m_file_id, varid,
-                                &nc_start[0], &nc_count[0],
-                                op); check(PISM_ERROR_LOCATION, stat);
-    }
+    stat = nc_put_vara_double(m_file_id, varid,
+                              &nc_start[0], &nc_count[0],
+                              op); check(PISM_ERROR_LOCATION, stat);
   }
 }
 
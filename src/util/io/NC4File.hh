@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -27,7 +27,7 @@ namespace io {
 class NC4File : public NCFile
 {
 public:
-  NC4File(MPI_Comm com, unsigned int compression_level);
+  NC4File(MPI_Comm com);
   virtual ~NC4File();
 
 protected:
@@ -56,6 +56,8 @@ protected:
   virtual void def_var_chunking_impl(const std::string &name,
                                     std::vector<size_t> &dimensions) const;
 
+  virtual void def_var_deflate_impl(const std::string &name, bool shuffle, int level) const;
+
   virtual void def_var_impl(const std::string &name,
                            IO_Type nctype, const std::vector<std::string> &dims) const;
 
@@ -69,11 +71,6 @@ protected:
                                    const std::vector<unsigned int> &count,
                                    const double *op) const;
 
-  virtual void get_varm_double_impl(const std::string &variable_name,
-                                   const std::vector<unsigned int> &start,
-                                   const std::vector<unsigned int> &count,
-                                   const std::vector<unsigned int> &imap, double *ip) const;
-
   virtual void inq_nvars_impl(int &result) const;
 
   virtual void inq_vardimid_impl(const std::string &variable_name, std::vector<std::string> &result) const;
@@ -102,14 +99,12 @@ protected:
 
   virtual void del_att_impl(const std::string &variable_name, const std::string &att_name) const;
 protected:
-  virtual void set_access_mode(int varid, bool mapped) const;
+  virtual void set_access_mode(int varid) const;
   virtual void get_put_var_double(const std::string &variable_name,
                                  const std::vector<unsigned int> &start,
                                  const std::vector<unsigned int> &count,
-                                 const std::vector<unsigned int> &imap, double *ip,
-                                 bool get,
-                                 bool mapped) const;
-  unsigned int m_compression_level;
+                                 double *ip,
+                                 bool get) const;
 
   int get_varid(const std::string &variable_name) const;
 };
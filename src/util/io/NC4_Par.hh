@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -28,7 +28,7 @@ class NC4_Par : public NC4File
 {
 public:
   NC4_Par(MPI_Comm c)
-    : NC4File(c, 0) {}
+    : NC4File(c) {}
   virtual ~NC4_Par() {}
 protected:
   // open/create/close
@@ -36,7 +36,7 @@ protected:
 
   virtual void create_impl(const std::string &filename);
 
-  virtual void set_access_mode(int varid, bool mapped) const;
+  virtual void set_access_mode(int varid) const;
 };
 
 
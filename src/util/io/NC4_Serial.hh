@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -27,8 +27,8 @@ namespace io {
 class NC4_Serial : public NC4File
 {
 public:
-  NC4_Serial(MPI_Comm c, unsigned int compression_level)
-    : NC4File(c, compression_level) {}
+  NC4_Serial(MPI_Comm c)
+    : NC4File(c) {}
   virtual ~NC4_Serial() {}
 protected:
   // open/create/close
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -18,7 +18,9 @@
 
 #include "NCFile.hh"
 
+#include <algorithm>            // std::min
 #include <cstdio>               // fprintf, stderr, rename, remove
+#include <mutex>
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/IceGrid.hh"
@@ -33,6 +35,108 @@
 namespace pism {
 namespace io {
 
+/*!
+ * Mutex used to serialize calls to the NetCDF library made by different threads.
+ *
+ * The NetCDF library is not thread-safe. PISM makes NetCDF calls from the main thread
+ * (via NCFile) and from the helper thread of AsyncWriter (on rank 0).
+ */
+std::recursive_mutex& netcdf_mutex() {
+  static std::recursive_mutex mutex;
+  return mutex;
+}
+
+typedef std::lock_guard<std::recursive_mutex> NetCDFLock;
+
+/*!
+ * Copy a hyperslab `input` stored in the order of dimensions in a file to `output`, using
+ * `imap` to map indices of an element in the file to its position in memory (as in
+ * nc_get_varm_double()).
+ *
+ * Loops over the last dimension in the file (contiguous in `input`) and the dimension
+ * with the smallest stride in memory (contiguous in `output`, e.g. `z` for 3D fields) are
+ * tiled, so that both arrays are accessed in cache-sized blocks.
+ */
+void transpose(const std::vector<unsigned int> &count,
+               const std::vector<unsigned int> &imap,
+               const double *input, double *output) {
+  const int ndims = static_cast<int>(count.size());
+
+  size_t size = 1;
+  for (int k = 0; k < ndims; ++k) {
+    size *= count[k];
+  }
+
+  if (size == 0) {
+    return;
+  }
+
+  if (ndims == 1) {
+    for (unsigned int i = 0; i < count[0]; ++i) {
+      output[i * imap[0]] = input[i];
+    }
+    return;
+  }
+
+  // strides of dimensions in the input array
+  std::vector<size_t> stride(ndims, 1);
+  for (int k = ndims - 2; k >= 0; --k) {
+    stride[k] = stride[k + 1] * count[k + 1];
+  }
+
+  // the dimension contiguous in the input...
+  const int a = ndims - 1;
+  // ... and the one closest to contiguous in the output
+  int b = 0;
+  for (int k = 1; k < a; ++k) {
+    if (imap[k] < imap[b]) {
+      b = k;
+    }
+  }
+
+  const unsigned int block = 16;
+
+  // indices along all the other dimensions
+  std::vector<unsigned int> i(ndims, 0);
+  while (true) {
+    size_t input_offset = 0, output_offset = 0;
+    for (int k = 0; k < ndims; ++k) {
+      input_offset  += i[k] * stride[k];
+      output_offset += i[k] * static_cast<size_t>(imap[k]);
+    }
+
+    for (unsigned int b0 = 0; b0 < count[b]; b0 += block) {
+      const unsigned int b1 = std::min(b0 + block, count[b]);
+      for (unsigned int a0 = 0; a0 < count[a]; a0 += block) {
+        const unsigned int a1 = std::min(a0 + block, count[a]);
+
+        for (unsigned int ib = b0; ib < b1; ++ib) {
+          const double *in = input + input_offset + ib * stride[b];
+          double *out = output + output_offset + ib * static_cast<size_t>(imap[b]);
+          for (unsigned int ia = a0; ia < a1; ++ia) {
+            out[ia * imap[a]] = in[ia];
+          }
+        }
+      }
+    }
+
+    // go to the next combination of indices along other dimensions
+    int k = a - 1;
+    for (; k >= 0; --k) {
+      if (k == b) {
+        continue;
+      }
+      if (++i[k] < count[k]) {
+        break;
+      }
+      i[k] = 0;
+    }
+    if (k < 0) {
+      break;
+    }
+  }
+}
+
 NCFile::NCFile(MPI_Comm c)
   : m_com(c), m_file_id(-1), m_define_mode(false) {
 }
@@ -52,31 +156,43 @@ void NCFile::def_var_chunking_impl(const std::string &name,
   // the default implementation does nothing
 }
 
+void NCFile::def_var_deflate_impl(const std::string &name, bool shuffle, int level) const {
+  (void) name;
+  (void) shuffle;
+  (void) level;
+  // the default implementation does nothing: only NetCDF-4 supports compression
+}
+
 
 void NCFile::open(const std::string &filename, IO_Mode mode) {
+  NetCDFLock lock(netcdf_mutex());
   this->open_impl(filename, mode);
   m_filename = filename;
   m_define_mode = false;
 }
 
 void NCFile::create(const std::string &filename) {
+  NetCDFLock lock(netcdf_mutex());
   this->create_impl(filename);
   m_filename = filename;
   m_define_mode = true;
 }
 
 void NCFile::sync() const {
+  NetCDFLock lock(netcdf_mutex());
   enddef();
   this->sync_impl();
 }
 
 void NCFile::close() {
+  NetCDFLock lock(netcdf_mutex());
   this->close_impl();
   m_filename.clear();
   m_file_id = -1;
 }
 
 void NCFile::enddef() const {
+  NetCDFLock lock(netcdf_mutex());
   if (m_define_mode) {
     this->enddef_impl();
     m_define_mode = false;
@@ -84,6 +200,7 @@ void NCFile::enddef() const {
 }
 
 void NCFile::redef() const {
+  NetCDFLock lock(netcdf_mutex());
   if (not m_define_mode) {
     this->redef_impl();
     m_define_mode = true;
@@ -91,38 +208,52 @@ void NCFile::redef() const {
 }
 
 void NCFile::def_dim(const std::string &name, size_t length) const {
+  NetCDFLock lock(netcdf_mutex());
   redef();
   this->def_dim_impl(name, length);
 }
 
 void NCFile::inq_dimid(const std::string &dimension_name, bool &exists) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_dimid_impl(dimension_name,exists);
 }
 
 void NCFile::inq_dimlen(const std::string &dimension_name, unsigned int &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_dimlen_impl(dimension_name,result);
 }
 
 void NCFile::inq_unlimdim(std::string &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_unlimdim_impl(result);
 }
 
 void NCFile::def_var(const std::string &name, IO_Type nctype,
                     const std::vector<std::string> &dims) const {
+  NetCDFLock lock(netcdf_mutex());
   redef();
   this->def_var_impl(name, nctype, dims);
 }
 
 void NCFile::def_var_chunking(const std::string &name,
                               std::vector<size_t> &dimensions) const {
+  NetCDFLock lock(netcdf_mutex());
   this->def_var_chunking_impl(name, dimensions);
 }
 
+//! Set compression parameters of a variable. `level == 0` disables compression.
+void NCFile::def_var_deflate(const std::string &name, bool shuffle, int level) const {
+  NetCDFLock lock(netcdf_mutex());
+  redef();
+  this->def_var_deflate_impl(name, shuffle, level);
+}
+
 
 void NCFile::get_vara_double(const std::string &variable_name,
                             const std::vector<unsigned int> &start,
                             const std::vector<unsigned int> &count,
                             double *ip) const {
+  NetCDFLock lock(netcdf_mutex());
 #if (Pism_DEBUG==1)
   if (start.size() != count.size()) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
@@ -138,6 +269,7 @@ void NCFile::put_vara_double(const std::string &variable_name,
                             const std::vector<unsigned int> &start,
                             const std::vector<unsigned int> &count,
                             const double *op) const {
+  NetCDFLock lock(netcdf_mutex());
 #if (Pism_DEBUG==1)
   if (start.size() != count.size()) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
@@ -155,6 +287,7 @@ void NCFile::write_darray(const std::string &variable_name,
                           unsigned int z_count,
                           unsigned int record,
                           const double *input) {
+  NetCDFLock lock(netcdf_mutex());
   enddef();
   this->write_darray_impl(variable_name, grid, z_count, record, input);
 }
@@ -204,6 +337,7 @@ void NCFile::get_varm_double(const std::string &variable_name,
                             const std::vector<unsigned int> &count,
                             const std::vector<unsigned int> &imap,
                             double *ip) const {
+  NetCDFLock lock(netcdf_mutex());
 
 #if (Pism_DEBUG==1)
   if (start.size() != count.size() or
@@ -217,35 +351,65 @@ void NCFile::get_varm_double(const std::string &variable_name,
   this->get_varm_double_impl(variable_name, start, count, imap, ip);
 }
 
+/*!
+ * The default implementation reads the hyperslab in the storage order used in the file
+ * (using one contiguous, collective get_vara_double() call) and transposes it in memory.
+ *
+ * This is much faster than nc_get_varm_double(), which maps one element at a time.
+ */
+void NCFile::get_varm_double_impl(const std::string &variable_name,
+                                  const std::vector<unsigned int> &start,
+                                  const std::vector<unsigned int> &count,
+                                  const std::vector<unsigned int> &imap,
+                                  double *ip) const {
+  size_t size = 1;
+  for (auto c : count) {
+    size *= c;
+  }
+
+  std::vector<double> buffer(size);
+
+  this->get_vara_double_impl(variable_name, start, count, buffer.data());
+
+  transpose(count, imap, buffer.data(), ip);
+}
+
 void NCFile::inq_nvars(int &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_nvars_impl(result);
 }
 
 void NCFile::inq_vardimid(const std::string &variable_name, std::vector<std::string> &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_vardimid_impl(variable_name, result);
 }
 
 void NCFile::inq_varnatts(const std::string &variable_name, int &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_varnatts_impl(variable_name, result);
 }
 
 void NCFile::inq_varid(const std::string &variable_name, bool &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_varid_impl(variable_name, result);
 }
 
 void NCFile::inq_varname(unsigned int j, std::string &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_varname_impl(j, result);
 }
 
 void NCFile::get_att_double(const std::string &variable_name,
                             const std::string &att_name,
                             std::vector<double> &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->get_att_double_impl(variable_name, att_name, result);
 }
 
 void NCFile::get_att_text(const std::string &variable_name,
                           const std::string &att_name,
                           std::string &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->get_att_text_impl(variable_name, att_name, result);
 }
 
@@ -253,33 +417,39 @@ void NCFile::put_att_double(const std::string &variable_name,
                             const std::string &att_name,
                             IO_Type xtype,
                             const std::vector<double> &data) const {
+  NetCDFLock lock(netcdf_mutex());
   this->put_att_double_impl(variable_name, att_name, xtype, data);
 }
 
 void NCFile::put_att_text(const std::string &variable_name,
                           const std::string &att_name,
                           const std::string &value) const {
+  NetCDFLock lock(netcdf_mutex());
   this->put_att_text_impl(variable_name, att_name, value);
 }
 
 void NCFile::inq_attname(const std::string &variable_name,
                          unsigned int n,
                          std::string &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_attname_impl(variable_name, n, result);
 }
 
 void NCFile::inq_atttype(const std::string &variable_name,
                          const std::string &att_name,
                          IO_Type &result) const {
+  NetCDFLock lock(netcdf_mutex());
   this->inq_atttype_impl(variable_name, att_name, result);
 }
 
 void NCFile::set_fill(int fillmode, int &old_modep) const {
+  NetCDFLock lock(netcdf_mutex());
   redef();
   this->set_fill_impl(fillmode, old_modep);
 }
 
 void NCFile::del_att(const std::string &variable_name, const std::string &att_name) const {
+  NetCDFLock lock(netcdf_mutex());
   this->del_att_impl(variable_name, att_name);
 }
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 #define _PISMNCWRAPPER_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -34,6 +35,13 @@ class IceGrid;
 //! Input and output code (NetCDF wrappers, etc)
 namespace io {
 
+//! Serializes calls to the NetCDF library made by different threads.
+std::recursive_mutex& netcdf_mutex();
+
+void transpose(const std::vector<unsigned int> &count,
+               const std::vector<unsigned int> &imap,
+               const double *input, double *output);
+
 //! \brief The PISM wrapper for a subset of the NetCDF C API.
 /*!
  * The goal of this class is to hide the fact that we need to communicate data
@@ -90,6 +98,8 @@ public:
 
   void def_var_chunking(const std::string &name, std::vector<size_t> &dimensions) const;
 
+  void def_var_deflate(const std::string &name, bool shuffle, int level) const;
+
   void get_vara_double(const std::string &variable_name,
                        const std::vector<unsigned int> &start,
                        const std::vector<unsigned int> &count,
@@ -176,6 +186,8 @@ protected:
   virtual void def_var_chunking_impl(const std::string &name,
                                     std::vector<size_t> &dimensions) const;
 
+  virtual void def_var_deflate_impl(const std::string &name, bool shuffle, int level) const;
+
   virtual void get_vara_double_impl(const std::string &variable_name,
                                    const std::vector<unsigned int> &start,
                                    const std::vector<unsigned int> &count,
@@ -196,7 +208,7 @@ protected:
                                    const std::vector<unsigned int> &start,
                                    const std::vector<unsigned int> &count,
                                    const std::vector<unsigned int> &imap,
-                                   double *ip) const = 0;
+                                   double *ip) const;
 
   virtual void inq_nvars_impl(int &result) const = 0;
 
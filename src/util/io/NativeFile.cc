@@ -0,0 +1,1131 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::min, std::max, std::fill
+#include <climits>              // INT_MAX
+#include <cstdint>
+#include <cstdio>               // fopen, fread, fclose, fprintf
+#include <cstring>              // memcpy, memcmp
+
+#include "NativeFile.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+//! The "magic" string at the beginning of every native file.
+static const char native_magic[8] = {'P', 'I', 'S', 'M', 'C', 'K', 'P', 'T'};
+
+static const uint64_t native_version = 1;
+
+//! Size of the preamble: magic, version, header offset, header size, header checksum.
+static const uint64_t preamble_size = sizeof(native_magic) + 4 * sizeof(uint64_t);
+
+//! The default fill value used by NetCDF for doubles.
+static const double default_fill_value = 9.9692099683868690e+36;
+
+static void check(const ErrorLocation &where, int return_code) {
+  if (return_code != MPI_SUCCESS) {
+    char message[MPI_MAX_ERROR_STRING];
+    int length = 0;
+    MPI_Error_string(return_code, message, &length);
+    throw RuntimeError(where, message);
+  }
+}
+
+/*!
+ * Fletcher-64 checksum of `n_bytes` bytes in `data` (using 32-bit words).
+ *
+ * The last word is padded with zeros if `n_bytes` is not a multiple of 4.
+ */
+static uint64_t fletcher64(const void *data, size_t n_bytes) {
+  const uint64_t modulus = 0xFFFFFFFFULL;
+  // Sums of up to this many words fit in 64 bits, so we can postpone computing remainders.
+  const size_t block_size = 65536;
+
+  const unsigned char *bytes = static_cast<const unsigned char*>(data);
+  const size_t n_words = (n_bytes + 3) / 4;
+
+  uint64_t a = 0, b = 0;
+  size_t k = 0;
+  while (k < n_words) {
+    const size_t block_end = std::min(n_words, k + block_size);
+    for (; k < block_end; ++k) {
+      uint32_t word = 0;
+      memcpy(&word, bytes + 4 * k, std::min<size_t>(4, n_bytes - 4 * k));
+      a += word;
+      b += a;
+    }
+    a %= modulus;
+    b %= modulus;
+  }
+
+  return (b << 32) | a;
+}
+
+struct Attribute {
+  std::string name;
+  IO_Type type;
+  std::vector<double> numbers;
+  std::string text;
+};
+
+//! A hyperslab of a variable written by one rank.
+struct Chunk {
+  std::vector<unsigned int> start;
+  std::vector<unsigned int> count;
+  //! location of data in the file, in bytes
+  uint64_t offset;
+  uint64_t checksum;
+};
+
+struct Variable {
+  std::string name;
+  IO_Type type;
+  std::vector<std::string> dimensions;
+  std::vector<Attribute> attributes;
+  //! chunks in the order they were written (later chunks replace earlier ones)
+  std::vector<Chunk> chunks;
+};
+
+struct Dimension {
+  std::string name;
+  size_t length;
+  bool unlimited;
+};
+
+//! Number of values in a hyperslab.
+static size_t hyperslab_size(const unsigned int *count, size_t ndims) {
+  size_t result = 1;
+  for (size_t k = 0; k < ndims; ++k) {
+    result *= count[k];
+  }
+  return result;
+}
+
+//! Serializes the header of a native file.
+class HeaderBuffer {
+public:
+  HeaderBuffer()
+    : m_position(0) {
+    // empty
+  }
+
+  std::vector<char> data;
+
+  void put(uint64_t value) {
+    const char *p = reinterpret_cast<const char*>(&value);
+    data.insert(data.end(), p, p + sizeof(value));
+  }
+
+  void put(double value) {
+    const char *p = reinterpret_cast<const char*>(&value);
+    data.insert(data.end(), p, p + sizeof(value));
+  }
+
+  void put(const std::string &value) {
+    put(static_cast<uint64_t>(value.size()));
+    data.insert(data.end(), value.begin(), value.end());
+  }
+
+  uint64_t get_integer() {
+    uint64_t result = 0;
+    get(&result, sizeof(result));
+    return result;
+  }
+
+  double get_double() {
+    double result = 0.0;
+    get(&result, sizeof(result));
+    return result;
+  }
+
+  std::string get_string() {
+    return get_string_of_size(get_integer());
+  }
+
+  std::string get_string_of_size(uint64_t size) {
+    if (size > data.size() - m_position) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "the header of a native file is corrupted");
+    }
+    std::string result(&data[m_position], size);
+    m_position += size;
+    return result;
+  }
+private:
+  void get(void *output, size_t size) {
+    if (size > data.size() - m_position) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "the header of a native file is corrupted");
+    }
+    memcpy(output, &data[m_position], size);
+    m_position += size;
+  }
+
+  size_t m_position;
+};
+
+static void put_attributes(HeaderBuffer &buffer, const std::vector<Attribute> &attributes) {
+  buffer.put(static_cast<uint64_t>(attributes.size()));
+  for (const auto &a : attributes) {
+    buffer.put(a.name);
+    buffer.put(static_cast<uint64_t>(a.type));
+    if (a.type == PISM_CHAR) {
+      buffer.put(a.text);
+    } else {
+      buffer.put(static_cast<uint64_t>(a.numbers.size()));
+      for (auto x : a.numbers) {
+        buffer.put(x);
+      }
+    }
+  }
+}
+
+static std::vector<Attribute> get_attributes(HeaderBuffer &buffer) {
+  std::vector<Attribute> result(buffer.get_integer());
+  for (auto &a : result) {
+    a.name = buffer.get_string();
+    a.type = static_cast<IO_Type>(buffer.get_integer());
+    if (a.type == PISM_CHAR) {
+      a.text = buffer.get_string();
+    } else {
+      a.numbers.resize(buffer.get_integer());
+      for (auto &x : a.numbers) {
+        x = buffer.get_double();
+      }
+    }
+  }
+  return result;
+}
+
+struct NativeFile::Impl {
+  MPI_Comm com;
+  MPI_File file;
+  bool is_open;
+  bool writable;
+  //! true if the header has to be written
+  bool modified;
+  int rank;
+  int size;
+  int fill_mode;
+  //! offset of the end of the data (the header is written here)
+  uint64_t end;
+
+  std::vector<Dimension> dimensions;
+  std::vector<Variable> variables;
+  //! global attributes
+  Variable global;
+
+  void reset();
+
+  Dimension* find_dimension(const std::string &name);
+  Variable* find_variable(const std::string &name);
+  Variable& variable(const std::string &name);
+
+  void write_header();
+  void read_header();
+
+  void read(const Variable &variable,
+            const std::vector<unsigned int> &start,
+            const std::vector<unsigned int> &count,
+            double *output);
+};
+
+void NativeFile::Impl::reset() {
+  dimensions.clear();
+  variables.clear();
+  global = Variable();
+  global.name = "PISM_GLOBAL";
+  global.type = PISM_NAT;
+  end = preamble_size;
+  modified = false;
+  writable = false;
+  fill_mode = PISM_FILL;
+}
+
+Dimension* NativeFile::Impl::find_dimension(const std::string &name) {
+  for (auto &d : dimensions) {
+    if (d.name == name) {
+      return &d;
+    }
+  }
+  return nullptr;
+}
+
+Variable* NativeFile::Impl::find_variable(const std::string &name) {
+  if (name == "PISM_GLOBAL") {
+    return &global;
+  }
+
+  for (auto &v : variables) {
+    if (v.name == name) {
+      return &v;
+    }
+  }
+  return nullptr;
+}
+
+Variable& NativeFile::Impl::variable(const std::string &name) {
+  Variable *result = find_variable(name);
+  if (result == nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "variable '%s' not found", name.c_str());
+  }
+  return *result;
+}
+
+/*!
+ * Write the header at the end of the data and update the preamble.
+ *
+ * This is a collective operation.
+ */
+void NativeFile::Impl::write_header() {
+  if (not writable or not modified) {
+    return;
+  }
+
+  uint64_t header_size = 0;
+  int stat = MPI_SUCCESS;
+
+  if (rank == 0) {
+    HeaderBuffer header;
+
+    header.put(static_cast<uint64_t>(dimensions.size()));
+    for (const auto &d : dimensions) {
+      header.put(d.name);
+      header.put(static_cast<uint64_t>(d.length));
+      header.put(static_cast<uint64_t>(d.unlimited));
+    }
+
+    put_attributes(header, global.attributes);
+
+    header.put(static_cast<uint64_t>(variables.size()));
+    for (const auto &v : variables) {
+      header.put(v.name);
+      header.put(static_cast<uint64_t>(v.type));
+
+      header.put(static_cast<uint64_t>(v.dimensions.size()));
+      for (const auto &d : v.dimensions) {
+        header.put(d);
+      }
+
+      put_attributes(header, v.attributes);
+
+      header.put(static_cast<uint64_t>(v.chunks.size()));
+      for (const auto &c : v.chunks) {
+        for (auto s : c.start) {
+          header.put(static_cast<uint64_t>(s));
+        }
+        for (auto s : c.count) {
+          header.put(static_cast<uint64_t>(s));
+        }
+        header.put(c.offset);
+        header.put(c.checksum);
+      }
+    }
+
+    header_size = header.data.size();
+
+    HeaderBuffer preamble;
+    preamble.data.assign(native_magic, native_magic + sizeof(native_magic));
+    preamble.put(native_version);
+    preamble.put(end);
+    preamble.put(header_size);
+    preamble.put(fletcher64(header.data.data(), header_size));
+
+    if (header_size > INT_MAX) {
+      stat = MPI_ERR_COUNT;
+    }
+
+    MPI_Status status;
+    if (stat == MPI_SUCCESS) {
+      stat = MPI_File_write_at(file, end, header.data.data(), static_cast<int>(header_size),
+                               MPI_CHAR, &status);
+    }
+    if (stat == MPI_SUCCESS) {
+      stat = MPI_File_write_at(file, 0, preamble.data.data(),
+                               static_cast<int>(preamble.data.size()), MPI_CHAR, &status);
+    }
+  }
+
+  MPI_Bcast(&stat, 1, MPI_INT, 0, com);
+  check(PISM_ERROR_LOCATION, stat);
+
+  MPI_Bcast(&header_size, 1, MPI_UINT64_T, 0, com);
+
+  // discard the rest of the old header (if any)
+  stat = MPI_File_set_size(file, end + header_size);
+  check(PISM_ERROR_LOCATION, stat);
+
+  modified = false;
+}
+
+/*!
+ * Read the preamble and the header.
+ *
+ * This is a collective operation.
+ */
+void NativeFile::Impl::read_header() {
+  // 0: success, 1: not a native file, 2: unsupported version, 3: corrupted header, 4: I/O error
+  int stat = 0;
+  uint64_t version = 0, header_offset = 0, header_size = 0;
+  HeaderBuffer header;
+
+  if (rank == 0) {
+    HeaderBuffer preamble;
+    preamble.data.resize(preamble_size);
+
+    MPI_Status status;
+    int count = 0;
+    int mpi_stat = MPI_File_read_at(file, 0, preamble.data.data(), preamble_size, MPI_CHAR,
+                                    &status);
+    if (mpi_stat == MPI_SUCCESS) {
+      MPI_Get_count(&status, MPI_CHAR, &count);
+    }
+
+    if (mpi_stat != MPI_SUCCESS) {
+      stat = 4;
+    } else if (count != static_cast<int>(preamble_size) or
+               memcmp(preamble.data.data(), native_magic, sizeof(native_magic)) != 0) {
+      stat = 1;
+    } else {
+      preamble.get_string_of_size(sizeof(native_magic));
+      version            = preamble.get_integer();
+      header_offset      = preamble.get_integer();
+      header_size        = preamble.get_integer();
+      uint64_t checksum  = preamble.get_integer();
+
+      if (version != native_version) {
+        stat = 2;
+      } else if (header_size > INT_MAX) {
+        stat = 3;
+      } else {
+        header.data.resize(header_size);
+        mpi_stat = MPI_File_read_at(file, header_offset, header.data.data(),
+                                    static_cast<int>(header_size), MPI_CHAR, &status);
+        if (mpi_stat != MPI_SUCCESS) {
+          stat = 4;
+        } else if (fletcher64(header.data.data(), header_size) != checksum) {
+          stat = 3;
+        }
+      }
+    }
+  }
+
+  MPI_Bcast(&stat, 1, MPI_INT, 0, com);
+  switch (stat) {
+  case 0:
+    break;
+  case 1:
+    throw RuntimeError(PISM_ERROR_LOCATION, "not a PISM native file");
+  case 2:
+    MPI_Bcast(&version, 1, MPI_UINT64_T, 0, com);
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "unsupported native file format version: %d (expected %d)",
+                                  (int)version, (int)native_version);
+  case 3:
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "the header of a native file is corrupted (checksum mismatch)");
+  default:
+    throw RuntimeError(PISM_ERROR_LOCATION, "failed to read the header of a native file");
+  }
+
+  MPI_Bcast(&header_offset, 1, MPI_UINT64_T, 0, com);
+  MPI_Bcast(&header_size, 1, MPI_UINT64_T, 0, com);
+
+  header.data.resize(header_size);
+  MPI_Bcast(header.data.data(), static_cast<int>(header_size), MPI_CHAR, 0, com);
+
+  reset();
+
+  dimensions.resize(header.get_integer());
+  for (auto &d : dimensions) {
+    d.name      = header.get_string();
+    d.length    = header.get_integer();
+    d.unlimited = header.get_integer() != 0;
+  }
+
+  global.attributes = get_attributes(header);
+
+  variables.resize(header.get_integer());
+  for (auto &v : variables) {
+    v.name = header.get_string();
+    v.type = static_cast<IO_Type>(header.get_integer());
+
+    v.dimensions.resize(header.get_integer());
+    for (auto &d : v.dimensions) {
+      d = header.get_string();
+    }
+
+    v.attributes = get_attributes(header);
+
+    const size_t ndims = v.dimensions.size();
+    v.chunks.resize(header.get_integer());
+    for (auto &c : v.chunks) {
+      c.start.resize(ndims);
+      c.count.resize(ndims);
+      for (auto &s : c.start) {
+        s = header.get_integer();
+      }
+      for (auto &s : c.count) {
+        s = header.get_integer();
+      }
+      c.offset   = header.get_integer();
+      c.checksum = header.get_integer();
+    }
+  }
+
+  // new data will overwrite the header
+  end = header_offset;
+}
+
+//! Copy the part of `chunk` (stored in `data`) that intersects `start, count` to `output`.
+static void copy_intersection(const Chunk &chunk, const double *data,
+                              const std::vector<unsigned int> &start,
+                              const std::vector<unsigned int> &count,
+                              double *output) {
+  const int ndims = static_cast<int>(start.size());
+
+  if (ndims == 0) {
+    output[0] = data[0];
+    return;
+  }
+
+  std::vector<unsigned int> lo(ndims), hi(ndims);
+  for (int k = 0; k < ndims; ++k) {
+    lo[k] = std::max(chunk.start[k], start[k]);
+    hi[k] = std::min(chunk.start[k] + chunk.count[k], start[k] + count[k]);
+    if (lo[k] >= hi[k]) {
+      // no intersection
+      return;
+    }
+  }
+
+  // copy contiguous runs along the last dimension
+  const int last = ndims - 1;
+  const size_t run = hi[last] - lo[last];
+
+  std::vector<unsigned int> i = lo;
+  while (true) {
+    size_t source = 0, destination = 0;
+    for (int k = 0; k < ndims; ++k) {
+      source      = source * chunk.count[k] + (i[k] - chunk.start[k]);
+      destination = destination * count[k] + (i[k] - start[k]);
+    }
+    std::copy(data + source, data + source + run, output + destination);
+
+    // move to the next run
+    int k = last - 1;
+    for (; k >= 0; --k) {
+      if (++i[k] < hi[k]) {
+        break;
+      }
+      i[k] = lo[k];
+    }
+    if (k < 0) {
+      break;
+    }
+  }
+}
+
+//! Returns true if `chunk` contains the hyperslab `start, count`.
+static bool contains(const Chunk &chunk,
+                     const std::vector<unsigned int> &start,
+                     const std::vector<unsigned int> &count) {
+  for (size_t k = 0; k < start.size(); ++k) {
+    if (start[k] < chunk.start[k] or
+        start[k] + count[k] > chunk.start[k] + chunk.count[k]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * Read the hyperslab `start, count` of `variable` into `output`.
+ *
+ * This is *not* a collective operation.
+ */
+void NativeFile::Impl::read(const Variable &variable,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            double *output) {
+  const size_t ndims = start.size();
+  const size_t size = hyperslab_size(count.data(), ndims);
+
+  if (size == 0) {
+    return;
+  }
+
+  // Find the last chunk containing the whole hyperslab: earlier chunks are not needed.
+  size_t first = 0;
+  bool covered = false;
+  for (size_t c = variable.chunks.size(); c-- > 0;) {
+    if (contains(variable.chunks[c], start, count)) {
+      first   = c;
+      covered = true;
+      break;
+    }
+  }
+
+  if (not covered) {
+    std::fill(output, output + size, default_fill_value);
+  }
+
+  std::vector<double> buffer;
+  for (size_t c = first; c < variable.chunks.size(); ++c) {
+    const Chunk &chunk = variable.chunks[c];
+
+    bool intersects = true;
+    for (size_t k = 0; k < ndims; ++k) {
+      if (chunk.start[k] >= start[k] + count[k] or
+          start[k] >= chunk.start[k] + chunk.count[k]) {
+        intersects = false;
+        break;
+      }
+    }
+    if (not intersects) {
+      continue;
+    }
+
+    const size_t chunk_size = hyperslab_size(chunk.count.data(), ndims);
+    if (chunk_size > INT_MAX) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "a chunk of '%s' is too big", variable.name.c_str());
+    }
+
+    // read directly into `output` if the chunk matches the hyperslab exactly (the same
+    // domain decomposition)
+    const bool exact = chunk.start == start and chunk.count == count;
+    double *data = output;
+    if (not exact) {
+      buffer.resize(chunk_size);
+      data = buffer.data();
+    }
+
+    MPI_Status status;
+    int stat = MPI_File_read_at(file, chunk.offset, data, static_cast<int>(chunk_size),
+                                MPI_DOUBLE, &status);
+    check(PISM_ERROR_LOCATION, stat);
+
+    if (fletcher64(data, chunk_size * sizeof(double)) != chunk.checksum) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "checksum mismatch while reading '%s' (the file is corrupted)",
+                                    variable.name.c_str());
+    }
+
+    if (not exact) {
+      copy_intersection(chunk, data, start, count, output);
+    }
+  }
+}
+
+/*!
+ * Remove trailing elements of `start` and `count` that do not correspond to dimensions
+ * of `variable`.
+ *
+ * (PISM uses 4 elements when writing 2D fields.)
+ */
+static void trim(const Variable &variable,
+                 const std::vector<unsigned int> &start,
+                 const std::vector<unsigned int> &count,
+                 std::vector<unsigned int> &start_result,
+                 std::vector<unsigned int> &count_result) {
+  const size_t ndims = variable.dimensions.size();
+
+  if (start.size() < ndims or count.size() < ndims) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "'%s' has %d dimensions, got start and count with %d and %d elements",
+                                  variable.name.c_str(), (int)ndims,
+                                  (int)start.size(), (int)count.size());
+  }
+
+  start_result.assign(start.begin(), start.begin() + ndims);
+  count_result.assign(count.begin(), count.begin() + ndims);
+}
+
+NativeFile::NativeFile(MPI_Comm com)
+  : NCFile(com), m_impl(new Impl) {
+  m_impl->com     = com;
+  m_impl->file    = MPI_FILE_NULL;
+  m_impl->is_open = false;
+  m_impl->rank    = 0;
+  m_impl->size    = 1;
+  m_impl->reset();
+
+  MPI_Comm_rank(com, &m_impl->rank);
+  MPI_Comm_size(com, &m_impl->size);
+}
+
+NativeFile::~NativeFile() {
+  if (m_impl->is_open) {
+    MPI_File_close(&m_impl->file);
+    if (m_impl->rank == 0) {
+      fprintf(stderr, "NativeFile::~NativeFile: file %s is still open\n",
+              m_filename.c_str());
+    }
+  }
+  delete m_impl;
+}
+
+//! Returns true if `filename` is a PISM native file. Returns false if it does not exist.
+bool NativeFile::is_native(MPI_Comm com, const std::string &filename) {
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  int result = 0;
+  if (rank == 0) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (f != nullptr) {
+      char buffer[sizeof(native_magic)];
+      if (fread(buffer, 1, sizeof(buffer), f) == sizeof(buffer) and
+          memcmp(buffer, native_magic, sizeof(native_magic)) == 0) {
+        result = 1;
+      }
+      fclose(f);
+    }
+  }
+  MPI_Bcast(&result, 1, MPI_INT, 0, com);
+
+  return result == 1;
+}
+
+void NativeFile::open_impl(const std::string &filename, IO_Mode mode) {
+  int access_mode = mode == PISM_READONLY ? MPI_MODE_RDONLY : MPI_MODE_RDWR;
+
+  int stat = MPI_File_open(m_com, filename.c_str(), access_mode, MPI_INFO_NULL,
+                           &m_impl->file);
+  check(PISM_ERROR_LOCATION, stat);
+  m_impl->is_open = true;
+  m_file_id = 0;
+
+  try {
+    m_impl->read_header();
+  } catch (...) {
+    MPI_File_close(&m_impl->file);
+    m_impl->is_open = false;
+    m_file_id = -1;
+    throw;
+  }
+
+  m_impl->writable = mode != PISM_READONLY;
+}
+
+void NativeFile::create_impl(const std::string &filename) {
+  int stat = MPI_File_open(m_com, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_RDWR,
+                           MPI_INFO_NULL, &m_impl->file);
+  check(PISM_ERROR_LOCATION, stat);
+  m_impl->is_open = true;
+  m_file_id = 0;
+
+  stat = MPI_File_set_size(m_impl->file, 0);
+  check(PISM_ERROR_LOCATION, stat);
+
+  m_impl->reset();
+  m_impl->writable = true;
+  m_impl->modified = true;
+}
+
+void NativeFile::sync_impl() const {
+  m_impl->write_header();
+
+  int stat = MPI_File_sync(m_impl->file);
+  check(PISM_ERROR_LOCATION, stat);
+}
+
+void NativeFile::close_impl() {
+  if (not m_impl->is_open) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "file is not open");
+  }
+
+  try {
+    m_impl->write_header();
+  } catch (...) {
+    MPI_File_close(&m_impl->file);
+    m_impl->is_open = false;
+    throw;
+  }
+
+  int stat = MPI_File_close(&m_impl->file);
+  m_impl->is_open = false;
+  m_impl->reset();
+  check(PISM_ERROR_LOCATION, stat);
+}
+
+void NativeFile::enddef_impl() const {
+  // empty: native files do not have "define mode"
+}
+
+void NativeFile::redef_impl() const {
+  // empty: native files do not have "define mode"
+}
+
+void NativeFile::def_dim_impl(const std::string &name, size_t length) const {
+  if (m_impl->find_dimension(name) != nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "dimension '%s' already exists", name.c_str());
+  }
+
+  Dimension d;
+  d.name      = name;
+  d.unlimited = length == PISM_UNLIMITED;
+  d.length    = d.unlimited ? 0 : length;
+
+  m_impl->dimensions.push_back(d);
+  m_impl->modified = true;
+}
+
+void NativeFile::inq_dimid_impl(const std::string &dimension_name, bool &exists) const {
+  exists = m_impl->find_dimension(dimension_name) != nullptr;
+}
+
+void NativeFile::inq_dimlen_impl(const std::string &dimension_name, unsigned int &result) const {
+  Dimension *d = m_impl->find_dimension(dimension_name);
+  if (d == nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "dimension '%s' not found", dimension_name.c_str());
+  }
+  result = d->length;
+}
+
+void NativeFile::inq_unlimdim_impl(std::string &result) const {
+  result.clear();
+  for (const auto &d : m_impl->dimensions) {
+    if (d.unlimited) {
+      result = d.name;
+      return;
+    }
+  }
+}
+
+void NativeFile::def_var_impl(const std::string &name, IO_Type nctype,
+                              const std::vector<std::string> &dims) const {
+  if (m_impl->find_variable(name) != nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "variable '%s' already exists", name.c_str());
+  }
+
+  for (const auto &d : dims) {
+    if (m_impl->find_dimension(d) == nullptr) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "dimension '%s' not found", d.c_str());
+    }
+  }
+
+  Variable v;
+  v.name       = name;
+  v.type       = nctype;
+  v.dimensions = dims;
+
+  m_impl->variables.push_back(v);
+  m_impl->modified = true;
+}
+
+void NativeFile::get_vara_double_impl(const std::string &variable_name,
+                                      const std::vector<unsigned int> &start_input,
+                                      const std::vector<unsigned int> &count_input,
+                                      double *ip) const {
+  const Variable &variable = m_impl->variable(variable_name);
+
+  std::vector<unsigned int> start, count;
+  trim(variable, start_input, count_input, start, count);
+
+  ParallelSection loop(m_com);
+  try {
+    m_impl->read(variable, start, count, ip);
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+}
+
+/*!
+ * Write a hyperslab. Each rank appends its part to the file as a separate chunk.
+ */
+void NativeFile::put_vara_double_impl(const std::string &variable_name,
+                                      const std::vector<unsigned int> &start_input,
+                                      const std::vector<unsigned int> &count_input,
+                                      const double *op) const {
+  Variable &variable = m_impl->variable(variable_name);
+
+  std::vector<unsigned int> start, count;
+  trim(variable, start_input, count_input, start, count);
+
+  const int ndims = static_cast<int>(start.size());
+  const int size = m_impl->size;
+
+  // gather hyperslabs of all ranks
+  std::vector<unsigned int> local(2 * ndims), all(2 * ndims * size);
+  std::copy(start.begin(), start.end(), local.begin());
+  std::copy(count.begin(), count.end(), local.begin() + ndims);
+
+  MPI_Allgather(local.data(), 2 * ndims, MPI_UNSIGNED,
+                all.data(), 2 * ndims, MPI_UNSIGNED, m_com);
+
+  // If all ranks write the same hyperslab (e.g. a time record), only rank 0 writes it.
+  bool replicated = true;
+  for (int r = 1; r < size; ++r) {
+    if (not std::equal(all.begin(), all.begin() + 2 * ndims, all.begin() + 2 * ndims * r)) {
+      replicated = false;
+      break;
+    }
+  }
+
+  std::vector<size_t> sizes(size, 0);
+  for (int r = 0; r < size; ++r) {
+    if (r == 0 or not replicated) {
+      sizes[r] = hyperslab_size(&all[2 * ndims * r + ndims], ndims);
+    }
+
+    if (sizes[r] > INT_MAX) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "a part of '%s' is too big to be written to a native file",
+                                    variable_name.c_str());
+    }
+  }
+
+  // offsets of chunks of all ranks
+  std::vector<uint64_t> offsets(size);
+  uint64_t offset = m_impl->end;
+  for (int r = 0; r < size; ++r) {
+    offsets[r] = offset;
+    offset += sizes[r] * sizeof(double);
+  }
+
+  const size_t local_size = sizes[m_impl->rank];
+
+  uint64_t checksum = fletcher64(op, local_size * sizeof(double));
+  std::vector<uint64_t> checksums(size);
+  MPI_Allgather(&checksum, 1, MPI_UINT64_T, checksums.data(), 1, MPI_UINT64_T, m_com);
+
+  MPI_Status status;
+  int stat = MPI_File_write_at_all(m_impl->file, offsets[m_impl->rank],
+                                   const_cast<double*>(op), static_cast<int>(local_size),
+                                   MPI_DOUBLE, &status);
+  check(PISM_ERROR_LOCATION, stat);
+
+  // record chunks
+  Dimension *time = nullptr;
+  if (ndims > 0) {
+    Dimension *d = m_impl->find_dimension(variable.dimensions[0]);
+    if (d->unlimited) {
+      time = d;
+    }
+  }
+
+  for (int r = 0; r < size; ++r) {
+    if (sizes[r] == 0) {
+      continue;
+    }
+
+    const unsigned int *s = &all[2 * ndims * r];
+
+    Chunk chunk;
+    chunk.start.assign(s, s + ndims);
+    chunk.count.assign(s + ndims, s + 2 * ndims);
+    chunk.offset   = offsets[r];
+    chunk.checksum = checksums[r];
+
+    variable.chunks.push_back(chunk);
+
+    if (time != nullptr) {
+      time->length = std::max(time->length, (size_t)(chunk.start[0] + chunk.count[0]));
+    }
+  }
+
+  m_impl->end = offset;
+  m_impl->modified = true;
+}
+
+void NativeFile::get_varm_double_impl(const std::string &variable_name,
+                                      const std::vector<unsigned int> &start_input,
+                                      const std::vector<unsigned int> &count_input,
+                                      const std::vector<unsigned int> &imap,
+                                      double *ip) const {
+  const Variable &variable = m_impl->variable(variable_name);
+
+  std::vector<unsigned int> start, count;
+  trim(variable, start_input, count_input, start, count);
+
+  const int ndims = static_cast<int>(start.size());
+  const size_t size = hyperslab_size(count.data(), ndims);
+
+  // read in the storage order used in the file...
+  std::vector<double> buffer(size);
+  {
+    ParallelSection loop(m_com);
+    try {
+      m_impl->read(variable, start, count, buffer.data());
+    } catch (...) {
+      loop.failed();
+    }
+    loop.check();
+  }
+
+  // ... and use `imap` to put values where they belong
+  transpose(count, imap, buffer.data(), ip);
+}
+
+void NativeFile::inq_nvars_impl(int &result) const {
+  result = static_cast<int>(m_impl->variables.size());
+}
+
+void NativeFile::inq_vardimid_impl(const std::string &variable_name,
+                                   std::vector<std::string> &result) const {
+  result = m_impl->variable(variable_name).dimensions;
+}
+
+void NativeFile::inq_varnatts_impl(const std::string &variable_name, int &result) const {
+  result = static_cast<int>(m_impl->variable(variable_name).attributes.size());
+}
+
+void NativeFile::inq_varid_impl(const std::string &variable_name, bool &exists) const {
+  exists = (variable_name != "PISM_GLOBAL" and
+            m_impl->find_variable(variable_name) != nullptr);
+}
+
+void NativeFile::inq_varname_impl(unsigned int j, std::string &result) const {
+  if (j >= m_impl->variables.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid variable index: %d", (int)j);
+  }
+  result = m_impl->variables[j].name;
+}
+
+//! Find an attribute. Returns nullptr if not found.
+static Attribute* find_attribute(Variable &variable, const std::string &name) {
+  for (auto &a : variable.attributes) {
+    if (a.name == name) {
+      return &a;
+    }
+  }
+  return nullptr;
+}
+
+//! Find an attribute or add a new one (keeping the order of existing attributes).
+static Attribute& get_or_add_attribute(Variable &variable, const std::string &name) {
+  Attribute *a = find_attribute(variable, name);
+  if (a != nullptr) {
+    return *a;
+  }
+
+  Attribute attribute;
+  attribute.name = name;
+  attribute.type = PISM_NAT;
+  variable.attributes.push_back(attribute);
+  return variable.attributes.back();
+}
+
+void NativeFile::get_att_double_impl(const std::string &variable_name,
+                                     const std::string &att_name,
+                                     std::vector<double> &result) const {
+  result.clear();
+
+  Variable *variable = m_impl->find_variable(variable_name);
+  if (variable == nullptr) {
+    return;
+  }
+
+  Attribute *a = find_attribute(*variable, att_name);
+  if (a == nullptr) {
+    return;
+  }
+
+  if (a->type == PISM_CHAR) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "attribute %s:%s is not a number",
+                                  variable_name.c_str(), att_name.c_str());
+  }
+
+  result = a->numbers;
+}
+
+void NativeFile::get_att_text_impl(const std::string &variable_name,
+                                   const std::string &att_name, std::string &result) const {
+  Attribute *a = find_attribute(m_impl->variable(variable_name), att_name);
+
+  if (a != nullptr and a->type == PISM_CHAR) {
+    result = a->text;
+  } else {
+    result.clear();
+  }
+}
+
+void NativeFile::put_att_double_impl(const std::string &variable_name,
+                                     const std::string &att_name,
+                                     IO_Type xtype, const std::vector<double> &data) const {
+  Attribute &a = get_or_add_attribute(m_impl->variable(variable_name), att_name);
+  a.type    = xtype;
+  a.numbers = data;
+  a.text.clear();
+
+  m_impl->modified = true;
+}
+
+void NativeFile::put_att_text_impl(const std::string &variable_name,
+                                   const std::string &att_name,
+                                   const std::string &value) const {
+  Attribute &a = get_or_add_attribute(m_impl->variable(variable_name), att_name);
+  a.type = PISM_CHAR;
+  a.text = value;
+  a.numbers.clear();
+
+  m_impl->modified = true;
+}
+
+void NativeFile::inq_attname_impl(const std::string &variable_name, unsigned int n,
+                                  std::string &result) const {
+  const Variable &variable = m_impl->variable(variable_name);
+
+  if (n >= variable.attributes.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid attribute index: %d", (int)n);
+  }
+
+  result = variable.attributes[n].name;
+}
+
+void NativeFile::inq_atttype_impl(const std::string &variable_name,
+                                  const std::string &att_name, IO_Type &result) const {
+  Attribute *a = find_attribute(m_impl->variable(variable_name), att_name);
+
+  result = a != nullptr ? a->type : PISM_NAT;
+}
+
+void NativeFile::set_fill_impl(int fillmode, int &old_modep) const {
+  old_modep = m_impl->fill_mode;
+  m_impl->fill_mode = fillmode;
+}
+
+void NativeFile::del_att_impl(const std::string &variable_name,
+                              const std::string &att_name) const {
+  Variable &variable = m_impl->variable(variable_name);
+
+  auto &attributes = variable.attributes;
+  for (auto a = attributes.begin(); a != attributes.end(); ++a) {
+    if (a->name == att_name) {
+      attributes.erase(a);
+      m_impl->modified = true;
+      return;
+    }
+  }
+
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "attribute %s:%s not found",
+                                variable_name.c_str(), att_name.c_str());
+}
+
+} // end of namespace io
+} // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -185,9 +185,34 @@ void ParallelIO::def_var_impl(const std::string &name, IO_Type nctype,
 
 void ParallelIO::def_var_chunking_impl(const std::string &name,
                                       std::vector<size_t> &dimensions) const {
-  (void) name;
-  (void) dimensions;
-  // FIXME
+  if (not (m_iotype == PIO_IOTYPE_NETCDF4P or m_iotype == PIO_IOTYPE_NETCDF4C)) {
+    // only NetCDF-4 files support chunking
+    return;
+  }
+
+  int stat = 0, varid = -1;
+
+  stat = PIOc_inq_varid(m_file_id, name.c_str(), &varid); check(PISM_ERROR_LOCATION, stat);
+
+  std::vector<PIO_Offset> chunks(dimensions.begin(), dimensions.end());
+
+  stat = PIOc_def_var_chunking(m_file_id, varid, NC_CHUNKED, chunks.data());
+  check(PISM_ERROR_LOCATION, stat);
+}
+
+void ParallelIO::def_var_deflate_impl(const std::string &name, bool shuffle, int level) const {
+  if (not (m_iotype == PIO_IOTYPE_NETCDF4P or m_iotype == PIO_IOTYPE_NETCDF4C) or
+      level == 0) {
+    // only NetCDF-4 files support compression
+    return;
+  }
+
+  int stat = 0, varid = -1;
+
+  stat = PIOc_inq_varid(m_file_id, name.c_str(), &varid); check(PISM_ERROR_LOCATION, stat);
+
+  stat = PIOc_def_var_deflate(m_file_id, varid, shuffle ? 1 : 0, 1, level);
+  check(PISM_ERROR_LOCATION, stat);
 }
 
 void ParallelIO::get_vara_double_impl(const std::string &variable_name,
@@ -286,20 +311,6 @@ void ParallelIO::write_darray_impl(const std::string &variable_name,
 }
 
 
-void ParallelIO::get_varm_double_impl(const std::string &variable_name,
-                                     const std::vector<unsigned int> &start,
-                                     const std::vector<unsigned int> &count,
-                                     const std::vector<unsigned int> &imap,
-                                     double *input) const {
-  (void) variable_name;
-  (void) start;
-  (void) count;
-  (void) imap;
-  (void) input;
-  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                "ParallelIO does not support transposed access");
-}
-
 void ParallelIO::inq_nvars_impl(int &result) const {
   int stat = PIOc_inq_nvars(m_file_id, &result); check(PISM_ERROR_LOCATION, stat);
 }
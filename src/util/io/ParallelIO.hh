@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -57,6 +57,8 @@ protected:
   void def_var_chunking_impl(const std::string &name,
                             std::vector<size_t> &dimensions) const;
 
+  void def_var_deflate_impl(const std::string &name, bool shuffle, int level) const;
+
   void get_vara_double_impl(const std::string &variable_name,
                            const std::vector<unsigned int> &start,
                            const std::vector<unsigned int> &count,
@@ -73,12 +75,6 @@ protected:
                          unsigned int record,
                          const double *input);
 
-  void get_varm_double_impl(const std::string &variable_name,
-                           const std::vector<unsigned int> &start,
-                           const std::vector<unsigned int> &count,
-                           const std::vector<unsigned int> &imap,
-                           double *ip) const;
-
   void inq_nvars_impl(int &result) const;
 
   void inq_vardimid_impl(const std::string &variable_name, std::vector<std::string> &result) const;
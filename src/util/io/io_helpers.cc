@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <cassert>
+#include <cstdlib>              // strtol
 
 #include "io_helpers.hh"
 #include "File.hh"
@@ -45,7 +46,7 @@ namespace io {
  * Note that its inputs are (essentially)
  * - the definition of the input grid
  * - the definition of the output grid
- * - input array (lic->buffer)
+ * - input array (`input_array`, one record read using `lic`)
  * - output array (double *output_array)
  *
  * The `output_array` is expected to be big enough to contain
@@ -55,14 +56,13 @@ namespace io {
  * fairly easily...
  */
 static void regrid(const IceGrid& grid, const std::vector<double> &zlevels_out,
-                   LocalInterpCtx *lic, double *output_array) {
+                   LocalInterpCtx *lic, const double *input_array, double *output_array) {
   // We'll work with the raw storage here so that the array we are filling is
   // indexed the same way as the buffer we are pulling from (input_array)
 
   const int X = 1, Z = 3; // indices, just for clarity
 
   unsigned int nlevels = zlevels_out.size();
-  double *input_array = &(lic->buffer[0]);
 
   // array sizes for mapping from logical to "flat" indices
   int
@@ -329,11 +329,9 @@ static void define_dimensions(const SpatialVariableMetadata& var,
 
 static void write_dimension_data(const File &file, const std::string &name,
                                  const std::vector<double> &data) {
-  bool written = file.attribute_type(name, "not_written") == PISM_NAT;
-  if (not written) {
+  if (not file.was_written(name)) {
     file.write_variable(name, {0}, {(unsigned int)data.size()}, data.data());
-    file.redef();
-    file.remove_attribute(name, "not_written");
+    file.mark_as_written(name);
   }
 }
 
@@ -441,7 +439,7 @@ static void read_distributed_array(const File &file, const IceGrid &grid,
 static void regrid_vec_generic(const File &file, const IceGrid &grid,
                                const std::string &variable_name,
                                const std::vector<double> &zlevels_out,
-                               unsigned int t_start,
+                               unsigned int t_start, unsigned int t_count,
                                bool fill_missing,
                                double default_value,
                                InterpolationType interpolation_type,
@@ -451,12 +449,30 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
   const Profiling& profiling = grid.ctx()->profiling();
 
   try {
-    grid_info gi(file, variable_name, grid.ctx()->unit_system(), grid.registration());
-    LocalInterpCtx lic(gi, grid, zlevels_out, interpolation_type);
-
-    std::vector<double> &buffer = lic.buffer;
+    std::shared_ptr<LocalInterpCtx> plan;
+    RegriddingCache *cache = file.regridding_cache();
+    if (cache != nullptr) {
+      plan = cache->plan(file, variable_name, grid, zlevels_out, interpolation_type);
+    } else {
+      grid_info gi(file, variable_name, grid.ctx()->unit_system(), grid.registration());
+      plan.reset(new LocalInterpCtx(gi, grid, zlevels_out, interpolation_type));
+    }
+    LocalInterpCtx &lic = *plan;
+
+    // Read all requested records in one call. The buffer in the plan holds one record, so
+    // use a temporary buffer if more than one record is needed.
+    //
+    // Note: lic.buffer may be bigger than one record (on rank 0 its size is the maximum
+    // over all ranks), so it cannot be used to compute the record size.
+    const size_t record_size = lic.count[X] * lic.count[Y] * lic.count[Z];
+    std::vector<double> records;
+    double *buffer = lic.buffer.data();
+    if (t_count > 1) {
+      records.resize(t_count * record_size);
+      buffer = records.data();
+    }
+    const size_t buffer_size = t_count * record_size;
 
-    const unsigned int t_count = 1;
     std::vector<unsigned int> start, count, imap;
     compute_start_and_count(file,
                             grid.ctx()->unit_system(),
@@ -470,9 +486,9 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
     bool transposed_io = use_transposed_io(file, grid.ctx()->unit_system(), variable_name);
     profiling.begin("io.regridding.read");
     if (transposed_io) {
-      file.read_variable_transposed(variable_name, start, count, imap, &buffer[0]);
+      file.read_variable_transposed(variable_name, start, count, imap, buffer);
     } else {
-      file.read_variable(variable_name, start, count, &buffer[0]);
+      file.read_variable(variable_name, start, count, buffer);
     }
     profiling.end("io.regridding.read");
 
@@ -483,7 +499,7 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
       if (attribute.size() == 1) {
         const double fill_value = attribute[0],
           epsilon = 1e-12;
-        for (unsigned int i = 0; i < buffer.size(); ++i) {
+        for (size_t i = 0; i < buffer_size; ++i) {
           if (fabs(buffer[i] - fill_value) < epsilon) {
             buffer[i] = default_value;
           }
@@ -493,7 +509,10 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
 
     // interpolate
     profiling.begin("io.regridding.interpolate");
-    regrid(grid, zlevels_out, &lic, output);
+    const size_t output_size = grid.xm() * grid.ym() * zlevels_out.size();
+    for (unsigned int k = 0; k < t_count; ++k) {
+      regrid(grid, zlevels_out, &lic, buffer + k * record_size, output + k * output_size);
+    }
     profiling.end("io.regridding.interpolate");
   } catch (RuntimeError &e) {
     e.add_context("reading variable '%s' (using linear interpolation) from '%s'",
@@ -506,13 +525,13 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
 //! interpolation to put it on the grid defined by "grid" and zlevels_out.
 static void regrid_vec(const File &file, const IceGrid &grid, const std::string &var_name,
                        const std::vector<double> &zlevels_out,
-                       unsigned int t_start,
+                       unsigned int t_start, unsigned int t_count,
                        InterpolationType interpolation_type,
                        double *output) {
   regrid_vec_generic(file, grid,
                      var_name,
                      zlevels_out,
-                     t_start,
+                     t_start, t_count,
                      false, 0.0,
                      interpolation_type,
                      output);
@@ -524,26 +543,168 @@ static void regrid_vec(const File &file, const IceGrid &grid, const std::string
  * @param grid computational grid; used to initialize interpolation
  * @param var_name variable to regrid
  * @param zlevels_out vertical levels of the resulting grid
- * @param t_start time index of the record to regrid
+ * @param t_start time index of the first record to regrid
+ * @param t_count number of records to regrid
  * @param default_value default value to replace `_FillValue` with
  * @param[out] output resulting interpolated field
  */
 static void regrid_vec_fill_missing(const File &file, const IceGrid &grid,
                                     const std::string &var_name,
                                     const std::vector<double> &zlevels_out,
-                                    unsigned int t_start,
+                                    unsigned int t_start, unsigned int t_count,
                                     double default_value,
                                     InterpolationType interpolation_type,
                                     double *output) {
   regrid_vec_generic(file, grid,
                      var_name,
                      zlevels_out,
-                     t_start,
+                     t_start, t_count,
                      true, default_value,
                      interpolation_type,
                      output);
 }
 
+/*!
+ * Look up the setting for `variable_name` in a comma-separated list of overrides
+ * ("name:value,name:value,...").
+ *
+ * Returns `default_value` if `variable_name` is not in the list.
+ */
+static std::string override_for(const std::string &overrides,
+                                const std::string &variable_name,
+                                const std::string &default_value) {
+  for (const auto &entry : split(overrides, ',')) {
+    auto words = split(entry, ':');
+    if (words.size() != 2) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "invalid override '%s' in '%s' (expected 'name:value')",
+                                    entry.c_str(), overrides.c_str());
+    }
+    if (words[0] == variable_name) {
+      return words[1];
+    }
+  }
+  return default_value;
+}
+
+/*!
+ * Chunk sizes of a spatial variable with dimensions ([time,] y, x[, z]) in a NetCDF-4
+ * file.
+ *
+ * A chunk always contains one record: PISM writes one record at a time and readers
+ * usually need one record at a time as well.
+ *
+ * - "decomposition": the largest sub-domain of the grid in the map plane and all
+ *   vertical levels. Each rank writes (almost) whole chunks of its own, so parallel
+ *   writes (especially compressed ones) do not have to update chunks shared by several
+ *   ranks.
+ * - "map": the whole map plane, one vertical level. This makes reading a map (or a
+ *   horizontal slice of a 3D field) for analysis or plotting fast.
+ * - "netcdf": let the NetCDF library choose. (Returns an empty vector.)
+ *
+ * Note: this is a collective operation.
+ */
+static std::vector<size_t> chunk_sizes(const std::string &policy,
+                                       const IceGrid &grid,
+                                       bool time_dependent,
+                                       unsigned int n_levels) {
+  std::vector<size_t> result;
+
+  size_t x = grid.Mx(), y = grid.My(), z = 1;
+
+  if (policy == "netcdf") {
+    return result;
+  } else if (policy == "decomposition") {
+    double patch[2] = {(double)grid.xm(), (double)grid.ym()}, max_patch[2];
+    GlobalMax(grid.com, patch, max_patch, 2);
+
+    x = static_cast<size_t>(max_patch[0]);
+    y = static_cast<size_t>(max_patch[1]);
+    z = n_levels;
+  } else if (policy == "map") {
+    // use defaults set above
+  } else {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid chunking policy: '%s'", policy.c_str());
+  }
+
+  if (time_dependent) {
+    result.push_back(1);
+  }
+
+  result.push_back(y);
+  result.push_back(x);
+
+  if (n_levels > 0) {
+    result.push_back(z);
+  }
+
+  return result;
+}
+
+/*!
+ * Set chunk sizes and compression parameters of a spatial variable in a NetCDF-4 file.
+ *
+ * Uses `output.netcdf4.chunking` and `output.netcdf4.compression_level` unless they are
+ * overridden for this variable by `output.netcdf4.chunking_overrides` and
+ * `output.netcdf4.compression_overrides`.
+ *
+ * Does nothing if `file` does not use a NetCDF-4 backend.
+ */
+static void define_storage(const SpatialVariableMetadata &var,
+                           const IceGrid &grid, const File &file,
+                           bool time_dependent, unsigned int n_levels) {
+  const IO_Backend backend = file.backend();
+  if (not (backend == PISM_NETCDF4_PARALLEL or
+           backend == PISM_PIO_NETCDF4C or
+           backend == PISM_PIO_NETCDF4P)) {
+    // chunking and compression are not supported: skip computing chunk sizes (a
+    // collective operation)
+    return;
+  }
+
+  const Config &config = *grid.ctx()->config();
+  const std::string name = var.get_name();
+
+  try {
+    std::string policy = override_for(config.get_string("output.netcdf4.chunking_overrides"),
+                                      name,
+                                      config.get_string("output.netcdf4.chunking"));
+
+    std::vector<size_t> chunks = chunk_sizes(policy, grid, time_dependent, n_levels);
+    if (not chunks.empty()) {
+      file.define_chunking(name, chunks);
+    }
+
+    int compression_level =
+      static_cast<int>(config.get_number("output.netcdf4.compression_level"));
+
+    std::string level = override_for(config.get_string("output.netcdf4.compression_overrides"),
+                                     name, "");
+    if (not level.empty()) {
+      char *endptr = NULL;
+      compression_level = strtol(level.c_str(), &endptr, 10);
+      if (endptr == level.c_str() or *endptr != '\0') {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "failed to parse compression level '%s'",
+                                      level.c_str());
+      }
+    }
+
+    if (compression_level < 0 or compression_level > 9) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "invalid compression level: %d (expected 0 to 9)",
+                                    compression_level);
+    }
+
+    file.define_compression(name, config.get_flag("output.netcdf4.shuffle"),
+                            compression_level);
+  } catch (RuntimeError &e) {
+    e.add_context("setting chunking and compression parameters of '%s'", name.c_str());
+    throw;
+  }
+}
+
 //! Define a NetCDF variable corresponding to a VariableMetadata object.
 void define_spatial_variable(const SpatialVariableMetadata &var,
                              const IceGrid &grid, const File &file,
@@ -581,6 +742,9 @@ void define_spatial_variable(const SpatialVariableMetadata &var,
   }
   file.define_variable(name, type, dims);
 
+  define_storage(var, grid, file, not var.get_time_independent(),
+                 z.empty() ? 0 : file.dimension_length(z));
+
   write_attributes(file, var, type);
 
   // add the "grid_mapping" attribute if the grid has an associated mapping. Variables lat, lon,
@@ -710,40 +874,22 @@ void write_spatial_variable(const SpatialVariableMetadata &var,
 
   // avoid writing time-independent variables more than once (saves time when writing to
   // extra_files)
-  if (var.get_time_independent()) {
-    bool written = file.attribute_type(var.get_name(), "not_written") == PISM_NAT;
-    if (written) {
-      return;
-    } else {
-      file.redef();
-      file.remove_attribute(var.get_name(), "not_written");
-    }
+  if (var.get_time_independent() and file.was_written(name)) {
+    return;
   }
 
   // make sure we have at least one level
   unsigned int nlevels = std::max(var.get_levels().size(), (size_t)1);
 
-  std::string
-    units               = var.get_string("units"),
-    glaciological_units = var.get_string("glaciological_units");
-
-  if (units != glaciological_units) {
-    size_t data_size = grid.xm() * grid.ym() * nlevels;
+  // convert to glaciological units (if necessary) and save
+  file.write_distributed_array(name, grid, nlevels,
+                               var.unit_system(),
+                               var.get_string("units"),
+                               var.get_string("glaciological_units"),
+                               input);
 
-    // create a temporary array, convert to glaciological units, and
-    // save
-    std::vector<double> tmp(data_size);
-    for (size_t k = 0; k < data_size; ++k) {
-      tmp[k] = input[k];
-    }
-
-    units::Converter(var.unit_system(),
-                     units,
-                     glaciological_units).convert_doubles(&tmp[0], tmp.size());
-
-    file.write_distributed_array(name, grid, nlevels, &tmp[0]);
-  } else {
-    file.write_distributed_array(name, grid, nlevels, input);
+  if (var.get_time_independent()) {
+    file.mark_as_written(name);
   }
 }
 
@@ -900,11 +1046,33 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
                              double default_value,
                              InterpolationType interpolation_type,
                              double *output) {
+  regrid_spatial_variable(variable, grid, file, t_start, 1, flag, report_range,
+                          allow_extrapolation, default_value, interpolation_type, output);
+}
+
+/*!
+ * Regrid `t_count` records of a variable starting from `t_start`.
+ *
+ * All records are read using one (collective) call, so this is much faster than reading
+ * them one by one, especially if the I/O backend does all the reading on rank 0.
+ *
+ * Records are stored in `output` one after another, each one using the storage order of
+ * a single record.
+ */
+void regrid_spatial_variable(SpatialVariableMetadata &variable,
+                             const IceGrid& grid, const File &file,
+                             unsigned int t_start, unsigned int t_count,
+                             RegriddingFlag flag,
+                             bool report_range,
+                             bool allow_extrapolation,
+                             double default_value,
+                             InterpolationType interpolation_type,
+                             double *output) {
   const Logger &log = *grid.ctx()->log();
 
   units::System::Ptr sys = variable.unit_system();
   const std::vector<double>& levels = variable.get_levels();
-  const size_t data_size = grid.xm() * grid.ym() * levels.size();
+  const size_t data_size = grid.xm() * grid.ym() * levels.size() * t_count;
 
   // Find the variable
   auto var = file.find_variable(variable.get_name(), variable.get_string("standard_name"));
@@ -912,12 +1080,18 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
   if (var.exists) {                      // the variable was found successfully
 
     {
-      grid_info input_grid(file, var.name, sys, grid.registration());
+      std::shared_ptr<const grid_info> input_grid;
+      RegriddingCache *cache = file.regridding_cache();
+      if (cache != nullptr) {
+        input_grid = cache->input_grid(file, var.name, sys, grid.registration());
+      } else {
+        input_grid.reset(new grid_info(file, var.name, sys, grid.registration()));
+      }
 
-      check_input_grid(input_grid);
+      check_input_grid(*input_grid);
 
       if (not allow_extrapolation) {
-        check_grid_overlap(input_grid, grid, levels);
+        check_grid_overlap(*input_grid, grid, levels);
       }
     }
 
@@ -928,9 +1102,9 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
                   file.filename().c_str());
 
       regrid_vec_fill_missing(file, grid, var.name, levels,
-                              t_start, default_value, interpolation_type, output);
+                              t_start, t_count, default_value, interpolation_type, output);
     } else {
-      regrid_vec(file, grid, var.name, levels, t_start, interpolation_type, output);
+      regrid_vec(file, grid, var.name, levels, t_start, t_count, interpolation_type, output);
     }
 
     // Now we need to get the units string from the file and convert
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -60,6 +60,15 @@ void regrid_spatial_variable(SpatialVariableMetadata &var,
                              InterpolationType type,
                              double *output);
 
+void regrid_spatial_variable(SpatialVariableMetadata &var,
+                             const IceGrid& grid, const File &nc,
+                             unsigned int t_start, unsigned int t_count,
+                             RegriddingFlag flag, bool do_report_range,
+                             bool allow_extrapolation,
+                             double default_value,
+                             InterpolationType type,
+                             double *output);
+
 void read_spatial_variable(const SpatialVariableMetadata &var,
                            const IceGrid& grid, const File &nc,
                            unsigned int time, double *output);
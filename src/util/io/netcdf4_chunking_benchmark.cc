@@ -0,0 +1,168 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Writes a file similar to a typical -extra_file (a number of records of 2D and 3D\n"
+  "fields) using each NetCDF-4 chunking policy and measures the time needed to write\n"
+  "it, read a map and read a time series at a point.\n\n";
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/io/File.hh"
+#include "pism/util/io/io_helpers.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+
+using namespace pism;
+
+int main(int argc, char *argv[]) {
+
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Context::Ptr ctx = context_from_options(com, "netcdf4_chunking_benchmark");
+    Logger::Ptr log = ctx->log();
+    Config::Ptr config = ctx->config();
+
+    std::string usage =
+      "  netcdf4_chunking_benchmark [-Mx N -My N -Mz N -records R -n_2d N -n_3d N\n"
+      "                             -policies A,B,... -o_format F -o prefix]\n"
+      "where\n"
+      "  -Mx, -My, -Mz  grid size\n"
+      "  -records       number of records to write\n"
+      "  -n_2d, -n_3d   number of 2D and 3D fields in each record\n"
+      "  -policies      chunking policies to try (see output.netcdf4.chunking)\n"
+      "  -o_format      output format (a NetCDF-4 one, e.g. netcdf4_parallel)\n"
+      "  -o             output file name prefix\n"
+      "\n"
+      "Use -o_compression_level and -output.netcdf4.shuffle to benchmark compression.\n";
+
+    bool done = show_usage_check_req_opts(*log, "NETCDF4_CHUNKING_BENCHMARK %s", {}, usage);
+    if (done) {
+      return 0;
+    }
+
+    options::Integer records("-records", "number of records to write", 10);
+    options::Integer n_2d("-n_2d", "number of 2D fields", 8);
+    options::Integer n_3d("-n_3d", "number of 3D fields", 1);
+    options::StringList policies("-policies", "chunking policies to try",
+                                 "netcdf,decomposition,map");
+    options::String prefix("-o", "output file name prefix", "chunking_benchmark");
+
+    GridParameters P(config);
+    P.horizontal_size_from_options();
+    P.horizontal_extent_from_options();
+    P.vertical_grid_from_options(config);
+    P.ownership_ranges_from_options(ctx->size());
+
+    IceGrid::Ptr grid(new IceGrid(ctx, P));
+
+    std::vector<std::shared_ptr<IceModelVec>> fields;
+    for (int k = 0; k < n_2d; ++k) {
+      std::string name = pism::printf("field_2d_%d", k);
+      std::shared_ptr<IceModelVec2S> v(new IceModelVec2S(grid, name, WITHOUT_GHOSTS));
+      v->set_attrs("diagnostic", name, "m", "m", "", 0);
+      fields.push_back(v);
+    }
+    for (int k = 0; k < n_3d; ++k) {
+      std::string name = pism::printf("field_3d_%d", k);
+      std::shared_ptr<IceModelVec3> v(new IceModelVec3(grid, name, WITHOUT_GHOSTS));
+      v->set_attrs("diagnostic", name, "K", "K", "", 0);
+      fields.push_back(v);
+    }
+
+    log->message(2, "Grid: %d x %d x %d points, %d processes, local domain %d x %d\n",
+                 grid->Mx(), grid->My(), grid->Mz(), grid->size(), grid->xm(), grid->ym());
+    log->message(2, "Writing %d records of %d 2D and %d 3D fields\n",
+                 (int)records, (int)n_2d, (int)n_3d);
+
+    const IO_Backend backend = string_to_backend(config->get_string("output.format"));
+    const double dt = 365 * 86400.0;
+
+    for (const auto &policy : policies.value()) {
+      config->set_string("output.netcdf4.chunking", policy);
+
+      std::string filename = prefix.value() + "_" + policy + ".nc";
+
+      // write
+      double start = get_time();
+      {
+        File file(com, filename, backend, PISM_READWRITE_MOVE, ctx->pio_iosys_id());
+
+        io::define_time(file, *ctx);
+        for (const auto &f : fields) {
+          f->define(file);
+        }
+
+        for (int r = 0; r < records; ++r) {
+          for (const auto &f : fields) {
+            f->set(r);
+          }
+
+          io::append_time(file, *config, r * dt);
+          for (const auto &f : fields) {
+            f->write(file);
+          }
+        }
+      }
+      double write_time = GlobalMax(com, get_time() - start);
+
+      // read a map and a time series at the center of the domain
+      double map_time = 0.0, time_series_time = 0.0;
+      {
+        File file(com, filename, PISM_GUESS, PISM_READONLY, ctx->pio_iosys_id());
+
+        start = get_time();
+        fields[0]->read(file, records - 1);
+        map_time = GlobalMax(com, get_time() - start);
+
+        const std::string name = fields[0]->metadata().get_name();
+        const unsigned int
+          n = records,
+          i = grid->Mx() / 2,
+          j = grid->My() / 2;
+        std::vector<double> time_series(n);
+
+        start = get_time();
+        file.read_variable(name, {0, j, i}, {n, 1, 1}, time_series.data());
+        time_series_time = GlobalMax(com, get_time() - start);
+      }
+
+      log->message(2, "  %-14s write: %8.4f s, read a map: %8.4f s, read a time series: %8.4f s\n",
+                   policy.c_str(), write_time, map_time, time_series_time);
+    }
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,40 +17,340 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <vector>
+#include <algorithm>            // std::sort, std::lower_bound
+#include <cmath>                // std::fabs
+
 #include "label_components.hh"
 
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/error_handling.hh"
-#include "connected_components.hh"
 
 namespace pism {
 
+namespace {
+
+//! Find the root of `k` in a union-find forest, compressing the path along the way.
+template<typename T>
+T find_root(std::vector<T> &parent, T k) {
+  T root = k;
+  while (parent[root] != root) {
+    root = parent[root];
+  }
+  // path compression
+  while (parent[k] != root) {
+    T next = parent[k];
+    parent[k] = root;
+    k = next;
+  }
+  return root;
+}
+
+//! Merge sets containing `a` and `b`, using the smaller root as the root of the union.
+template<typename T>
+void join(std::vector<T> &parent, T a, T b) {
+  a = find_root(parent, a);
+  b = find_root(parent, b);
+  if (a < b) {
+    parent[b] = a;
+  } else if (b < a) {
+    parent[a] = b;
+  }
+}
+
+//! Gather `local` from all ranks in `com`; the result is ordered by rank.
+std::vector<double> all_gather(MPI_Comm com, const std::vector<double> &local) {
+  int size = 0;
+  MPI_Comm_size(com, &size);
+
+  int n_local = local.size();
+  std::vector<int> counts(size), offsets(size);
+  MPI_Allgather(&n_local, 1, MPI_INT, counts.data(), 1, MPI_INT, com);
+
+  int total = 0;
+  for (int k = 0; k < size; ++k) {
+    offsets[k] = total;
+    total += counts[k];
+  }
+
+  std::vector<double> result(total);
+  MPI_Allgatherv(local.data(), n_local, MPI_DOUBLE,
+                 result.data(), counts.data(), offsets.data(), MPI_DOUBLE, com);
+
+  return result;
+}
+
+/*!
+ * Equivalences between labels of components in different sub-domains.
+ *
+ * Labels are indices of nodes in a union-find forest of all components touching a
+ * sub-domain boundary. These are few compared to the number of grid points, so every
+ * rank resolves all equivalences redundantly.
+ */
+class Equivalences {
+public:
+  Equivalences(const std::vector<double> &triples) {
+    // assign indices to labels (sorted, so that smaller labels get smaller indices)
+    std::vector<double> labels;
+    labels.reserve(2 * triples.size() / 3);
+    for (unsigned int k = 0; k < triples.size(); k += 3) {
+      labels.push_back(triples[k + 0]);
+      labels.push_back(triples[k + 1]);
+    }
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+
+    m_labels = labels;
+    m_parent.resize(m_labels.size());
+    for (unsigned int k = 0; k < m_parent.size(); ++k) {
+      m_parent[k] = k;
+    }
+    m_grounded.resize(m_labels.size(), 0);
+
+    for (unsigned int k = 0; k < triples.size(); k += 3) {
+      int
+        a = index(triples[k + 0]),
+        b = index(triples[k + 1]);
+
+      join(m_parent, a, b);
+
+      if (triples[k + 2] > 0.0) {
+        m_grounded[a] = 1;
+      }
+    }
+
+    // propagate "grounded" flags to roots
+    for (unsigned int k = 0; k < m_parent.size(); ++k) {
+      int root = find_root(m_parent, (int)k);
+      if (m_grounded[k]) {
+        m_grounded[root] = 1;
+      }
+    }
+  }
+
+  //! Resolve `label`. Returns false if `label` does not touch a sub-domain boundary.
+  bool resolve(double label, double &root_label, bool &grounded) {
+    auto it = std::lower_bound(m_labels.begin(), m_labels.end(), label);
+    if (it == m_labels.end() or *it != label) {
+      return false;
+    }
+
+    int root = find_root(m_parent, (int)(it - m_labels.begin()));
+
+    root_label = m_labels[root];
+    grounded   = m_grounded[root];
+
+    return true;
+  }
+private:
+  int index(double label) const {
+    return std::lower_bound(m_labels.begin(), m_labels.end(), label) - m_labels.begin();
+  }
+
+  std::vector<double> m_labels;
+  std::vector<int> m_parent;
+  std::vector<char> m_grounded;
+};
+
+} // end of anonymous namespace
+
 /*!
  * Label connected components in a mask stored in an IceModelVec2Int.
  *
- * This function allocates a copy on rank 0 and so should not be used if that is a
- * problem.
+ * Grid points with positive mask values belong to the foreground; two foreground points
+ * are connected if they are neighbors in the X or the Y direction. Wrap-around
+ * connections of periodic grids are ignored.
+ *
+ * If `identify_icebergs` is true, points in components containing at least one point
+ * with the value `mask_grounded` are set to 0 and all other foreground points are set to
+ * 1. Otherwise components are labeled 1, 2, ... in the order of their first point (in the
+ * order `j*Mx + i`). Background values are not modified. Results are identical to the
+ * serial algorithm in label_connected_components().
+ *
+ * The algorithm is distributed:
+ *
+ * 1. Label components within each sub-domain using union-find. The label of a component
+ *    is one plus the global index `j*Mx + i` of its first point.
+ * 2. Use ghost exchange to find pairs of labels of components in neighboring sub-domains
+ *    that touch across a sub-domain boundary.
+ * 3. Gather these pairs on all ranks and resolve equivalences, so that each component
+ *    spanning several sub-domains is assigned the smallest of its labels.
+ *
+ * This does not gather the mask on one rank: the amount of data exchanged in step 3 is
+ * proportional to the number of components touching sub-domain boundaries.
  */
 void label_components(IceModelVec2Int &mask, bool identify_icebergs, double mask_grounded) {
-  auto mask_p0 = mask.allocate_proc0_copy();
+  const double eps = 1e-6;
+
+  IceGrid::ConstPtr grid = mask.grid();
+
+  const int
+    Mx = grid->Mx(),
+    My = grid->My(),
+    xs = grid->xs(),
+    xm = grid->xm(),
+    ys = grid->ys(),
+    ym = grid->ym();
+
+  // Step 1: label components within this sub-domain.
+  //
+  // Local indexes k = (j - ys) * xm + (i - xs) are ordered in the same way as global
+  // indexes j * Mx + i, so the root of each local component (the point with the smallest
+  // local index) is also its first point in the global order.
+  const int N = xm * ym;
+  std::vector<int> parent(N);
+  std::vector<char> grounded(N, 0);
+  {
+    IceModelVec::AccessList list{&mask};
+
+    for (int j = ys; j < ys + ym; ++j) {
+      for (int i = xs; i < xs + xm; ++i) {
+        const int k = (j - ys) * xm + (i - xs);
 
-  mask.put_on_proc0(*mask_p0);
+        if (not (mask(i, j) > 0.0)) {
+          parent[k] = -1;       // background
+          continue;
+        }
 
-  auto grid = mask.grid();
+        parent[k] = k;
 
-  ParallelSection rank0(grid->com);
-  try {
-    if (grid->rank() == 0) {
-      petsc::VecArray array(*mask_p0);
-      label_connected_components(array.get(), grid->My(), grid->Mx(),
-                                 identify_icebergs, mask_grounded);
+        if (std::fabs(mask(i, j) - mask_grounded) < eps) {
+          grounded[k] = 1;
+        }
+
+        if (i > xs and parent[k - 1] >= 0) {
+          join(parent, k - 1, k);
+        }
+
+        if (j > ys and parent[k - xm] >= 0) {
+          join(parent, k - xm, k);
+        }
+      }
+    }
+
+    // propagate "grounded" flags to roots
+    for (int k = 0; k < N; ++k) {
+      if (parent[k] >= 0 and grounded[k]) {
+        grounded[find_root(parent, k)] = 1;
+      }
     }
-  } catch (...) {
-    rank0.failed();
   }
-  rank0.check();
 
-  mask.get_from_proc0(*mask_p0);
+  auto label = [&](int k) {
+    int root = find_root(parent, k);
+    int
+      i = xs + root % xm,
+      j = ys + root / xm;
+    return (double)j * Mx + i + 1.0;
+  };
+
+  // Step 2: find pairs of labels of components touching across sub-domain boundaries.
+  IceModelVec2Int labels(grid, "component_labels", WITH_GHOSTS, 1);
+  std::vector<double> triples;
+  {
+    IceModelVec::AccessList list{&labels};
+
+    for (int j = ys; j < ys + ym; ++j) {
+      for (int i = xs; i < xs + xm; ++i) {
+        const int k = (j - ys) * xm + (i - xs);
+        labels(i, j) = parent[k] >= 0 ? label(k) : 0.0;
+      }
+    }
+
+    labels.update_ghosts();
+
+    // neighbors across sub-domain boundaries (ignoring wrap-around connections)
+    std::vector<std::pair<double, double> > pairs;
+    auto check = [&](int i, int j, int i_n, int j_n) {
+      if (i_n < 0 or i_n >= Mx or j_n < 0 or j_n >= My) {
+        return;
+      }
+      if (labels(i, j) > 0.0 and labels(i_n, j_n) > 0.0) {
+        pairs.push_back({labels(i, j), labels(i_n, j_n)});
+      }
+    };
+
+    for (int j = ys; j < ys + ym; ++j) {
+      check(xs, j, xs - 1, j);
+      check(xs + xm - 1, j, xs + xm, j);
+    }
+    for (int i = xs; i < xs + xm; ++i) {
+      check(i, ys, i, ys - 1);
+      check(i, ys + ym - 1, i, ys + ym);
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    for (const auto &p : pairs) {
+      // the first label belongs to a component in this sub-domain
+      const double a = p.first;
+      const int
+        i = (int)(a - 1.0) % Mx,
+        j = (int)(a - 1.0) / Mx;
+
+      triples.push_back(a);
+      triples.push_back(p.second);
+      triples.push_back(grounded[(j - ys) * xm + (i - xs)]);
+    }
+  }
+
+  // Step 3: resolve equivalences.
+  Equivalences equivalences(all_gather(grid->com, triples));
+
+  // final label and the "grounded" flag of each local root
+  std::vector<double> root_label(N, 0.0);
+  for (int k = 0; k < N; ++k) {
+    if (parent[k] == k) {
+      root_label[k] = label(k);
+
+      bool root_grounded = grounded[k];
+      equivalences.resolve(label(k), root_label[k], root_grounded);
+      grounded[k] = root_grounded;
+    }
+  }
+
+  // Components are numbered in the order of their first points: gather labels of all
+  // components owned by (i.e. containing the first point in) each sub-domain.
+  std::vector<double> all_labels;
+  if (not identify_icebergs) {
+    std::vector<double> local_labels;
+    for (int k = 0; k < N; ++k) {
+      if (parent[k] == k and root_label[k] == label(k)) {
+        local_labels.push_back(root_label[k]);
+      }
+    }
+
+    all_labels = all_gather(grid->com, local_labels);
+    std::sort(all_labels.begin(), all_labels.end());
+  }
+
+  {
+    IceModelVec::AccessList list{&mask};
+
+    for (int j = ys; j < ys + ym; ++j) {
+      for (int i = xs; i < xs + xm; ++i) {
+        const int k = (j - ys) * xm + (i - xs);
+
+        if (parent[k] < 0) {
+          continue;
+        }
+
+        const int root = find_root(parent, k);
+
+        if (identify_icebergs) {
+          mask(i, j) = grounded[root] ? 0.0 : 1.0;
+        } else {
+          auto it = std::lower_bound(all_labels.begin(), all_labels.end(), root_label[root]);
+          mask(i, j) = (it - all_labels.begin()) + 1;
+        }
+      }
+    }
+  }
+
+  if (mask.stencil_width() > 0) {
+    mask.update_ghosts();
+  }
 }
 
 } // end of namespace pism
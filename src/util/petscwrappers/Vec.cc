@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -124,6 +124,20 @@ TemporaryGlobalVec::~TemporaryGlobalVec() {
   }
 }
 
+TemporaryLocalVec::TemporaryLocalVec(DM::Ptr dm) {
+  m_dm = dm;
+  PetscErrorCode ierr = DMGetLocalVector(*m_dm, &m_value);
+  PISM_CHK(ierr, "DMGetLocalVector");
+}
+
+TemporaryLocalVec::~TemporaryLocalVec() {
+  // See the comment in ~TemporaryGlobalVec().
+  if (m_value != NULL) {
+    PetscErrorCode ierr = DMRestoreLocalVector(*m_dm, &m_value); CHKERRCONTINUE(ierr);
+    m_value = NULL;
+  }
+}
+
 
 } // end of namespace petsc
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016 PISM Authors
+/* Copyright (C) 2015, 2016, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -97,6 +97,14 @@ private:
   DM::Ptr m_dm;
 };
 
+class TemporaryLocalVec : public Vec {
+public:
+  TemporaryLocalVec(DM::Ptr dm);
+  ~TemporaryLocalVec();
+private:
+  DM::Ptr m_dm;
+};
+
 } // end of namespace petsc
 } // end of namespace pism
 
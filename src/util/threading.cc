@@ -0,0 +1,60 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "pism/util/threading.hh"
+#include "pism/pism_config.hh"  // Pism_USE_OPENMP
+
+#if (Pism_USE_OPENMP==1)
+#include <omp.h>
+#endif
+
+namespace pism {
+
+int max_threads() {
+#if (Pism_USE_OPENMP==1)
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+int thread_index() {
+#if (Pism_USE_OPENMP==1)
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+void ThreadErrors::capture() {
+#pragma omp critical (pism_thread_errors)
+  {
+    if (not m_error) {
+      m_error = std::current_exception();
+    }
+  }
+}
+
+void ThreadErrors::rethrow() const {
+  if (m_error) {
+    std::rethrow_exception(m_error);
+  }
+}
+
+} // end of namespace pism
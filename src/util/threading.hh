@@ -0,0 +1,188 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_THREADING_H
+#define PISM_THREADING_H
+
+#include <exception>            // std::exception_ptr
+#include <memory>               // std::unique_ptr
+#include <vector>
+
+#include "pism/util/IceGrid.hh"
+
+namespace pism {
+
+//! Maximum number of threads used by thread-parallel loops (1 if PISM is built without
+//! OpenMP support).
+int max_threads();
+
+//! Index of the calling thread (always 0 outside of thread-parallel loops).
+int thread_index();
+
+/*!
+ * Per-thread storage for scratch objects used in thread-parallel loops.
+ *
+ * Allocates `max_threads()` instances of `T`, each constructed using the same arguments.
+ * Objects are created by the thread calling the constructor (i.e. *not* in a parallel
+ * region), so it is safe to read configuration parameters in `T`'s constructor.
+ *
+ * Usage:
+ *
+ * ~~~{.cpp}
+ * PerThread<std::vector<double>> column(grid.Mz());
+ *
+ * parallel_for(grid, [&](int i, int j) {
+ *     std::vector<double> &c = column.get();
+ *     ...
+ *   });
+ * ~~~
+ */
+template<class T>
+class PerThread {
+public:
+  template<typename... Args>
+  PerThread(Args&&... args) {
+    int N = max_threads();
+    m_data.reserve(N);
+    for (int k = 0; k < N; ++k) {
+      m_data.emplace_back(new T(args...));
+    }
+  }
+
+  //! Scratch object owned by the calling thread.
+  T& get() {
+    return *m_data[thread_index()];
+  }
+
+  //! Scratch object owned by the thread `k` (use this to combine per-thread results).
+  T& operator[](int k) {
+    return *m_data[k];
+  }
+
+  int size() const {
+    return m_data.size();
+  }
+private:
+  std::vector<std::unique_ptr<T> > m_data;
+};
+
+/*!
+ * Collects exceptions thrown in a thread-parallel region.
+ *
+ * C++ exceptions cannot cross the boundary of an OpenMP parallel region, so each thread
+ * catches exceptions thrown by its kernel and stores the first one here. It is re-thrown
+ * by the calling thread once all threads are done.
+ */
+class ThreadErrors {
+public:
+  //! Store the exception that is being handled. Call from a `catch (...)` block **only**.
+  void capture();
+  //! Re-throw the first exception captured by `capture()` (if any).
+  void rethrow() const;
+private:
+  std::exception_ptr m_error;
+};
+
+/*!
+ * Thread-parallel loop over the part of the grid owned by this MPI process, including
+ * `stencil_width` ghost points on each side.
+ *
+ * Calls `kernel(i, j)` once for each grid point. Rows are distributed among threads
+ * dynamically, so `kernel` has to be safe to call concurrently for different points:
+ * - it should not call PETSc (access to all IceModelVecs involved has to be started
+ *   before the loop, e.g. using IceModelVec::AccessList),
+ * - it should use PerThread to get its own scratch storage,
+ * - it should combine per-thread partial results instead of updating shared counters.
+ *
+ * An exception thrown by `kernel` stops processing of the row containing the failing point.
+ * It is re-thrown by the calling thread after the parallel region, so this function
+ * can be used inside a ParallelSection just like a regular Points loop:
+ *
+ * ~~~{.cpp}
+ * ParallelSection loop(grid.com);
+ * try {
+ *   parallel_for(grid, [&](int i, int j) { ... });
+ * } catch (...) {
+ *   loop.failed();
+ * }
+ * loop.check();
+ * ~~~
+ *
+ * Without OpenMP this is equivalent to a loop over `PointsWithGhosts(grid, stencil_width)`.
+ */
+template<typename F>
+void parallel_for(const IceGrid &grid, unsigned int stencil_width, F kernel) {
+  const int
+    i_first = grid.xs() - stencil_width,
+    i_last  = grid.xs() + grid.xm() + stencil_width - 1,
+    j_first = grid.ys() - stencil_width,
+    j_last  = grid.ys() + grid.ym() + stencil_width - 1;
+
+  ThreadErrors errors;
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int j = j_first; j <= j_last; ++j) {
+    try {
+      for (int i = i_first; i <= i_last; ++i) {
+        kernel(i, j);
+      }
+    } catch (...) {
+      errors.capture();
+    }
+  }
+
+  errors.rethrow();
+}
+
+//! Thread-parallel loop over the part of the grid owned by this MPI process.
+template<typename F>
+void parallel_for(const IceGrid &grid, F kernel) {
+  parallel_for(grid, 0, kernel);
+}
+
+/*!
+ * Thread-parallel loop over tiles of the local sub-domain.
+ *
+ * Each thread processes whole tiles (see Tiles), so all arrays used by `kernel` stay in
+ * the cache of the core processing a given tile. The same restrictions as in
+ * `parallel_for(grid, stencil_width, kernel)` apply.
+ */
+template<typename F>
+void parallel_for(const Tiles &tiles, F kernel) {
+  const int N = tiles.size();
+
+  ThreadErrors errors;
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int k = 0; k < N; ++k) {
+    try {
+      for (PointsInTile p(tiles, k); p; p.next()) {
+        kernel(p.i(), p.j());
+      }
+    } catch (...) {
+      errors.capture();
+    }
+  }
+
+  errors.rethrow();
+}
+
+} // end of namespace pism
+
+#endif /* PISM_THREADING_H */
@@ -0,0 +1,185 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Compares row-by-row and tiled traversal of the local sub-domain using a\n"
+  "staggered-grid stencil kernel similar to the ones used by the SIA solver.\n\n";
+
+#include <cmath>
+#include <algorithm>            // std::max
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+
+using namespace pism;
+
+//! Staggered-grid kernel reading 5 arrays (with a 3x3 stencil) and writing 4.
+static void kernel(int i, int j, double dx, double dy,
+                   const IceModelVec2S &h, const IceModelVec2S &H,
+                   const IceModelVec2S &b, const IceModelVec2S &A,
+                   const IceModelVec2S &tau,
+                   IceModelVec2Stag &h_x, IceModelVec2Stag &h_y,
+                   IceModelVec2Stag &D, IceModelVec2Stag &Q) {
+  for (int o = 0; o < 2; ++o) {
+    const int oi = 1 - o, oj = o;
+
+    const double
+      H_s   = 0.5 * (H(i, j) + H(i + oi, j + oj)),
+      A_s   = 0.5 * (A(i, j) + A(i + oi, j + oj)),
+      b_s   = 0.5 * (b(i, j) + b(i + oi, j + oj)),
+      tau_s = 0.5 * (tau(i, j) + tau(i + oi, j + oj));
+
+    double hx = 0.0, hy = 0.0;
+    if (o == 0) {
+      hx = (h(i + 1, j) - h(i, j)) / dx;
+      hy = (h(i + 1, j + 1) + h(i, j + 1) - h(i + 1, j - 1) - h(i, j - 1)) / (4.0 * dy);
+    } else {
+      hx = (h(i + 1, j + 1) + h(i + 1, j) - h(i - 1, j + 1) - h(i - 1, j)) / (4.0 * dx);
+      hy = (h(i, j + 1) - h(i, j)) / dy;
+    }
+
+    const double
+      slope2 = hx * hx + hy * hy,
+      d      = A_s * pow(H_s, 5.0) * slope2 + tau_s * std::max(b_s, 0.0);
+
+    h_x(i, j, o) = hx;
+    h_y(i, j, o) = hy;
+    D(i, j, o)   = d;
+    Q(i, j, o)   = - d * (o == 0 ? hx : hy);
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Context::Ptr ctx = context_from_options(com, "tiling_benchmark");
+    Logger::Ptr log = ctx->log();
+    Config::Ptr config = ctx->config();
+
+    std::string usage =
+      "  tiling_benchmark [-Mx N -My N -tile_sizes A,B,... -repeat R]\n"
+      "where\n"
+      "  -Mx, -My     grid size (use a large grid to see the effect of tiling)\n"
+      "  -tile_sizes  tile sizes to try\n"
+      "  -repeat      number of times to apply the kernel\n"
+      "\n"
+      "To measure cache misses directly, run this under 'perf stat -e cache-misses'\n"
+      "once for each tile size.\n";
+
+    bool done = show_usage_check_req_opts(*log, "TILING_BENCHMARK %s", {}, usage);
+    if (done) {
+      return 0;
+    }
+
+    options::IntegerList tile_sizes("-tile_sizes", "tile sizes to try", {16, 32, 64, 128});
+    options::Integer repeat("-repeat", "number of times to apply the kernel", 10);
+
+    GridParameters P(config);
+    P.horizontal_size_from_options();
+    P.horizontal_extent_from_options();
+    P.vertical_grid_from_options(config);
+    P.ownership_ranges_from_options(ctx->size());
+
+    IceGrid::Ptr grid(new IceGrid(ctx, P));
+
+    IceModelVec2S h, H, b, A, tau;
+    h.create(grid, "h", WITH_GHOSTS);
+    H.create(grid, "H", WITH_GHOSTS);
+    b.create(grid, "b", WITH_GHOSTS);
+    A.create(grid, "A", WITH_GHOSTS);
+    tau.create(grid, "tau", WITH_GHOSTS);
+
+    IceModelVec2Stag h_x, h_y, D, Q;
+    h_x.create(grid, "h_x", WITH_GHOSTS);
+    h_y.create(grid, "h_y", WITH_GHOSTS);
+    D.create(grid, "D", WITH_GHOSTS);
+    Q.create(grid, "Q", WITH_GHOSTS);
+
+    {
+      IceModelVec::AccessList list{&h, &H, &b, &A, &tau};
+      for (Points p(*grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+        const double x = grid->x(i), y = grid->y(j);
+
+        H(i, j)   = 1000.0 + 100.0 * sin(x / 50e3) * cos(y / 50e3);
+        b(i, j)   = 200.0 * cos(x / 20e3);
+        h(i, j)   = H(i, j) + b(i, j);
+        A(i, j)   = 1e-24;
+        tau(i, j) = 1e5 + 1e3 * sin(y / 10e3);
+      }
+    }
+    for (auto *v : {&h, &H, &b, &A, &tau}) {
+      v->update_ghosts();
+    }
+
+    const double dx = grid->dx(), dy = grid->dy();
+
+    IceModelVec::AccessList list{&h, &H, &b, &A, &tau, &h_x, &h_y, &D, &Q};
+
+    log->message(2, "Grid: %d x %d points, %d processes, local domain %d x %d\n",
+                 grid->Mx(), grid->My(), grid->size(), grid->xm(), grid->ym());
+
+    // row by row
+    {
+      double start = get_time();
+      for (int r = 0; r < repeat; ++r) {
+        for (Points p(*grid); p; p.next()) {
+          kernel(p.i(), p.j(), dx, dy, h, H, b, A, tau, h_x, h_y, D, Q);
+        }
+      }
+      double elapsed = GlobalMax(com, get_time() - start);
+      log->message(2, "  row by row:      %8.4f s\n", elapsed);
+    }
+
+    // tiled
+    for (auto size : tile_sizes.value()) {
+      if (size <= 0) {
+        continue;
+      }
+
+      double start = get_time();
+      for (int r = 0; r < repeat; ++r) {
+        for (Tiles t(*grid, size, size, 0); t; t.next()) {
+          for (PointsInTile p(t); p; p.next()) {
+            kernel(p.i(), p.j(), dx, dy, h, H, b, A, tau, h_x, h_y, D, Q);
+          }
+        }
+      }
+      double elapsed = GlobalMax(com, get_time() - start);
+      log->message(2, "  tiles %4d x %4d: %8.4f s\n", size, size, elapsed);
+    }
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+#!/usr/bin/env python
+"""Tests of the age model.
+"""
+
+import PISM
+from PISM.util import convert
+import numpy as np
+
+ctx = PISM.Context()
+ctx.log.set_threshold(1)
+
+H = 1000.0
+
+
+def setup_module():
+    global grid, ice_thickness, u, v, w
+
+    params = PISM.GridParameters(ctx.config)
+    params.Mx = 21
+    params.My = 21
+    params.ownership_ranges_from_options(ctx.size)
+    grid = PISM.IceGrid(ctx.ctx, params)
+
+    ice_thickness = PISM.model.createIceThicknessVec(grid)
+    ice_thickness.set(H)
+
+    u = PISM.IceModelVec3(grid, "u", PISM.WITHOUT_GHOSTS)
+    v = PISM.IceModelVec3(grid, "v", PISM.WITHOUT_GHOSTS)
+    w = PISM.IceModelVec3(grid, "w", PISM.WITHOUT_GHOSTS)
+
+
+def run(method, speed, dt, initial_age=None):
+    """Create an age model using `method` and perform one step of length `dt`.
+
+    If `initial_age` is set, use `initial_age(x, y, z)` as the age at the beginning of the
+    step.
+    """
+    old_method = ctx.config.get_string("age.method")
+    ctx.config.set_string("age.method", method)
+    try:
+        model = PISM.AgeModel(grid, None)
+    finally:
+        ctx.config.set_string("age.method", old_method)
+
+    model.init(PISM.InputOptions(PISM.INIT_OTHER, "", 0))
+
+    if initial_age is not None:
+        x = grid.x()
+        y = grid.y()
+        z = np.array(grid.z())
+        age = model.age()
+        with PISM.vec.Access(nocomm=[age]):
+            for (i, j) in grid.points():
+                age.set_column(i, j, list(initial_age(x[i], y[j], z)))
+        age.update_ghosts()
+
+    u.set(speed)
+    v.set(speed)
+    w.set(0.0)
+
+    model.update(0.0, dt, PISM.AgeModelInputs(ice_thickness, u, v, w))
+
+    return model
+
+
+def check_uniform_age(model, dt):
+    "Check that the age of ice is `dt` below the surface and zero above."
+    z = np.array(grid.z())
+    k_s = grid.kBelowHeight(H)
+
+    age = model.age()
+    with PISM.vec.Access(nocomm=[age]):
+        for (i, j) in grid.points():
+            column = np.array(age.get_column_vector(i, j))
+            np.testing.assert_almost_equal(column[:k_s + 1] / dt, 1.0)
+            np.testing.assert_almost_equal(column[k_s + 1:], 0.0)
+
+
+def test_no_flow():
+    "Age of stagnant ice increases by dt (both methods)"
+    dt = convert(100, "years", "seconds")
+    for method in ["upwind", "semi_lagrangian"]:
+        check_uniform_age(run(method, 0.0, dt), dt)
+
+
+def test_semi_lagrangian_long_step():
+    "Semi-Lagrangian age: a step much longer than the CFL limit"
+    dt = convert(1000, "years", "seconds")
+    # ice moves 5 grid cells per step
+    speed = 5.0 * grid.dx() / dt
+
+    model = run("semi_lagrangian", speed, dt)
+
+    check_uniform_age(model, dt)
+
+    assert model.max_timestep(0.0).infinite()
+
+
+def test_semi_lagrangian_shifted_profile():
+    "Semi-Lagrangian age: advection of a non-uniform age field"
+    dt = convert(1000, "years", "seconds")
+    # ice moves 2.3 grid cells per step (this requires sub-steps and interpolation)
+    speed = 2.3 * grid.dx() / dt
+
+    x0 = grid.x()[0]
+    y0 = grid.y()[0]
+
+    def f(x, y, z):
+        "Age field that is linear in x, y, and z (and so is reproduced by interpolation)."
+        return dt * (3.0 * (x - x0) / grid.Lx() + 2.0 * (y - y0) / grid.Ly() + z / H)
+
+    model = run("semi_lagrangian", speed, dt, initial_age=f)
+
+    x = grid.x()
+    y = grid.y()
+    z = np.array(grid.z())
+    k_s = grid.kBelowHeight(H)
+    shift = speed * dt
+
+    # departure points of points near the upstream edge of the domain are in the
+    # periodic image of the domain, where the age field is discontinuous
+    margin = 5
+
+    age = model.age()
+    with PISM.vec.Access(nocomm=[age]):
+        for (i, j) in grid.points():
+            if i < margin or j < margin:
+                continue
+
+            column = np.array(age.get_column_vector(i, j))
+            expected = f(x[i] - shift, y[j] - shift, z) + dt
+
+            np.testing.assert_allclose(column[:k_s + 1], expected[:k_s + 1], rtol=1e-8)
+            np.testing.assert_almost_equal(column[k_s + 1:], 0.0)
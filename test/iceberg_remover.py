@@ -0,0 +1,79 @@
+#!/usr/bin/env python
+"""Tests of the iceberg remover (PISM.IcebergRemover)."""
+
+import PISM
+import numpy as np
+
+ctx = PISM.Context()
+
+# suppress all output
+ctx.log.set_threshold(1)
+
+Mx = 11
+My = 9
+
+def set_geometry(grid, cell_type, ice_thickness, icebergs):
+    """Set up an ice sheet with an attached ice shelf and `icebergs`: a list of (i, j)
+    indexes of floating cells that are not connected to the ice shelf."""
+    with PISM.vec.Access(nocomm=[cell_type, ice_thickness]):
+        for (i, j) in grid.points():
+            if i < 3:
+                cell_type[i, j] = PISM.MASK_GROUNDED
+                ice_thickness[i, j] = 1000.0
+            elif i < 6 or (i, j) in icebergs:
+                cell_type[i, j] = PISM.MASK_FLOATING
+                ice_thickness[i, j] = 100.0
+            else:
+                cell_type[i, j] = PISM.MASK_ICE_FREE_OCEAN
+                ice_thickness[i, j] = 0.0
+    cell_type.update_ghosts()
+    ice_thickness.update_ghosts()
+
+def ice_free(grid, ice_thickness, points):
+    "Return True if all `points` are ice-free."
+    result = True
+    with PISM.vec.Access(nocomm=[ice_thickness]):
+        for (i, j) in grid.points():
+            if (i, j) in points and ice_thickness[i, j] != 0.0:
+                result = False
+    return PISM.GlobalMin(grid.com, 1.0 if result else 0.0) > 0.0
+
+def labeling_skipped_test():
+    "IcebergRemover skips labeling if its input did not change"
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 1, 1, 0, 0, Mx, My,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    cell_type = PISM.IceModelVec2CellType(grid, "mask", PISM.WITH_GHOSTS)
+    ice_thickness = PISM.IceModelVec2S(grid, "thk", PISM.WITH_GHOSTS)
+    bc_mask = PISM.IceModelVec2Int(grid, "bc_mask", PISM.WITH_GHOSTS)
+    bc_mask.set(0.0)
+
+    remover = PISM.IcebergRemover(grid)
+    remover.init()
+
+    first = [(8, 4)]
+    set_geometry(grid, cell_type, ice_thickness, first)
+
+    # the first call has to label components and remove the iceberg
+    remover.update(bc_mask, cell_type, ice_thickness)
+    assert remover.labelings_performed() == 1
+    assert remover.labelings_skipped() == 0
+    assert ice_free(grid, ice_thickness, first)
+
+    # inputs did not change (the iceberg is gone), so labeling is skipped
+    remover.update(bc_mask, cell_type, ice_thickness)
+    assert remover.labelings_performed() == 1
+    assert remover.labelings_skipped() == 1
+
+    # a new iceberg appears: labeling has to run again
+    second = [(8, 2), (9, 2)]
+    set_geometry(grid, cell_type, ice_thickness, second)
+
+    remover.update(bc_mask, cell_type, ice_thickness)
+    assert remover.labelings_performed() == 2
+    assert remover.labelings_skipped() == 1
+    assert ice_free(grid, ice_thickness, second)
+
+    # the attached ice shelf is not an iceberg
+    assert not ice_free(grid, ice_thickness, [(4, 4)])
+
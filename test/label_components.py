@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+"""Tests of the connected component labeling code (PISM.label_components).
+
+Compares results to a simple (and slow) reference implementation. Run using more than one
+MPI process to test merging of components across sub-domain boundaries.
+"""
+
+import PISM
+import numpy as np
+
+ctx = PISM.Context()
+
+Mx = 31
+My = 23
+
+def grid():
+    return PISM.IceGrid.Shallow(ctx.ctx, 1, 1, 0, 0, Mx, My,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+def reference(mask, identify_icebergs, mask_grounded):
+    "Label components of `mask` using a breadth-first search."
+    result = np.array(mask)
+    labels = np.zeros(mask.shape, dtype=int)
+
+    n_labels = 0
+    for j in range(mask.shape[0]):
+        for i in range(mask.shape[1]):
+            if mask[j, i] <= 0 or labels[j, i] > 0:
+                continue
+
+            n_labels += 1
+            labels[j, i] = n_labels
+            queue = [(j, i)]
+            component = []
+            while queue:
+                p = queue.pop()
+                component.append(p)
+                for q in [(p[0] - 1, p[1]), (p[0] + 1, p[1]), (p[0], p[1] - 1), (p[0], p[1] + 1)]:
+                    if (0 <= q[0] < mask.shape[0] and 0 <= q[1] < mask.shape[1] and
+                        mask[q] > 0 and labels[q] == 0):
+                        labels[q] = n_labels
+                        queue.append(q)
+
+            grounded = any(abs(mask[p] - mask_grounded) < 1e-6 for p in component)
+            for p in component:
+                if identify_icebergs:
+                    result[p] = 0 if grounded else 1
+                else:
+                    result[p] = n_labels
+
+    return result
+
+def run(mask, identify_icebergs, mask_grounded):
+    g = grid()
+    m = PISM.IceModelVec2Int(g, "mask", PISM.WITHOUT_GHOSTS)
+
+    with PISM.vec.Access(nocomm=m):
+        for (i, j) in g.points():
+            m[i, j] = mask[j, i]
+
+    PISM.label_components(m, identify_icebergs, mask_grounded)
+
+    return m.numpy()
+
+def random_mask(seed, fraction):
+    np.random.seed(seed)
+    mask = np.array(np.random.rand(My, Mx) < fraction, dtype=float)
+    # some "grounded" points
+    mask[np.logical_and(mask > 0, np.random.rand(My, Mx) < 0.05)] = 2.0
+    return mask
+
+def check(mask, identify_icebergs, mask_grounded=2.0):
+    result = run(mask, identify_icebergs, mask_grounded)
+    if ctx.rank == 0:
+        np.testing.assert_equal(result, reference(mask, identify_icebergs, mask_grounded))
+
+def label_test():
+    "Label connected components"
+    for fraction in [0.3, 0.5, 0.6]:
+        check(random_mask(1, fraction), False)
+
+def iceberg_test():
+    "Identify icebergs"
+    for fraction in [0.3, 0.5, 0.6]:
+        check(random_mask(2, fraction), True)
+
+def spiral_test():
+    "A component spanning all sub-domains"
+    mask = np.zeros((My, Mx))
+    mask[::2, :] = 1.0
+    mask[1::4, -1] = 1.0
+    mask[3::4, 0] = 1.0
+    mask[-1, -1] = 2.0
+    check(mask, False)
+    check(mask, True)
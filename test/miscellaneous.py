@@ -15,7 +15,7 @@ import PISM.testing
 import sys
 import os
 import numpy as np
-from unittest import TestCase
+from unittest import TestCase, SkipTest
 
 ctx = PISM.Context()
 ctx.log.set_threshold(0)
@@ -800,7 +800,225 @@ def regridding_test():
     import os
     os.remove("thk1.nc")
 
+def regridding_plan_reuse_test():
+    "Test regridding several fields from the same file (re-using regridding plans)"
+    ctx = PISM.Context().ctx
 
+    grid = PISM.testing.shallow_grid(Mx=5, My=7)
+
+    x = grid.x()
+    y = grid.y()
+
+    fields = []
+    for k in range(3):
+        v = PISM.IceModelVec2S(grid, "v{}".format(k), PISM.WITHOUT_GHOSTS)
+        v.set_attrs("testing", "test field {}".format(k), "m", "m", "", 0)
+        with PISM.vec.Access(nocomm=[v]):
+            for (i, j) in grid.points():
+                v[i, j] = (k + 1) * x[i] + y[j]
+        fields.append(v)
+
+    filename = "regridding_plan_reuse.nc"
+    try:
+        PISM.util.prepare_output(filename)
+        for v in fields:
+            v.write(filename)
+
+        # a finer grid covering the same domain
+        fine_grid = PISM.testing.shallow_grid(Mx=9, My=13)
+
+        f = PISM.File(ctx.com(), filename, PISM.PISM_NETCDF3, PISM.PISM_READONLY)
+        for target in [grid, fine_grid, grid]:
+            X, Y = np.meshgrid(target.x(), target.y())
+            for k in range(3):
+                w = PISM.IceModelVec2S(target, "v{}".format(k), PISM.WITHOUT_GHOSTS)
+                w.set_attrs("testing", "test field {}".format(k), "m", "m", "", 0)
+                w.regrid(f, PISM.CRITICAL)
+
+                # linear functions should be recovered exactly
+                np.testing.assert_almost_equal(w.numpy(), (k + 1) * X + Y)
+        f.close()
+    finally:
+        os.remove(filename)
+
+def netcdf4_storage_policy_test():
+    "Test chunking and compression policies for spatial variables"
+    ctx = PISM.Context().ctx
+    config = ctx.config()
+
+    grid = PISM.testing.shallow_grid(Mx=5, My=7)
+
+    v = PISM.IceModelVec2S(grid, "v", PISM.WITHOUT_GHOSTS)
+    v.set_attrs("testing", "test field", "m", "m", "", 0)
+    v.metadata().set_time_independent(True)
+    with PISM.vec.Access(nocomm=[v]):
+        for (i, j) in grid.points():
+            v[i, j] = i + 10 * j
+
+    u = PISM.IceModelVec3(grid, "u", PISM.WITHOUT_GHOSTS)
+    u.set_attrs("testing", "3D test field", "m", "m", "", 0)
+    u.metadata().set_time_independent(True)
+    u.set(1.0)
+
+    netcdf4_backends = []
+    if PISM.Pism_USE_PARALLEL_NETCDF4:
+        netcdf4_backends += [PISM.PISM_NETCDF4_PARALLEL]
+    if PISM.Pism_USE_PIO:
+        netcdf4_backends += [PISM.PISM_PIO_NETCDF4C]
+
+    try:
+        import netCDF4
+    except ImportError:
+        netCDF4 = None
+
+    # the largest sub-domain in the map plane
+    xm = int(PISM.GlobalMax(grid.com, grid.xm()))
+    ym = int(PISM.GlobalMax(grid.com, grid.ym()))
+
+    expected_chunks = {"decomposition" : {"v" : [ym, xm], "u" : [ym, xm, grid.Mz()]},
+                       "map" : {"v" : [grid.My(), grid.Mx()], "u" : [grid.My(), grid.Mx(), 1]}}
+
+    def write(backend):
+        f = PISM.File(ctx.com(), filename, backend, PISM.PISM_READWRITE_MOVE,
+                      ctx.pio_iosys_id())
+        try:
+            v.write(f)
+            u.write(f)
+        finally:
+            f.close()
+
+    filename = "netcdf4_storage_policy.nc"
+    old_policy = config.get_string("output.netcdf4.chunking")
+    old_level = config.get_number("output.netcdf4.compression_level")
+    old_shuffle = config.get_flag("output.netcdf4.shuffle")
+    try:
+        for backend in [PISM.PISM_NETCDF3] + netcdf4_backends:
+            for policy in ["netcdf", "decomposition", "map"]:
+                config.set_string("output.netcdf4.chunking", policy)
+
+                write(backend)
+
+                w = PISM.IceModelVec2S(grid, "v", PISM.WITHOUT_GHOSTS)
+                w.set_attrs("testing", "test field", "m", "m", "", 0)
+                w.read(filename, 0)
+
+                np.testing.assert_equal(w.numpy(), v.numpy())
+
+                if backend != PISM.PISM_NETCDF3 and netCDF4 is not None and policy != "netcdf":
+                    with netCDF4.Dataset(filename) as f:
+                        for name in ["v", "u"]:
+                            chunks = f.variables[name].chunking()
+                            assert chunks == expected_chunks[policy][name], \
+                                "{}: {} != {}".format(name, chunks, expected_chunks[policy][name])
+
+        # compression settings and per-variable overrides
+        config.set_string("output.netcdf4.chunking", "decomposition")
+        config.set_number("output.netcdf4.compression_level", 4)
+        config.set_flag("output.netcdf4.shuffle", True)
+        config.set_string("output.netcdf4.compression_overrides", "u:0")
+        for backend in netcdf4_backends:
+            write(backend)
+
+            if netCDF4 is not None:
+                with netCDF4.Dataset(filename) as f:
+                    filters = f.variables["v"].filters()
+                    assert filters["zlib"] and filters["complevel"] == 4 and filters["shuffle"]
+
+                    filters = f.variables["u"].filters()
+                    assert not filters["zlib"] and not filters["shuffle"]
+        config.set_string("output.netcdf4.compression_overrides", "")
+
+        # invalid overrides should be reported
+        config.set_string("output.netcdf4.chunking_overrides", "v")
+        f = PISM.File(ctx.com(), filename, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_MOVE)
+        try:
+            v.write(f)
+            assert False, "failed to catch an invalid override"
+        except RuntimeError:
+            pass
+        finally:
+            f.close()
+    finally:
+        config.set_string("output.netcdf4.chunking", old_policy)
+        config.set_number("output.netcdf4.compression_level", old_level)
+        config.set_flag("output.netcdf4.shuffle", old_shuffle)
+        config.set_string("output.netcdf4.chunking_overrides", "")
+        config.set_string("output.netcdf4.compression_overrides", "")
+        os.remove(filename)
+
+    if not netcdf4_backends:
+        raise SkipTest("PISM was built without NetCDF-4 support: stored chunking and compression were not checked")
+
+    if netCDF4 is None:
+        raise SkipTest("netCDF4 is not installed: stored chunking and compression were not checked")
+
+def diagnostic_reducer_test():
+    "Test time-averaged and decimated output of diagnostics"
+    ctx = PISM.Context().ctx
+
+    grid = PISM.testing.shallow_grid(Mx=5, My=7)
+
+    v = PISM.IceModelVec2S(grid, "v", PISM.WITHOUT_GHOSTS)
+    v.set_attrs("testing", "test field", "m", "m", "", 0)
+
+    # a field with two degrees of freedom (components "ubar" and "vbar")
+    bar = PISM.IceModelVec2V(grid, "bar", PISM.WITHOUT_GHOSTS)
+    bar.set_attrs("testing", "test field (x component)", "m", "m", "", 0)
+    bar.set_attrs("testing", "test field (y component)", "m", "m", "", 1)
+
+    reducer = PISM.DiagnosticReducer(grid, True, 2)
+    reducer.add(PISM.Diagnostic.wrap(v))
+    reducer.add(PISM.Diagnostic.wrap(bar))
+    reducer.reset()
+
+    def g(i, j):
+        return 10.0 * i + j
+
+    # coefficients (a, b) of values a * g(i, j) + b and time step lengths
+    steps = [(1.0, 0.0, 1.0), (-1.0, 5.0, 3.0)]
+    for a, b, dt in steps:
+        with PISM.vec.Access(nocomm=[v, bar]):
+            for (i, j) in grid.points():
+                v[i, j] = a * g(i, j) + b
+                bar[i, j].u = 2.0 * (a * g(i, j) + b)
+                bar[i, j].v = -(a * g(i, j) + b)
+        reducer.update(dt)
+
+    coarse_grid = reducer.output_grid()
+    np.testing.assert_equal(coarse_grid.x(), grid.x()[::2])
+    np.testing.assert_equal(coarse_grid.y(), grid.y()[::2])
+
+    # values on the fine grid, stored as [j, i]
+    I, J = np.meshgrid(np.arange(grid.Mx()), np.arange(grid.My()))
+    values = [a * g(I, J) + b for a, b, _ in steps]
+    weights = [dt for _, _, dt in steps]
+
+    mean = sum(w * x for w, x in zip(weights, values)) / sum(weights)
+    minimum = np.minimum(*values)
+    maximum = np.maximum(*values)
+
+    # make sure that the test is not trivial
+    assert not np.all(minimum == values[0])
+    assert not np.all(maximum == values[0])
+
+    expected = {"v": mean, "v_min": minimum, "v_max": maximum,
+                "ubar": 2.0 * mean, "ubar_min": 2.0 * minimum, "ubar_max": 2.0 * maximum,
+                "vbar": -mean, "vbar_min": -maximum, "vbar_max": -minimum}
+
+    filename = "diagnostic_reducer.nc"
+    try:
+        f = PISM.util.prepare_output(filename)
+        reducer.write(f, PISM.PISM_DOUBLE)
+        f.close()
+
+        for name, value in expected.items():
+            w = PISM.IceModelVec2S(coarse_grid, name, PISM.WITHOUT_GHOSTS)
+            w.set_attrs("testing", "test field", "m", "m", "", 0)
+            w.read(filename, 0)
+
+            np.testing.assert_almost_equal(w.numpy(), value[::2, ::2])
+    finally:
+        os.remove(filename)
 
 def interpolation_weights_test():
     "Test 2D interpolation weights."
@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+"""Tests of the distance computation used by PICO (PISM.eikonal_equation).
+
+Compares results to a breadth-first search. Run using more than one MPI process to test
+propagation of distances across sub-domain boundaries.
+"""
+
+import PISM
+import numpy as np
+
+ctx = PISM.Context()
+
+Mx = 37
+My = 29
+
+def grid():
+    return PISM.IceGrid.Shallow(ctx.ctx, 1, 1, 0, 0, Mx, My,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+def reference(mask):
+    "Compute distances using a breadth-first search."
+    result = np.array(mask, dtype=int)
+
+    front = [(j, i) for j in range(My) for i in range(Mx) if result[j, i] == 1]
+    while front:
+        next_front = []
+        for p in front:
+            for q in [(p[0] - 1, p[1]), (p[0] + 1, p[1]), (p[0], p[1] - 1), (p[0], p[1] + 1)]:
+                if 0 <= q[0] < My and 0 <= q[1] < Mx and result[q] == 0:
+                    result[q] = result[p] + 1
+                    next_front.append(q)
+        front = next_front
+
+    return result
+
+def run(mask):
+    g = grid()
+    m = PISM.IceModelVec2Int(g, "mask", PISM.WITH_GHOSTS)
+
+    with PISM.vec.Access(nocomm=m):
+        for (i, j) in g.points():
+            m[i, j] = mask[j, i]
+    m.update_ghosts()
+
+    PISM.eikonal_equation(m)
+
+    return m.numpy()
+
+def check(mask):
+    # cells at the edge of the grid are outside the domain (ghosts are periodic)
+    mask[0, :] = -1
+    mask[-1, :] = -1
+    mask[:, 0] = -1
+    mask[:, -1] = -1
+
+    result = run(mask)
+    if ctx.rank == 0:
+        np.testing.assert_equal(result, reference(mask))
+
+def random_test():
+    "Distances in a domain with random holes"
+    np.random.seed(1)
+    mask = np.zeros((My, Mx))
+    mask[np.random.rand(My, Mx) < 0.3] = -1
+    mask[np.random.rand(My, Mx) < 0.02] = 1
+    check(mask)
+
+def spiral_test():
+    "A path crossing all sub-domain boundaries many times"
+    mask = -np.ones((My, Mx))
+    mask[1::2, 1:-1] = 0
+    mask[2::4, -2] = 0
+    mask[4::4, 1] = 0
+    mask[1, 1] = 1
+    check(mask)
@@ -0,0 +1,40 @@
+#!/bin/bash
+
+echo "Asynchronous output: snapshots, spatial time-series and backups match synchronous output."
+PISM_PATH=$1
+MPIEXEC=$2
+
+files="sync-async-output.nc sync-async-output_backup.nc sync-snapshots.nc sync-extra.nc
+async-async-output.nc async-async-output_backup.nc async-snapshots.nc async-extra.nc"
+
+rm -f $files
+
+set -e -x
+
+OPTS="-Mx 31 -My 31 -Mz 11 -y 1000 -max_dt 100 -o_size small \
+      -save_times 200:200:1000 -save_size medium \
+      -extra_times 0:100:1000 -extra_vars thk,topg,usurf,velsurf_mag,temp \
+      -backup_interval 0 -backup_size small"
+
+# synchronous output
+$MPIEXEC -n 2 $PISM_PATH/pisms $OPTS \
+         -save_file sync-snapshots.nc -extra_file sync-extra.nc -o sync-async-output.nc
+
+# asynchronous output (backups are written after every time step, so at most
+# output.async.max_pending files are waiting to be written most of the time)
+$MPIEXEC -n 2 $PISM_PATH/pisms $OPTS -async_output \
+         -save_file async-snapshots.nc -extra_file async-extra.nc -o async-async-output.nc
+
+set +e
+
+# compare all variables except for the ones containing wall clock times
+for suffix in async-output.nc async-output_backup.nc snapshots.nc extra.nc;
+do
+  $PISM_PATH/nccmp.py -x -v timestamp,run_stats sync-$suffix async-$suffix
+  if [ $? != 0 ];
+  then
+    exit 1
+  fi
+done
+
+rm -f $files; exit 0
@@ -10,6 +10,9 @@ Compares results of
   * re-initializing
   * one more 1000 year step
 
+If PISM was built with FFTW's MPI interface, also compares serial and distributed versions
+of the model.
+
 Used as a regression test for PISM.LingleClark.
 """
 
@@ -118,3 +121,36 @@ def lingle_clark_restart_test():
     "Compare straight and re-started runs."
     compare(run(dt),
             run(dt, restart=True))
+
+
+def lingle_clark_asynchronous_restart_test():
+    "Compare straight and re-started runs (asynchronous updates)."
+    ctx.config.set_flag("bed_deformation.lc.asynchronous", True)
+    try:
+        compare(run(dt),
+                run(dt, restart=True))
+    finally:
+        ctx.config.set_flag("bed_deformation.lc.asynchronous", False)
+
+
+def lingle_clark_distributed_test():
+    "Compare serial and distributed versions of the model."
+    if not PISM.Pism_USE_FFTW_MPI:
+        return
+
+    serial = run(dt)
+
+    ctx.config.set_flag("bed_deformation.lc.distributed", True)
+    try:
+        distributed = run(dt)
+    finally:
+        ctx.config.set_flag("bed_deformation.lc.distributed", False)
+
+    for name in ["total_displacement", "viscous_displacement", "elastic_displacement"]:
+        v1 = getattr(serial, name)()
+        v2 = getattr(distributed, name)()
+        print("Comparing {}".format(v1.get_name()))
+        np.testing.assert_allclose(v1.numpy(), v2.numpy(), rtol=1e-10, atol=1e-8)
+
+    np.testing.assert_allclose(serial.elastic_load_response_matrix().numpy(),
+                               distributed.elastic_load_response_matrix().numpy())
@@ -1,6 +1,7 @@
 import PISM
 import PISM.testing
 import os
+import numpy as np
 from unittest import TestCase, SkipTest
 
 # always available
@@ -25,7 +26,8 @@ backend_names = {PISM.PISM_NETCDF3 : "netcdf3",
                  PISM.PISM_PIO_NETCDF : "pio_netcdf",
                  PISM.PISM_PIO_NETCDF4P : "pio_netcdf4p",
                  PISM.PISM_PIO_NETCDF4C : "pio_netcdf4c",
-                 PISM.PISM_PIO_PNETCDF: "pio_pnetcdf"}
+                 PISM.PISM_PIO_PNETCDF: "pio_pnetcdf",
+                 PISM.PISM_NATIVE: "native"}
 
 def fail(backend):
     assert False, "test failed (backend = {})".format(backend_names[backend])
@@ -500,6 +502,71 @@ class File(TestCase):
             assert f.read_text_attribute("PISM_GLOBAL", "history") == "twoone"
             f.close()
 
+    def test_metadata_cache(self):
+        "File: cached metadata are updated when metadata change"
+        for backend in backends:
+            f = PISM.File(ctx.com(), self.file_with_time, backend, PISM.PISM_READWRITE,
+                          ctx.pio_iosys_id())
+            variable_name = "new_variable_{}".format(backend)
+            dimension_name = "new_dimension_{}".format(backend)
+            n_variables = f.nvariables()
+            n_records = f.nrecords()
+
+            # query everything first (these answers are cached)...
+            assert not f.find_variable(variable_name)
+            assert not f.find_dimension(dimension_name)
+            assert f.read_text_attribute("v", "test_attribute") == ""
+            assert f.attribute_type("v", "test_attribute") == PISM.PISM_NAT
+
+            # ... then change metadata and make sure that answers change as well
+            f.define_dimension(dimension_name, 2)
+            f.define_variable(variable_name, PISM.PISM_DOUBLE, [dimension_name])
+            f.write_attribute("v", "test_attribute", "one")
+
+            assert f.find_dimension(dimension_name)
+            assert f.dimension_length(dimension_name) == 2
+            assert f.find_variable(variable_name)
+            assert f.dimensions(variable_name) == (dimension_name,)
+            assert f.nvariables() == n_variables + 1
+            assert f.read_text_attribute("v", "test_attribute") == "one"
+
+            f.write_attribute("v", "test_attribute", "two")
+            assert f.read_text_attribute("v", "test_attribute") == "two"
+
+            f.remove_attribute("v", "test_attribute")
+            assert f.attribute_type("v", "test_attribute") == PISM.PISM_NAT
+
+            # writing to a new record increases the number of records
+            f.write_variable("time", [n_records], [1], [1.0 * n_records])
+            assert f.nrecords() == n_records + 1
+
+            f.close()
+
+    def test_was_written(self):
+        "File.was_written(), File.mark_as_written()"
+        for backend in backends:
+            f = PISM.File(ctx.com(), self.file_with_time, backend, PISM.PISM_READWRITE,
+                          ctx.pio_iosys_id())
+            variable_name = "time_independent_{}".format(backend)
+            f.define_variable(variable_name, PISM.PISM_DOUBLE, [])
+            f.write_attribute(variable_name, "not_written", PISM.PISM_INT, [1.0])
+
+            assert not f.was_written(variable_name)
+            f.mark_as_written(variable_name)
+            assert f.was_written(variable_name)
+
+            # the attribute is removed by sync() (or close())
+            assert f.attribute_type(variable_name, "not_written") == PISM.PISM_INT
+            f.sync()
+            assert f.attribute_type(variable_name, "not_written") == PISM.PISM_NAT
+            f.close()
+
+            # variables without the attribute were written
+            f = PISM.File(ctx.com(), self.file_with_time, backend, PISM.PISM_READONLY,
+                          ctx.pio_iosys_id())
+            assert f.was_written(variable_name)
+            f.close()
+
     def setUp(self):
         self.file_with_time = "test_file_with_time.nc"
         self.file_without_time = "test_file_without_time.nc"
@@ -573,6 +640,222 @@ class File(TestCase):
             os.remove(f)
             pass
 
+class NativeFormat(TestCase):
+    "Test writing and reading files in PISM's native format."
+
+    def test_round_trip(self):
+        "Write and read a field using the native format"
+
+        for backend in [PISM.PISM_GUESS, PISM.PISM_NETCDF3]:
+            # native files are recognized regardless of the backend
+            f = PISM.File(ctx.com(), self.filename, backend, PISM.PISM_READONLY)
+            assert f.backend() == PISM.PISM_NATIVE
+            assert f.nrecords() == 1
+            assert f.read_text_attribute("v", "long_name") == "dummy variable for testing"
+            f.close()
+
+            self.vec.set(0.0)
+            self.vec.read(self.filename, 0)
+            np.testing.assert_equal(self.vec.numpy(), self.values)
+
+    def test_corrupted_file(self):
+        "Checksum mismatches are errors"
+
+        with open(self.filename, "r+b") as f:
+            # the 40 byte preamble (containing the offset of the header) is followed by data
+            f.seek(16)
+            header_offset = np.frombuffer(f.read(8), dtype=np.uint64)[0]
+            f.seek(40)
+            f.write(b"\xff" * int(header_offset - 40))
+
+        try:
+            self.vec.read(self.filename, 0)
+            assert False, "failed to detect a corrupted file"
+        except RuntimeError:
+            pass
+
+    def setUp(self):
+        self.filename = "test_native_file.nc"
+        grid = PISM.testing.shallow_grid()
+
+        self.vec = PISM.IceModelVec2S(grid, "v", PISM.WITHOUT_GHOSTS)
+        self.vec.set_attrs("testing", "dummy variable for testing", "Kelvin", "Kelvin", "", 0)
+
+        with PISM.vec.Access(nocomm=self.vec):
+            for (i, j) in grid.points():
+                self.vec[i, j] = 10 * i + j
+        self.values = self.vec.numpy()
+
+        format = ctx.config().get_string("output.format")
+        try:
+            ctx.config().set_string("output.format", "native")
+            self.vec.dump(self.filename)
+        finally:
+            ctx.config().set_string("output.format", format)
+
+    def tearDown(self):
+        os.remove(self.filename)
+
+class TransposedRead(TestCase):
+    "Test reading variables stored using a different order of dimensions."
+
+    # sizes of the 3D test variable; Mx and Mz exceed the tile size (16) used by
+    # io::transpose()
+    Mx = 20
+    My = 3
+    Mz = 18
+    Nt = 2
+
+    def value_3d(self, t, k, j, i):
+        "Value of the 3D test variable at the record t and the grid point (i, j, k)."
+        return i + self.Mx * (j + self.My * (k + self.Mz * t))
+
+    def grid_3d(self):
+        "Grid matching the 3D test variable."
+        P = PISM.GridParameters(ctx.config())
+        P.Lx = 0.5 * (self.Mx - 1) * 1000.0
+        P.Ly = 0.5 * (self.My - 1) * 1000.0
+        P.x0 = 0.0
+        P.y0 = 0.0
+        P.Mx = self.Mx
+        P.My = self.My
+        P.registration = PISM.CELL_CORNER
+        P.periodicity = PISM.NOT_PERIODIC
+        P.z = PISM.DoubleVector([100.0 * k for k in range(self.Mz)])
+        P.ownership_ranges_from_options(ctx.size())
+
+        return PISM.IceGrid(ctx, P)
+
+    def test_read_transposed(self):
+        "Read a variable stored as v(x, y)"
+        grid = PISM.testing.shallow_grid()
+
+        for backend in backends:
+            f = PISM.File(ctx.com(), self.filename, backend, PISM.PISM_READONLY,
+                          ctx.pio_iosys_id())
+
+            v = PISM.IceModelVec2S(grid, "v", PISM.WITHOUT_GHOSTS)
+            v.set_attrs("testing", "transposed variable", "Kelvin", "Kelvin", "", 0)
+            v.regrid(f, PISM.CRITICAL)
+            f.close()
+
+            with PISM.vec.Access(nocomm=v):
+                for (i, j) in grid.points():
+                    if v[i, j] != 10 * i + j:
+                        fail(backend)
+
+    def test_read_transposed_3d(self):
+        "Read all records of a variable stored as v(time, z, y, x)"
+        grid = self.grid_3d()
+
+        for backend in backends:
+            f = PISM.File(ctx.com(), self.filename_3d, backend, PISM.PISM_READONLY,
+                          ctx.pio_iosys_id())
+
+            v = PISM.IceModelVec3(grid, "v", PISM.WITHOUT_GHOSTS)
+            v.set_attrs("testing", "transposed variable", "Kelvin", "Kelvin", "", 0)
+
+            for t in range(self.Nt):
+                v.read(f, t)
+
+                with PISM.vec.Access(nocomm=v):
+                    for (i, j) in grid.points():
+                        for k in range(self.Mz):
+                            if v[i, j, k] != self.value_3d(t, k, j, i):
+                                fail(backend)
+            f.close()
+
+    def ncgen(self, basename, cdl):
+        "Create basename.nc using the CDL text cdl."
+        with open(basename + ".cdl", "w") as f:
+            f.write(cdl)
+
+        status = os.system("ncgen -o %s.nc %s.cdl" % (basename, basename))
+        assert status == 0, "ncgen failed to create %s.nc" % basename
+
+    def setUp(self):
+        self.basename = "transposed_read_test"
+        self.filename = self.basename + ".nc"
+
+        # the same grid as PISM.testing.shallow_grid()
+        values = ", ".join(str(10 * i + j) for i in range(3) for j in range(5))
+        cdl = """
+netcdf transposed_read_test {{
+dimensions:
+  x = 3 ;
+  y = 5 ;
+variables:
+  double x(x) ;
+    x:units = "m" ;
+    x:axis = "X" ;
+  double y(y) ;
+    y:units = "m" ;
+    y:axis = "Y" ;
+  double v(x, y) ;
+    v:units = "Kelvin" ;
+data:
+  x = -10000, 0, 10000 ;
+  y = -20000, -10000, 0, 10000, 20000 ;
+  v = {0} ;
+}}
+""".format(values)
+        self.ncgen(self.basename, cdl)
+
+        self.basename_3d = "transposed_read_test_3d"
+        self.filename_3d = self.basename_3d + ".nc"
+
+        def coords(M, dx):
+            return ", ".join(str((k - 0.5 * (M - 1)) * dx) for k in range(M))
+
+        values = ", ".join(str(self.value_3d(t, k, j, i))
+                           for t in range(self.Nt)
+                           for k in range(self.Mz)
+                           for j in range(self.My)
+                           for i in range(self.Mx))
+        cdl = """
+netcdf transposed_read_test_3d {{
+dimensions:
+  time = UNLIMITED ;
+  x = {Mx} ;
+  y = {My} ;
+  z = {Mz} ;
+variables:
+  double time(time) ;
+    time:units = "seconds since 1-1-1" ;
+    time:axis = "T" ;
+  double x(x) ;
+    x:units = "m" ;
+    x:axis = "X" ;
+  double y(y) ;
+    y:units = "m" ;
+    y:axis = "Y" ;
+  double z(z) ;
+    z:units = "m" ;
+    z:axis = "Z" ;
+    z:positive = "up" ;
+  double v(time, z, y, x) ;
+    v:units = "Kelvin" ;
+data:
+  time = {time} ;
+  x = {x} ;
+  y = {y} ;
+  z = {z} ;
+  v = {v} ;
+}}
+""".format(Mx=self.Mx, My=self.My, Mz=self.Mz,
+           time=", ".join(str(t) for t in range(self.Nt)),
+           x=coords(self.Mx, 1000.0),
+           y=coords(self.My, 1000.0),
+           z=", ".join(str(100.0 * k) for k in range(self.Mz)),
+           v=values)
+        self.ncgen(self.basename_3d, cdl)
+
+    def tearDown(self):
+        for basename in [self.basename, self.basename_3d]:
+            for ext in [".nc", ".cdl"]:
+                if os.path.exists(basename + ext):
+                    os.remove(basename + ext)
+
 class StringAttribute(TestCase):
     "Test reading a NetCDF-4 string attribute."
 
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Reading several records of a forcing field in one call (IceModelVec2T::update()) gives
+the same result as reading them one record at a time, even if sub-domains have different
+sizes.
+
+Run using 2 MPI processes.
+"""
+
+import numpy as np
+import os
+import sys
+import PISM
+
+ctx = PISM.Context()
+
+# use the 360-day calendar so that all records have the same length
+ctx.ctx.time().init_calendar("360_day")
+
+# suppress all output
+ctx.log.set_threshold(1)
+
+Mx = 7
+My = 5
+N = 6                           # number of records
+dt = 30.0                       # record length, days
+units = "days since 1-1-1"
+
+def create_grid(procs_x=None):
+    "Create a grid, using ownership ranges `procs_x` in the X direction if given."
+    params = PISM.GridParameters(ctx.config)
+    params.Lx = 3e3
+    params.Ly = 2e3
+    params.x0 = 0.0
+    params.y0 = 0.0
+    params.Mx = Mx
+    params.My = My
+    params.registration = PISM.CELL_CORNER
+    params.periodicity = PISM.NOT_PERIODIC
+    params.z = PISM.DoubleVector([0.0, 1000.0])
+
+    if procs_x is None:
+        params.ownership_ranges_from_options(ctx.size)
+    else:
+        params.procs_x = PISM.UnsignedIntVector(procs_x)
+        params.procs_y = PISM.UnsignedIntVector([My])
+
+    return PISM.IceGrid(ctx.ctx, params)
+
+def value(i, j, k):
+    "Value of the test field at the grid point (i, j) in the record k"
+    return 10.0 * i + j + 100.0 * k
+
+def write_input(filename):
+    "Write a time-dependent field with N records."
+    grid = create_grid()
+
+    v = PISM.IceModelVec2S(grid, "v", PISM.WITHOUT_GHOSTS)
+    v.set_attrs("testing", "test field", "m", "m", "", 0)
+
+    bounds = PISM.TimeBoundsMetadata("time_bounds", "time", ctx.unit_system)
+    bounds.set_string("units", units)
+
+    output = PISM.util.prepare_output(filename, append_time=False)
+    output.write_attribute("time", "units", units)
+    output.write_attribute("time", "bounds", "time_bounds")
+
+    tb = np.r_[0:N + 1] * dt
+    for k in range(N):
+        PISM.append_time(output, "time", tb[k + 1])
+        PISM.write_time_bounds(output, bounds, k, (tb[k], tb[k + 1]))
+
+        with PISM.vec.Access(nocomm=v):
+            for (i, j) in grid.points():
+                v[i, j] = value(i, j, k)
+        v.write(output)
+
+    output.close()
+
+def forcing(grid, filename, buffer_size):
+    "Allocate and initialize a forcing field"
+    input_file = PISM.File(ctx.com, filename, PISM.PISM_NETCDF3, PISM.PISM_READONLY)
+    result = PISM.IceModelVec2T.ForcingField(grid, input_file, "v", "",
+                                             buffer_size, 52, False)
+    result.metadata().set_string("long_name", "test field")
+    result.init(filename, 0, 0)
+
+    return result
+
+def main():
+    if ctx.size != 2:
+        print("This test has to use 2 MPI processes")
+        sys.exit(1)
+
+    filename = "forcing_records_input.nc"
+    write_input(filename)
+
+    try:
+        # rank 0 owns the smaller sub-domain, so the buffer it uses to read one record
+        # (sized using the largest sub-domain) is bigger than one record it owns
+        grid = create_grid(procs_x=[2, Mx - 2])
+
+        seconds_per_day = 86400.0
+        # times in the middle of each record
+        times = (np.r_[0:N] + 0.5) * dt * seconds_per_day
+
+        # read all records in one call
+        all_records = forcing(grid, filename, N)
+        all_records.update(0.0, N * dt * seconds_per_day)
+        all_records.init_interpolation(PISM.DoubleVector(list(times)))
+
+        # read records one at a time
+        one_record = forcing(grid, filename, 1)
+
+        failed = False
+        with PISM.vec.Access(nocomm=[all_records]):
+            multi = {(i, j): all_records.interp(i, j) for (i, j) in grid.points()}
+
+        for k, t in enumerate(times):
+            one_record.update(t, 1.0)
+            one_record.interp(t)
+
+            with PISM.vec.Access(nocomm=[one_record]):
+                for (i, j) in grid.points():
+                    single = one_record[i, j]
+                    if multi[(i, j)][k] != single or not np.isclose(single, value(i, j, k)):
+                        print("rank {}: record {} at ({}, {}): {} (one call) != {} (one record) or {} (expected)".format(
+                            ctx.rank, k, i, j, multi[(i, j)][k], single, value(i, j, k)))
+                        failed = True
+
+        failed = PISM.GlobalMax(ctx.com, 1.0 if failed else 0.0) > 0.0
+    finally:
+        if ctx.rank == 0:
+            os.remove(filename)
+
+    sys.exit(1 if failed else 0)
+
+if __name__ == "__main__":
+    main()
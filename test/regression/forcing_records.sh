@@ -0,0 +1,15 @@
+#!/bin/bash
+
+echo "Reading several records of a forcing field at once using 2 processes."
+PISM_PATH=$1
+MPIEXEC=$2
+PISM_SOURCE_DIR=$3
+if [ $# -ge 4 ] && [ "$4" == "-python" ]
+then
+  PYTHONEXEC=$5
+  export PYTHONPATH=${PISM_PATH}/site-packages:${PYTHONPATH}
+fi
+
+set -e -x
+
+$MPIEXEC -n 2 ${PYTHONEXEC:-python} $PISM_SOURCE_DIR/test/regression/forcing_records.py
@@ -0,0 +1,23 @@
+#!/bin/bash
+
+# Compares the ghost update of several fields packed into one vector and the non-blocking
+# ghost update to updating ghosts of each field separately and checks that PointsInterior
+# and PointsBoundary visit each owned point once, using several grid sizes and numbers of
+# processes.
+
+PISM_PATH=$1
+MPIEXEC=$2
+PISM_SOURCE_DIR=$3
+
+set -e -x
+
+for n in 1 2 3 4;
+do
+  # small grids produce sub-domains narrower than twice the stencil width
+  for grid in "-Mx 5 -My 7" "-Mx 11 -My 6" "-Mx 23 -My 31";
+  do
+    $MPIEXEC -n $n $PISM_PATH/ghost_update_test $grid -Mz 5 -verbose 1
+  done
+done
+
+exit 0
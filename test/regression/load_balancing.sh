@@ -0,0 +1,92 @@
+#!/bin/bash
+
+# Tests GridParameters::balance_ownership_ranges() using a known ice thickness field: new
+# ownership ranges have to cover the grid, respect the minimum sub-domain size and reduce
+# the estimated work imbalance.
+
+PISM_PATH=$1
+MPIEXEC=$2
+PISM_SOURCE_DIR=$3
+PYTHONEXEC=$5
+export PYTHONPATH=${PISM_PATH}/site-packages:${PYTHONPATH}
+
+files="load_balancing_test.py load_balancing_input.nc"
+
+rm -f $files
+
+set -e -x
+
+cat > load_balancing_test.py <<END
+import PISM
+from sys import exit
+
+ctx = PISM.Context()
+config = ctx.config
+
+Mx, My = 41, 31
+input_file = "load_balancing_input.nc"
+
+def icy(i, j):
+    "Ice covers one corner of the domain."
+    return i < Mx // 4 and j < My // 3
+
+P = PISM.GridParameters(config)
+P.Mx = Mx
+P.My = My
+P.ownership_ranges_from_options(ctx.size)
+grid = PISM.IceGrid(ctx.ctx, P)
+
+thickness = PISM.model.createIceThicknessVec(grid)
+with PISM.vec.Access(nocomm=[thickness]):
+    for (i, j) in grid.points():
+        thickness[i, j] = 1000.0 if icy(i, j) else 0.0
+thickness.dump(input_file)
+
+uniform_x = list(P.procs_x)
+uniform_y = list(P.procs_y)
+
+f = PISM.File(ctx.com, input_file, PISM.PISM_NETCDF3, PISM.PISM_READONLY)
+P.balance_ownership_ranges(ctx.ctx, f)
+f.close()
+
+balanced_x = list(P.procs_x)
+balanced_y = list(P.procs_y)
+
+def imbalance(procs_x, procs_y):
+    "Largest amount of work per processor divided by the mean (see IceGrid.cc)."
+    Mz = len(P.z)
+    work = []
+    y_start = 0
+    for ny in procs_y:
+        x_start = 0
+        for nx in procs_x:
+            work.append(sum(Mz if icy(i, j) else 1
+                            for i in range(x_start, x_start + nx)
+                            for j in range(y_start, y_start + ny)))
+            x_start += nx
+        y_start += ny
+    return max(work) / (sum(work) / float(len(work)))
+
+min_size = max(2, int(config.get_number("grid.max_stencil_width")))
+
+before = imbalance(uniform_x, uniform_y)
+after = imbalance(balanced_x, balanced_y)
+
+print("procs_x: {} -> {}".format(uniform_x, balanced_x))
+print("procs_y: {} -> {}".format(uniform_y, balanced_y))
+print("imbalance: {} -> {}".format(before, after))
+
+assert len(balanced_x) == len(uniform_x)
+assert len(balanced_y) == len(uniform_y)
+assert sum(balanced_x) == Mx
+assert sum(balanced_y) == My
+assert min(balanced_x) >= min_size
+assert min(balanced_y) >= min_size
+assert after < before
+
+exit(0)
+END
+
+$MPIEXEC -n 4 $PYTHONEXEC load_balancing_test.py
+
+rm -f $files; exit 0
@@ -0,0 +1,56 @@
+#!/bin/bash
+
+echo "Multi-rate time stepping for energy and age models."
+PISM_PATH=$1
+MPIEXEC=$2
+
+files="input-multirate.nc default-multirate.nc one-step-multirate.nc n-steps-multirate.nc n-steps-multirate.log"
+
+OPTS="-Mx 21 -My 21 -Mz 11 -age -o_size small"
+
+set -e -x
+
+rm -f $files
+
+# generate an interesting file
+$PISM_PATH/pisms $OPTS -y 5000 -max_dt 500.0 -o input-multirate.nc
+
+# reference run: energy and age are updated every step
+$MPIEXEC -n 2 $PISM_PATH/pisms -i input-multirate.nc $OPTS -y 200 -o default-multirate.nc
+
+# multi-rate time stepping, updating energy and age every step
+$MPIEXEC -n 2 $PISM_PATH/pisms -i input-multirate.nc $OPTS -y 200 \
+         -multirate -multirate_steps 1 -o one-step-multirate.nc
+
+# multi-rate time stepping, updating energy and age every 20 steps
+$MPIEXEC -n 2 $PISM_PATH/pisms -i input-multirate.nc $OPTS -y 200 \
+         -multirate -multirate_steps 20 -verbose 3 -o n-steps-multirate.nc > n-steps-multirate.log
+
+set +e
+
+# -multirate_steps 1 reproduces the default run (forcing "averaged" over one step
+# differs by round-off only)
+$PISM_PATH/nccmp.py -v enthalpy,age,thk -r -t 1e-10 default-multirate.nc one-step-multirate.nc
+if [ $? != 0 ];
+then
+    exit 1
+fi
+
+# the time step of energy and age models does not exceed the 3D CFL limit (computed
+# using velocities at the end of the step, hence the tolerance)
+awk '/multi-rate: updating energy and age/ {
+       gsub(/[(),;]/, " ");
+       n_updates += 1;
+       if ($7 > 1) { n_long += 1 }
+       if ($14 > 0 && $9 > 1.01 * $14) { print "3D CFL limit exceeded:", $0; failed = 1 }
+     }
+     END {
+       if (n_updates == 0 || n_long == 0) { print "no multi-rate updates found"; failed = 1 }
+       exit failed
+     }' n-steps-multirate.log
+if [ $? != 0 ];
+then
+    exit 1
+fi
+
+rm -f $files; exit 0
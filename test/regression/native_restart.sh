@@ -0,0 +1,41 @@
+#!/bin/bash
+
+echo "Restarting from a file in the native format using a different number of processes."
+PISM_PATH=$1
+MPIEXEC=$2
+
+files="netcdf-native-restart.nc native-native-restart.nc
+netcdf-1-native-restart.nc native-1-native-restart.nc
+netcdf-3-native-restart.nc native-3-native-restart.nc"
+
+rm -f $files
+
+set -e -x
+
+OPTS="-energy enthalpy -Mx 31 -My 41 -o_size small"
+
+# the same run saving the result in the NetCDF-3 and native formats
+$MPIEXEC -n 2 $PISM_PATH/pisms $OPTS -y 1000 -o netcdf-native-restart.nc
+$MPIEXEC -n 2 $PISM_PATH/pisms $OPTS -y 1000 -o_format native -o native-native-restart.nc
+
+# restart from both using 1 and 3 processes (i.e. a different domain decomposition)
+for N in 1 3;
+do
+  $MPIEXEC -n $N $PISM_PATH/pismr -i netcdf-native-restart.nc -y 0 -o_size small \
+           -o netcdf-$N-native-restart.nc
+  $MPIEXEC -n $N $PISM_PATH/pismr -i native-native-restart.nc -y 0 -o_size small \
+           -o native-$N-native-restart.nc
+done
+
+set +e
+
+for N in 1 3;
+do
+  $PISM_PATH/nccmp.py -x -v timestamp netcdf-$N-native-restart.nc native-$N-native-restart.nc
+  if [ $? != 0 ];
+  then
+    exit 1
+  fi
+done
+
+rm -f $files; exit 0
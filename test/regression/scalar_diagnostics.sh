@@ -0,0 +1,103 @@
+#!/bin/bash
+
+echo "Scalar diagnostics computed in one pass match functions in geometry/Geometry.cc."
+PISM_PATH=$1
+MPIEXEC=$2
+PISM_SOURCE_DIR=$3
+if [ $# -ge 4 ] && [ "$4" == "-python" ]
+then
+  PYTHONEXEC=$5
+  export PYTHONPATH=${PISM_PATH}/site-packages:${PYTHONPATH}
+fi
+
+files="input-scalar-diagnostics.nc output-scalar-diagnostics.nc ts-scalar-diagnostics.nc"
+
+rm -f $files
+
+set -e -x
+
+grid="-Mx 31 -My 31 -Mz 11 -Lz 5000"
+
+# create an ice sheet
+$PISM_PATH/pisms $grid -y 3000 -o input-scalar-diagnostics.nc -verbose 1
+
+# tilt the bed so that parts of the ice sheet are grounded below sea level and parts are
+# floating
+${PYTHONEXEC:-python} <<EOF
+from netCDF4 import Dataset
+import numpy as np
+
+with Dataset("input-scalar-diagnostics.nc", "a") as f:
+    x = f.variables["x"][:]
+    topg = f.variables["topg"]
+    topg[:] = np.zeros(topg.shape) + (-1000.0 * x / x.max())[np.newaxis, np.newaxis, :]
+EOF
+
+ts_vars=ice_volume,ice_volume_glacierized,ice_mass,ice_area_glacierized,\
+ice_area_glacierized_grounded,ice_area_glacierized_floating,limnsw,sea_level_rise_potential
+
+$MPIEXEC -n 2 $PISM_PATH/pismr -i input-scalar-diagnostics.nc -bootstrap $grid \
+         -stress_balance none -energy none -part_grid \
+         -ys 0 -y 10 -ts_file ts-scalar-diagnostics.nc -ts_times 0:1:10 -ts_vars $ts_vars \
+         -o output-scalar-diagnostics.nc -o_size big -verbose 1
+
+set +e
+
+# compare the last record of each time series to the function in Geometry.cc applied to
+# the final model state
+${PYTHONEXEC:-python} <<EOF
+import PISM
+from netCDF4 import Dataset
+from sys import exit
+
+ctx = PISM.Context()
+config = ctx.config
+config.set_flag("geometry.part_grid.enabled", True)
+
+grid = PISM.IceGrid.FromFile(ctx.ctx, "output-scalar-diagnostics.nc", ["thk"],
+                             PISM.CELL_CENTER)
+
+geometry = PISM.Geometry(grid)
+
+geometry.ice_thickness.regrid("output-scalar-diagnostics.nc", PISM.CRITICAL)
+geometry.bed_elevation.regrid("output-scalar-diagnostics.nc", PISM.CRITICAL)
+geometry.cell_type.regrid("output-scalar-diagnostics.nc", PISM.CRITICAL)
+geometry.sea_level_elevation.regrid("output-scalar-diagnostics.nc", PISM.OPTIONAL, 0.0)
+geometry.ice_area_specific_volume.regrid("output-scalar-diagnostics.nc", PISM.OPTIONAL, 0.0)
+
+threshold = config.get_number("output.ice_free_thickness_standard")
+rho_i = config.get_number("constants.ice.density")
+
+expected = {
+    "ice_volume"                    : PISM.ice_volume(geometry, 0.0),
+    "ice_volume_glacierized"        : PISM.ice_volume(geometry, threshold),
+    "ice_mass"                      : rho_i * PISM.ice_volume(geometry, 0.0),
+    "ice_area_glacierized"          : PISM.ice_area(geometry, threshold),
+    "ice_area_glacierized_grounded" : PISM.ice_area_grounded(geometry, threshold),
+    "ice_area_glacierized_floating" : PISM.ice_area_floating(geometry, threshold),
+    "limnsw"                        : rho_i * PISM.ice_volume_not_displacing_seawater(geometry,
+                                                                                      threshold),
+    "sea_level_rise_potential"      : PISM.sea_level_rise_potential(geometry, threshold),
+}
+
+# make sure that the geometry is not trivial
+assert expected["ice_area_glacierized_grounded"] > 0.0
+assert expected["ice_area_glacierized_floating"] > 0.0
+
+failed = False
+with Dataset("ts-scalar-diagnostics.nc") as f:
+    for name, value in expected.items():
+        computed = f.variables[name][-1]
+        print("%s: computed %e, expected %e" % (name, computed, value))
+        if abs(computed - value) > 1e-12 * max(abs(value), 1.0):
+            print("%s does not match" % name)
+            failed = True
+
+exit(1 if failed else 0)
+EOF
+if [ $? != 0 ];
+then
+    exit 1
+fi
+
+rm -f $files; exit 0